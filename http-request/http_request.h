@@ -7,6 +7,28 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "http_request_json_stream_parser.h"
+#import "http_request_cache.h"
+#import "http_request_metrics.h"
+#import "http_request_batch.h"
+#import "http_request_download.h"
+#import "http_request_retry_policy.h"
+#import "http_request_scheduler.h"
+#import "http_request_compression.h"
+#import "http_request_json_codec.h"
+#import "http_request_media_type.h"
+#import "http_request_parser_registry.h"
+#import "http_request_msgpack.h"
+#import "http_request_cbor.h"
+#import "http_request_future.h"
+#import "http_request_descriptor.h"
+#import "http_request_header_templates.h"
+#import "http_request_recording.h"
+#import "http_request_recorder.h"
+#import "http_request_replay_protocol.h"
+#import "http_request_circuit_breaker.h"
+#import "http_request_hedging_policy.h"
+#import "http_request_multipart_body.h"
 
 #define kHttpRequestDomain              @"http-request"
 
@@ -18,6 +40,11 @@
 #define kPutHttpMethod                  @"PUT"
 #define kPostHttpMethod                 @"POST"
 #define kDeleteHttpMethod               @"DELETE"
+#define kHeadHttpMethod                 @"HEAD"
+
+#define kDefaultStreamBufferLimit       (1024 * 1024)
+
+#define kHttpRequestDeadlineKey         @"http_request_deadline"
 
 /**
  *  http_request is an iOS light-weight library that simplifies asynchronous HTTP operations.
@@ -42,6 +69,107 @@
  */
 @property (copy) BOOL (^responseValidator)(NSURLResponse *, id body, NSError *__autoreleasing *);
 
+/**
+ *  The queue on which the body parser and the response validator run. Defaults to a concurrent queue limited to the
+ *  number of active processors; when nil they run inline on the session delegate queue.
+ */
+@property (strong) NSOperationQueue *parsingQueue;
+
+/**
+ *  The queue on which the success and error callbacks are called. When nil (the default) they are called one at a
+ *  time on the serial session delegate queue, whereas parsing and validation may run concurrently on the parsing queue.
+ */
+@property (strong) NSOperationQueue *callbackQueue;
+
+/**
+ *  The response cache used for GET requests issued through issueAsync. Optional (the default), can be nil.
+ *  Fresh entries are served without contacting the server, in which case the returned task is never resumed; stale
+ *  entries are revalidated through a conditional request and served again upon a 304.
+ */
+@property (strong) http_request_cache *cache;
+
+/**
+ *  The sink to which the metrics of every completed request are pushed, e.g. an http_request_metrics_collector.
+ *  Optional, can be nil; no metrics are gathered when nil.
+ */
+@property (strong) id<http_request_metrics_sink> metricsSink;
+
+/**
+ *  The registry through which the default bodyParser dispatches response bodies by media type; register a parser in
+ *  it to support another format without replacing the bodyParser.
+ */
+@property (strong) http_request_parser_registry *parserRegistry;
+
+/**
+ *  The templates of headers (e.g. authorization and tracing) added to the requests issued, uploaded, downloaded or
+ *  streamed, by host or base URL; headers set on a request take precedence.
+ */
+@property (strong) http_request_header_templates *headerTemplates;
+
+/**
+ *  The recorder capturing the requests issued through issueAsync which reach the network, with their responses and
+ *  timings. Optional (the default), can be nil.
+ */
+@property (strong) http_request_recorder *recorder;
+
+/**
+ *  The policy with which failed requests issued through issueAsync are retried. Optional (the default), can be nil;
+ *  nothing is retried when nil.
+ */
+@property (strong) http_request_retry_policy *retryPolicy;
+
+/**
+ *  The policy with which slow requests issued through issueAsync are hedged with a second attempt. Optional (the
+ *  default), can be nil; nothing is hedged when nil.
+ */
+@property (strong) http_request_hedging_policy *hedgingPolicy;
+
+/**
+ *  The circuit breaker guarding the routes of the requests issued through issueAsync which reach the network; rejected
+ *  requests fail fast with error code -7 (circuit open) or -8 (concurrency limit reached). Optional (the default), can
+ *  be nil.
+ */
+@property (strong) http_request_circuit_breaker *circuitBreaker;
+
+/**
+ *  Determines whether identical GET and HEAD requests issued while one is already in flight share its fetch and its
+ *  body parsing. Each caller still gets its own task, which is never resumed; cancelling it only detaches that caller
+ *  and the shared fetch is cancelled once no caller is left. Defaults to NO.
+ */
+@property (assign) BOOL coalescesRequests;
+
+/**
+ *  The scheduler which limits the requests running against every host and starts queued ones by priority (see
+ *  http_request_scheduler setPriority:forRequest:). Optional (the default), can be nil; tasks are resumed right away when
+ *  nil. Must be set before issuing requests.
+ */
+@property (strong) http_request_scheduler *scheduler;
+
+/**
+ *  The content coding (gzip or deflate) with which request bodies issued through issueAsync are compressed before being
+ *  sent, along with the matching Content-Encoding header. Optional (the default), can be nil; bodies are sent as is when
+ *  nil. Only enable it for servers which accept compressed request bodies. Responses are negotiated (Accept-Encoding)
+ *  and decoded by NSURLSession regardless.
+ */
+@property (copy) NSString *requestContentEncoding;
+
+/**
+ *  The minimum size of a request body for it to be compressed, in bytes; smaller bodies rarely shrink enough to pay for
+ *  the compression. Defaults to 1024.
+ */
+@property (assign) NSUInteger requestCompressionThreshold;
+
+/**
+ *  The maximum number of streamed bytes which can be buffered awaiting delivery before the task is suspended.
+ *  Defaults to kDefaultStreamBufferLimit.
+ */
+@property (assign) NSUInteger streamBufferLimit;
+
+/**
+ *  The record parser factory block property; returns the incremental parser for the response or nil if unsupported.
+ */
+@property (copy) http_request_json_stream_parser *(^recordParserFactory)(NSURLResponse *, void (^)(id));
+
 /**
  *  Determines whether or not the status code is informational.
  *
@@ -87,6 +215,33 @@
  */
 + (BOOL)isServerErrorStatusCode:(int)statusCode;
 
+/**
+ *  Sets the deadline of a request issued through issueAsync. Once it passes, the request fails with an
+ *  NSURLErrorTimedOut error whether it is on the network, waiting for a retry or being parsed; every attempt times out
+ *  no later than it and no retry is scheduled past it.
+ *
+ *  @param deadline The deadline. Optional, can be nil to remove it.
+ *  @param request  The request. Must not be nil.
+ */
++ (void)setDeadline:(NSDate *)deadline forRequest:(NSMutableURLRequest *)request;
+
+/**
+ *  Sets the deadline of a request issued through issueAsync to a time interval from now.
+ *
+ *  @param timeout The time interval in seconds.
+ *  @param request The request. Must not be nil.
+ */
++ (void)setTimeout:(NSTimeInterval)timeout forRequest:(NSMutableURLRequest *)request;
+
+/**
+ *  Retrieves the deadline of a request.
+ *
+ *  @param request The request. Must not be nil.
+ *
+ *  @return The deadline; otherwise, nil if it has none.
+ */
++ (NSDate *)deadlineForRequest:(NSURLRequest *)request;
+
 /**
  *  Constructs an HTTP request given the provided parameters.
  *
@@ -114,7 +269,7 @@
 + (BOOL)isValidResponse:(NSURLResponse *)response withBody:(id)body error:(NSError *__autoreleasing *)error;
 
 /**
- *  Parses the data given a response.
+ *  Parses the data given a response, with the parser registered for its media type in the default registry.
  *
  *  @param response The response. Must not be nil.
  *  @param data     The data to parse as the body. Optional, can be nil.
@@ -135,12 +290,12 @@
 + (NSData *)serializeBody:(id)body error:(NSError *__autoreleasing *)error;
 
 /**
- *  Converts the provided NSData into its JSON representation.
+ *  Converts the provided NSData into its JSON representation through the JSON codec.
  *
  *  @param data  The data to parse. Optional, can be nil.
  *  @param error The error, if any. Must not be nil.
  *
- *  @return The NSDictionary representing the parsed data.
+ *  @return The object representing the parsed data (an NSDictionary with the default codec).
  */
 + (id)jsonDataParser:(NSData *)data error:(NSError *__autoreleasing *)error;
 
@@ -167,12 +322,38 @@
 /**
  *  Converts the provided JSON into its NSData representation.
  *
- *  @param dict  The JSON to serialize. Optional, can be nil.
+ *  @param json  The JSON (NSDictionary, NSArray or http_request_json_document) to serialize. Optional, can be nil.
  *  @param error The error, if any. Must not be nil.
  *
  *  @return The NSData representing the serialized JSON.
  */
-+ (NSData *)serializeJson:(NSDictionary *)dict error:(NSError *__autoreleasing *)error;
++ (NSData *)serializeJson:(id)json error:(NSError *__autoreleasing *)error;
+
+/**
+ *  Retrieves the codec through which JSON bodies are parsed and serialized.
+ *
+ *  @return The codec; an http_request_foundation_json_codec unless another one was set.
+ */
++ (id<http_request_json_codec>)jsonCodec;
+
+/**
+ *  Sets the codec through which every instance parses and serializes JSON bodies (e.g. an http_request_lazy_json_codec
+ *  to parse JSON responses into lazy documents).
+ *
+ *  @param codec The codec. Optional, can be nil to restore the default codec.
+ */
++ (void)setJsonCodec:(id<http_request_json_codec>)codec;
+
+/**
+ *  Creates the incremental record parser for the response content type: application/x-ndjson is parsed as newline
+ *  delimited JSON and application/json as a JSON array of records.
+ *
+ *  @param response The response. Must not be nil.
+ *  @param record   The callback called for each parsed record; passes the record. Must not be nil.
+ *
+ *  @return The parser for the response; otherwise, nil if the content type is not supported.
+ */
++ (http_request_json_stream_parser *)recordParserForResponse:(NSURLResponse *)response onRecord:(void(^)(id))record;
 
 /**
  *  The default instance initializer.
@@ -534,6 +715,39 @@
                             onSuccess:(void(^)(NSURLResponse *, id))success
                               onError:(void(^)(NSError *))error;
 
+/**
+ *  Issues the HTTP request described, parses the response body and validates the status code. Every verb method above
+ *  is a thin wrapper around it; build a descriptor once and derive it per request to skip the per-call setup.
+ *
+ *  @param descriptor The descriptor of the HTTP request to issue. Must not be nil.
+ *  @param success    The callback called upon success; passes the response and the body. Must not be nil.
+ *  @param error      The callback called upon error; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionDataTask *)sendAsync:(http_request_descriptor *)descriptor
+                          onSuccess:(void(^)(NSURLResponse *, id))success
+                            onError:(void(^)(NSError *))error;
+
+/**
+ *  Issues the HTTP request described with a body serialized by the bodySerializer, parses the response body and
+ *  validates the status code.
+ *
+ *  @param descriptor The descriptor of the HTTP request to issue. Must not be nil.
+ *  @param body       The body (e.g. NSData, NSString or JSON), which replaces the one of the descriptor; an
+ *                    http_request_multipart_body is streamed through an upload task instead. Optional, can be nil to
+ *                    keep it.
+ *  @param success    The callback called upon success; passes the response and the body. Must not be nil.
+ *  @param error      The callback called upon error, including a body which cannot be serialized; passes an NSError.
+ *                    Must not be nil.
+ *
+ *  @return The task representing the operation; otherwise, nil if the body cannot be serialized.
+ */
+- (NSURLSessionDataTask *)sendAsync:(http_request_descriptor *)descriptor
+                           withBody:(id)body
+                          onSuccess:(void(^)(NSURLResponse *, id))success
+                            onError:(void(^)(NSError *))error;
+
 /**
  *  Issues an HTTP request, parses the response body and validates the status code.
  *
@@ -564,4 +778,474 @@
                            onSuccess:(void (^)(NSURLResponse *, id))successCallback
                              onError:(void (^)(NSError *))errorCallback;
 
+/**
+ *  Put the content of the file for the provided url, streaming it from disk through an upload task.
+ *
+ *  @param url      The uniform resource locator to update the content with. Must not be nil.
+ *  @param headers  The NSDitionary representing the headers to set for the request. Optional, can be nil.
+ *  @param fileUrl  The file URL of the body of the request. Must not be nil.
+ *  @param progress The callback called as the body is sent; passes the bytes sent and expected. Optional, can be nil.
+ *  @param success  The callback called upon success; passes the response and the body. Must not be nil.
+ *  @param error    The callback called upon error; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionUploadTask *)putAsync:(NSURL *)url
+                         withHeaders:(NSDictionary *)headers
+                            withFile:(NSURL *)fileUrl
+                          onProgress:(void(^)(int64_t, int64_t))progress
+                           onSuccess:(void(^)(NSURLResponse *, id))success
+                             onError:(void(^)(NSError *))error;
+
+/**
+ *  Put the content read from the stream for the provided url through an upload task. Unless a Content-Length header
+ *  is provided the body is sent chunked.
+ *
+ *  @param url      The uniform resource locator to update the content with. Must not be nil.
+ *  @param headers  The NSDitionary representing the headers to set for the request. Optional, can be nil.
+ *  @param stream   The unopened stream from which to read the body of the request. Must not be nil.
+ *  @param progress The callback called as the body is sent; passes the bytes sent and expected. Optional, can be nil.
+ *  @param success  The callback called upon success; passes the response and the body. Must not be nil.
+ *  @param error    The callback called upon error; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionUploadTask *)putAsync:(NSURL *)url
+                         withHeaders:(NSDictionary *)headers
+                          withStream:(NSInputStream *)stream
+                          onProgress:(void(^)(int64_t, int64_t))progress
+                           onSuccess:(void(^)(NSURLResponse *, id))success
+                             onError:(void(^)(NSError *))error;
+
+/**
+ *  Post the content of the file for the provided url, streaming it from disk through an upload task.
+ *
+ *  @param url      The uniform resource locator to update the content with. Must not be nil.
+ *  @param headers  The NSDitionary representing the headers to set for the request. Optional, can be nil.
+ *  @param fileUrl  The file URL of the body of the request. Must not be nil.
+ *  @param progress The callback called as the body is sent; passes the bytes sent and expected. Optional, can be nil.
+ *  @param success  The callback called upon success; passes the response and the body. Must not be nil.
+ *  @param error    The callback called upon error; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionUploadTask *)postAsync:(NSURL *)url
+                          withHeaders:(NSDictionary *)headers
+                             withFile:(NSURL *)fileUrl
+                           onProgress:(void(^)(int64_t, int64_t))progress
+                            onSuccess:(void(^)(NSURLResponse *, id))success
+                              onError:(void(^)(NSError *))error;
+
+/**
+ *  Post the content read from the stream for the provided url through an upload task. Unless a Content-Length header
+ *  is provided the body is sent chunked.
+ *
+ *  @param url      The uniform resource locator to update the content with. Must not be nil.
+ *  @param headers  The NSDitionary representing the headers to set for the request. Optional, can be nil.
+ *  @param stream   The unopened stream from which to read the body of the request. Must not be nil.
+ *  @param progress The callback called as the body is sent; passes the bytes sent and expected. Optional, can be nil.
+ *  @param success  The callback called upon success; passes the response and the body. Must not be nil.
+ *  @param error    The callback called upon error; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionUploadTask *)postAsync:(NSURL *)url
+                          withHeaders:(NSDictionary *)headers
+                           withStream:(NSInputStream *)stream
+                           onProgress:(void(^)(int64_t, int64_t))progress
+                            onSuccess:(void(^)(NSURLResponse *, id))success
+                              onError:(void(^)(NSError *))error;
+
+/**
+ *  Post the multipart body for the provided url, streaming it part after part through an upload task.
+ *
+ *  @param url      The uniform resource locator to update the content with. Must not be nil.
+ *  @param headers  The NSDitionary representing the headers to set for the request. Optional, can be nil.
+ *  @param body     The multipart body of the request. Must not be nil.
+ *  @param progress The callback called as the body is sent; passes the bytes sent and expected. Optional, can be nil.
+ *  @param success  The callback called upon success; passes the response and the body. Must not be nil.
+ *  @param error    The callback called upon error; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionUploadTask *)postAsync:(NSURL *)url
+                          withHeaders:(NSDictionary *)headers
+                    withMultipartBody:(http_request_multipart_body *)body
+                           onProgress:(void(^)(int64_t, int64_t))progress
+                            onSuccess:(void(^)(NSURLResponse *, id))success
+                              onError:(void(^)(NSError *))error;
+
+/**
+ *  Patch the content of the file for the provided url, streaming it from disk through an upload task.
+ *
+ *  @param url      The uniform resource locator to update the content with. Must not be nil.
+ *  @param headers  The NSDitionary representing the headers to set for the request. Optional, can be nil.
+ *  @param fileUrl  The file URL of the body of the request. Must not be nil.
+ *  @param progress The callback called as the body is sent; passes the bytes sent and expected. Optional, can be nil.
+ *  @param success  The callback called upon success; passes the response and the body. Must not be nil.
+ *  @param error    The callback called upon error; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionUploadTask *)patchAsync:(NSURL *)url
+                           withHeaders:(NSDictionary *)headers
+                              withFile:(NSURL *)fileUrl
+                            onProgress:(void(^)(int64_t, int64_t))progress
+                             onSuccess:(void(^)(NSURLResponse *, id))success
+                               onError:(void(^)(NSError *))error;
+
+/**
+ *  Patch the content read from the stream for the provided url through an upload task. Unless a Content-Length header
+ *  is provided the body is sent chunked.
+ *
+ *  @param url      The uniform resource locator to update the content with. Must not be nil.
+ *  @param headers  The NSDitionary representing the headers to set for the request. Optional, can be nil.
+ *  @param stream   The unopened stream from which to read the body of the request. Must not be nil.
+ *  @param progress The callback called as the body is sent; passes the bytes sent and expected. Optional, can be nil.
+ *  @param success  The callback called upon success; passes the response and the body. Must not be nil.
+ *  @param error    The callback called upon error; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionUploadTask *)patchAsync:(NSURL *)url
+                           withHeaders:(NSDictionary *)headers
+                            withStream:(NSInputStream *)stream
+                            onProgress:(void(^)(int64_t, int64_t))progress
+                             onSuccess:(void(^)(NSURLResponse *, id))success
+                               onError:(void(^)(NSError *))error;
+
+/**
+ *  Issues an HTTP request whose body is streamed from the file through an upload task, parses the response body and
+ *  validates the status code. Memory use does not depend on the size of the file. Progress is reported on a
+ *  background queue.
+ *
+ *  @param request          The HTTP request to issue; its body, if any, is ignored. Must not be nil.
+ *  @param fileUrl          The file URL of the body of the request. Must not be nil.
+ *  @param progressCallback The callback called as the body is sent; passes the bytes sent and expected. Optional, can be nil.
+ *  @param successCallback  The callback called upon success; passes the response and the body. Must not be nil.
+ *  @param errorCallback    The callback called upon error; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionUploadTask *)uploadAsync:(NSMutableURLRequest *)request
+                               fromFile:(NSURL *)fileUrl
+                             onProgress:(void (^)(int64_t, int64_t))progressCallback
+                              onSuccess:(void (^)(NSURLResponse *, id))successCallback
+                                onError:(void (^)(NSError *))errorCallback;
+
+/**
+ *  Issues an HTTP request whose body is read from the stream through an upload task, parses the response body and
+ *  validates the status code. The stream is read once, so a request which needs its body again (e.g. upon a
+ *  redirect) fails. Progress is reported on a background queue.
+ *
+ *  @param request          The HTTP request to issue; its body, if any, is ignored. Must not be nil.
+ *  @param stream           The unopened stream from which to read the body of the request. Must not be nil.
+ *  @param progressCallback The callback called as the body is sent; passes the bytes sent and expected. Optional, can be nil.
+ *  @param successCallback  The callback called upon success; passes the response and the body. Must not be nil.
+ *  @param errorCallback    The callback called upon error; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionUploadTask *)uploadAsync:(NSMutableURLRequest *)request
+                             fromStream:(NSInputStream *)stream
+                             onProgress:(void (^)(int64_t, int64_t))progressCallback
+                              onSuccess:(void (^)(NSURLResponse *, id))successCallback
+                                onError:(void (^)(NSError *))errorCallback;
+
+/**
+ *  Issues an HTTP request whose body is the multipart body, streamed part after part through an upload task, parses
+ *  the response body and validates the status code. The Content-Type and, if known, the Content-Length of the request
+ *  are set from the body; memory use does not depend on the size of its parts. Progress is reported on a background
+ *  queue.
+ *
+ *  @param request          The HTTP request to issue; its body, if any, is ignored. Must not be nil.
+ *  @param body             The multipart body of the request. Must not be nil.
+ *  @param progressCallback The callback called as the body is sent; passes the bytes sent and expected. Optional, can be nil.
+ *  @param successCallback  The callback called upon success; passes the response and the body. Must not be nil.
+ *  @param errorCallback    The callback called upon error, including a part which cannot be read, which aborts the
+ *                          upload; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionUploadTask *)uploadAsync:(NSMutableURLRequest *)request
+                      fromMultipartBody:(http_request_multipart_body *)body
+                             onProgress:(void (^)(int64_t, int64_t))progressCallback
+                              onSuccess:(void (^)(NSURLResponse *, id))successCallback
+                                onError:(void (^)(NSError *))errorCallback;
+
+/**
+ *  Downloads the content for the provided url straight to the file through a download task, without ever holding the
+ *  body in memory. The response is validated with the responseValidator; the file is only written when valid.
+ *  Upon a network error, the NSError userInfo carries NSURLSessionDownloadTaskResumeData if the download can be resumed.
+ *
+ *  @param url      The uniform resource locator to retrieve the content from. Must not be nil.
+ *  @param fileUrl  The file URL to write the content to; an existing file is replaced. Must not be nil.
+ *  @param progress The callback called as the body is written; passes the bytes written and expected. Optional, can be nil.
+ *  @param success  The callback called upon success; passes the response and the file URL. Must not be nil.
+ *  @param error    The callback called upon error; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionDownloadTask *)downloadAsync:(NSURL *)url
+                                     toFile:(NSURL *)fileUrl
+                                 onProgress:(void(^)(int64_t, int64_t))progress
+                                  onSuccess:(void(^)(NSURLResponse *, NSURL *))success
+                                    onError:(void(^)(NSError *))error;
+
+/**
+ *  Downloads the content for the provided url to the file, fetching byte ranges in parallel over several connections
+ *  when the server supports range requests (learnt through a HEAD request) and the content is large enough; otherwise,
+ *  the content is downloaded through a single connection. Should a range request be answered with anything but 206
+ *  (Partial Content), the ranges are cancelled and the content is downloaded through a single connection instead.
+ *
+ *  @param url             The uniform resource locator to retrieve the content from. Must not be nil.
+ *  @param fileUrl         The file URL to write the content to; an existing file is replaced. Must not be nil.
+ *  @param connectionCount The maximum number of ranges fetched in parallel; zero is treated as one.
+ *  @param progress        The callback called as the body is written; passes the bytes written across every range and
+ *                         the expected total. Optional, can be nil.
+ *  @param success         The callback called once every range was written; passes the response and the file URL. Must not be nil.
+ *  @param error           The callback called upon the first error; passes an NSError. Must not be nil.
+ *
+ *  @return The download representing the operation.
+ */
+- (http_request_download *)downloadAsync:(NSURL *)url
+                                  toFile:(NSURL *)fileUrl
+                         withConnections:(NSUInteger)connectionCount
+                              onProgress:(void(^)(int64_t, int64_t))progress
+                               onSuccess:(void(^)(NSURLResponse *, NSURL *))success
+                                 onError:(void(^)(NSError *))error;
+
+/**
+ *  Resumes a download which failed or was cancelled, from the resume data carried by its error or produced by
+ *  cancelByProducingResumeData:.
+ *
+ *  @param resumeData The resume data. Must not be nil.
+ *  @param fileUrl    The file URL to write the content to; an existing file is replaced. Must not be nil.
+ *  @param progress   The callback called as the body is written; passes the bytes written and expected. Optional, can be nil.
+ *  @param success    The callback called upon success; passes the response and the file URL. Must not be nil.
+ *  @param error      The callback called upon error; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionDownloadTask *)resumeDownloadAsync:(NSData *)resumeData
+                                           toFile:(NSURL *)fileUrl
+                                       onProgress:(void(^)(int64_t, int64_t))progress
+                                        onSuccess:(void(^)(NSURLResponse *, NSURL *))success
+                                          onError:(void(^)(NSError *))error;
+
+/**
+ *  Continues downloading the content for the provided url into a partially written file through a Range request, e.g.
+ *  after the application was relaunched and no resume data is available. If the server answers with the whole content
+ *  instead of the remaining range, the file is replaced.
+ *
+ *  @param url      The uniform resource locator to retrieve the content from. Must not be nil.
+ *  @param fileUrl  The file URL of the partially written content. Must not be nil.
+ *  @param progress The callback called as the body is written; passes the bytes written and expected. Optional, can be nil.
+ *  @param success  The callback called upon success; passes the response and the file URL. Must not be nil.
+ *  @param error    The callback called upon error; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionDownloadTask *)continueDownloadAsync:(NSURL *)url
+                                             toFile:(NSURL *)fileUrl
+                                         onProgress:(void(^)(int64_t, int64_t))progress
+                                          onSuccess:(void(^)(NSURLResponse *, NSURL *))success
+                                            onError:(void(^)(NSError *))error;
+
+/**
+ *  Issues an HTTP request whose response body is written straight to the file through a download task. A 206 response
+ *  is written at the offset; any other valid response replaces the file. Progress is reported on a background queue.
+ *
+ *  @param request          The HTTP request to issue. Must not be nil.
+ *  @param fileUrl          The file URL to write the content to. Must not be nil.
+ *  @param offset           The offset at which to write a partial (206) response.
+ *  @param progressCallback The callback called as the body is written; passes the bytes written and expected. Optional, can be nil.
+ *  @param successCallback  The callback called upon success; passes the response and the file URL. Must not be nil.
+ *  @param errorCallback    The callback called upon error; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionDownloadTask *)issueDownloadAsync:(NSMutableURLRequest *)request
+                                          toFile:(NSURL *)fileUrl
+                                        atOffset:(int64_t)offset
+                                      onProgress:(void (^)(int64_t, int64_t))progressCallback
+                                       onSuccess:(void (^)(NSURLResponse *, NSURL *))successCallback
+                                         onError:(void (^)(NSError *))errorCallback;
+
+/**
+ *  Issues an HTTP request, parses the response body and validates the status code, retrying it according to the
+ *  policy, hedging it according to hedgingPolicy and failing it at its deadline. The returned task represents the whole
+ *  operation: cancelling it cancels the attempts in flight and any pending retry. Exactly one of the callbacks is
+ *  called, once.
+ *
+ *  @param request          The HTTP request to issue. Must not be nil.
+ *  @param bodyParser       The parser used to convert the body. Optional, can be nil.
+ *  @param validateResponse The validator used to check the response. Optional, can be nil.
+ *  @param retryPolicy      The policy with which to retry the request. Optional, can be nil to not retry it.
+ *  @param successCallback  The callback called upon success; passes the response and the body. Must not be nil.
+ *  @param errorCallback    The callback called upon the last error; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionDataTask *)issueAsync:(NSMutableURLRequest *)request
+                      withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+              withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                     withRetryPolicy:(http_request_retry_policy *)retryPolicy
+                           onSuccess:(void (^)(NSURLResponse *, id))successCallback
+                             onError:(void (^)(NSError *))errorCallback;
+
+/**
+ *  Issues an HTTP GET request through issueAsync and returns its future instead of taking callbacks.
+ *
+ *  @param url     The URL to get. Must not be nil.
+ *  @param headers The additional headers. Optional, can be nil.
+ *
+ *  @return The future of the parsed body; cancelling it cancels the task.
+ */
+- (http_request_future *)getFuture:(NSURL *)url withHeaders:(NSDictionary *)headers;
+
+/**
+ *  Issues an HTTP PUT request through issueAsync and returns its future instead of taking callbacks.
+ *
+ *  @param url     The URL to put to. Must not be nil.
+ *  @param headers The additional headers. Optional, can be nil.
+ *  @param body    The body, serialized with the bodySerializer (e.g. NSData, NSString or JSON). Optional, can be nil.
+ *
+ *  @return The future of the parsed body, rejected right away if the body cannot be serialized; cancelling it cancels
+ *          the task.
+ */
+- (http_request_future *)putFuture:(NSURL *)url withHeaders:(NSDictionary *)headers withBody:(id)body;
+
+/**
+ *  Issues an HTTP POST request through issueAsync and returns its future instead of taking callbacks.
+ *
+ *  @param url     The URL to post to. Must not be nil.
+ *  @param headers The additional headers. Optional, can be nil.
+ *  @param body    The body, serialized with the bodySerializer (e.g. NSData, NSString or JSON). Optional, can be nil.
+ *
+ *  @return The future of the parsed body, rejected right away if the body cannot be serialized; cancelling it cancels
+ *          the task.
+ */
+- (http_request_future *)postFuture:(NSURL *)url withHeaders:(NSDictionary *)headers withBody:(id)body;
+
+/**
+ *  Issues an HTTP PATCH request through issueAsync and returns its future instead of taking callbacks.
+ *
+ *  @param url     The URL to patch. Must not be nil.
+ *  @param headers The additional headers. Optional, can be nil.
+ *  @param body    The body, serialized with the bodySerializer (e.g. NSData, NSString or JSON). Optional, can be nil.
+ *
+ *  @return The future of the parsed body, rejected right away if the body cannot be serialized; cancelling it cancels
+ *          the task.
+ */
+- (http_request_future *)patchFuture:(NSURL *)url withHeaders:(NSDictionary *)headers withBody:(id)body;
+
+/**
+ *  Issues an HTTP DELETE request through issueAsync and returns its future instead of taking callbacks.
+ *
+ *  @param url     The URL to delete. Must not be nil.
+ *  @param headers The additional headers. Optional, can be nil.
+ *
+ *  @return The future of the parsed body; cancelling it cancels the task.
+ */
+- (http_request_future *)deleteFuture:(NSURL *)url withHeaders:(NSDictionary *)headers;
+
+/**
+ *  Issues the HTTP request described through issueAsync and returns its future instead of taking callbacks.
+ *
+ *  @param descriptor The descriptor of the HTTP request to issue. Must not be nil.
+ *  @param body       The body, serialized with the bodySerializer, which replaces the one of the descriptor; an
+ *                    http_request_multipart_body is streamed through an upload task instead. Optional, can be nil to
+ *                    keep it.
+ *
+ *  @return The future of the parsed body, rejected right away if the body cannot be serialized; cancelling it cancels
+ *          the task.
+ */
+- (http_request_future *)sendFuture:(http_request_descriptor *)descriptor withBody:(id)body;
+
+/**
+ *  Issues an HTTP request through issueAsync, with the bodyParser, responseValidator and retryPolicy of the instance,
+ *  and returns its future instead of taking callbacks. The future completes on the callback queue, where its
+ *  continuations then run without further dispatch.
+ *
+ *  @param request The HTTP request to issue. Must not be nil.
+ *
+ *  @return The future of the parsed body; cancelling it cancels the task.
+ */
+- (http_request_future *)issueFuture:(NSMutableURLRequest *)request;
+
+/**
+ *  Issues a batch of HTTP requests, keeping at most maxConcurrency of them in flight, parsing and validating each one
+ *  with the bodyParser and responseValidator of the instance. Results are delivered serially on a background queue.
+ *
+ *  @param requests         The HTTP requests to issue, e.g. as constructed by constructRequest. Must not be nil.
+ *  @param maxConcurrency   The maximum number of requests in flight; zero issues them all at once.
+ *  @param delivery         The order in which results are delivered.
+ *  @param resultCallback   The callback called for each completed request; passes its result. Optional, can be nil.
+ *  @param completeCallback The callback called once every request completed; passes the results in the order of the
+ *                          requests. Must not be nil.
+ *
+ *  @return The batch representing the operation.
+ */
+- (http_request_batch *)batchAsync:(NSArray *)requests
+                    maxConcurrency:(NSUInteger)maxConcurrency
+                          delivery:(http_request_batch_delivery)delivery
+                          onResult:(void (^)(http_request_batch_result *))resultCallback
+                        onComplete:(void (^)(NSArray *))completeCallback;
+
+/**
+ *  Issues an HTTP request and delivers the response body in chunks as they arrive instead of buffering it.
+ *
+ *  @param request  The HTTP request to issue. Must not be nil.
+ *  @param chunk    The callback called for each chunk of the body, in order; passes the chunk. Must not be nil.
+ *  @param complete The callback called once the whole body was delivered; passes the response. Must not be nil.
+ *  @param error    The callback called upon error; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionDataTask *)streamAsync:(NSMutableURLRequest *)request
+                              onChunk:(void(^)(NSData *))chunk
+                           onComplete:(void(^)(NSURLResponse *))complete
+                              onError:(void(^)(NSError *))error;
+
+/**
+ *  Issues an HTTP request and delivers the response body in chunks as they arrive instead of buffering it.
+ *  The response is validated as soon as its headers are received; upon an invalid response the (bounded) body is
+ *  parsed and handed to the validator again so that the error carries it, and no chunks are delivered.
+ *  Chunks are delivered serially on a background queue; whenever more than streamBufferLimit bytes are pending
+ *  delivery the task is suspended until the chunk callback catches up.
+ *
+ *  @param request          The HTTP request to issue. Must not be nil.
+ *  @param bodyParser       The parser used to convert the body of an invalid response. Optional, can be nil.
+ *  @param validateResponse The validator used to check the response. Optional, can be nil.
+ *  @param chunkCallback    The callback called for each chunk of the body, in order; passes the chunk. Must not be nil.
+ *  @param completeCallback The callback called once the whole body was delivered; passes the response. Must not be nil.
+ *  @param errorCallback    The callback called upon error; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionDataTask *)streamAsync:(NSMutableURLRequest *)request
+                       withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+               withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                              onChunk:(void (^)(NSData *))chunkCallback
+                           onComplete:(void (^)(NSURLResponse *))completeCallback
+                              onError:(void (^)(NSError *))errorCallback;
+
+/**
+ *  Issues an HTTP request and incrementally parses the streamed body into records, delivering each one as soon as it
+ *  was received. The parser is created through the recordParserFactory and records are delivered serially on a
+ *  background queue.
+ *
+ *  @param request          The HTTP request to issue. Must not be nil.
+ *  @param recordCallback   The callback called for each record, in order; passes the record. Must not be nil.
+ *  @param completeCallback The callback called once every record was delivered; passes the response. Must not be nil.
+ *  @param errorCallback    The callback called upon error; passes an NSError. Must not be nil.
+ *
+ *  @return The task representing the operation.
+ */
+- (NSURLSessionDataTask *)recordStreamAsync:(NSMutableURLRequest *)request
+                                   onRecord:(void (^)(id))recordCallback
+                                 onComplete:(void (^)(NSURLResponse *))completeCallback
+                                    onError:(void (^)(NSError *))errorCallback;
+
 @end
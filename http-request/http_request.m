@@ -7,32 +7,204 @@
 //
 
 #import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_session_delegate.h"
+
+/**
+ *  The state shared by the callbacks of a streaming task.
+ */
+@interface http_request_stream_context : NSObject
+
+@property (strong) NSURLResponse *response;
+@property (strong) NSError *validationError;
+@property (strong) NSMutableData *errorBody;
+@property (strong) dispatch_queue_t deliveryQueue;
+@property (assign) NSUInteger pendingBytes;
+@property (assign) BOOL suspended;
+@property (assign) BOOL invalidResponse;
+
+@end
+
+@implementation http_request_stream_context
+@end
+
+/**
+ *  A caller attached to a coalesced fetch.
+ */
+@interface http_request_coalesced_caller : NSObject
+
+@property (weak) NSURLSessionDataTask *task;
+@property (copy) void (^successCallback)(NSURLResponse *, id);
+@property (copy) void (^errorCallback)(NSError *);
+
+@end
+
+@implementation http_request_coalesced_caller
+@end
+
+/**
+ *  A fetch shared by every caller which issued an identical request while it was in flight.
+ */
+@interface http_request_coalesced_fetch : NSObject
+
+@property (strong) NSURLSessionDataTask *task;
+@property (strong) NSMutableArray *callers;
+
+@end
+
+@implementation http_request_coalesced_fetch
+@end
+
+/**
+ *  The progress of a request issued with a retry policy, a hedging policy or a deadline.
+ */
+@interface http_request_attempt_state : NSObject
+
+@property (weak) NSURLSessionDataTask *handleTask;
+@property (strong) NSMutableArray *attemptTasks;
+@property (strong) NSDate *deadline;
+@property (strong) dispatch_source_t deadlineTimer;
+@property (assign) NSUInteger inFlightCount;
+@property (assign) NSUInteger retryCount;
+@property (assign) BOOL hedged;
+@property (assign) BOOL finished;
+
+@end
+
+@implementation http_request_attempt_state
+@end
+
+static id<http_request_json_codec> _jsonCodec = nil;
 
 @interface http_request()
+{
+    http_request_session_delegate *_sessionDelegate;
+    NSMutableDictionary *_coalescedFetches;
+}
 
-+ (void)throwIfNil:(id)parameter withName:(NSString *)parameterName;
-+ (BOOL)isNotNil:(id)value;
 + (int)getMostSignificantDigit:(int)value;
 + (BOOL)mostSignificantDigitEquals:(int)value1 equals:(int)value2;
 + (void)raiseExceptionOnInvalidStatusCodeRange:(int)statusCode;
++ (BOOL)isCoalescableRequest:(NSURLRequest *)request;
++ (BOOL)moveDownloadedFile:(NSURL *)temporaryUrl toFile:(NSURL *)fileUrl atOffset:(int64_t)offset error:(NSError *__autoreleasing *)error;
++ (NSString *)coalescingKeyForRequest:(NSURLRequest *)request
+                       withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+               withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse;
 
 - (void)configureBodyParser;
 - (void)configureBodySerializer;
 - (void)configureResponseValidator;
+- (void)configureRecordParserFactory;
 
-- (NSURLSessionDataTask *)callBodySerializeAndExecuteAsync:(NSString *)method
-                                                       url:(NSURL *)url
-                                               withHeaders:(NSDictionary *)headers
-                                                  withBody:(id)body
-                                                 onSuccess:(void (^)(NSURLResponse *, id))success
-                                                   onError:(void (^)(NSError *))error;
 - (void)dataTaskCompletionHandler:(NSURLResponse *)response
                          withBody:(NSData *)data
                    withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
            withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                      withMetrics:(http_request_metrics *)metrics
                             error:(NSError *)error
                         onSuccess:(void(^)(NSURLResponse *, id))successCallback
                           onError:(void(^)(NSError *))errorCallback;
+- (NSURLSessionDataTask *)streamAsync:(NSMutableURLRequest *)request
+                       withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+               withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                           onResponse:(void (^)(NSURLResponse *))responseCallback
+                              onChunk:(void (^)(NSData *))chunkCallback
+                           onComplete:(void (^)(NSURLResponse *))completeCallback
+                              onError:(void (^)(NSError *))errorCallback;
+- (NSURLSessionDataTask *)issueOnceAsync:(NSMutableURLRequest *)request
+                           withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+                   withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                                onSuccess:(void(^)(NSURLResponse *, id))successCallback
+                                  onError:(void(^)(NSError *))errorCallback;
+- (NSURLSessionDataTask *)issueSupervisedAsync:(NSMutableURLRequest *)request
+                                 withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+                         withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                                withRetryPolicy:(http_request_retry_policy *)retryPolicy
+                              withHedgingPolicy:(http_request_hedging_policy *)hedgingPolicy
+                                   withDeadline:(NSDate *)deadline
+                                      onSuccess:(void(^)(NSURLResponse *, id))successCallback
+                                        onError:(void(^)(NSError *))errorCallback;
+- (void)issueAttempt:(NSMutableURLRequest *)request
+      withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+     withRetryPolicy:(http_request_retry_policy *)retryPolicy
+   withHedgingPolicy:(http_request_hedging_policy *)hedgingPolicy
+    withAttemptState:(http_request_attempt_state *)state
+             asHedge:(BOOL)hedge
+           onSuccess:(void(^)(NSURLResponse *, id))successCallback
+             onError:(void(^)(NSError *))errorCallback;
+- (NSArray *)finishAttempts:(http_request_attempt_state *)state;
+- (NSURLSessionDataTask *)issueDirectAsync:(NSMutableURLRequest *)request
+                             withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+                     withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                                  onSuccess:(void(^)(NSURLResponse *, id))successCallback
+                                    onError:(void(^)(NSError *))errorCallback;
+- (NSURLSessionDataTask *)issueCoalescedAsync:(NSMutableURLRequest *)request
+                                withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+                        withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                                     onSuccess:(void(^)(NSURLResponse *, id))successCallback
+                                       onError:(void(^)(NSError *))errorCallback;
+- (NSArray *)completeCoalescedFetch:(http_request_coalesced_fetch *)fetch forKey:(NSString *)key;
+- (void)detachCoalescedCaller:(http_request_coalesced_caller *)caller forKey:(NSString *)key withError:(NSError *)error;
+- (NSURLSessionDataTask *)issueCachedAsync:(NSMutableURLRequest *)request
+                                  withCache:(http_request_cache *)cache
+                             withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+                     withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                                withMetrics:(http_request_metrics *)metrics
+                                  onSuccess:(void(^)(NSURLResponse *, id))successCallback
+                                    onError:(void(^)(NSError *))errorCallback;
+- (void)cacheEntryCompletionHandler:(http_request_cache_entry *)entry
+                     withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+                        withMetrics:(http_request_metrics *)metrics
+                          onSuccess:(void(^)(NSURLResponse *, id))successCallback
+                            onError:(void(^)(NSError *))errorCallback;
+- (void)issueUploadTask:(NSURLSessionUploadTask *)uploadTask
+             forRequest:(NSURLRequest *)request
+         withBodyStream:(NSInputStream *)bodyStream
+             onProgress:(void(^)(int64_t, int64_t))progressCallback
+              onSuccess:(void(^)(NSURLResponse *, id))successCallback
+                onError:(void(^)(NSError *))errorCallback;
+- (void)issueDownloadTask:(NSURLSessionDownloadTask *)downloadTask
+                   toFile:(NSURL *)fileUrl
+                 atOffset:(int64_t)offset
+  requiringPartialContent:(BOOL)requiresPartialContent
+               onProgress:(void(^)(int64_t, int64_t))progressCallback
+                onSuccess:(void(^)(NSURLResponse *, NSURL *))successCallback
+                  onError:(void(^)(NSError *))errorCallback;
+- (void)downloadCompletionHandler:(NSURLResponse *)response
+                withTemporaryFile:(NSURL *)temporaryUrl
+                           toFile:(NSURL *)fileUrl
+                         atOffset:(int64_t)offset
+          requiringPartialContent:(BOOL)requiresPartialContent
+                            error:(NSError *)error
+                        onSuccess:(void(^)(NSURLResponse *, NSURL *))successCallback
+                          onError:(void(^)(NSError *))errorCallback;
+- (void)downloadRanges:(NSURL *)url
+                toFile:(NSURL *)fileUrl
+       withConnections:(NSUInteger)connectionCount
+      withHeadResponse:(NSHTTPURLResponse *)headResponse
+           forDownload:(http_request_download *)download
+            onProgress:(void(^)(int64_t, int64_t))progressCallback
+             onSuccess:(void(^)(NSURLResponse *, NSURL *))successCallback
+               onError:(void(^)(NSError *))errorCallback;
+- (void)resumeTask:(NSURLSessionTask *)task onResume:(void(^)(void))resumeCallback;
+- (void)taskDidComplete:(NSURLSessionTask *)task;
+- (void)dispatchParsing:(void(^)(void))block;
+- (NSURLSessionDataTask *)rejectedTask:(NSURLRequest *)request
+                             withError:(NSError *)error
+                           withMetrics:(http_request_metrics *)metrics
+                               onError:(void(^)(NSError *))errorCallback;
+- (void)dispatchCallback:(void(^)(void))block;
+- (void)dispatchCallback:(void(^)(void))block withMetrics:(http_request_metrics *)metrics;
+- (void)compressRequestBody:(NSMutableURLRequest *)request;
+- (http_request_metrics *)metricsForRequest:(NSURLRequest *)request;
+- (void)streamCompletionHandler:(http_request_stream_context *)context
+                 withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+         withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                          error:(NSError *)error
+                     onComplete:(void(^)(NSURLResponse *))completeCallback
+                        onError:(void(^)(NSError *))errorCallback;
+- (http_request_future *)futureOfTask:(NSURLSessionTask *(^)(void(^)(NSURLResponse *, id), void(^)(NSError *)))issue;
 
 @end
 
@@ -70,6 +242,33 @@
     return [http_request mostSignificantDigitEquals:statusCode equals:5];
 }
 
++ (void)setDeadline:(NSDate *)deadline forRequest:(NSMutableURLRequest *)request
+{
+    [http_request throwIfNil:request withName:@"request"];
+
+    if (deadline)
+    {
+        [NSURLProtocol setProperty:deadline forKey:kHttpRequestDeadlineKey inRequest:request];
+    }
+    else
+    {
+        [NSURLProtocol removePropertyForKey:kHttpRequestDeadlineKey inRequest:request];
+    }
+}
+
++ (void)setTimeout:(NSTimeInterval)timeout forRequest:(NSMutableURLRequest *)request
+{
+    [http_request setDeadline:[NSDate dateWithTimeIntervalSinceNow:timeout] forRequest:request];
+}
+
++ (NSDate *)deadlineForRequest:(NSURLRequest *)request
+{
+    [http_request throwIfNil:request withName:@"request"];
+
+    id deadline = [NSURLProtocol propertyForKey:kHttpRequestDeadlineKey inRequest:request];
+    return [deadline isKindOfClass:[NSDate class]] ? deadline : nil;
+}
+
 + (NSMutableURLRequest *)constructRequest:(NSString *)method
                                   withUrl:(NSURL *)url
                               withHeaders:(NSDictionary *)headers
@@ -106,12 +305,15 @@
         NSString *localizedErrorAsString = [NSString
                                             stringWithFormat:@"Unsuccessful response. Status code: %ld",
                                             httpResponse.statusCode];
-        *error = [[NSError alloc]
-                  initWithDomain:kHttpRequestDomain
-                  code:-1011
-                  userInfo:@{NSLocalizedDescriptionKey:localizedErrorAsString,
-                             @"Response": httpResponse,
-                             @"Body": body}];
+        NSMutableDictionary *userInfo = [NSMutableDictionary
+                                         dictionaryWithDictionary:@{NSLocalizedDescriptionKey:localizedErrorAsString,
+                                                                    @"Response": httpResponse}];
+        if (body)
+        {
+            [userInfo setObject:body forKey:@"Body"];
+        }
+
+        *error = [[NSError alloc] initWithDomain:kHttpRequestDomain code:-1011 userInfo:userInfo];
     }
     
     return successStatusCode;
@@ -121,23 +323,7 @@
 {
     [http_request throwIfNil:response withName:@"response"];
 
-    *error = nil;
-    NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
-    id parsedData = data;
-    NSString *contentType = [[httpResponse allHeaderFields] valueForKey:@"Content-Type"];
-    if ([http_request isNotNil:contentType] && [http_request isNotNil:data])
-    {
-        if ([contentType caseInsensitiveCompare:kApplicationJsonContentType] == NSOrderedSame)
-        {
-            parsedData = [http_request jsonDataParser:data error:error];
-        }
-        else if ([contentType caseInsensitiveCompare:kTextHtmlContentType] == NSOrderedSame)
-        {
-            parsedData = [http_request stringDataParser:data error:error];
-        }
-    }
-    
-    return parsedData;
+    return [[http_request_parser_registry defaultRegistry] parseResponse:response withBody:data error:error];
 }
 
 + (NSData *)serializeBody:(id)body error:(NSError *__autoreleasing *)error
@@ -150,7 +336,9 @@
         {
             bodyAsData = [http_request serializeString:body error:error];
         }
-        else if ([body isKindOfClass:[NSDictionary class]])
+        else if ([body isKindOfClass:[NSDictionary class]]
+                 || [body isKindOfClass:[NSArray class]]
+                 || [body isKindOfClass:[http_request_json_document class]])
         {
             bodyAsData = [http_request serializeJson:body error:error];
         }
@@ -173,10 +361,10 @@
 + (id)jsonDataParser:(NSData *)data error:(NSError *__autoreleasing *)error
 {
     *error = nil;
-    NSDictionary *jsonResponse = nil;
+    id jsonResponse = nil;
     if ([http_request isNotNil:data])
     {
-        jsonResponse = [NSJSONSerialization JSONObjectWithData:data options:kNilOptions error:error];
+        jsonResponse = [[http_request jsonCodec] decodeData:data error:error];
     }
 
     return jsonResponse;
@@ -201,23 +389,70 @@
     return data;
 }
 
-+ (NSData *)serializeJson:(NSDictionary *)dict error:(NSError *__autoreleasing *)error
++ (NSData *)serializeJson:(id)json error:(NSError *__autoreleasing *)error
 {
     *error = nil;
-    NSData *data = [NSJSONSerialization dataWithJSONObject:dict options:kNilOptions error:error];
+    NSData *data = [[http_request jsonCodec] encodeObject:json error:error];
     return data;
 }
 
++ (id<http_request_json_codec>)jsonCodec
+{
+    @synchronized([http_request class])
+    {
+        if (!_jsonCodec)
+        {
+            _jsonCodec = [http_request_foundation_json_codec new];
+        }
+
+        return _jsonCodec;
+    }
+}
+
++ (void)setJsonCodec:(id<http_request_json_codec>)codec
+{
+    @synchronized([http_request class])
+    {
+        _jsonCodec = codec;
+    }
+}
+
++ (http_request_json_stream_parser *)recordParserForResponse:(NSURLResponse *)response onRecord:(void (^)(id))record
+{
+    [http_request throwIfNil:response withName:@"response"];
+    [http_request throwIfNil:record withName:@"record"];
+
+    http_request_json_stream_parser *parser = nil;
+    NSString *mediaType = response.MIMEType;
+    if ([http_request isNotNil:mediaType])
+    {
+        if ([mediaType caseInsensitiveCompare:kApplicationNdjsonContentType] == NSOrderedSame)
+        {
+            parser = [[http_request_json_stream_parser alloc]
+                      initWithFormat:http_request_json_stream_format_ndjson
+                      onRecord:record];
+        }
+        else if ([mediaType caseInsensitiveCompare:kApplicationJsonContentType] == NSOrderedSame)
+        {
+            parser = [[http_request_json_stream_parser alloc]
+                      initWithFormat:http_request_json_stream_format_array
+                      onRecord:record];
+        }
+    }
+
+    return parser;
+}
+
 - (NSURLSessionDataTask *)getAsync:(NSURL *)url
                          onSuccess:(void (^)(NSURLResponse *, id))success
                            onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSURLSessionDataTask *task = [self getAsync:url withHeaders:nil onSuccess:success onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_get
+                                           url:url
+                                           headers:nil
+                                           body:nil];
+    return [self sendAsync:descriptor onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)getAsync:(NSURL *)url
@@ -225,13 +460,12 @@
                          onSuccess:(void (^)(NSURLResponse *, id))success
                            onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSMutableURLRequest *request = [http_request constructRequest:kGetHttpMethod withUrl:url withHeaders:headers withBody:nil];
-    NSURLSessionDataTask *task = [self issueAsync:request onSuccess:success onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_get
+                                           url:url
+                                           headers:headers
+                                           body:nil];
+    return [self sendAsync:descriptor onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)putAsync:(NSURL *)url
@@ -239,12 +473,12 @@
                          onSuccess:(void (^)(NSURLResponse *, id))success
                            onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSURLSessionDataTask *task = [self putAsync:url withHeaders:nil withBody:data onSuccess:success onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_put
+                                           url:url
+                                           headers:nil
+                                           body:data];
+    return [self sendAsync:descriptor onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)putAsync:(NSURL *)url
@@ -252,18 +486,12 @@
                          onSuccess:(void (^)(NSURLResponse *, id))success
                            onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSURLSessionDataTask *task = [self
-                                  callBodySerializeAndExecuteAsync:kPutHttpMethod
-                                  url:url
-                                  withHeaders:nil
-                                  withBody:dict
-                                  onSuccess:success
-                                  onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_put
+                                           url:url
+                                           headers:nil
+                                           body:nil];
+    return [self sendAsync:descriptor withBody:dict onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)putAsync:(NSURL *)url
@@ -271,18 +499,12 @@
                          onSuccess:(void (^)(NSURLResponse *, id))success
                            onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSURLSessionDataTask *task = [self
-                                  callBodySerializeAndExecuteAsync:kPutHttpMethod
-                                  url:url
-                                  withHeaders:nil
-                                  withBody:str
-                                  onSuccess:success
-                                  onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_put
+                                           url:url
+                                           headers:nil
+                                           body:nil];
+    return [self sendAsync:descriptor withBody:str onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)putAsync:(NSURL *)url
@@ -291,13 +513,12 @@
                          onSuccess:(void (^)(NSURLResponse *, id))success
                            onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSMutableURLRequest *request = [http_request constructRequest:kPutHttpMethod withUrl:url withHeaders:headers withBody:data];
-    NSURLSessionDataTask *task = [self issueAsync:request onSuccess:success onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_put
+                                           url:url
+                                           headers:headers
+                                           body:data];
+    return [self sendAsync:descriptor onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)putAsync:(NSURL *)url
@@ -306,18 +527,12 @@
                          onSuccess:(void (^)(NSURLResponse *, id))success
                            onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSURLSessionDataTask *task = [self
-                                  callBodySerializeAndExecuteAsync:kPutHttpMethod
-                                  url:url
-                                  withHeaders:headers
-                                  withBody:str
-                                  onSuccess:success
-                                  onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_put
+                                           url:url
+                                           headers:headers
+                                           body:nil];
+    return [self sendAsync:descriptor withBody:str onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)putAsync:(NSURL *)url
@@ -326,18 +541,12 @@
                          onSuccess:(void (^)(NSURLResponse *, id))success
                            onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSURLSessionDataTask *task = [self
-                                  callBodySerializeAndExecuteAsync:kPutHttpMethod
-                                  url:url
-                                  withHeaders:headers
-                                  withBody:dict
-                                  onSuccess:success
-                                  onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_put
+                                           url:url
+                                           headers:headers
+                                           body:nil];
+    return [self sendAsync:descriptor withBody:dict onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)postAsync:(NSURL *)url
@@ -345,12 +554,12 @@
                           onSuccess:(void (^)(NSURLResponse *, id))success
                             onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSURLSessionDataTask *task = [self postAsync:url withHeaders:nil withBody:data onSuccess:success onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_post
+                                           url:url
+                                           headers:nil
+                                           body:data];
+    return [self sendAsync:descriptor onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)postAsync:(NSURL *)url
@@ -358,18 +567,12 @@
                           onSuccess:(void (^)(NSURLResponse *, id))success
                             onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSURLSessionDataTask *task = [self
-                                  callBodySerializeAndExecuteAsync:kPostHttpMethod
-                                  url:url
-                                  withHeaders:nil
-                                  withBody:dict
-                                  onSuccess:success
-                                  onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_post
+                                           url:url
+                                           headers:nil
+                                           body:nil];
+    return [self sendAsync:descriptor withBody:dict onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)postAsync:(NSURL *)url
@@ -377,18 +580,12 @@
                           onSuccess:(void (^)(NSURLResponse *, id))success
                             onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSURLSessionDataTask *task = [self
-                                  callBodySerializeAndExecuteAsync:kPostHttpMethod
-                                  url:url
-                                  withHeaders:nil
-                                  withBody:str
-                                  onSuccess:success
-                                  onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_post
+                                           url:url
+                                           headers:nil
+                                           body:nil];
+    return [self sendAsync:descriptor withBody:str onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)postAsync:(NSURL *)url
@@ -397,13 +594,12 @@
                           onSuccess:(void (^)(NSURLResponse *, id))success
                             onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSMutableURLRequest *request = [http_request constructRequest:kPostHttpMethod withUrl:url withHeaders:headers withBody:data];
-    NSURLSessionDataTask *task = [self issueAsync:request onSuccess:success onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_post
+                                           url:url
+                                           headers:headers
+                                           body:data];
+    return [self sendAsync:descriptor onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)postAsync:(NSURL *)url
@@ -412,18 +608,12 @@
                           onSuccess:(void (^)(NSURLResponse *, id))success
                             onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSURLSessionDataTask *task = [self
-                                  callBodySerializeAndExecuteAsync:kPostHttpMethod
-                                  url:url
-                                  withHeaders:headers
-                                  withBody:dict
-                                  onSuccess:success
-                                  onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_post
+                                           url:url
+                                           headers:headers
+                                           body:nil];
+    return [self sendAsync:descriptor withBody:dict onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)postAsync:(NSURL *)url
@@ -432,18 +622,12 @@
                           onSuccess:(void (^)(NSURLResponse *, id))success
                             onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSURLSessionDataTask *task = [self
-                                  callBodySerializeAndExecuteAsync:kPostHttpMethod
-                                  url:url
-                                  withHeaders:headers
-                                  withBody:str
-                                  onSuccess:success
-                                  onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_post
+                                           url:url
+                                           headers:headers
+                                           body:nil];
+    return [self sendAsync:descriptor withBody:str onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)patchAsync:(NSURL *)url
@@ -451,12 +635,12 @@
                            onSuccess:(void (^)(NSURLResponse *, id))success
                              onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSURLSessionDataTask *task = [self patchAsync:url withHeaders:nil withBody:data onSuccess:success onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_patch
+                                           url:url
+                                           headers:nil
+                                           body:data];
+    return [self sendAsync:descriptor onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)patchAsync:(NSURL *)url
@@ -464,18 +648,12 @@
                            onSuccess:(void (^)(NSURLResponse *, id))success
                              onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSURLSessionDataTask *task = [self
-                                  callBodySerializeAndExecuteAsync:kPatchHttpMethod
-                                  url:url
-                                  withHeaders:nil
-                                  withBody:dict
-                                  onSuccess:success
-                                  onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_patch
+                                           url:url
+                                           headers:nil
+                                           body:nil];
+    return [self sendAsync:descriptor withBody:dict onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)patchAsync:(NSURL *)url
@@ -483,18 +661,12 @@
                            onSuccess:(void (^)(NSURLResponse *, id))success
                              onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSURLSessionDataTask *task = [self
-                                  callBodySerializeAndExecuteAsync:kPatchHttpMethod
-                                  url:url
-                                  withHeaders:nil
-                                  withBody:str
-                                  onSuccess:success
-                                  onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_patch
+                                           url:url
+                                           headers:nil
+                                           body:nil];
+    return [self sendAsync:descriptor withBody:str onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)patchAsync:(NSURL *)url
@@ -503,13 +675,12 @@
                            onSuccess:(void (^)(NSURLResponse *, id))success
                              onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSMutableURLRequest *request = [http_request constructRequest:kPatchHttpMethod withUrl:url withHeaders:headers withBody:data];
-    NSURLSessionDataTask *task = [self issueAsync:request onSuccess:success onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_patch
+                                           url:url
+                                           headers:headers
+                                           body:data];
+    return [self sendAsync:descriptor onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)patchAsync:(NSURL *)url
@@ -518,18 +689,12 @@
                            onSuccess:(void (^)(NSURLResponse *, id))success
                              onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSURLSessionDataTask *task = [self
-                                  callBodySerializeAndExecuteAsync:kPatchHttpMethod
-                                  url:url
-                                  withHeaders:headers
-                                  withBody:dict
-                                  onSuccess:success
-                                  onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_patch
+                                           url:url
+                                           headers:headers
+                                           body:nil];
+    return [self sendAsync:descriptor withBody:dict onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)patchAsync:(NSURL *)url
@@ -538,29 +703,24 @@
                            onSuccess:(void (^)(NSURLResponse *, id))success
                              onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    NSURLSessionDataTask *task = [self
-                                  callBodySerializeAndExecuteAsync:kPatchHttpMethod
-                                  url:url
-                                  withHeaders:headers
-                                  withBody:str
-                                  onSuccess:success
-                                  onError:error];
-    return task;
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_patch
+                                           url:url
+                                           headers:headers
+                                           body:nil];
+    return [self sendAsync:descriptor withBody:str onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)deleteAsync:(NSURL *)url
                             onSuccess:(void (^)(NSURLResponse *, id))success
                               onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
-    [http_request throwIfNil:success withName:@"success"];
-    [http_request throwIfNil:error withName:@"error"];
-
-    return [self deleteAsync:url withHeaders:nil onSuccess:success onError:error];
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_delete
+                                           url:url
+                                           headers:nil
+                                           body:nil];
+    return [self sendAsync:descriptor onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)deleteAsync:(NSURL *)url
@@ -568,13 +728,57 @@
                             onSuccess:(void (^)(NSURLResponse *, id))success
                               onError:(void (^)(NSError *))error
 {
-    [http_request throwIfNil:url withName:@"url"];
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_delete
+                                           url:url
+                                           headers:headers
+                                           body:nil];
+    return [self sendAsync:descriptor onSuccess:success onError:error];
+}
+
+- (NSURLSessionDataTask *)sendAsync:(http_request_descriptor *)descriptor
+                          onSuccess:(void (^)(NSURLResponse *, id))success
+                            onError:(void (^)(NSError *))error
+{
+    [http_request throwIfNil:descriptor withName:@"descriptor"];
+
+    return [self issueAsync:[descriptor request] onSuccess:success onError:error];
+}
+
+- (NSURLSessionDataTask *)sendAsync:(http_request_descriptor *)descriptor
+                           withBody:(id)body
+                          onSuccess:(void (^)(NSURLResponse *, id))success
+                            onError:(void (^)(NSError *))error
+{
+    [http_request throwIfNil:descriptor withName:@"descriptor"];
     [http_request throwIfNil:success withName:@"success"];
     [http_request throwIfNil:error withName:@"error"];
 
-    NSMutableURLRequest *request = [http_request constructRequest:kDeleteHttpMethod withUrl:url withHeaders:headers withBody:nil];
-    NSURLSessionDataTask *task = [self issueAsync:request onSuccess:success onError:error];
-    return task;
+    if ([body isKindOfClass:[http_request_multipart_body class]])
+    {
+        NSURLSessionUploadTask *task = [self
+                                        uploadAsync:[descriptor request]
+                                        fromMultipartBody:body
+                                        onProgress:nil
+                                        onSuccess:success
+                                        onError:error];
+        return task;
+    }
+
+    if (body)
+    {
+        NSError *serializationError = nil;
+        NSData *data = self.bodySerializer(body, &serializationError);
+        if (serializationError)
+        {
+            error(serializationError);
+            return nil;
+        }
+
+        descriptor = [descriptor descriptorWithBody:data];
+    }
+
+    return [self issueAsync:[descriptor request] onSuccess:success onError:error];
 }
 
 - (NSURLSessionDataTask *)issueAsync:(NSMutableURLRequest *)request
@@ -600,163 +804,2180 @@
                            onSuccess:(void (^)(NSURLResponse *, id))successCallback
                              onError:(void (^)(NSError *))errorCallback
 {
-    [http_request throwIfNil:request withName:@"request"];
-    [http_request throwIfNil:successCallback withName:@"successCallback"];
-    [http_request throwIfNil:errorCallback withName:@"errorCallback"];
+    NSURLSessionDataTask *task = [self
+                                  issueAsync:request
+                                  withBodyParser:bodyParser
+                                  withResponseValidation:validateResponse
+                                  withRetryPolicy:self.retryPolicy
+                                  onSuccess:successCallback
+                                  onError:errorCallback];
+    return task;
+}
 
-    NSURLSessionDataTask *dataTask = [_session
-                                      dataTaskWithRequest:request
-                                      completionHandler:^(NSData *data, NSURLResponse *response, NSError *error)
+- (NSURLSessionDataTask *)issueAsync:(NSMutableURLRequest *)request
+                      withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+              withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                     withRetryPolicy:(http_request_retry_policy *)retryPolicy
+                           onSuccess:(void (^)(NSURLResponse *, id))successCallback
+                             onError:(void (^)(NSError *))errorCallback
+{
+    [http_request throwIfNil:request withName:@"request"];
+    [http_request throwIfNil:successCallback withName:@"successCallback"];
+    [http_request throwIfNil:errorCallback withName:@"errorCallback"];
+
+    // Templates and compression are applied to a copy so that the caller's request is left as is and can be reissued.
+    request = [request mutableCopy];
+    [self.headerTemplates applyToRequest:request];
+    [self compressRequestBody:request];
+    NSDate *deadline = [http_request deadlineForRequest:request];
+    http_request_hedging_policy *hedgingPolicy = self.hedgingPolicy;
+    if (hedgingPolicy && ![hedgingPolicy shouldHedgeRequest:request])
+    {
+        hedgingPolicy = nil;
+    }
+
+    if (retryPolicy || hedgingPolicy || deadline)
+    {
+        NSURLSessionDataTask *task = [self
+                                      issueSupervisedAsync:request
+                                      withBodyParser:bodyParser
+                                      withResponseValidation:validateResponse
+                                      withRetryPolicy:retryPolicy
+                                      withHedgingPolicy:hedgingPolicy
+                                      withDeadline:deadline
+                                      onSuccess:successCallback
+                                      onError:errorCallback];
+        return task;
+    }
+
+    NSURLSessionDataTask *task = [self
+                                  issueOnceAsync:request
+                                  withBodyParser:bodyParser
+                                  withResponseValidation:validateResponse
+                                  onSuccess:successCallback
+                                  onError:errorCallback];
+    return task;
+}
+
+- (NSURLSessionUploadTask *)putAsync:(NSURL *)url
+                         withHeaders:(NSDictionary *)headers
+                            withFile:(NSURL *)fileUrl
+                          onProgress:(void (^)(int64_t, int64_t))progress
+                           onSuccess:(void (^)(NSURLResponse *, id))success
+                             onError:(void (^)(NSError *))error
+{
+    [http_request throwIfNil:url withName:@"url"];
+
+    NSMutableURLRequest *request = [http_request constructRequest:kPutHttpMethod withUrl:url withHeaders:headers withBody:nil];
+    NSURLSessionUploadTask *task = [self
+                                    uploadAsync:request
+                                    fromFile:fileUrl
+                                    onProgress:progress
+                                    onSuccess:success
+                                    onError:error];
+    return task;
+}
+
+- (NSURLSessionUploadTask *)putAsync:(NSURL *)url
+                         withHeaders:(NSDictionary *)headers
+                          withStream:(NSInputStream *)stream
+                          onProgress:(void (^)(int64_t, int64_t))progress
+                           onSuccess:(void (^)(NSURLResponse *, id))success
+                             onError:(void (^)(NSError *))error
+{
+    [http_request throwIfNil:url withName:@"url"];
+
+    NSMutableURLRequest *request = [http_request constructRequest:kPutHttpMethod withUrl:url withHeaders:headers withBody:nil];
+    NSURLSessionUploadTask *task = [self
+                                    uploadAsync:request
+                                    fromStream:stream
+                                    onProgress:progress
+                                    onSuccess:success
+                                    onError:error];
+    return task;
+}
+
+- (NSURLSessionUploadTask *)postAsync:(NSURL *)url
+                          withHeaders:(NSDictionary *)headers
+                             withFile:(NSURL *)fileUrl
+                           onProgress:(void (^)(int64_t, int64_t))progress
+                            onSuccess:(void (^)(NSURLResponse *, id))success
+                              onError:(void (^)(NSError *))error
+{
+    [http_request throwIfNil:url withName:@"url"];
+
+    NSMutableURLRequest *request = [http_request constructRequest:kPostHttpMethod withUrl:url withHeaders:headers withBody:nil];
+    NSURLSessionUploadTask *task = [self
+                                    uploadAsync:request
+                                    fromFile:fileUrl
+                                    onProgress:progress
+                                    onSuccess:success
+                                    onError:error];
+    return task;
+}
+
+- (NSURLSessionUploadTask *)postAsync:(NSURL *)url
+                          withHeaders:(NSDictionary *)headers
+                           withStream:(NSInputStream *)stream
+                           onProgress:(void (^)(int64_t, int64_t))progress
+                            onSuccess:(void (^)(NSURLResponse *, id))success
+                              onError:(void (^)(NSError *))error
+{
+    [http_request throwIfNil:url withName:@"url"];
+
+    NSMutableURLRequest *request = [http_request constructRequest:kPostHttpMethod withUrl:url withHeaders:headers withBody:nil];
+    NSURLSessionUploadTask *task = [self
+                                    uploadAsync:request
+                                    fromStream:stream
+                                    onProgress:progress
+                                    onSuccess:success
+                                    onError:error];
+    return task;
+}
+
+- (NSURLSessionUploadTask *)postAsync:(NSURL *)url
+                          withHeaders:(NSDictionary *)headers
+                    withMultipartBody:(http_request_multipart_body *)body
+                           onProgress:(void (^)(int64_t, int64_t))progress
+                            onSuccess:(void (^)(NSURLResponse *, id))success
+                              onError:(void (^)(NSError *))error
+{
+    [http_request throwIfNil:url withName:@"url"];
+
+    NSMutableURLRequest *request = [http_request constructRequest:kPostHttpMethod withUrl:url withHeaders:headers withBody:nil];
+    NSURLSessionUploadTask *task = [self
+                                    uploadAsync:request
+                                    fromMultipartBody:body
+                                    onProgress:progress
+                                    onSuccess:success
+                                    onError:error];
+    return task;
+}
+
+- (NSURLSessionUploadTask *)patchAsync:(NSURL *)url
+                           withHeaders:(NSDictionary *)headers
+                              withFile:(NSURL *)fileUrl
+                            onProgress:(void (^)(int64_t, int64_t))progress
+                             onSuccess:(void (^)(NSURLResponse *, id))success
+                               onError:(void (^)(NSError *))error
+{
+    [http_request throwIfNil:url withName:@"url"];
+
+    NSMutableURLRequest *request = [http_request constructRequest:kPatchHttpMethod withUrl:url withHeaders:headers withBody:nil];
+    NSURLSessionUploadTask *task = [self
+                                    uploadAsync:request
+                                    fromFile:fileUrl
+                                    onProgress:progress
+                                    onSuccess:success
+                                    onError:error];
+    return task;
+}
+
+- (NSURLSessionUploadTask *)patchAsync:(NSURL *)url
+                           withHeaders:(NSDictionary *)headers
+                            withStream:(NSInputStream *)stream
+                            onProgress:(void (^)(int64_t, int64_t))progress
+                             onSuccess:(void (^)(NSURLResponse *, id))success
+                               onError:(void (^)(NSError *))error
+{
+    [http_request throwIfNil:url withName:@"url"];
+
+    NSMutableURLRequest *request = [http_request constructRequest:kPatchHttpMethod withUrl:url withHeaders:headers withBody:nil];
+    NSURLSessionUploadTask *task = [self
+                                    uploadAsync:request
+                                    fromStream:stream
+                                    onProgress:progress
+                                    onSuccess:success
+                                    onError:error];
+    return task;
+}
+
+- (NSURLSessionUploadTask *)uploadAsync:(NSMutableURLRequest *)request
+                               fromFile:(NSURL *)fileUrl
+                             onProgress:(void (^)(int64_t, int64_t))progressCallback
+                              onSuccess:(void (^)(NSURLResponse *, id))successCallback
+                                onError:(void (^)(NSError *))errorCallback
+{
+    [http_request throwIfNil:request withName:@"request"];
+    [http_request throwIfNil:fileUrl withName:@"fileUrl"];
+    [http_request throwIfNil:successCallback withName:@"successCallback"];
+    [http_request throwIfNil:errorCallback withName:@"errorCallback"];
+
+    // Templates are applied to a copy so that the caller's request is left as is and can be reissued.
+    request = [request mutableCopy];
+    [self.headerTemplates applyToRequest:request];
+    NSURLSessionUploadTask *uploadTask = [_session uploadTaskWithRequest:request fromFile:fileUrl];
+    [self
+     issueUploadTask:uploadTask
+     forRequest:request
+     withBodyStream:nil
+     onProgress:progressCallback
+     onSuccess:successCallback
+     onError:errorCallback];
+    return uploadTask;
+}
+
+- (NSURLSessionUploadTask *)uploadAsync:(NSMutableURLRequest *)request
+                             fromStream:(NSInputStream *)stream
+                             onProgress:(void (^)(int64_t, int64_t))progressCallback
+                              onSuccess:(void (^)(NSURLResponse *, id))successCallback
+                                onError:(void (^)(NSError *))errorCallback
+{
+    [http_request throwIfNil:request withName:@"request"];
+    [http_request throwIfNil:stream withName:@"stream"];
+    [http_request throwIfNil:successCallback withName:@"successCallback"];
+    [http_request throwIfNil:errorCallback withName:@"errorCallback"];
+
+    // Templates are applied to a copy so that the caller's request is left as is and can be reissued.
+    request = [request mutableCopy];
+    [self.headerTemplates applyToRequest:request];
+    NSURLSessionUploadTask *uploadTask = [_session uploadTaskWithStreamedRequest:request];
+    [self
+     issueUploadTask:uploadTask
+     forRequest:request
+     withBodyStream:stream
+     onProgress:progressCallback
+     onSuccess:successCallback
+     onError:errorCallback];
+    return uploadTask;
+}
+
+- (NSURLSessionUploadTask *)uploadAsync:(NSMutableURLRequest *)request
+                      fromMultipartBody:(http_request_multipart_body *)body
+                             onProgress:(void (^)(int64_t, int64_t))progressCallback
+                              onSuccess:(void (^)(NSURLResponse *, id))successCallback
+                                onError:(void (^)(NSError *))errorCallback
+{
+    [http_request throwIfNil:request withName:@"request"];
+    [http_request throwIfNil:body withName:@"body"];
+    [http_request throwIfNil:successCallback withName:@"successCallback"];
+    [http_request throwIfNil:errorCallback withName:@"errorCallback"];
+
+    // A part which cannot be read aborts the upload, which then fails with the error of the part.
+    __block NSError *partError = nil;
+    __block __weak NSURLSessionUploadTask *weakUploadTask = nil;
+    NSInputStream *stream = [body
+                             inputStreamOnError:^(NSError *error)
+                             {
+                                 NSURLSessionUploadTask *uploadTask = nil;
+                                 @synchronized(body)
+                                 {
+                                     partError = error;
+                                     uploadTask = weakUploadTask;
+                                 }
+
+                                 [uploadTask cancel];
+                             }];
+    // The headers of the body are set on a copy so that the caller's request is left as is.
+    request = [request mutableCopy];
+    [body applyToRequest:request];
+    NSURLSessionUploadTask *task = [self
+                                    uploadAsync:request
+                                    fromStream:stream
+                                    onProgress:progressCallback
+                                    onSuccess:successCallback
+                                    onError:^(NSError *error)
+                                    {
+                                        NSError *uploadError = nil;
+                                        @synchronized(body)
+                                        {
+                                            uploadError = partError ?: error;
+                                        }
+
+                                        errorCallback(uploadError);
+                                    }];
+    BOOL failed = NO;
+    @synchronized(body)
+    {
+        weakUploadTask = task;
+        failed = partError != nil;
+    }
+
+    if (failed)
+    {
+        [task cancel];
+    }
+
+    return task;
+}
+
+- (NSURLSessionDownloadTask *)downloadAsync:(NSURL *)url
+                                     toFile:(NSURL *)fileUrl
+                                 onProgress:(void (^)(int64_t, int64_t))progress
+                                  onSuccess:(void (^)(NSURLResponse *, NSURL *))success
+                                    onError:(void (^)(NSError *))error
+{
+    [http_request throwIfNil:url withName:@"url"];
+
+    NSMutableURLRequest *request = [http_request constructRequest:kGetHttpMethod withUrl:url withHeaders:nil withBody:nil];
+    NSURLSessionDownloadTask *task = [self
+                                      issueDownloadAsync:request
+                                      toFile:fileUrl
+                                      atOffset:0
+                                      onProgress:progress
+                                      onSuccess:success
+                                      onError:error];
+    return task;
+}
+
+- (http_request_download *)downloadAsync:(NSURL *)url
+                                  toFile:(NSURL *)fileUrl
+                         withConnections:(NSUInteger)connectionCount
+                              onProgress:(void (^)(int64_t, int64_t))progress
+                               onSuccess:(void (^)(NSURLResponse *, NSURL *))success
+                                 onError:(void (^)(NSError *))error
+{
+    [http_request throwIfNil:url withName:@"url"];
+    [http_request throwIfNil:fileUrl withName:@"fileUrl"];
+    [http_request throwIfNil:success withName:@"success"];
+    [http_request throwIfNil:error withName:@"error"];
+
+    NSUInteger maxConnectionCount = MAX(connectionCount, (NSUInteger)1);
+    http_request_download *download = [http_request_download new];
+    NSMutableURLRequest *headRequest = [http_request constructRequest:kHeadHttpMethod withUrl:url withHeaders:nil withBody:nil];
+    [self.headerTemplates applyToRequest:headRequest];
+    NSURLSessionDataTask *headTask = [_session
+                                      dataTaskWithRequest:headRequest
+                                      completionHandler:^(NSData *data, NSURLResponse *response, NSError *headError)
                                       {
                                           [self
-                                           dataTaskCompletionHandler:response
-                                           withBody:data
-                                           withBodyParser:bodyParser
-                                           withResponseValidation:validateResponse
-                                           error:error
-                                           onSuccess:successCallback
-                                           onError:errorCallback];
+                                           downloadRanges:url
+                                           toFile:fileUrl
+                                           withConnections:maxConnectionCount
+                                           withHeadResponse:(NSHTTPURLResponse *)response
+                                           forDownload:download
+                                           onProgress:progress
+                                           onSuccess:success
+                                           onError:error];
                                       }];
-    [dataTask resume];
+    if ([download addTask:headTask])
+    {
+        [headTask resume];
+    }
+
+    return download;
+}
+
+- (NSURLSessionDownloadTask *)resumeDownloadAsync:(NSData *)resumeData
+                                           toFile:(NSURL *)fileUrl
+                                       onProgress:(void (^)(int64_t, int64_t))progress
+                                        onSuccess:(void (^)(NSURLResponse *, NSURL *))success
+                                          onError:(void (^)(NSError *))error
+{
+    [http_request throwIfNil:resumeData withName:@"resumeData"];
+    [http_request throwIfNil:fileUrl withName:@"fileUrl"];
+    [http_request throwIfNil:success withName:@"success"];
+    [http_request throwIfNil:error withName:@"error"];
+
+    NSURLSessionDownloadTask *downloadTask = [_session downloadTaskWithResumeData:resumeData];
+    [self
+     issueDownloadTask:downloadTask
+     toFile:fileUrl
+     atOffset:0
+     requiringPartialContent:NO
+     onProgress:progress
+     onSuccess:success
+     onError:error];
+    return downloadTask;
+}
+
+- (NSURLSessionDownloadTask *)continueDownloadAsync:(NSURL *)url
+                                             toFile:(NSURL *)fileUrl
+                                         onProgress:(void (^)(int64_t, int64_t))progress
+                                          onSuccess:(void (^)(NSURLResponse *, NSURL *))success
+                                            onError:(void (^)(NSError *))error
+{
+    [http_request throwIfNil:url withName:@"url"];
+    [http_request throwIfNil:fileUrl withName:@"fileUrl"];
+    [http_request throwIfNil:success withName:@"success"];
+    [http_request throwIfNil:error withName:@"error"];
+
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:[fileUrl path] error:nil];
+    int64_t offset = (int64_t)[attributes fileSize];
+    NSDictionary *headers = offset > 0 ? @{@"Range":[NSString stringWithFormat:@"bytes=%lld-", offset]} : nil;
+    NSMutableURLRequest *request = [http_request constructRequest:kGetHttpMethod withUrl:url withHeaders:headers withBody:nil];
+    [self.headerTemplates applyToRequest:request];
+    NSURLSessionDownloadTask *downloadTask = [_session downloadTaskWithRequest:request];
+    __weak NSURLSessionDownloadTask *weakDownloadTask = downloadTask;
+    [self
+     issueDownloadTask:downloadTask
+     toFile:fileUrl
+     atOffset:offset
+     requiringPartialContent:NO
+     onProgress:progress == nil ? nil : ^(int64_t written, int64_t expected)
+     {
+         // A full response replaces the file, so the existing part only counts when the range was honored.
+         int64_t existingLength = ((NSHTTPURLResponse *)weakDownloadTask.response).statusCode == 206 ? offset : 0;
+         progress(existingLength + written, expected < 0 ? expected : existingLength + expected);
+     }
+     onSuccess:success
+     onError:error];
+    return downloadTask;
+}
+
+- (NSURLSessionDownloadTask *)issueDownloadAsync:(NSMutableURLRequest *)request
+                                          toFile:(NSURL *)fileUrl
+                                        atOffset:(int64_t)offset
+                                      onProgress:(void (^)(int64_t, int64_t))progressCallback
+                                       onSuccess:(void (^)(NSURLResponse *, NSURL *))successCallback
+                                         onError:(void (^)(NSError *))errorCallback
+{
+    [http_request throwIfNil:request withName:@"request"];
+    [http_request throwIfNil:fileUrl withName:@"fileUrl"];
+    [http_request throwIfNil:successCallback withName:@"successCallback"];
+    [http_request throwIfNil:errorCallback withName:@"errorCallback"];
+
+    // Templates are applied to a copy so that the caller's request is left as is and can be reissued.
+    request = [request mutableCopy];
+    [self.headerTemplates applyToRequest:request];
+    NSURLSessionDownloadTask *downloadTask = [_session downloadTaskWithRequest:request];
+    [self
+     issueDownloadTask:downloadTask
+     toFile:fileUrl
+     atOffset:offset
+     requiringPartialContent:NO
+     onProgress:progressCallback
+     onSuccess:successCallback
+     onError:errorCallback];
+    return downloadTask;
+}
+
+- (http_request_future *)getFuture:(NSURL *)url withHeaders:(NSDictionary *)headers
+{
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_get
+                                           url:url
+                                           headers:headers
+                                           body:nil];
+    return [self sendFuture:descriptor withBody:nil];
+}
+
+- (http_request_future *)putFuture:(NSURL *)url withHeaders:(NSDictionary *)headers withBody:(id)body
+{
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_put
+                                           url:url
+                                           headers:headers
+                                           body:nil];
+    return [self sendFuture:descriptor withBody:body];
+}
+
+- (http_request_future *)postFuture:(NSURL *)url withHeaders:(NSDictionary *)headers withBody:(id)body
+{
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_post
+                                           url:url
+                                           headers:headers
+                                           body:nil];
+    return [self sendFuture:descriptor withBody:body];
+}
+
+- (http_request_future *)patchFuture:(NSURL *)url withHeaders:(NSDictionary *)headers withBody:(id)body
+{
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_patch
+                                           url:url
+                                           headers:headers
+                                           body:nil];
+    return [self sendFuture:descriptor withBody:body];
+}
+
+- (http_request_future *)deleteFuture:(NSURL *)url withHeaders:(NSDictionary *)headers
+{
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_delete
+                                           url:url
+                                           headers:headers
+                                           body:nil];
+    return [self sendFuture:descriptor withBody:nil];
+}
+
+- (http_request_future *)sendFuture:(http_request_descriptor *)descriptor withBody:(id)body
+{
+    [http_request throwIfNil:descriptor withName:@"descriptor"];
+
+    if ([body isKindOfClass:[http_request_multipart_body class]])
+    {
+        // Streamed through an upload task, as sendAsync does, rather than read into memory first.
+        return [self
+                futureOfTask:^NSURLSessionTask *(void (^success)(NSURLResponse *, id), void (^error)(NSError *))
+                {
+                    return [self
+                            uploadAsync:[descriptor request]
+                            fromMultipartBody:body
+                            onProgress:nil
+                            onSuccess:success
+                            onError:error];
+                }];
+    }
+
+    if (body)
+    {
+        NSError *serializationError = nil;
+        NSData *data = self.bodySerializer(body, &serializationError);
+        if (serializationError)
+        {
+            return [http_request_future futureWithError:serializationError];
+        }
+
+        descriptor = [descriptor descriptorWithBody:data];
+    }
+
+    return [self issueFuture:[descriptor request]];
+}
+
+- (http_request_future *)issueFuture:(NSMutableURLRequest *)request
+{
+    [http_request throwIfNil:request withName:@"request"];
+
+    return [self
+            futureOfTask:^NSURLSessionTask *(void (^success)(NSURLResponse *, id), void (^error)(NSError *))
+            {
+                return [self issueAsync:request onSuccess:success onError:error];
+            }];
+}
+
+- (http_request_batch *)batchAsync:(NSArray *)requests
+                    maxConcurrency:(NSUInteger)maxConcurrency
+                          delivery:(http_request_batch_delivery)delivery
+                          onResult:(void (^)(http_request_batch_result *))resultCallback
+                        onComplete:(void (^)(NSArray *))completeCallback
+{
+    http_request_batch *batch = [[http_request_batch alloc]
+                                 initWithRequests:requests
+                                 maxConcurrency:maxConcurrency
+                                 delivery:delivery
+                                 onResult:resultCallback
+                                 onComplete:completeCallback];
+    [batch startWithHttpRequest:self];
+    return batch;
+}
+
+- (NSURLSessionDataTask *)streamAsync:(NSMutableURLRequest *)request
+                              onChunk:(void (^)(NSData *))chunk
+                           onComplete:(void (^)(NSURLResponse *))complete
+                              onError:(void (^)(NSError *))error
+{
+    [http_request throwIfNil:request withName:@"request"];
+    [http_request throwIfNil:chunk withName:@"chunk"];
+    [http_request throwIfNil:complete withName:@"complete"];
+    [http_request throwIfNil:error withName:@"error"];
+
+    NSURLSessionDataTask *task = [self
+                                  streamAsync:request
+                                  withBodyParser:self.bodyParser
+                                  withResponseValidation:self.responseValidator
+                                  onChunk:chunk
+                                  onComplete:complete
+                                  onError:error];
+    return task;
+}
+
+- (NSURLSessionDataTask *)streamAsync:(NSMutableURLRequest *)request
+                       withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+               withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                              onChunk:(void (^)(NSData *))chunkCallback
+                           onComplete:(void (^)(NSURLResponse *))completeCallback
+                              onError:(void (^)(NSError *))errorCallback
+{
+    [http_request throwIfNil:request withName:@"request"];
+    [http_request throwIfNil:chunkCallback withName:@"chunkCallback"];
+    [http_request throwIfNil:completeCallback withName:@"completeCallback"];
+    [http_request throwIfNil:errorCallback withName:@"errorCallback"];
+
+    NSURLSessionDataTask *task = [self
+                                  streamAsync:request
+                                  withBodyParser:bodyParser
+                                  withResponseValidation:validateResponse
+                                  onResponse:nil
+                                  onChunk:chunkCallback
+                                  onComplete:completeCallback
+                                  onError:errorCallback];
+    return task;
+}
+
+- (NSURLSessionDataTask *)recordStreamAsync:(NSMutableURLRequest *)request
+                                   onRecord:(void (^)(id))recordCallback
+                                 onComplete:(void (^)(NSURLResponse *))completeCallback
+                                    onError:(void (^)(NSError *))errorCallback
+{
+    [http_request throwIfNil:request withName:@"request"];
+    [http_request throwIfNil:recordCallback withName:@"recordCallback"];
+    [http_request throwIfNil:completeCallback withName:@"completeCallback"];
+    [http_request throwIfNil:errorCallback withName:@"errorCallback"];
+
+    // All of the stream callbacks are delivered serially, hence the unsynchronized shared state.
+    http_request_json_stream_parser *(^recordParserFactory)(NSURLResponse *, void(^)(id)) = self.recordParserFactory;
+    __block http_request_json_stream_parser *parser = nil;
+    __block NSError *recordError = nil;
+    __block __weak NSURLSessionDataTask *weakTask = nil;
+    NSURLSessionDataTask *task = [self
+                                  streamAsync:request
+                                  withBodyParser:self.bodyParser
+                                  withResponseValidation:self.responseValidator
+                                  onResponse:^(NSURLResponse *response)
+                                  {
+                                      parser = recordParserFactory(response, recordCallback);
+                                      if (!parser)
+                                      {
+                                          recordError = [[NSError alloc]
+                                                         initWithDomain:kHttpRequestDomain
+                                                         code:-4
+                                                         userInfo:@{NSLocalizedDescriptionKey:@"Unsupported content type for record streaming.",
+                                                                    @"Response":response}];
+                                          [weakTask cancel];
+                                      }
+                                  }
+                                  onChunk:^(NSData *chunk)
+                                  {
+                                      NSError *parsingError = nil;
+                                      if (!recordError && ![parser appendData:chunk error:&parsingError])
+                                      {
+                                          recordError = parsingError;
+                                          [weakTask cancel];
+                                      }
+                                  }
+                                  onComplete:^(NSURLResponse *response)
+                                  {
+                                      NSError *parsingError = nil;
+                                      if (recordError || ![parser finish:&parsingError])
+                                      {
+                                          errorCallback(recordError ?: parsingError);
+                                      }
+                                      else
+                                      {
+                                          completeCallback(response);
+                                      }
+                                  }
+                                  onError:^(NSError *error)
+                                  {
+                                      errorCallback(recordError ?: error);
+                                  }];
+    weakTask = task;
+    return task;
+}
+
+#pragma mark - Internal API
+
+- (http_request_future *)futureOfTask:(NSURLSessionTask *(^)(void (^)(NSURLResponse *, id), void (^)(NSError *)))issue
+{
+    http_request_future *future = [http_request_future new];
+    NSURLSessionTask *task = issue(^(NSURLResponse *response, id body)
+                                   {
+                                       [future completeWithValue:body error:nil response:response];
+                                   },
+                                   ^(NSError *error)
+                                   {
+                                       [future
+                                        completeWithValue:nil
+                                        error:error
+                                        response:[error.userInfo objectForKey:@"Response"]];
+                                   });
+
+    // The task is held strongly since handle tasks (retries, coalescing) are not retained by the session; the cycle
+    // through its completion handler is broken once the future completes.
+    [future setCancellation:^
+     {
+         [task cancel];
+     }];
+    return future;
+}
+
+- (NSURLSessionDataTask *)streamAsync:(NSMutableURLRequest *)request
+                       withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+               withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                           onResponse:(void (^)(NSURLResponse *))responseCallback
+                              onChunk:(void (^)(NSData *))chunkCallback
+                           onComplete:(void (^)(NSURLResponse *))completeCallback
+                              onError:(void (^)(NSError *))errorCallback
+{
+    NSUInteger bufferLimit = MAX(self.streamBufferLimit, (NSUInteger)1);
+    // Templates are applied to a copy so that the caller's request is left as is and can be reissued.
+    request = [request mutableCopy];
+    [self.headerTemplates applyToRequest:request];
+    NSURLSessionDataTask *dataTask = [_session dataTaskWithRequest:request];
+    __weak NSURLSessionDataTask *weakDataTask = dataTask;
+    http_request_stream_context *context = [http_request_stream_context new];
+    context.deliveryQueue = dispatch_queue_create("http-request.stream", DISPATCH_QUEUE_SERIAL);
+
+    http_request_task_handler *handler = [http_request_task_handler new];
+    handler.onResponse = ^BOOL (NSURLResponse *response)
+    {
+        context.response = response;
+        NSError *validationError = nil;
+        if (validateResponse && !validateResponse(response, nil, &validationError))
+        {
+            // Keep the (bounded) body of an invalid response so that the error can carry it.
+            context.invalidResponse = YES;
+            context.validationError = validationError;
+            context.errorBody = [NSMutableData new];
+        }
+        else if (responseCallback)
+        {
+            dispatch_async(context.deliveryQueue, ^
+            {
+                responseCallback(response);
+            });
+        }
+
+        return YES;
+    };
+    handler.onData = ^(NSData *data)
+    {
+        if (context.invalidResponse)
+        {
+            if (context.errorBody && context.errorBody.length + data.length > bufferLimit)
+            {
+                context.errorBody = nil;
+                [weakDataTask cancel];
+            }
+            else
+            {
+                [context.errorBody appendData:data];
+            }
+
+            return;
+        }
+
+        BOOL suspend = NO;
+        @synchronized(context)
+        {
+            context.pendingBytes += data.length;
+            if (!context.suspended && context.pendingBytes > bufferLimit)
+            {
+                context.suspended = YES;
+                suspend = YES;
+            }
+        }
+
+        if (suspend)
+        {
+            [weakDataTask suspend];
+        }
+
+        dispatch_async(context.deliveryQueue, ^
+        {
+            chunkCallback(data);
+            BOOL resume = NO;
+            @synchronized(context)
+            {
+                context.pendingBytes -= data.length;
+                if (context.suspended && context.pendingBytes <= bufferLimit / 2)
+                {
+                    context.suspended = NO;
+                    resume = YES;
+                }
+            }
+
+            if (resume)
+            {
+                [weakDataTask resume];
+            }
+        });
+    };
+    handler.onComplete = ^(NSError *error)
+    {
+        [self taskDidComplete:weakDataTask];
+        dispatch_async(context.deliveryQueue, ^
+        {
+            [self
+             streamCompletionHandler:context
+             withBodyParser:bodyParser
+             withResponseValidation:validateResponse
+             error:error
+             onComplete:completeCallback
+             onError:errorCallback];
+        });
+    };
+
+    [_sessionDelegate setHandler:handler forTask:dataTask];
+    [self resumeTask:dataTask onResume:nil];
     return dataTask;
 }
 
-#pragma mark - Internal API
++ (void)throwIfNil:(id)parameter withName:(NSString *)parameterName
+{
+    if (![http_request isNotNil:parameter])
+    {
+        [NSException
+         raise:kHttpRequestDomain
+         format:@"Invalid parameter value%@. Expected non-nil value!",
+         parameterName
+         ? [NSString stringWithFormat:@"%@%@%@", @" \"", parameterName, @"\""]
+         : @""];
+    }
+}
+
++ (BOOL)isNotNil:(id)value
+{
+    return value && ![value isKindOfClass:[NSNull class]];
+}
+
++ (void)raiseExceptionOnInvalidStatusCodeRange:(int)statusCode
+{
+    if (statusCode < 100 || statusCode >= 600)
+    {
+        @throw [NSException exceptionWithName:NSInternalInconsistencyException
+                                       reason:@"Invalid status code value: not within range"
+                                     userInfo:nil];
+    }
+}
+
++ (BOOL)mostSignificantDigitEquals:(int)value1 equals:(int)value2
+{
+    int mostSignificantDigit = [http_request getMostSignificantDigit:(int)value1];
+    BOOL equals = mostSignificantDigit == value2;
+    return equals;
+}
+
++ (int)getMostSignificantDigit:(int)value
+{
+    int numberOfDigits = (int)log10(value);
+    return value / pow(10, numberOfDigits);
+}
+
++ (BOOL)isCoalescableRequest:(NSURLRequest *)request
+{
+    NSString *method = request.HTTPMethod;
+    return ([method caseInsensitiveCompare:kGetHttpMethod] == NSOrderedSame
+            || [method caseInsensitiveCompare:kHeadHttpMethod] == NSOrderedSame)
+           && !request.HTTPBody
+           && !request.HTTPBodyStream;
+}
+
++ (NSString *)coalescingKeyForRequest:(NSURLRequest *)request
+                       withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+               withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+{
+    NSMutableString *key = [NSMutableString
+                            stringWithFormat:@"%@ %@ %p %p",
+                            [request.HTTPMethod uppercaseString],
+                            [request.URL absoluteString],
+                            bodyParser,
+                            validateResponse];
+    NSDictionary *headers = [request allHTTPHeaderFields];
+    for (NSString *name in [[headers allKeys] sortedArrayUsingSelector:@selector(caseInsensitiveCompare:)])
+    {
+        [key appendFormat:@"\n%@: %@", [name lowercaseString], [headers objectForKey:name]];
+    }
+
+    return key;
+}
+
+- (void)dataTaskCompletionHandler:(NSURLResponse *)response
+                         withBody:(NSData *)data
+                   withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+           withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                      withMetrics:(http_request_metrics *)metrics
+                            error:(NSError *)error
+                        onSuccess:(void (^)(NSURLResponse *, id))successCallback
+                          onError:(void (^)(NSError *))errorCallback
+{
+    metrics.statusCode = [response isKindOfClass:[NSHTTPURLResponse class]] ? ((NSHTTPURLResponse *)response).statusCode : 0;
+    metrics.bytesReceived = data.length;
+    metrics.encodedBytesReceived = data.length;
+    if (metrics && [response isKindOfClass:[NSHTTPURLResponse class]])
+    {
+        NSDictionary *headers = [(NSHTTPURLResponse *)response allHeaderFields];
+        NSString *contentEncoding = [headers valueForKey:@"Content-Encoding"];
+        NSString *contentLength = [headers valueForKey:@"Content-Length"];
+        if ([http_request isNotNil:contentEncoding]
+            && [contentEncoding caseInsensitiveCompare:@"identity"] != NSOrderedSame
+            && [http_request isNotNil:contentLength])
+        {
+            metrics.encodedBytesReceived = (unsigned long long)[contentLength longLongValue];
+        }
+    }
+
+    if (!error)
+    {
+        id parsedData = data;
+        NSError *parsingError = nil;
+        if (bodyParser && data)
+        {
+            CFAbsoluteTime parseStart = CFAbsoluteTimeGetCurrent();
+            parsedData = bodyParser(response, data, &parsingError);
+            [metrics addDuration:CFAbsoluteTimeGetCurrent() - parseStart toPhase:http_request_metrics_phase_parse];
+        }
+
+        if (!parsingError)
+        {
+            if (validateResponse)
+            {
+                NSError *validationError = nil;
+                CFAbsoluteTime validationStart = CFAbsoluteTimeGetCurrent();
+                BOOL validResponse = validateResponse(response, parsedData, &validationError);
+                [metrics addDuration:CFAbsoluteTimeGetCurrent() - validationStart toPhase:http_request_metrics_phase_validation];
+                if (validResponse)
+                {
+                    [self
+                     dispatchCallback:^
+                     {
+                         successCallback(response, parsedData);
+                     }
+                     withMetrics:metrics];
+                }
+                else
+                {
+                    metrics.failed = YES;
+                    [self
+                     dispatchCallback:^
+                     {
+                         errorCallback(validationError);
+                     }
+                     withMetrics:metrics];
+                }
+            }
+            else
+            {
+                [self
+                 dispatchCallback:^
+                 {
+                     successCallback(response, parsedData);
+                 }
+                 withMetrics:metrics];
+            }
+        }
+        else
+        {
+            NSError *verboseParsingError = [[NSError alloc]
+                                            initWithDomain:kHttpRequestDomain
+                                            code:-3
+                                            userInfo:@{NSLocalizedDescriptionKey:@"Unsuccessful body parsing.",
+                                                       @"Error":parsingError,
+                                                       @"Response":(NSHTTPURLResponse *)response,
+                                                       @"Body":data}];
+            metrics.failed = YES;
+            [self
+             dispatchCallback:^
+             {
+                 errorCallback(verboseParsingError);
+             }
+             withMetrics:metrics];
+        }
+    }
+    else
+    {
+        metrics.failed = YES;
+        [self
+         dispatchCallback:^
+         {
+             errorCallback(error);
+         }
+         withMetrics:metrics];
+    }
+}
+
+- (void)issueUploadTask:(NSURLSessionUploadTask *)uploadTask
+             forRequest:(NSURLRequest *)request
+         withBodyStream:(NSInputStream *)bodyStream
+             onProgress:(void (^)(int64_t, int64_t))progressCallback
+              onSuccess:(void (^)(NSURLResponse *, id))successCallback
+                onError:(void (^)(NSError *))errorCallback
+{
+    // The upload is driven by the session delegate so that progress is reported; only the response body is buffered.
+    http_request_metrics *metrics = [self metricsForRequest:request];
+    id (^bodyParser)(NSURLResponse *, NSData *, NSError *__autoreleasing *) = self.bodyParser;
+    BOOL (^validateResponse)(NSURLResponse *, id, NSError *__autoreleasing *) = self.responseValidator;
+    NSMutableData *responseData = [NSMutableData new];
+    __block CFAbsoluteTime resumeTime = metrics.issueTime;
+    __weak NSURLSessionUploadTask *weakUploadTask = uploadTask;
+    http_request_task_handler *handler = [http_request_task_handler new];
+    handler.bodyStream = bodyStream;
+    handler.onSendProgress = progressCallback;
+    handler.onData = ^(NSData *data)
+    {
+        [responseData appendData:data];
+    };
+    handler.onComplete = ^(NSError *error)
+    {
+        NSURLSessionUploadTask *strongUploadTask = weakUploadTask;
+        [self taskDidComplete:strongUploadTask];
+        CFAbsoluteTime networkEnd = CFAbsoluteTimeGetCurrent();
+        [metrics addDuration:networkEnd - resumeTime toPhase:http_request_metrics_phase_network];
+        metrics.bytesSent = strongUploadTask.countOfBytesSent;
+        NSURLResponse *response = strongUploadTask.response;
+        [self dispatchParsing:^
+         {
+             [metrics
+              addDuration:CFAbsoluteTimeGetCurrent() - networkEnd
+              toPhase:http_request_metrics_phase_dispatch_wait];
+             [self
+              dataTaskCompletionHandler:response
+              withBody:responseData
+              withBodyParser:bodyParser
+              withResponseValidation:validateResponse
+              withMetrics:metrics
+              error:error
+              onSuccess:successCallback
+              onError:errorCallback];
+         }];
+    };
+    [_sessionDelegate setHandler:handler forTask:uploadTask];
+    [self
+     resumeTask:uploadTask
+     onResume:^
+     {
+         resumeTime = CFAbsoluteTimeGetCurrent();
+         [metrics addDuration:resumeTime - metrics.issueTime toPhase:http_request_metrics_phase_queue_wait];
+     }];
+}
+
++ (BOOL)moveDownloadedFile:(NSURL *)temporaryUrl toFile:(NSURL *)fileUrl atOffset:(int64_t)offset error:(NSError *__autoreleasing *)error
+{
+    *error = nil;
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    if (offset < 0)
+    {
+        [fileManager removeItemAtURL:fileUrl error:nil];
+        return [fileManager moveItemAtURL:temporaryUrl toURL:fileUrl error:error];
+    }
+
+    // A partial response is copied in bounded chunks so that memory does not depend on the size of the range.
+    if (![fileManager fileExistsAtPath:[fileUrl path]])
+    {
+        [fileManager createFileAtPath:[fileUrl path] contents:nil attributes:nil];
+    }
+
+    NSFileHandle *input = [NSFileHandle fileHandleForReadingFromURL:temporaryUrl error:error];
+    NSFileHandle *output = input ? [NSFileHandle fileHandleForWritingToURL:fileUrl error:error] : nil;
+    if (!output)
+    {
+        return NO;
+    }
+
+    BOOL moved = YES;
+    @try
+    {
+        [output seekToFileOffset:(unsigned long long)offset];
+        NSData *chunk = nil;
+        do
+        {
+            @autoreleasepool
+            {
+                chunk = [input readDataOfLength:kDefaultStreamBufferLimit];
+                [output writeData:chunk];
+            }
+        }
+        while (chunk.length > 0);
+    }
+    @catch (NSException *exception)
+    {
+        *error = [[NSError alloc]
+                  initWithDomain:kHttpRequestDomain
+                  code:-5
+                  userInfo:@{NSLocalizedDescriptionKey:@"Unsuccessful download write.", @"Error":exception.reason ?: @""}];
+        moved = NO;
+    }
+
+    [input closeFile];
+    [output closeFile];
+    return moved;
+}
+
+- (void)issueDownloadTask:(NSURLSessionDownloadTask *)downloadTask
+                   toFile:(NSURL *)fileUrl
+                 atOffset:(int64_t)offset
+  requiringPartialContent:(BOOL)requiresPartialContent
+               onProgress:(void (^)(int64_t, int64_t))progressCallback
+                onSuccess:(void (^)(NSURLResponse *, NSURL *))successCallback
+                  onError:(void (^)(NSError *))errorCallback
+{
+    // The downloaded file is deleted once the delegate returns, so it is moved aside before validation.
+    __block NSURL *temporaryUrl = nil;
+    __weak NSURLSessionDownloadTask *weakDownloadTask = downloadTask;
+    http_request_task_handler *handler = [http_request_task_handler new];
+    handler.onDownloadProgress = progressCallback;
+    handler.onDownloaded = ^(NSURL *location)
+    {
+        NSString *temporaryName = [NSString stringWithFormat:@"http-request-%@", [[NSUUID UUID] UUIDString]];
+        NSURL *movedUrl = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:temporaryName]];
+        if ([[NSFileManager defaultManager] moveItemAtURL:location toURL:movedUrl error:nil])
+        {
+            temporaryUrl = movedUrl;
+        }
+    };
+    handler.onComplete = ^(NSError *error)
+    {
+        [self taskDidComplete:weakDownloadTask];
+        NSURLResponse *response = weakDownloadTask.response;
+        NSURL *downloadedUrl = temporaryUrl;
+        [self dispatchParsing:^
+         {
+             [self
+              downloadCompletionHandler:response
+              withTemporaryFile:downloadedUrl
+              toFile:fileUrl
+              atOffset:offset
+              requiringPartialContent:requiresPartialContent
+              error:error
+              onSuccess:successCallback
+              onError:errorCallback];
+         }];
+    };
+    [_sessionDelegate setHandler:handler forTask:downloadTask];
+    [self resumeTask:downloadTask onResume:nil];
+}
+
+- (void)downloadCompletionHandler:(NSURLResponse *)response
+                withTemporaryFile:(NSURL *)temporaryUrl
+                           toFile:(NSURL *)fileUrl
+                         atOffset:(int64_t)offset
+          requiringPartialContent:(BOOL)requiresPartialContent
+                            error:(NSError *)error
+                        onSuccess:(void (^)(NSURLResponse *, NSURL *))successCallback
+                          onError:(void (^)(NSError *))errorCallback
+{
+    NSError *downloadError = error;
+    if (!downloadError)
+    {
+        BOOL (^validateResponse)(NSURLResponse *, id, NSError *__autoreleasing *) = self.responseValidator;
+        NSError *validationError = nil;
+        if (validateResponse && !validateResponse(response, fileUrl, &validationError))
+        {
+            // Hand a bounded error body to the validator again so that the error carries it.
+            id (^bodyParser)(NSURLResponse *, NSData *, NSError *__autoreleasing *) = self.bodyParser;
+            NSData *data = temporaryUrl ? [NSData dataWithContentsOfURL:temporaryUrl options:NSDataReadingMappedIfSafe error:nil] : nil;
+            if (data.length > 0 && data.length <= self.streamBufferLimit)
+            {
+                NSError *parsingError = nil;
+                id parsedData = bodyParser ? bodyParser(response, data, &parsingError) : data;
+                NSError *verboseValidationError = nil;
+                if (!parsingError && !validateResponse(response, parsedData, &verboseValidationError) && verboseValidationError)
+                {
+                    validationError = verboseValidationError;
+                }
+            }
+
+            downloadError = validationError;
+        }
+        else if (!temporaryUrl)
+        {
+            downloadError = [[NSError alloc]
+                             initWithDomain:kHttpRequestDomain
+                             code:-5
+                             userInfo:@{NSLocalizedDescriptionKey:@"Unsuccessful download write."}];
+        }
+        else if (requiresPartialContent && ((NSHTTPURLResponse *)response).statusCode != 206)
+        {
+            // The server ignored the range, so the body is not the part of the file it is meant to be written to.
+            downloadError = [[NSError alloc]
+                             initWithDomain:kHttpRequestDomain
+                             code:-9
+                             userInfo:@{NSLocalizedDescriptionKey:@"Unsatisfied range request.", @"Response":response}];
+        }
+        else
+        {
+            NSInteger statusCode = ((NSHTTPURLResponse *)response).statusCode;
+            NSError *moveError = nil;
+            [http_request
+             moveDownloadedFile:temporaryUrl
+             toFile:fileUrl
+             atOffset:statusCode == 206 ? offset : -1
+             error:&moveError];
+            downloadError = moveError;
+        }
+    }
+
+    if (temporaryUrl)
+    {
+        [[NSFileManager defaultManager] removeItemAtURL:temporaryUrl error:nil];
+    }
+
+    [self dispatchCallback:^
+     {
+         if (downloadError)
+         {
+             errorCallback(downloadError);
+         }
+         else
+         {
+             successCallback(response, fileUrl);
+         }
+     }];
+}
+
+- (void)downloadRanges:(NSURL *)url
+                toFile:(NSURL *)fileUrl
+       withConnections:(NSUInteger)connectionCount
+      withHeadResponse:(NSHTTPURLResponse *)headResponse
+           forDownload:(http_request_download *)download
+            onProgress:(void (^)(int64_t, int64_t))progressCallback
+             onSuccess:(void (^)(NSURLResponse *, NSURL *))successCallback
+               onError:(void (^)(NSError *))errorCallback
+{
+    int64_t length = headResponse.expectedContentLength;
+    NSString *acceptRanges = [[headResponse allHeaderFields] valueForKey:@"Accept-Ranges"];
+    BOOL rangesSupported = headResponse.statusCode == 200
+                           && [acceptRanges rangeOfString:@"bytes" options:NSCaseInsensitiveSearch].location != NSNotFound
+                           && length >= (int64_t)kDefaultMinimumRangeLength * 2;
+    NSUInteger rangeCount = rangesSupported ? (NSUInteger)MIN((int64_t)connectionCount, length / kDefaultMinimumRangeLength) : 1;
+    [download setTotalBytesExpected:rangesSupported ? length : NSURLSessionTransferSizeUnknown];
+    if (rangeCount > 1)
+    {
+        // Reserve the whole file up front so that every range is written in place.
+        [[NSFileManager defaultManager] removeItemAtURL:fileUrl error:nil];
+        [[NSFileManager defaultManager] createFileAtPath:[fileUrl path] contents:nil attributes:nil];
+        NSFileHandle *reservation = [NSFileHandle fileHandleForWritingToURL:fileUrl error:nil];
+        [reservation truncateFileAtOffset:(unsigned long long)length];
+        [reservation closeFile];
+    }
+
+    __block NSUInteger pendingCount = rangeCount;
+    __block BOOL failed = NO;
+    __block NSURLResponse *firstResponse = nil;
+    int64_t rangeLength = length / rangeCount;
+    for (NSUInteger range = 0; range < rangeCount; range++)
+    {
+        int64_t start = range * rangeLength;
+        int64_t end = range == rangeCount - 1 ? length - 1 : start + rangeLength - 1;
+        NSDictionary *headers = rangeCount > 1 ? @{@"Range":[NSString stringWithFormat:@"bytes=%lld-%lld", start, end]} : nil;
+        NSMutableURLRequest *request = [http_request constructRequest:kGetHttpMethod withUrl:url withHeaders:headers withBody:nil];
+        [self.headerTemplates applyToRequest:request];
+        NSURLSessionDownloadTask *downloadTask = [_session downloadTaskWithRequest:request];
+        __weak NSURLSessionDownloadTask *weakDownloadTask = downloadTask;
+        [self
+         issueDownloadTask:downloadTask
+         toFile:fileUrl
+         atOffset:rangeCount > 1 ? start : -1
+         requiringPartialContent:rangeCount > 1
+         onProgress:^(int64_t written, int64_t expected)
+         {
+             int64_t totalWritten = [download setBytesWritten:written forTask:weakDownloadTask];
+             if (progressCallback)
+             {
+                 progressCallback(totalWritten, download.totalBytesExpected);
+             }
+         }
+         onSuccess:^(NSURLResponse *response, NSURL *downloadedUrl)
+         {
+             BOOL completed = NO;
+             @synchronized(download)
+             {
+                 firstResponse = firstResponse ?: response;
+                 completed = --pendingCount == 0 && !failed;
+             }
+
+             if (completed)
+             {
+                 successCallback(firstResponse, fileUrl);
+             }
+         }
+         onError:^(NSError *rangeError)
+         {
+             BOOL first = NO;
+             @synchronized(download)
+             {
+                 first = !failed;
+                 failed = YES;
+             }
+
+             if (!first)
+             {
+                 return;
+             }
+
+             if (rangeCount > 1 && [rangeError.domain isEqualToString:kHttpRequestDomain] && rangeError.code == -9
+                 && [download reset])
+             {
+                 // The server does not honor ranges after all: fetch the whole file over a single connection.
+                 [self
+                  downloadRanges:url
+                  toFile:fileUrl
+                  withConnections:1
+                  withHeadResponse:headResponse
+                  forDownload:download
+                  onProgress:progressCallback
+                  onSuccess:successCallback
+                  onError:errorCallback];
+                 return;
+             }
+
+             [download cancel];
+             errorCallback(rangeError);
+         }];
+        if (![download addTask:downloadTask])
+        {
+            [downloadTask cancel];
+        }
+    }
+}
+
+- (void)resumeTask:(NSURLSessionTask *)task onResume:(void (^)(void))resumeCallback
+{
+    http_request_scheduler *scheduler = self.scheduler;
+    if (scheduler)
+    {
+        [scheduler
+         scheduleTask:task
+         withPriority:[http_request_scheduler priorityForRequest:task.originalRequest]
+         onResume:resumeCallback];
+        return;
+    }
+
+    if (resumeCallback)
+    {
+        resumeCallback();
+    }
+
+    [task resume];
+}
+
+- (void)taskDidComplete:(NSURLSessionTask *)task
+{
+    if (task)
+    {
+        [self.scheduler taskDidComplete:task];
+    }
+}
+
+- (void)dispatchParsing:(void (^)(void))block
+{
+    NSOperationQueue *parsingQueue = self.parsingQueue;
+    if (parsingQueue)
+    {
+        [parsingQueue addOperationWithBlock:block];
+    }
+    else
+    {
+        block();
+    }
+}
 
-+ (void)throwIfNil:(id)parameter withName:(NSString *)parameterName
+- (void)dispatchCallback:(void (^)(void))block
 {
-    if (![http_request isNotNil:parameter])
+    NSOperationQueue *callbackQueue = self.callbackQueue;
+    if (callbackQueue)
     {
-        [NSException
-         raise:kHttpRequestDomain
-         format:@"Invalid parameter value%@. Expected non-nil value!",
-         parameterName
-         ? [NSString stringWithFormat:@"%@%@%@", @" \"", parameterName, @"\""]
-         : @""];
+        [callbackQueue addOperationWithBlock:block];
+    }
+    else if ([NSOperationQueue currentQueue] == _session.delegateQueue)
+    {
+        block();
+    }
+    else
+    {
+        // The parsing queue is concurrent, so the callbacks are serialized on the session delegate queue instead.
+        [_session.delegateQueue addOperationWithBlock:block];
     }
 }
 
-+ (BOOL)isNotNil:(id)value
+- (void)dispatchCallback:(void (^)(void))block withMetrics:(http_request_metrics *)metrics
 {
-    return value && ![value isKindOfClass:[NSNull class]];
+    id<http_request_metrics_sink> metricsSink = self.metricsSink;
+    if (!metrics || !metricsSink)
+    {
+        [self dispatchCallback:block];
+        return;
+    }
+
+    CFAbsoluteTime dispatchTime = CFAbsoluteTimeGetCurrent();
+    [self dispatchCallback:^
+     {
+         CFAbsoluteTime callbackStart = CFAbsoluteTimeGetCurrent();
+         [metrics addDuration:callbackStart - dispatchTime toPhase:http_request_metrics_phase_dispatch_wait];
+         block();
+         CFAbsoluteTime callbackEnd = CFAbsoluteTimeGetCurrent();
+         [metrics addDuration:callbackEnd - callbackStart toPhase:http_request_metrics_phase_callback];
+         [metrics addDuration:callbackEnd - metrics.issueTime toPhase:http_request_metrics_phase_total];
+         [metricsSink recordMetrics:metrics];
+     }];
 }
 
-+ (void)raiseExceptionOnInvalidStatusCodeRange:(int)statusCode
+- (void)compressRequestBody:(NSMutableURLRequest *)request
 {
-    if (statusCode < 100 || statusCode >= 600)
+    NSString *encoding = self.requestContentEncoding;
+    NSData *body = request.HTTPBody;
+    if (!encoding
+        || body.length == 0
+        || body.length < self.requestCompressionThreshold
+        || [http_request isNotNil:[request valueForHTTPHeaderField:@"Content-Encoding"]])
     {
-        @throw [NSException exceptionWithName:NSInternalInconsistencyException
-                                       reason:@"Invalid status code value: not within range"
-                                     userInfo:nil];
+        return;
+    }
+
+    NSData *compressedBody = [http_request_compression compressData:body withEncoding:encoding];
+    if (compressedBody && compressedBody.length < body.length)
+    {
+        [NSURLProtocol setProperty:@(body.length) forKey:kHttpRequestUncompressedLengthKey inRequest:request];
+        [request setValue:[encoding lowercaseString] forHTTPHeaderField:@"Content-Encoding"];
+        [request setValue:[NSString stringWithFormat:@"%lu", (unsigned long)compressedBody.length] forHTTPHeaderField:@"Content-Length"];
+        request.HTTPBody = compressedBody;
     }
 }
 
-+ (BOOL)mostSignificantDigitEquals:(int)value1 equals:(int)value2
+- (http_request_metrics *)metricsForRequest:(NSURLRequest *)request
 {
-    int mostSignificantDigit = [http_request getMostSignificantDigit:(int)value1];
-    BOOL equals = mostSignificantDigit == value2;
-    return equals;
+    if (!self.metricsSink)
+    {
+        return nil;
+    }
+
+    http_request_metrics *metrics = [http_request_metrics new];
+    metrics.method = [request.HTTPMethod uppercaseString];
+    metrics.host = [request.URL.host lowercaseString];
+    metrics.bytesSent = request.HTTPBody.length;
+    NSNumber *uncompressedLength = [NSURLProtocol propertyForKey:kHttpRequestUncompressedLengthKey inRequest:request];
+    metrics.uncompressedBytesSent = uncompressedLength ? [uncompressedLength unsignedLongLongValue] : metrics.bytesSent;
+    metrics.issueTime = CFAbsoluteTimeGetCurrent();
+    return metrics;
 }
 
-+ (int)getMostSignificantDigit:(int)value
+- (NSURLSessionDataTask *)issueOnceAsync:(NSMutableURLRequest *)request
+                           withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+                   withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                                onSuccess:(void (^)(NSURLResponse *, id))successCallback
+                                  onError:(void (^)(NSError *))errorCallback
 {
-    int numberOfDigits = (int)log10(value);
-    return value / pow(10, numberOfDigits);
+    if (self.coalescesRequests && [http_request isCoalescableRequest:request])
+    {
+        NSURLSessionDataTask *task = [self
+                                      issueCoalescedAsync:request
+                                      withBodyParser:bodyParser
+                                      withResponseValidation:validateResponse
+                                      onSuccess:successCallback
+                                      onError:errorCallback];
+        return task;
+    }
+
+    NSURLSessionDataTask *task = [self
+                                  issueDirectAsync:request
+                                  withBodyParser:bodyParser
+                                  withResponseValidation:validateResponse
+                                  onSuccess:successCallback
+                                  onError:errorCallback];
+    return task;
+}
+
+- (NSURLSessionDataTask *)issueSupervisedAsync:(NSMutableURLRequest *)request
+                                 withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+                         withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                                withRetryPolicy:(http_request_retry_policy *)retryPolicy
+                              withHedgingPolicy:(http_request_hedging_policy *)hedgingPolicy
+                                   withDeadline:(NSDate *)deadline
+                                      onSuccess:(void (^)(NSURLResponse *, id))successCallback
+                                        onError:(void (^)(NSError *))errorCallback
+{
+    // The attempts come and go: the caller gets a task which is never resumed and represents all of them.
+    http_request_attempt_state *state = [http_request_attempt_state new];
+    state.attemptTasks = [NSMutableArray new];
+    state.deadline = deadline;
+    NSURLSessionDataTask *handleTask = [_session
+                                        dataTaskWithRequest:request
+                                        completionHandler:^(NSData *data, NSURLResponse *response, NSError *error)
+                                        {
+                                            NSArray *attemptTasks = [self finishAttempts:state];
+                                            if (!attemptTasks)
+                                            {
+                                                return;
+                                            }
+
+                                            [attemptTasks makeObjectsPerformSelector:@selector(cancel)];
+                                            [self dispatchCallback:^
+                                             {
+                                                 errorCallback(error);
+                                             }];
+                                        }];
+    state.handleTask = handleTask;
+    if (deadline)
+    {
+        dispatch_source_t deadlineTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER,
+                                                                 0,
+                                                                 0,
+                                                                 dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+        dispatch_source_set_timer(deadlineTimer,
+                                  dispatch_time(DISPATCH_TIME_NOW, (int64_t)(MAX([deadline timeIntervalSinceNow], 0) * NSEC_PER_SEC)),
+                                  DISPATCH_TIME_FOREVER,
+                                  0);
+        dispatch_source_set_event_handler(deadlineTimer, ^
+        {
+            NSArray *attemptTasks = [self finishAttempts:state];
+            if (!attemptTasks)
+            {
+                return;
+            }
+
+            [attemptTasks makeObjectsPerformSelector:@selector(cancel)];
+            NSError *deadlineError = [[NSError alloc]
+                                      initWithDomain:NSURLErrorDomain
+                                      code:NSURLErrorTimedOut
+                                      userInfo:@{NSLocalizedDescriptionKey:@"Deadline exceeded."}];
+            [self dispatchCallback:^
+             {
+                 errorCallback(deadlineError);
+             }];
+            [state.handleTask cancel];
+        });
+        state.deadlineTimer = deadlineTimer;
+        dispatch_resume(deadlineTimer);
+    }
+
+    [retryPolicy.budget depositForRequest];
+    [self
+     issueAttempt:request
+     withBodyParser:bodyParser
+     withResponseValidation:validateResponse
+     withRetryPolicy:retryPolicy
+     withHedgingPolicy:hedgingPolicy
+     withAttemptState:state
+     asHedge:NO
+     onSuccess:successCallback
+     onError:errorCallback];
+    NSTimeInterval hedgeDelay = [hedgingPolicy hedgeDelay];
+    if (hedgingPolicy && hedgeDelay >= 0 && (!deadline || hedgeDelay < [deadline timeIntervalSinceNow]))
+    {
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(hedgeDelay * NSEC_PER_SEC)),
+                       dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^
+        {
+            // Hedge the attempt still in flight, unless it already completed or failed over to a retry.
+            @synchronized(state)
+            {
+                if (state.finished || state.hedged || state.retryCount > 0 || state.inFlightCount == 0)
+                {
+                    return;
+                }
+
+                state.hedged = YES;
+            }
+
+            if (hedgingPolicy.budget && ![hedgingPolicy.budget withdrawForRetry])
+            {
+                return;
+            }
+
+            [hedgingPolicy recordHedge];
+            [self
+             issueAttempt:request
+             withBodyParser:bodyParser
+             withResponseValidation:validateResponse
+             withRetryPolicy:retryPolicy
+             withHedgingPolicy:hedgingPolicy
+             withAttemptState:state
+             asHedge:YES
+             onSuccess:successCallback
+             onError:errorCallback];
+        });
+    }
+
+    return handleTask;
 }
 
-- (NSURLSessionDataTask *)callBodySerializeAndExecuteAsync:(NSString *)method
-                                                       url:(NSURL *)url
-                                               withHeaders:(NSDictionary *)headers
-                                                  withBody:(id)body
-                                                 onSuccess:(void (^)(NSURLResponse *, id))success
-                                                   onError:(void (^)(NSError *))error
+- (void)issueAttempt:(NSMutableURLRequest *)request
+      withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+     withRetryPolicy:(http_request_retry_policy *)retryPolicy
+   withHedgingPolicy:(http_request_hedging_policy *)hedgingPolicy
+    withAttemptState:(http_request_attempt_state *)state
+             asHedge:(BOOL)hedge
+           onSuccess:(void (^)(NSURLResponse *, id))successCallback
+             onError:(void (^)(NSError *))errorCallback
 {
-    NSError *serializationError = nil;
-    NSData *data = self.bodySerializer(body, &serializationError);
-    NSURLSessionDataTask *task = nil;
-    if (!serializationError)
+    NSMutableURLRequest *attemptRequest = request;
+    NSDate *deadline = state.deadline;
+    if (deadline)
+    {
+        // The deadline timer fails the operation once it passes; until then, no attempt may outlive it.
+        NSTimeInterval remainingTime = [deadline timeIntervalSinceNow];
+        if (remainingTime <= 0)
+        {
+            return;
+        }
+
+        attemptRequest = [request mutableCopy];
+        attemptRequest.timeoutInterval = MIN(request.timeoutInterval, remainingTime);
+    }
+
+    @synchronized(state)
     {
-        if ([kPutHttpMethod caseInsensitiveCompare:method] == NSOrderedSame)
+        if (state.finished)
+        {
+            return;
+        }
+
+        state.inFlightCount++;
+    }
+
+    CFAbsoluteTime attemptStart = CFAbsoluteTimeGetCurrent();
+    void (^attemptSuccessCallback)(NSURLResponse *, id) = ^(NSURLResponse *response, id body)
+    {
+        [hedgingPolicy recordLatency:CFAbsoluteTimeGetCurrent() - attemptStart];
+        NSArray *attemptTasks = [self finishAttempts:state];
+        if (!attemptTasks)
+        {
+            return;
+        }
+
+        // The first attempt to succeed wins: the other one, if any, is cancelled.
+        [attemptTasks makeObjectsPerformSelector:@selector(cancel)];
+        if (hedge)
+        {
+            [hedgingPolicy recordHedgeWin];
+        }
+
+        successCallback(response, body);
+        [state.handleTask cancel];
+    };
+    void (^attemptErrorCallback)(NSError *) = ^(NSError *error)
+    {
+        NSUInteger retry = 0;
+        @synchronized(state)
+        {
+            // While another attempt is in flight, its outcome decides.
+            if (state.finished || --state.inFlightCount > 0)
+            {
+                return;
+            }
+
+            retry = ++state.retryCount;
+        }
+
+        NSTimeInterval delay = [retryPolicy delayBeforeRetry:retry afterError:error];
+        BOOL retried = retryPolicy
+                       && delay >= 0
+                       && (!deadline || delay < [deadline timeIntervalSinceNow])
+                       && [retryPolicy shouldRetryRequest:request afterError:error retry:retry]
+                       && (!retryPolicy.budget || [retryPolicy.budget withdrawForRetry]);
+        if (retried)
         {
-            task = [self putAsync:url withHeaders:headers withBody:data onSuccess:success onError:error];
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)),
+                           dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^
+            {
+                [self
+                 issueAttempt:request
+                 withBodyParser:bodyParser
+                 withResponseValidation:validateResponse
+                 withRetryPolicy:retryPolicy
+                 withHedgingPolicy:hedgingPolicy
+                 withAttemptState:state
+                 asHedge:NO
+                 onSuccess:successCallback
+                 onError:errorCallback];
+            });
+            return;
         }
-        else if ([kPostHttpMethod caseInsensitiveCompare:method] == NSOrderedSame)
+
+        if (![self finishAttempts:state])
         {
-            task = [self postAsync:url withHeaders:headers withBody:data onSuccess:success onError:error];
+            return;
         }
-        else if ([kPatchHttpMethod caseInsensitiveCompare:method] == NSOrderedSame)
+
+        errorCallback(error);
+        [state.handleTask cancel];
+    };
+    NSURLSessionDataTask *attemptTask = hedge
+                                        ? [self
+                                           issueDirectAsync:attemptRequest
+                                           withBodyParser:bodyParser
+                                           withResponseValidation:validateResponse
+                                           onSuccess:attemptSuccessCallback
+                                           onError:attemptErrorCallback]
+                                        : [self
+                                           issueOnceAsync:attemptRequest
+                                           withBodyParser:bodyParser
+                                           withResponseValidation:validateResponse
+                                           onSuccess:attemptSuccessCallback
+                                           onError:attemptErrorCallback];
+    BOOL finished = NO;
+    @synchronized(state)
+    {
+        finished = state.finished;
+        if (!finished)
         {
-            task = [self patchAsync:url withHeaders:headers withBody:data onSuccess:success onError:error];
+            [state.attemptTasks addObject:attemptTask];
         }
     }
-    else
+
+    if (finished)
     {
-        error(serializationError);
+        [attemptTask cancel];
     }
-    
-    return task;
 }
 
-- (void)dataTaskCompletionHandler:(NSURLResponse *)response
-                         withBody:(NSData *)data
-                   withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
-           withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
-                            error:(NSError *)error
-                        onSuccess:(void (^)(NSURLResponse *, id))successCallback
-                          onError:(void (^)(NSError *))errorCallback
+- (NSArray *)finishAttempts:(http_request_attempt_state *)state
 {
-    if (!error)
+    NSArray *attemptTasks = nil;
+    dispatch_source_t deadlineTimer = nil;
+    @synchronized(state)
     {
-        id parsedData = data;
-        NSError *parsingError = nil;
-        if (bodyParser && data)
+        if (state.finished)
         {
-            parsedData = bodyParser(response, data, &parsingError);
+            return nil;
         }
 
-        if (!parsingError)
+        state.finished = YES;
+        attemptTasks = [state.attemptTasks copy];
+        [state.attemptTasks removeAllObjects];
+        deadlineTimer = state.deadlineTimer;
+        state.deadlineTimer = nil;
+    }
+
+    if (deadlineTimer)
+    {
+        dispatch_source_cancel(deadlineTimer);
+    }
+
+    return attemptTasks;
+}
+
+- (NSURLSessionDataTask *)issueDirectAsync:(NSMutableURLRequest *)request
+                             withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+                     withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                                  onSuccess:(void (^)(NSURLResponse *, id))successCallback
+                                    onError:(void (^)(NSError *))errorCallback
+{
+    http_request_metrics *metrics = [self metricsForRequest:request];
+    http_request_cache *cache = self.cache;
+    if (cache && [request.HTTPMethod caseInsensitiveCompare:kGetHttpMethod] == NSOrderedSame)
+    {
+        NSURLSessionDataTask *task = [self
+                                      issueCachedAsync:request
+                                      withCache:cache
+                                      withBodyParser:bodyParser
+                                      withResponseValidation:validateResponse
+                                      withMetrics:metrics
+                                      onSuccess:successCallback
+                                      onError:errorCallback];
+        return task;
+    }
+
+    http_request_circuit_breaker *circuitBreaker = self.circuitBreaker;
+    NSString *route = circuitBreaker ? [circuitBreaker routeOfRequest:request] : nil;
+    NSUInteger probeToken = 0;
+    NSError *admissionError = nil;
+    if (circuitBreaker && ![circuitBreaker acquireRoute:route probeToken:&probeToken error:&admissionError])
+    {
+        return [self rejectedTask:request withError:admissionError withMetrics:metrics onError:errorCallback];
+    }
+
+    __block CFAbsoluteTime resumeTime = metrics.issueTime;
+    __block __weak NSURLSessionDataTask *weakDataTask = nil;
+    NSURLSessionDataTask *dataTask = [_session
+                                      dataTaskWithRequest:request
+                                      completionHandler:^(NSData *data, NSURLResponse *response, NSError *error)
+                                      {
+                                          [self taskDidComplete:weakDataTask];
+                                          CFAbsoluteTime networkEnd = CFAbsoluteTimeGetCurrent();
+                                          [metrics addDuration:networkEnd - resumeTime toPhase:http_request_metrics_phase_network];
+                                          [circuitBreaker
+                                           releaseRoute:route
+                                           probeToken:probeToken
+                                           withResponse:response
+                                           error:error
+                                           latency:networkEnd - resumeTime];
+                                          if (response && !error)
+                                          {
+                                              [self.recorder
+                                               recordRequest:request
+                                               response:response
+                                               body:data
+                                               startTime:resumeTime
+                                               duration:networkEnd - resumeTime];
+                                          }
+
+                                          [self dispatchParsing:^
+                                           {
+                                               [metrics
+                                                addDuration:CFAbsoluteTimeGetCurrent() - networkEnd
+                                                toPhase:http_request_metrics_phase_dispatch_wait];
+                                               [self
+                                                dataTaskCompletionHandler:response
+                                                withBody:data
+                                                withBodyParser:bodyParser
+                                                withResponseValidation:validateResponse
+                                                withMetrics:metrics
+                                                error:error
+                                                onSuccess:successCallback
+                                                onError:errorCallback];
+                                           }];
+                                      }];
+    weakDataTask = dataTask;
+    [self
+     resumeTask:dataTask
+     onResume:^
+     {
+         resumeTime = CFAbsoluteTimeGetCurrent();
+         [metrics addDuration:resumeTime - metrics.issueTime toPhase:http_request_metrics_phase_queue_wait];
+     }];
+    return dataTask;
+}
+
+- (NSURLSessionDataTask *)issueCoalescedAsync:(NSMutableURLRequest *)request
+                                withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+                        withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                                     onSuccess:(void (^)(NSURLResponse *, id))successCallback
+                                       onError:(void (^)(NSError *))errorCallback
+{
+    NSString *key = [http_request
+                     coalescingKeyForRequest:request
+                     withBodyParser:bodyParser
+                     withResponseValidation:validateResponse];
+    http_request_coalesced_caller *caller = [http_request_coalesced_caller new];
+    caller.successCallback = successCallback;
+    caller.errorCallback = errorCallback;
+
+    // Every caller gets its own task which is never resumed: cancelling it only detaches that caller.
+    NSURLSessionDataTask *callerTask = [_session
+                                        dataTaskWithRequest:request
+                                        completionHandler:^(NSData *data, NSURLResponse *response, NSError *error)
+                                        {
+                                            [self detachCoalescedCaller:caller forKey:key withError:error];
+                                        }];
+    caller.task = callerTask;
+
+    http_request_coalesced_fetch *fetch = nil;
+    BOOL startFetch = NO;
+    @synchronized(_coalescedFetches)
+    {
+        fetch = [_coalescedFetches objectForKey:key];
+        if (!fetch)
         {
-            if (validateResponse)
+            fetch = [http_request_coalesced_fetch new];
+            fetch.callers = [NSMutableArray new];
+            [_coalescedFetches setObject:fetch forKey:key];
+            startFetch = YES;
+        }
+
+        [fetch.callers addObject:caller];
+    }
+
+    if (startFetch)
+    {
+        fetch.task = [self
+                      issueDirectAsync:request
+                      withBodyParser:bodyParser
+                      withResponseValidation:validateResponse
+                      onSuccess:^(NSURLResponse *response, id body)
+                      {
+                          for (http_request_coalesced_caller *caller in [self completeCoalescedFetch:fetch forKey:key])
+                          {
+                              caller.successCallback(response, body);
+                              [caller.task cancel];
+                          }
+                      }
+                      onError:^(NSError *error)
+                      {
+                          for (http_request_coalesced_caller *caller in [self completeCoalescedFetch:fetch forKey:key])
+                          {
+                              caller.errorCallback(error);
+                              [caller.task cancel];
+                          }
+                      }];
+        @synchronized(_coalescedFetches)
+        {
+            // Every caller may have detached before the fetch was issued.
+            if (fetch.callers.count == 0 && [_coalescedFetches objectForKey:key] != fetch)
             {
-                NSError *validationError = nil;
-                BOOL validResponse = validateResponse(response, parsedData, &validationError);
-                if (validResponse)
-                {
-                    successCallback(response, parsedData);
-                }
-                else
-                {
-                    errorCallback(validationError);
-                }
+                [fetch.task cancel];
             }
-            else
+        }
+    }
+
+    return callerTask;
+}
+
+- (NSArray *)completeCoalescedFetch:(http_request_coalesced_fetch *)fetch forKey:(NSString *)key
+{
+    @synchronized(_coalescedFetches)
+    {
+        NSArray *callers = [fetch.callers copy];
+        [fetch.callers removeAllObjects];
+        if ([_coalescedFetches objectForKey:key] == fetch)
+        {
+            [_coalescedFetches removeObjectForKey:key];
+        }
+
+        return callers;
+    }
+}
+
+- (void)detachCoalescedCaller:(http_request_coalesced_caller *)caller forKey:(NSString *)key withError:(NSError *)error
+{
+    BOOL detached = NO;
+    NSURLSessionDataTask *abandonedTask = nil;
+    @synchronized(_coalescedFetches)
+    {
+        http_request_coalesced_fetch *fetch = [_coalescedFetches objectForKey:key];
+        if ([fetch.callers containsObject:caller])
+        {
+            detached = YES;
+            [fetch.callers removeObject:caller];
+            if (fetch.callers.count == 0)
+            {
+                [_coalescedFetches removeObjectForKey:key];
+                abandonedTask = fetch.task;
+            }
+        }
+    }
+
+    if (detached)
+    {
+        [abandonedTask cancel];
+        [self dispatchCallback:^
+         {
+             caller.errorCallback(error);
+         }];
+    }
+}
+
+- (NSURLSessionDataTask *)issueCachedAsync:(NSMutableURLRequest *)request
+                                  withCache:(http_request_cache *)cache
+                             withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+                     withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                                withMetrics:(http_request_metrics *)metrics
+                                  onSuccess:(void (^)(NSURLResponse *, id))successCallback
+                                    onError:(void (^)(NSError *))errorCallback
+{
+    http_request_cache_entry *entry = [cache entryForRequest:request];
+    if (entry && [cache isFreshEntry:entry forRequest:request])
+    {
+        // Served without contacting the server: the task only represents the operation and is never resumed.
+        NSURLSessionDataTask *placeholderTask = [_session dataTaskWithRequest:request];
+        metrics.cached = YES;
+        CFAbsoluteTime dispatchTime = CFAbsoluteTimeGetCurrent();
+        [self dispatchParsing:^
+         {
+             [metrics
+              addDuration:CFAbsoluteTimeGetCurrent() - dispatchTime
+              toPhase:http_request_metrics_phase_dispatch_wait];
+             [self
+              cacheEntryCompletionHandler:entry
+              withBodyParser:bodyParser
+              withMetrics:metrics
+              onSuccess:successCallback
+              onError:errorCallback];
+             [placeholderTask cancel];
+         }];
+        return placeholderTask;
+    }
+
+    NSMutableURLRequest *networkRequest = entry && [entry canBeRevalidated]
+                                          ? [cache conditionalRequest:request forEntry:entry]
+                                          : [request mutableCopy];
+    networkRequest.cachePolicy = NSURLRequestReloadIgnoringLocalCacheData;
+    http_request_circuit_breaker *circuitBreaker = self.circuitBreaker;
+    NSString *route = circuitBreaker ? [circuitBreaker routeOfRequest:networkRequest] : nil;
+    NSUInteger probeToken = 0;
+    NSError *admissionError = nil;
+    if (circuitBreaker && ![circuitBreaker acquireRoute:route probeToken:&probeToken error:&admissionError])
+    {
+        return [self rejectedTask:request withError:admissionError withMetrics:metrics onError:errorCallback];
+    }
+
+    __block CFAbsoluteTime resumeTime = metrics.issueTime;
+    __block __weak NSURLSessionDataTask *weakDataTask = nil;
+    NSURLSessionDataTask *dataTask = [_session
+                                      dataTaskWithRequest:networkRequest
+                                      completionHandler:^(NSData *data, NSURLResponse *response, NSError *error)
+                                      {
+                                          [self taskDidComplete:weakDataTask];
+                                          CFAbsoluteTime networkEnd = CFAbsoluteTimeGetCurrent();
+                                          [metrics addDuration:networkEnd - resumeTime toPhase:http_request_metrics_phase_network];
+                                          [circuitBreaker
+                                           releaseRoute:route
+                                           probeToken:probeToken
+                                           withResponse:response
+                                           error:error
+                                           latency:networkEnd - resumeTime];
+                                          if (response && !error)
+                                          {
+                                              [self.recorder
+                                               recordRequest:networkRequest
+                                               response:response
+                                               body:data
+                                               startTime:resumeTime
+                                               duration:networkEnd - resumeTime];
+                                          }
+
+                                          [self dispatchParsing:^
+                                           {
+                                               [metrics
+                                                addDuration:CFAbsoluteTimeGetCurrent() - networkEnd
+                                                toPhase:http_request_metrics_phase_dispatch_wait];
+                                               NSHTTPURLResponse *httpResponse = (NSHTTPURLResponse *)response;
+                                               if (!error && entry && httpResponse.statusCode == 304)
+                                               {
+                                                   http_request_cache_entry *refreshedEntry = [cache
+                                                                                               refreshEntry:entry
+                                                                                               withResponse:httpResponse
+                                                                                               forRequest:request];
+                                                   metrics.cached = YES;
+                                                   [self
+                                                    cacheEntryCompletionHandler:refreshedEntry
+                                                    withBodyParser:bodyParser
+                                                    withMetrics:metrics
+                                                    onSuccess:successCallback
+                                                    onError:errorCallback];
+                                                   return;
+                                               }
+
+                                               [self
+                                                dataTaskCompletionHandler:response
+                                                withBody:data
+                                                withBodyParser:bodyParser
+                                                withResponseValidation:validateResponse
+                                                withMetrics:metrics
+                                                error:error
+                                                onSuccess:^(NSURLResponse *response, id body)
+                                                {
+                                                    [cache
+                                                     storeResponse:(NSHTTPURLResponse *)response
+                                                     withData:data
+                                                     withBody:body
+                                                     withBodyParser:bodyParser
+                                                     forRequest:request];
+                                                    successCallback(response, body);
+                                                }
+                                                onError:errorCallback];
+                                           }];
+                                      }];
+    weakDataTask = dataTask;
+    [self
+     resumeTask:dataTask
+     onResume:^
+     {
+         resumeTime = CFAbsoluteTimeGetCurrent();
+         [metrics addDuration:resumeTime - metrics.issueTime toPhase:http_request_metrics_phase_queue_wait];
+     }];
+    return dataTask;
+}
+
+- (NSURLSessionDataTask *)rejectedTask:(NSURLRequest *)request
+                             withError:(NSError *)error
+                           withMetrics:(http_request_metrics *)metrics
+                               onError:(void (^)(NSError *))errorCallback
+{
+    // Failed without contacting the server: the task only represents the operation and is never resumed. The error is
+    // always delivered asynchronously, as it would be from the network, so that the caller holds the task before its
+    // callback runs and callers issuing their next request from it (e.g. batches) do not recurse.
+    NSURLSessionDataTask *placeholderTask = [_session dataTaskWithRequest:request];
+    metrics.failed = YES;
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^
+    {
+        [self
+         dispatchCallback:^
+         {
+             errorCallback(error);
+             [placeholderTask cancel];
+         }
+         withMetrics:metrics];
+    });
+    return placeholderTask;
+}
+
+- (void)cacheEntryCompletionHandler:(http_request_cache_entry *)entry
+                     withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+                        withMetrics:(http_request_metrics *)metrics
+                          onSuccess:(void (^)(NSURLResponse *, id))successCallback
+                            onError:(void (^)(NSError *))errorCallback
+{
+    metrics.statusCode = entry.response.statusCode;
+    metrics.bytesReceived = entry.data.length;
+    id parsedData = entry.data;
+    if (bodyParser)
+    {
+        // The body and its parser are read and written together, as concurrent hits may parse the same entry.
+        id cachedBody = nil;
+        @synchronized(entry)
+        {
+            if (entry.bodyParser == bodyParser)
             {
-                successCallback(response, parsedData);
+                cachedBody = entry.body;
             }
         }
+
+        if (cachedBody)
+        {
+            parsedData = cachedBody;
+        }
         else
         {
-            NSError *verboseParsingError = [[NSError alloc]
-                                            initWithDomain:kHttpRequestDomain
-                                            code:-3
-                                            userInfo:@{NSLocalizedDescriptionKey:@"Unsuccessful body parsing.",
-                                                       @"Error":parsingError,
-                                                       @"Response":(NSHTTPURLResponse *)response,
-                                                       @"Body":data}];
-            errorCallback(verboseParsingError);
+            NSError *parsingError = nil;
+            CFAbsoluteTime parseStart = CFAbsoluteTimeGetCurrent();
+            parsedData = bodyParser(entry.response, entry.data, &parsingError);
+            [metrics addDuration:CFAbsoluteTimeGetCurrent() - parseStart toPhase:http_request_metrics_phase_parse];
+            if (parsingError)
+            {
+                NSError *verboseParsingError = [[NSError alloc]
+                                                initWithDomain:kHttpRequestDomain
+                                                code:-3
+                                                userInfo:@{NSLocalizedDescriptionKey:@"Unsuccessful body parsing.",
+                                                           @"Error":parsingError,
+                                                           @"Response":entry.response,
+                                                           @"Body":entry.data}];
+                metrics.failed = YES;
+                [self
+                 dispatchCallback:^
+                 {
+                     errorCallback(verboseParsingError);
+                 }
+                 withMetrics:metrics];
+                return;
+            }
+
+            @synchronized(entry)
+            {
+                entry.body = parsedData;
+                entry.bodyParser = bodyParser;
+            }
         }
     }
-    else
+
+    [self
+     dispatchCallback:^
+     {
+         successCallback(entry.response, parsedData);
+     }
+     withMetrics:metrics];
+}
+
+- (void)streamCompletionHandler:(http_request_stream_context *)context
+                 withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+         withResponseValidation:(BOOL (^)(NSURLResponse *, id, NSError *__autoreleasing *))validateResponse
+                          error:(NSError *)error
+                     onComplete:(void (^)(NSURLResponse *))completeCallback
+                        onError:(void (^)(NSError *))errorCallback
+{
+    if (context.invalidResponse)
+    {
+        NSError *validationError = context.validationError;
+        NSData *data = context.errorBody;
+        if (data.length > 0)
+        {
+            id parsedData = data;
+            NSError *parsingError = nil;
+            if (bodyParser)
+            {
+                parsedData = bodyParser(context.response, data, &parsingError);
+            }
+
+            NSError *verboseValidationError = nil;
+            if (!parsingError
+                && !validateResponse(context.response, parsedData, &verboseValidationError)
+                && verboseValidationError)
+            {
+                validationError = verboseValidationError;
+            }
+        }
+
+        errorCallback(validationError);
+    }
+    else if (error)
     {
         errorCallback(error);
     }
+    else
+    {
+        completeCallback(context.response);
+    }
 }
 
 - (void)configureBodyParser
 {
+    __weak http_request *weakSelf = self;
     self.bodyParser = ^id (NSURLResponse *response, NSData *data, NSError *__autoreleasing *error)
     {
-        return [http_request parseBody:response withBody:data error:error];
+        http_request_parser_registry *registry = weakSelf.parserRegistry ?: [http_request_parser_registry defaultRegistry];
+        return [registry parseResponse:response withBody:data error:error];
     };
 }
 
@@ -776,6 +2997,14 @@
     };
 }
 
+- (void)configureRecordParserFactory
+{
+    self.recordParserFactory = ^http_request_json_stream_parser *(NSURLResponse *response, void (^record)(id))
+    {
+        return [http_request recordParserForResponse:response onRecord:record];
+    };
+}
+
 #pragma mark - Initialization
 
 - (id)initWithConfiguration:(NSURLSessionConfiguration *)sessionConfiguration
@@ -783,20 +3012,35 @@
     self = [super init];
     if (self)
     {
+        self.parserRegistry = [http_request_parser_registry new];
+        self.headerTemplates = [http_request_header_templates new];
         [self configureBodyParser];
         [self configureBodySerializer];
         [self configureResponseValidator];
-        _session = [NSURLSession sessionWithConfiguration:sessionConfiguration];
+        [self configureRecordParserFactory];
+        self.parsingQueue = [NSOperationQueue new];
+        self.parsingQueue.name = @"http-request.parsing";
+        self.parsingQueue.maxConcurrentOperationCount = [[NSProcessInfo processInfo] activeProcessorCount];
+        self.streamBufferLimit = kDefaultStreamBufferLimit;
+        self.requestCompressionThreshold = kDefaultCompressionThreshold;
+        _coalescedFetches = [NSMutableDictionary new];
+        _sessionDelegate = [http_request_session_delegate new];
+        _session = [NSURLSession sessionWithConfiguration:sessionConfiguration delegate:_sessionDelegate delegateQueue:nil];
     }
 
     return self;
 }
 
+- (void)dealloc
+{
+    [_session finishTasksAndInvalidate];
+}
+
 - (id)init
 {
     NSURLSessionConfiguration *sessionConfiguration = [NSURLSessionConfiguration defaultSessionConfiguration];
-    [sessionConfiguration setHTTPAdditionalHeaders:@{@"Content-Type":kApplicationJsonContentType}];
-    [sessionConfiguration setHTTPAdditionalHeaders:@{@"Accept":kApplicationJsonContentType}];
+    [sessionConfiguration setHTTPAdditionalHeaders:@{@"Content-Type":kApplicationJsonContentType,
+                                                     @"Accept":kApplicationJsonContentType}];
     return [self initWithConfiguration:sessionConfiguration];
 }
 
@@ -0,0 +1,83 @@
+//
+//  http_request_batch.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  The orders in which the results of a batch can be delivered.
+ */
+typedef NS_ENUM(NSInteger, http_request_batch_delivery)
+{
+    /**
+     *  Results are delivered in the order of the requests; a result waits until every earlier one was delivered.
+     */
+    http_request_batch_delivery_in_order,
+    /**
+     *  Results are delivered as soon as their request completes.
+     */
+    http_request_batch_delivery_as_completed
+};
+
+/**
+ *  The outcome of a single request of a batch.
+ */
+@interface http_request_batch_result : NSObject
+
+/**
+ *  The index of the request within the batch.
+ */
+@property (readonly) NSUInteger index;
+
+/**
+ *  The request.
+ */
+@property (strong, readonly) NSURLRequest *request;
+
+/**
+ *  The response, if one was received; otherwise, nil.
+ */
+@property (strong, readonly) NSURLResponse *response;
+
+/**
+ *  The parsed body upon success; otherwise, nil.
+ */
+@property (strong, readonly) id body;
+
+/**
+ *  The error upon failure; otherwise, nil.
+ */
+@property (strong, readonly) NSError *error;
+
+@end
+
+/**
+ *  http_request_batch represents a set of requests issued with bounded concurrency.
+ */
+@interface http_request_batch : NSObject
+
+/**
+ *  The number of requests in the batch.
+ */
+@property (readonly) NSUInteger count;
+
+/**
+ *  The number of requests which completed, successfully or not.
+ */
+@property (readonly) NSUInteger completedCount;
+
+/**
+ *  The number of requests which failed.
+ */
+@property (readonly) NSUInteger failedCount;
+
+/**
+ *  Cancels the requests in flight and those not issued yet; each of them completes with a cancellation error.
+ */
+- (void)cancel;
+
+@end
@@ -0,0 +1,242 @@
+//
+//  http_request_batch.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_batch.h"
+
+@implementation http_request_batch_result
+
+#pragma mark - Initialization
+
+- (id)initWithIndex:(NSUInteger)index
+            request:(NSURLRequest *)request
+           response:(NSURLResponse *)response
+               body:(id)body
+              error:(NSError *)error
+{
+    self = [super init];
+    if (self)
+    {
+        _index = index;
+        _request = request;
+        _response = response;
+        _body = body;
+        _error = error;
+    }
+
+    return self;
+}
+
+@end
+
+@interface http_request_batch()
+{
+    NSArray *_requests;
+    NSUInteger _maxConcurrency;
+    http_request_batch_delivery _delivery;
+    void (^_resultCallback)(http_request_batch_result *);
+    void (^_completeCallback)(NSArray *);
+    http_request *_httpRequest;
+    NSMutableArray *_results;
+    NSMutableDictionary *_tasks;
+    NSUInteger _nextIssueIndex;
+    NSUInteger _nextDeliveryIndex;
+    BOOL _cancelled;
+    dispatch_queue_t _deliveryQueue;
+}
+
+- (void)issueNext;
+- (void)completeIndex:(NSUInteger)index withResponse:(NSURLResponse *)response withBody:(id)body withError:(NSError *)error;
+
+@end
+
+@implementation http_request_batch
+
+#pragma mark - Public API
+
+- (void)cancel
+{
+    NSArray *tasks = nil;
+    NSRange pending;
+    @synchronized(self)
+    {
+        _cancelled = YES;
+        tasks = [_tasks allValues];
+        pending = NSMakeRange(_nextIssueIndex, _count - _nextIssueIndex);
+        _nextIssueIndex = _count;
+    }
+
+    NSError *cancellationError = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil];
+    for (NSUInteger index = pending.location; index < NSMaxRange(pending); index++)
+    {
+        [self completeIndex:index withResponse:nil withBody:nil withError:cancellationError];
+    }
+
+    for (NSURLSessionDataTask *task in tasks)
+    {
+        [task cancel];
+    }
+}
+
+- (void)startWithHttpRequest:(http_request *)httpRequest
+{
+    [http_request throwIfNil:httpRequest withName:@"httpRequest"];
+
+    _httpRequest = httpRequest;
+    if (_count == 0)
+    {
+        dispatch_async(_deliveryQueue, ^
+        {
+            _completeCallback(@[]);
+        });
+        return;
+    }
+
+    NSUInteger initialCount = _maxConcurrency > 0 ? MIN(_maxConcurrency, _count) : _count;
+    for (NSUInteger issued = 0; issued < initialCount; issued++)
+    {
+        [self issueNext];
+    }
+}
+
+#pragma mark - Internal API
+
+- (void)issueNext
+{
+    NSUInteger index = 0;
+    http_request *httpRequest = nil;
+    @synchronized(self)
+    {
+        if (_cancelled || _nextIssueIndex >= _count)
+        {
+            return;
+        }
+
+        index = _nextIssueIndex++;
+        httpRequest = _httpRequest;
+    }
+
+    NSURLSessionDataTask *task = [httpRequest
+                                  issueAsync:_requests[index]
+                                  withBodyParser:httpRequest.bodyParser
+                                  withResponseValidation:httpRequest.responseValidator
+                                  onSuccess:^(NSURLResponse *response, id body)
+                                  {
+                                      [self completeIndex:index withResponse:response withBody:body withError:nil];
+                                  }
+                                  onError:^(NSError *error)
+                                  {
+                                      [self completeIndex:index withResponse:error.userInfo[@"Response"] withBody:nil withError:error];
+                                  }];
+    @synchronized(self)
+    {
+        if (task && _results[index] == [NSNull null])
+        {
+            [_tasks setObject:task forKey:@(index)];
+        }
+    }
+}
+
+- (void)completeIndex:(NSUInteger)index withResponse:(NSURLResponse *)response withBody:(id)body withError:(NSError *)error
+{
+    http_request_batch_result *result = [[http_request_batch_result alloc]
+                                         initWithIndex:index
+                                         request:_requests[index]
+                                         response:response
+                                         body:body
+                                         error:error];
+    @synchronized(self)
+    {
+        if (_results[index] != [NSNull null])
+        {
+            return;
+        }
+
+        _results[index] = result;
+        [_tasks removeObjectForKey:@(index)];
+        _completedCount++;
+        _failedCount += error ? 1 : 0;
+
+        NSMutableArray *deliverableResults = [NSMutableArray new];
+        if (_delivery == http_request_batch_delivery_as_completed)
+        {
+            [deliverableResults addObject:result];
+        }
+        else
+        {
+            while (_nextDeliveryIndex < _count && _results[_nextDeliveryIndex] != [NSNull null])
+            {
+                [deliverableResults addObject:_results[_nextDeliveryIndex++]];
+            }
+        }
+
+        // Enqueued while locked so that the serial delivery queue sees results in the order they were released.
+        BOOL finished = _completedCount == _count;
+        NSArray *results = finished ? [_results copy] : nil;
+        void (^resultCallback)(http_request_batch_result *) = _resultCallback;
+        void (^completeCallback)(NSArray *) = _completeCallback;
+        dispatch_async(_deliveryQueue, ^
+        {
+            if (resultCallback)
+            {
+                for (http_request_batch_result *deliverableResult in deliverableResults)
+                {
+                    resultCallback(deliverableResult);
+                }
+            }
+
+            if (finished)
+            {
+                completeCallback(results);
+            }
+        });
+
+        if (finished)
+        {
+            _httpRequest = nil;
+        }
+    }
+
+    [self issueNext];
+}
+
+#pragma mark - Initialization
+
+- (id)initWithRequests:(NSArray *)requests
+        maxConcurrency:(NSUInteger)maxConcurrency
+              delivery:(http_request_batch_delivery)delivery
+              onResult:(void (^)(http_request_batch_result *))resultCallback
+            onComplete:(void (^)(NSArray *))completeCallback
+{
+    [http_request throwIfNil:requests withName:@"requests"];
+    [http_request throwIfNil:completeCallback withName:@"completeCallback"];
+
+    self = [super init];
+    if (self)
+    {
+        _requests = [requests copy];
+        _count = _requests.count;
+        _maxConcurrency = maxConcurrency;
+        _delivery = delivery;
+        _resultCallback = [resultCallback copy];
+        _completeCallback = [completeCallback copy];
+        _results = [NSMutableArray arrayWithCapacity:_count];
+        for (NSUInteger index = 0; index < _count; index++)
+        {
+            [_results addObject:[NSNull null]];
+        }
+
+        _tasks = [NSMutableDictionary new];
+        _deliveryQueue = dispatch_queue_create("http-request.batch", DISPATCH_QUEUE_SERIAL);
+    }
+
+    return self;
+}
+
+@end
@@ -0,0 +1,200 @@
+//
+//  http_request_cache.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#define kDefaultCacheMemoryCapacity     (4 * 1024 * 1024)
+#define kDefaultCacheDiskCapacity       (32 * 1024 * 1024)
+
+/**
+ *  A cached response along with its raw and parsed body.
+ */
+@interface http_request_cache_entry : NSObject
+
+/**
+ *  The cached response.
+ */
+@property (strong, readonly) NSHTTPURLResponse *response;
+
+/**
+ *  The raw body of the cached response.
+ */
+@property (strong, readonly) NSData *data;
+
+/**
+ *  The parsed body of the cached response, if it was parsed; otherwise, nil. It is read and written together with the
+ *  bodyParser while synchronized on the entry.
+ */
+@property (strong) id body;
+
+/**
+ *  The parser which produced the parsed body, if any.
+ */
+@property (copy) id (^bodyParser)(NSURLResponse *, NSData *, NSError *__autoreleasing *);
+
+/**
+ *  The date after which the entry needs to be revalidated with the server.
+ */
+@property (strong, readonly) NSDate *expirationDate;
+
+/**
+ *  Determines whether or not the entry can be served without revalidation.
+ *
+ *  @return YES if it is fresh; otherwise, NO.
+ */
+- (BOOL)isFresh;
+
+/**
+ *  Determines whether or not the entry carries a validator (ETag or Last-Modified) to revalidate it with.
+ *
+ *  @return YES if it can be revalidated; otherwise, NO.
+ */
+- (BOOL)canBeRevalidated;
+
+@end
+
+/**
+ *  http_request_cache is an HTTP response cache with an LRU memory tier, which holds parsed bodies, backed by a disk
+ *  tier. It honors Cache-Control, Expires, ETag, Last-Modified and Vary.
+ */
+@interface http_request_cache : NSObject
+
+/**
+ *  The number of responses served from the cache without contacting the server.
+ */
+@property (readonly) NSUInteger hitCount;
+
+/**
+ *  The number of responses served from the cache after the server confirmed them through a 304.
+ */
+@property (readonly) NSUInteger revalidationCount;
+
+/**
+ *  The number of responses which had to be fetched in full from the server.
+ */
+@property (readonly) NSUInteger missCount;
+
+/**
+ *  The maximum number of body bytes kept in memory.
+ */
+@property (readonly) NSUInteger memoryCapacity;
+
+/**
+ *  The maximum number of bytes kept on disk.
+ */
+@property (readonly) NSUInteger diskCapacity;
+
+/**
+ *  Computes the date after which the response needs to be revalidated.
+ *
+ *  @param response The response. Must not be nil.
+ *
+ *  @return The expiration date.
+ */
++ (NSDate *)expirationDateForResponse:(NSHTTPURLResponse *)response;
+
+/**
+ *  Determines whether or not the response to the request can be stored.
+ *
+ *  @param response The response. Must not be nil.
+ *  @param request  The request of the response. Must not be nil.
+ *
+ *  @return YES if it can be stored; otherwise, NO.
+ */
++ (BOOL)isCacheableResponse:(NSHTTPURLResponse *)response forRequest:(NSURLRequest *)request;
+
+/**
+ *  The default instance initializer; uses the default capacities and a directory within the caches directory.
+ *
+ *  @return An instance of class.
+ */
+- (id)init;
+
+/**
+ *  Initializes the instance with the provided capacities.
+ *
+ *  @param memoryCapacity The maximum number of body bytes kept in memory.
+ *  @param diskCapacity   The maximum number of bytes kept on disk. Zero disables the disk tier.
+ *  @param path           The directory in which to keep the disk tier. Optional, can be nil.
+ *
+ *  @return An instance of class.
+ */
+- (id)initWithMemoryCapacity:(NSUInteger)memoryCapacity diskCapacity:(NSUInteger)diskCapacity diskPath:(NSString *)path;
+
+/**
+ *  Looks up the entry for the request in memory and then on disk. Counts a hit if the entry is fresh.
+ *
+ *  @param request The request. Must not be nil.
+ *
+ *  @return The (possibly stale) entry for the request; otherwise, nil.
+ */
+- (http_request_cache_entry *)entryForRequest:(NSURLRequest *)request;
+
+/**
+ *  Determines whether or not the entry can be served for the request without revalidation.
+ *
+ *  @param entry   The entry. Must not be nil.
+ *  @param request The request. Must not be nil.
+ *
+ *  @return YES if the entry is fresh and the request does not demand revalidation; otherwise, NO.
+ */
+- (BOOL)isFreshEntry:(http_request_cache_entry *)entry forRequest:(NSURLRequest *)request;
+
+/**
+ *  Constructs the conditional request which revalidates the entry.
+ *
+ *  @param request The original request. Must not be nil.
+ *  @param entry   The entry to revalidate. Must not be nil.
+ *
+ *  @return The request carrying If-None-Match and/or If-Modified-Since.
+ */
+- (NSMutableURLRequest *)conditionalRequest:(NSURLRequest *)request forEntry:(http_request_cache_entry *)entry;
+
+/**
+ *  Stores the response fetched in full from the server, if cacheable. Counts a miss.
+ *
+ *  @param response   The response. Must not be nil.
+ *  @param data       The raw body. Optional, can be nil.
+ *  @param body       The parsed body. Optional, can be nil.
+ *  @param bodyParser The parser which produced the parsed body. Optional, can be nil.
+ *  @param request    The request of the response. Must not be nil.
+ *
+ *  @return The stored entry; otherwise, nil if the response is not cacheable.
+ */
+- (http_request_cache_entry *)storeResponse:(NSHTTPURLResponse *)response
+                                   withData:(NSData *)data
+                                   withBody:(id)body
+                             withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+                                 forRequest:(NSURLRequest *)request;
+
+/**
+ *  Refreshes the entry with the headers of the 304 response which revalidated it. Counts a revalidation.
+ *
+ *  @param entry    The revalidated entry. Must not be nil.
+ *  @param response The 304 response. Must not be nil.
+ *  @param request  The original request. Must not be nil.
+ *
+ *  @return The refreshed entry.
+ */
+- (http_request_cache_entry *)refreshEntry:(http_request_cache_entry *)entry
+                              withResponse:(NSHTTPURLResponse *)response
+                                forRequest:(NSURLRequest *)request;
+
+/**
+ *  Removes the entry for the request from memory and disk.
+ *
+ *  @param request The request. Must not be nil.
+ */
+- (void)removeEntryForRequest:(NSURLRequest *)request;
+
+/**
+ *  Removes every entry from memory and disk.
+ */
+- (void)removeAllEntries;
+
+@end
@@ -0,0 +1,626 @@
+//
+//  http_request_cache.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <CommonCrypto/CommonDigest.h>
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_cache.h"
+
+@interface http_request_cache_entry()
+
+@property (strong, readwrite) NSHTTPURLResponse *response;
+@property (strong, readwrite) NSData *data;
+@property (strong, readwrite) NSDate *expirationDate;
+@property (strong) NSString *key;
+@property (strong) NSDictionary *varyHeaders;
+@property (strong) http_request_cache_entry *next;
+@property (weak) http_request_cache_entry *previous;
+
+@end
+
+@implementation http_request_cache_entry
+
+- (BOOL)isFresh
+{
+    return [self.expirationDate timeIntervalSinceNow] > 0;
+}
+
+- (BOOL)canBeRevalidated
+{
+    NSDictionary *headers = [self.response allHeaderFields];
+    return [headers objectForKey:@"ETag"] || [headers objectForKey:@"Last-Modified"];
+}
+
+@end
+
+@interface http_request_cache()
+{
+    NSMutableDictionary *_memoryEntries;
+    http_request_cache_entry *_mostRecentlyUsed;
+    http_request_cache_entry *_leastRecentlyUsed;
+    NSUInteger _memorySize;
+    NSString *_diskPath;
+    NSUInteger _diskSize;
+    dispatch_queue_t _diskQueue;
+}
+
++ (NSString *)keyForRequest:(NSURLRequest *)request;
++ (NSDictionary *)cacheControlDirectives:(NSString *)cacheControl;
++ (NSDate *)dateFromHttpDate:(NSString *)httpDate;
++ (NSDictionary *)varyHeadersForResponse:(NSHTTPURLResponse *)response withRequest:(NSURLRequest *)request;
++ (BOOL)entry:(http_request_cache_entry *)entry matchesVaryHeadersOfRequest:(NSURLRequest *)request;
+
+- (http_request_cache_entry *)memoryEntryForKey:(NSString *)key;
+- (void)storeMemoryEntry:(http_request_cache_entry *)entry;
+- (void)removeMemoryEntry:(http_request_cache_entry *)entry;
+- (NSString *)diskPathForKey:(NSString *)key;
+- (http_request_cache_entry *)diskEntryForKey:(NSString *)key;
+- (void)storeDiskEntry:(http_request_cache_entry *)entry;
+- (void)trimDisk;
+
+@end
+
+@implementation http_request_cache
+
+#pragma mark - Public API
+
++ (NSDate *)expirationDateForResponse:(NSHTTPURLResponse *)response
+{
+    NSDictionary *headers = [response allHeaderFields];
+    NSDictionary *directives = [http_request_cache cacheControlDirectives:[headers objectForKey:@"Cache-Control"]];
+    NSDate *now = [NSDate date];
+    NSTimeInterval age = [[headers objectForKey:@"Age"] doubleValue];
+    NSDate *date = [http_request_cache dateFromHttpDate:[headers objectForKey:@"Date"]] ?: now;
+    NSTimeInterval lifetime = 0;
+    if ([directives objectForKey:@"no-cache"])
+    {
+        lifetime = 0;
+    }
+    else if ([directives objectForKey:@"max-age"])
+    {
+        lifetime = [[directives objectForKey:@"max-age"] doubleValue];
+    }
+    else if ([headers objectForKey:@"Expires"])
+    {
+        NSDate *expires = [http_request_cache dateFromHttpDate:[headers objectForKey:@"Expires"]];
+        lifetime = expires ? [expires timeIntervalSinceDate:date] : 0;
+    }
+    else if ([headers objectForKey:@"Last-Modified"])
+    {
+        // Heuristic freshness: a tenth of the time elapsed since the last modification.
+        NSDate *lastModified = [http_request_cache dateFromHttpDate:[headers objectForKey:@"Last-Modified"]];
+        lifetime = lastModified ? MAX([date timeIntervalSinceDate:lastModified] / 10, 0) : 0;
+    }
+
+    return [now dateByAddingTimeInterval:MAX(lifetime - age, 0)];
+}
+
++ (BOOL)isCacheableResponse:(NSHTTPURLResponse *)response forRequest:(NSURLRequest *)request
+{
+    [http_request throwIfNil:response withName:@"response"];
+    [http_request throwIfNil:request withName:@"request"];
+
+    if ([request.HTTPMethod caseInsensitiveCompare:kGetHttpMethod] != NSOrderedSame
+        || (response.statusCode != 200 && response.statusCode != 203))
+    {
+        return NO;
+    }
+
+    NSDictionary *requestDirectives = [http_request_cache
+                                       cacheControlDirectives:[request valueForHTTPHeaderField:@"Cache-Control"]];
+    NSDictionary *headers = [response allHeaderFields];
+    NSDictionary *responseDirectives = [http_request_cache cacheControlDirectives:[headers objectForKey:@"Cache-Control"]];
+    NSString *vary = [headers objectForKey:@"Vary"];
+    if ([requestDirectives objectForKey:@"no-store"]
+        || [responseDirectives objectForKey:@"no-store"]
+        || [[vary stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] isEqualToString:@"*"])
+    {
+        return NO;
+    }
+
+    NSDate *expirationDate = [http_request_cache expirationDateForResponse:response];
+    return [expirationDate timeIntervalSinceNow] > 0
+           || [headers objectForKey:@"ETag"]
+           || [headers objectForKey:@"Last-Modified"];
+}
+
+- (http_request_cache_entry *)entryForRequest:(NSURLRequest *)request
+{
+    [http_request throwIfNil:request withName:@"request"];
+
+    NSString *key = [http_request_cache keyForRequest:request];
+    http_request_cache_entry *entry = [self memoryEntryForKey:key];
+    if (!entry && _diskPath)
+    {
+        entry = [self diskEntryForKey:key];
+        if (entry)
+        {
+            [self storeMemoryEntry:entry];
+        }
+    }
+
+    if (entry && ![http_request_cache entry:entry matchesVaryHeadersOfRequest:request])
+    {
+        entry = nil;
+    }
+
+    if (entry && [self isFreshEntry:entry forRequest:request])
+    {
+        @synchronized(self)
+        {
+            _hitCount++;
+        }
+    }
+
+    return entry;
+}
+
+- (BOOL)isFreshEntry:(http_request_cache_entry *)entry forRequest:(NSURLRequest *)request
+{
+    [http_request throwIfNil:entry withName:@"entry"];
+    [http_request throwIfNil:request withName:@"request"];
+
+    NSDictionary *requestDirectives = [http_request_cache
+                                       cacheControlDirectives:[request valueForHTTPHeaderField:@"Cache-Control"]];
+    return [entry isFresh] && ![requestDirectives objectForKey:@"no-cache"];
+}
+
+- (NSMutableURLRequest *)conditionalRequest:(NSURLRequest *)request forEntry:(http_request_cache_entry *)entry
+{
+    [http_request throwIfNil:request withName:@"request"];
+    [http_request throwIfNil:entry withName:@"entry"];
+
+    NSMutableURLRequest *conditionalRequest = [request mutableCopy];
+    NSDictionary *headers = [entry.response allHeaderFields];
+    NSString *etag = [headers objectForKey:@"ETag"];
+    NSString *lastModified = [headers objectForKey:@"Last-Modified"];
+    if (etag)
+    {
+        [conditionalRequest setValue:etag forHTTPHeaderField:@"If-None-Match"];
+    }
+
+    if (lastModified)
+    {
+        [conditionalRequest setValue:lastModified forHTTPHeaderField:@"If-Modified-Since"];
+    }
+
+    return conditionalRequest;
+}
+
+- (http_request_cache_entry *)storeResponse:(NSHTTPURLResponse *)response
+                                   withData:(NSData *)data
+                                   withBody:(id)body
+                             withBodyParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))bodyParser
+                                 forRequest:(NSURLRequest *)request
+{
+    [http_request throwIfNil:response withName:@"response"];
+    [http_request throwIfNil:request withName:@"request"];
+
+    @synchronized(self)
+    {
+        _missCount++;
+    }
+
+    if (![http_request_cache isCacheableResponse:response forRequest:request])
+    {
+        [self removeEntryForRequest:request];
+        return nil;
+    }
+
+    http_request_cache_entry *entry = [http_request_cache_entry new];
+    entry.key = [http_request_cache keyForRequest:request];
+    entry.response = response;
+    entry.data = data ?: [NSData data];
+    entry.body = body;
+    entry.bodyParser = bodyParser;
+    entry.expirationDate = [http_request_cache expirationDateForResponse:response];
+    entry.varyHeaders = [http_request_cache varyHeadersForResponse:response withRequest:request];
+    [self storeMemoryEntry:entry];
+    [self storeDiskEntry:entry];
+    return entry;
+}
+
+- (http_request_cache_entry *)refreshEntry:(http_request_cache_entry *)entry
+                              withResponse:(NSHTTPURLResponse *)response
+                                forRequest:(NSURLRequest *)request
+{
+    [http_request throwIfNil:entry withName:@"entry"];
+    [http_request throwIfNil:response withName:@"response"];
+    [http_request throwIfNil:request withName:@"request"];
+
+    NSMutableDictionary *headers = [[entry.response allHeaderFields] mutableCopy];
+    [[response allHeaderFields] enumerateKeysAndObjectsUsingBlock:^(id key, id value, BOOL *stop)
+    {
+        if ([key caseInsensitiveCompare:@"Content-Length"] != NSOrderedSame
+            && [key caseInsensitiveCompare:@"Content-Type"] != NSOrderedSame
+            && [key caseInsensitiveCompare:@"Content-Encoding"] != NSOrderedSame)
+        {
+            [headers setObject:value forKey:key];
+        }
+    }];
+
+    NSHTTPURLResponse *refreshedResponse = [[NSHTTPURLResponse alloc]
+                                            initWithURL:entry.response.URL
+                                            statusCode:entry.response.statusCode
+                                            HTTPVersion:@"HTTP/1.1"
+                                            headerFields:headers];
+    http_request_cache_entry *refreshedEntry = [http_request_cache_entry new];
+    refreshedEntry.key = entry.key;
+    refreshedEntry.response = refreshedResponse;
+    refreshedEntry.data = entry.data;
+    @synchronized(entry)
+    {
+        refreshedEntry.body = entry.body;
+        refreshedEntry.bodyParser = entry.bodyParser;
+    }
+
+    refreshedEntry.expirationDate = [http_request_cache expirationDateForResponse:refreshedResponse];
+    refreshedEntry.varyHeaders = [http_request_cache varyHeadersForResponse:refreshedResponse withRequest:request];
+    @synchronized(self)
+    {
+        _revalidationCount++;
+    }
+
+    [self storeMemoryEntry:refreshedEntry];
+    [self storeDiskEntry:refreshedEntry];
+    return refreshedEntry;
+}
+
+- (void)removeEntryForRequest:(NSURLRequest *)request
+{
+    [http_request throwIfNil:request withName:@"request"];
+
+    NSString *key = [http_request_cache keyForRequest:request];
+    @synchronized(self)
+    {
+        [self removeMemoryEntry:[_memoryEntries objectForKey:key]];
+    }
+
+    if (_diskPath)
+    {
+        NSString *path = [self diskPathForKey:key];
+        dispatch_async(_diskQueue, ^
+        {
+            NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil];
+            if (attributes && [[NSFileManager defaultManager] removeItemAtPath:path error:nil])
+            {
+                _diskSize -= MIN(_diskSize, (NSUInteger)[attributes fileSize]);
+            }
+        });
+    }
+}
+
+- (void)removeAllEntries
+{
+    @synchronized(self)
+    {
+        [_memoryEntries removeAllObjects];
+        _mostRecentlyUsed = nil;
+        _leastRecentlyUsed = nil;
+        _memorySize = 0;
+    }
+
+    if (_diskPath)
+    {
+        dispatch_async(_diskQueue, ^
+        {
+            [[NSFileManager defaultManager] removeItemAtPath:_diskPath error:nil];
+            [[NSFileManager defaultManager] createDirectoryAtPath:_diskPath withIntermediateDirectories:YES attributes:nil error:nil];
+            _diskSize = 0;
+        });
+    }
+}
+
+#pragma mark - Internal API
+
++ (NSString *)keyForRequest:(NSURLRequest *)request
+{
+    return [NSString stringWithFormat:@"%@ %@", [request.HTTPMethod uppercaseString], [request.URL absoluteString]];
+}
+
++ (NSDictionary *)cacheControlDirectives:(NSString *)cacheControl
+{
+    NSMutableDictionary *directives = [NSMutableDictionary new];
+    for (NSString *directive in [cacheControl componentsSeparatedByString:@","])
+    {
+        NSArray *components = [directive componentsSeparatedByString:@"="];
+        NSString *name = [[[components firstObject]
+                           stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]]
+                          lowercaseString];
+        if (name.length > 0)
+        {
+            NSString *value = components.count > 1
+                              ? [[components objectAtIndex:1]
+                                 stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@" \""]]
+                              : @"";
+            [directives setObject:value forKey:name];
+        }
+    }
+
+    return directives;
+}
+
++ (NSDate *)dateFromHttpDate:(NSString *)httpDate
+{
+    static NSDateFormatter *formatter = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^
+    {
+        formatter = [NSDateFormatter new];
+        formatter.locale = [[NSLocale alloc] initWithLocaleIdentifier:@"en_US_POSIX"];
+        formatter.timeZone = [NSTimeZone timeZoneWithAbbreviation:@"GMT"];
+        formatter.dateFormat = @"EEE',' dd MMM yyyy HH':'mm':'ss zzz";
+    });
+
+    return httpDate ? [formatter dateFromString:httpDate] : nil;
+}
+
++ (NSDictionary *)varyHeadersForResponse:(NSHTTPURLResponse *)response withRequest:(NSURLRequest *)request
+{
+    NSMutableDictionary *varyHeaders = [NSMutableDictionary new];
+    NSString *vary = [[response allHeaderFields] objectForKey:@"Vary"];
+    for (NSString *header in [vary componentsSeparatedByString:@","])
+    {
+        NSString *name = [[header stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] lowercaseString];
+        if (name.length > 0)
+        {
+            [varyHeaders setObject:[request valueForHTTPHeaderField:name] ?: @"" forKey:name];
+        }
+    }
+
+    return varyHeaders;
+}
+
++ (BOOL)entry:(http_request_cache_entry *)entry matchesVaryHeadersOfRequest:(NSURLRequest *)request
+{
+    __block BOOL matches = YES;
+    [entry.varyHeaders enumerateKeysAndObjectsUsingBlock:^(NSString *name, NSString *value, BOOL *stop)
+    {
+        matches = [value isEqualToString:[request valueForHTTPHeaderField:name] ?: @""];
+        *stop = !matches;
+    }];
+
+    return matches;
+}
+
+- (http_request_cache_entry *)memoryEntryForKey:(NSString *)key
+{
+    @synchronized(self)
+    {
+        http_request_cache_entry *entry = [_memoryEntries objectForKey:key];
+        if (entry && entry != _mostRecentlyUsed)
+        {
+            [self removeMemoryEntry:entry];
+            [self storeMemoryEntry:entry];
+        }
+
+        return entry;
+    }
+}
+
+- (void)storeMemoryEntry:(http_request_cache_entry *)entry
+{
+    @synchronized(self)
+    {
+        [self removeMemoryEntry:[_memoryEntries objectForKey:entry.key]];
+        if (entry.data.length > _memoryCapacity)
+        {
+            return;
+        }
+
+        [_memoryEntries setObject:entry forKey:entry.key];
+        entry.previous = nil;
+        entry.next = _mostRecentlyUsed;
+        _mostRecentlyUsed.previous = entry;
+        _mostRecentlyUsed = entry;
+        if (!_leastRecentlyUsed)
+        {
+            _leastRecentlyUsed = entry;
+        }
+
+        _memorySize += entry.data.length;
+        while (_memorySize > _memoryCapacity && _leastRecentlyUsed)
+        {
+            [self removeMemoryEntry:_leastRecentlyUsed];
+        }
+    }
+}
+
+- (void)removeMemoryEntry:(http_request_cache_entry *)entry
+{
+    if (!entry)
+    {
+        return;
+    }
+
+    @synchronized(self)
+    {
+        http_request_cache_entry *previous = entry.previous;
+        http_request_cache_entry *next = entry.next;
+        if (previous)
+        {
+            previous.next = next;
+        }
+        else
+        {
+            _mostRecentlyUsed = next;
+        }
+
+        if (next)
+        {
+            next.previous = previous;
+        }
+        else
+        {
+            _leastRecentlyUsed = previous;
+        }
+
+        entry.previous = nil;
+        entry.next = nil;
+        _memorySize -= MIN(_memorySize, entry.data.length);
+        [_memoryEntries removeObjectForKey:entry.key];
+    }
+}
+
+- (NSString *)diskPathForKey:(NSString *)key
+{
+    NSData *keyAsData = [key dataUsingEncoding:NSUTF8StringEncoding];
+    unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+    CC_SHA1(keyAsData.bytes, (CC_LONG)keyAsData.length, digest);
+    NSMutableString *fileName = [NSMutableString stringWithCapacity:CC_SHA1_DIGEST_LENGTH * 2];
+    for (int index = 0; index < CC_SHA1_DIGEST_LENGTH; index++)
+    {
+        [fileName appendFormat:@"%02x", digest[index]];
+    }
+
+    return [_diskPath stringByAppendingPathComponent:fileName];
+}
+
+- (http_request_cache_entry *)diskEntryForKey:(NSString *)key
+{
+    NSString *path = [self diskPathForKey:key];
+    __block NSDictionary *archive = nil;
+    dispatch_sync(_diskQueue, ^
+    {
+        NSData *archiveAsData = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:nil];
+        if (archiveAsData)
+        {
+            @try
+            {
+                archive = [NSKeyedUnarchiver unarchiveObjectWithData:archiveAsData];
+            }
+            @catch (NSException *exception)
+            {
+                archive = nil;
+            }
+        }
+    });
+
+    http_request_cache_entry *entry = nil;
+    if ([archive isKindOfClass:[NSDictionary class]] && [key isEqualToString:[archive objectForKey:@"key"]])
+    {
+        entry = [http_request_cache_entry new];
+        entry.key = key;
+        entry.response = [archive objectForKey:@"response"];
+        entry.data = [archive objectForKey:@"data"];
+        entry.expirationDate = [archive objectForKey:@"expirationDate"];
+        entry.varyHeaders = [archive objectForKey:@"varyHeaders"];
+    }
+
+    return entry;
+}
+
+- (void)storeDiskEntry:(http_request_cache_entry *)entry
+{
+    if (!_diskPath || entry.data.length > _diskCapacity)
+    {
+        return;
+    }
+
+    NSString *path = [self diskPathForKey:entry.key];
+    NSDictionary *archive = @{@"key":entry.key,
+                              @"response":entry.response,
+                              @"data":entry.data,
+                              @"expirationDate":entry.expirationDate,
+                              @"varyHeaders":entry.varyHeaders};
+    dispatch_async(_diskQueue, ^
+    {
+        NSData *archiveAsData = [NSKeyedArchiver archivedDataWithRootObject:archive];
+        NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil];
+        if ([archiveAsData writeToFile:path atomically:YES])
+        {
+            _diskSize -= MIN(_diskSize, (NSUInteger)[attributes fileSize]);
+            _diskSize += archiveAsData.length;
+            if (_diskSize > _diskCapacity)
+            {
+                [self trimDisk];
+            }
+        }
+    });
+}
+
+- (void)trimDisk
+{
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSURL *directory = [NSURL fileURLWithPath:_diskPath isDirectory:YES];
+    NSArray *keys = @[NSURLContentModificationDateKey, NSURLFileSizeKey];
+    NSArray *files = [fileManager
+                      contentsOfDirectoryAtURL:directory
+                      includingPropertiesForKeys:keys
+                      options:NSDirectoryEnumerationSkipsHiddenFiles
+                      error:nil];
+    files = [files sortedArrayUsingComparator:^NSComparisonResult(NSURL *file1, NSURL *file2)
+    {
+        NSDate *date1 = nil;
+        NSDate *date2 = nil;
+        [file1 getResourceValue:&date1 forKey:NSURLContentModificationDateKey error:nil];
+        [file2 getResourceValue:&date2 forKey:NSURLContentModificationDateKey error:nil];
+        return [date1 compare:date2];
+    }];
+
+    _diskSize = 0;
+    for (NSURL *file in files)
+    {
+        NSNumber *fileSize = nil;
+        [file getResourceValue:&fileSize forKey:NSURLFileSizeKey error:nil];
+        _diskSize += [fileSize unsignedIntegerValue];
+    }
+
+    for (NSURL *file in files)
+    {
+        if (_diskSize <= _diskCapacity)
+        {
+            break;
+        }
+
+        NSNumber *fileSize = nil;
+        [file getResourceValue:&fileSize forKey:NSURLFileSizeKey error:nil];
+        if ([fileManager removeItemAtURL:file error:nil])
+        {
+            _diskSize -= MIN(_diskSize, [fileSize unsignedIntegerValue]);
+        }
+    }
+}
+
+#pragma mark - Initialization
+
+- (id)initWithMemoryCapacity:(NSUInteger)memoryCapacity diskCapacity:(NSUInteger)diskCapacity diskPath:(NSString *)path
+{
+    self = [super init];
+    if (self)
+    {
+        _memoryCapacity = memoryCapacity;
+        _diskCapacity = diskCapacity;
+        _memoryEntries = [NSMutableDictionary new];
+        _diskQueue = dispatch_queue_create("http-request.cache", DISPATCH_QUEUE_SERIAL);
+        if (diskCapacity > 0)
+        {
+            _diskPath = path;
+            if (!_diskPath)
+            {
+                NSString *cachesPath = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) firstObject];
+                _diskPath = [cachesPath stringByAppendingPathComponent:kHttpRequestDomain];
+            }
+
+            [[NSFileManager defaultManager] createDirectoryAtPath:_diskPath withIntermediateDirectories:YES attributes:nil error:nil];
+            dispatch_async(_diskQueue, ^
+            {
+                [self trimDisk];
+            });
+        }
+    }
+
+    return self;
+}
+
+- (id)init
+{
+    return [self initWithMemoryCapacity:kDefaultCacheMemoryCapacity diskCapacity:kDefaultCacheDiskCapacity diskPath:nil];
+}
+
+@end
@@ -0,0 +1,30 @@
+//
+//  http_request_cbor.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#define kApplicationCborContentType         @"application/cbor"
+
+/**
+ *  http_request_cbor_decoder decodes CBOR (RFC 7049) into Foundation objects: maps into NSDictionary, arrays into
+ *  NSArray, text strings into NSString, byte strings into NSData, integers, floats and booleans into NSNumber, and null
+ *  and undefined into NSNull. Tags are ignored in favor of the value they tag.
+ */
+@interface http_request_cbor_decoder : NSObject
+
+/**
+ *  Decodes a single CBOR data item.
+ *
+ *  @param data  The data to decode. Must not be nil.
+ *  @param error The error, if any. Must not be nil.
+ *
+ *  @return The decoded value; otherwise, nil if the data is malformed or holds more than one data item.
+ */
++ (id)decodeData:(NSData *)data error:(NSError *__autoreleasing *)error;
+
+@end
@@ -0,0 +1,260 @@
+//
+//  http_request_cbor.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_cbor.h"
+
+#define kCborIndefiniteLength           31
+#define kCborBreak                      0xff
+
+/**
+ *  The position of the decoder within the data.
+ */
+typedef struct
+{
+    const uint8_t *bytes;
+    NSUInteger length;
+    NSUInteger offset;
+} http_request_cbor_cursor;
+
+static BOOL cbor_read(http_request_cbor_cursor *cursor, NSUInteger count, uint64_t *value)
+{
+    if (cursor->length - cursor->offset < count)
+    {
+        return NO;
+    }
+
+    // CBOR is big endian.
+    *value = 0;
+    for (NSUInteger index = 0; index < count; index++)
+    {
+        *value = (*value << 8) | cursor->bytes[cursor->offset++];
+    }
+
+    return YES;
+}
+
+static BOOL cbor_argument(http_request_cbor_cursor *cursor, uint8_t additional, uint64_t *argument)
+{
+    if (additional < 24)
+    {
+        *argument = additional;
+        return YES;
+    }
+
+    return additional <= 27 && cbor_read(cursor, 1 << (additional - 24), argument);
+}
+
+static BOOL cbor_at_break(http_request_cbor_cursor *cursor)
+{
+    if (cursor->offset < cursor->length && cursor->bytes[cursor->offset] == kCborBreak)
+    {
+        cursor->offset++;
+        return YES;
+    }
+
+    return NO;
+}
+
+static double cbor_half_float(uint16_t half)
+{
+    int exponent = (half >> 10) & 0x1f;
+    int mantissa = half & 0x3ff;
+    double value = exponent == 0
+                   ? ldexp(mantissa, -24)
+                   : (exponent != 31 ? ldexp(mantissa + 1024, exponent - 25) : (mantissa == 0 ? INFINITY : NAN));
+    return half & 0x8000 ? -value : value;
+}
+
+static id cbor_value(http_request_cbor_cursor *cursor, NSUInteger depth);
+
+static id cbor_string(http_request_cbor_cursor *cursor, uint8_t major, uint8_t additional)
+{
+    if (additional == kCborIndefiniteLength)
+    {
+        // An indefinite length string is a sequence of definite length chunks of the same major type.
+        NSMutableData *chunks = [NSMutableData new];
+        while (!cbor_at_break(cursor))
+        {
+            uint64_t header = 0;
+            uint64_t length = 0;
+            if (!cbor_read(cursor, 1, &header)
+                || (header >> 5) != major
+                || (header & 0x1f) == kCborIndefiniteLength
+                || !cbor_argument(cursor, header & 0x1f, &length)
+                || cursor->length - cursor->offset < length)
+            {
+                return nil;
+            }
+
+            [chunks appendBytes:cursor->bytes + cursor->offset length:(NSUInteger)length];
+            cursor->offset += (NSUInteger)length;
+        }
+
+        return major == 3 ? [[NSString alloc] initWithData:chunks encoding:NSUTF8StringEncoding] : chunks;
+    }
+
+    uint64_t length = 0;
+    if (!cbor_argument(cursor, additional, &length) || cursor->length - cursor->offset < length)
+    {
+        return nil;
+    }
+
+    const uint8_t *start = cursor->bytes + cursor->offset;
+    cursor->offset += (NSUInteger)length;
+    return major == 3
+           ? [[NSString alloc] initWithBytes:start length:(NSUInteger)length encoding:NSUTF8StringEncoding]
+           : [NSData dataWithBytes:start length:(NSUInteger)length];
+}
+
+static id cbor_array(http_request_cbor_cursor *cursor, uint8_t additional, NSUInteger depth)
+{
+    BOOL indefinite = additional == kCborIndefiniteLength;
+    uint64_t count = 0;
+    // Every element takes at least a byte, which bounds the capacity of a malicious count.
+    if (!indefinite && (!cbor_argument(cursor, additional, &count) || cursor->length - cursor->offset < count))
+    {
+        return nil;
+    }
+
+    NSMutableArray *array = [NSMutableArray arrayWithCapacity:(NSUInteger)count];
+    for (uint64_t index = 0; indefinite ? !cbor_at_break(cursor) : index < count; index++)
+    {
+        id element = cbor_value(cursor, depth + 1);
+        if (!element)
+        {
+            return nil;
+        }
+
+        [array addObject:element];
+    }
+
+    return array;
+}
+
+static id cbor_map(http_request_cbor_cursor *cursor, uint8_t additional, NSUInteger depth)
+{
+    BOOL indefinite = additional == kCborIndefiniteLength;
+    uint64_t count = 0;
+    if (!indefinite && (!cbor_argument(cursor, additional, &count) || (cursor->length - cursor->offset) / 2 < count))
+    {
+        return nil;
+    }
+
+    NSMutableDictionary *map = [NSMutableDictionary dictionaryWithCapacity:(NSUInteger)count];
+    for (uint64_t index = 0; indefinite ? !cbor_at_break(cursor) : index < count; index++)
+    {
+        id key = cbor_value(cursor, depth + 1);
+        id value = key ? cbor_value(cursor, depth + 1) : nil;
+        if (!value || ![key conformsToProtocol:@protocol(NSCopying)])
+        {
+            return nil;
+        }
+
+        [map setObject:value forKey:key];
+    }
+
+    return map;
+}
+
+static id cbor_value(http_request_cbor_cursor *cursor, NSUInteger depth)
+{
+    uint64_t header = 0;
+    if (depth > kMaxBinaryDecodingDepth || !cbor_read(cursor, 1, &header))
+    {
+        return nil;
+    }
+
+    uint8_t major = header >> 5;
+    uint8_t additional = header & 0x1f;
+    uint64_t argument = 0;
+    switch (major)
+    {
+        case 0:
+            return cbor_argument(cursor, additional, &argument) ? @(argument) : nil;
+        case 1:
+            // -1 - argument does not fit in a signed 64-bit integer past INT64_MAX.
+            if (!cbor_argument(cursor, additional, &argument))
+            {
+                return nil;
+            }
+
+            return argument <= INT64_MAX ? @(-1 - (int64_t)argument) : @(-1.0 - (double)argument);
+        case 2:
+        case 3:
+            return cbor_string(cursor, major, additional);
+        case 4:
+            return cbor_array(cursor, additional, depth);
+        case 5:
+            return cbor_map(cursor, additional, depth);
+        case 6:
+            return cbor_argument(cursor, additional, &argument) ? cbor_value(cursor, depth + 1) : nil;
+        default:
+            break;
+    }
+
+    switch (additional)
+    {
+        case 20:
+            return @NO;
+        case 21:
+            return @YES;
+        case 22:
+        case 23:
+            return [NSNull null];
+        case 25:
+            return cbor_read(cursor, 2, &argument) ? @(cbor_half_float((uint16_t)argument)) : nil;
+        case 26:
+            if (cbor_read(cursor, 4, &argument))
+            {
+                uint32_t bits = (uint32_t)argument;
+                float number = 0;
+                memcpy(&number, &bits, sizeof(number));
+                return @(number);
+            }
+
+            return nil;
+        case 27:
+            if (cbor_read(cursor, 8, &argument))
+            {
+                double number = 0;
+                memcpy(&number, &argument, sizeof(number));
+                return @(number);
+            }
+
+            return nil;
+        default:
+            return nil;
+    }
+}
+
+@implementation http_request_cbor_decoder
+
+#pragma mark - Public API
+
++ (id)decodeData:(NSData *)data error:(NSError *__autoreleasing *)error
+{
+    [http_request throwIfNil:data withName:@"data"];
+
+    *error = nil;
+    http_request_cbor_cursor cursor = { data.bytes, data.length, 0 };
+    id value = cbor_value(&cursor, 0);
+    if (!value || cursor.offset != cursor.length)
+    {
+        *error = [[NSError alloc]
+                  initWithDomain:kHttpRequestDomain
+                  code:-3
+                  userInfo:@{NSLocalizedDescriptionKey:@"Malformed CBOR data."}];
+        return nil;
+    }
+
+    return value;
+}
+
+@end
@@ -0,0 +1,128 @@
+//
+//  http_request_circuit_breaker.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#define kDefaultCircuitFailureThreshold         5
+#define kDefaultCircuitOpenInterval             30.0
+#define kDefaultInitialConcurrencyLimit         8
+#define kDefaultMinConcurrencyLimit             1
+#define kDefaultMaxConcurrencyLimit             64
+#define kDefaultLatencyTolerance                2.0
+
+/**
+ *  The states of the circuit of a route.
+ */
+typedef NS_ENUM(NSInteger, http_request_circuit_state)
+{
+    /**
+     *  Requests flow, up to the concurrency limit of the route.
+     */
+    http_request_circuit_state_closed,
+    /**
+     *  Requests fail fast until the open interval elapsed.
+     */
+    http_request_circuit_state_open,
+    /**
+     *  A single probe request is let through; its outcome closes or reopens the circuit.
+     */
+    http_request_circuit_state_half_open
+};
+
+/**
+ *  http_request_circuit_breaker guards each route (by default, the host) against a degraded backend. After
+ *  failureThreshold consecutive failures (transport errors or server error status codes) the circuit of the route
+ *  opens and its requests fail fast with error code -7, instead of waiting out the session timeout. Once openInterval
+ *  elapsed a single probe is let through to decide whether to close the circuit again.
+ *
+ *  While closed, the number of requests in flight to the route is bounded by a concurrency limit which adapts to the
+ *  observed latency: it grows additively while the latency stays within latencyTolerance times the lowest latency
+ *  observed, and shrinks multiplicatively once it exceeds it or upon failure. Requests beyond the limit fail fast with
+ *  error code -8.
+ */
+@interface http_request_circuit_breaker : NSObject
+
+/**
+ *  The number of consecutive failures which opens the circuit of a route; kDefaultCircuitFailureThreshold by default.
+ */
+@property (assign) NSUInteger failureThreshold;
+
+/**
+ *  The time in seconds a circuit stays open before probing; kDefaultCircuitOpenInterval by default.
+ */
+@property (assign) NSTimeInterval openInterval;
+
+/**
+ *  The concurrency limit of a route before any latency was observed; kDefaultInitialConcurrencyLimit by default.
+ */
+@property (assign) NSUInteger initialConcurrencyLimit;
+
+/**
+ *  The lowest concurrency limit of a route; kDefaultMinConcurrencyLimit by default.
+ */
+@property (assign) NSUInteger minConcurrencyLimit;
+
+/**
+ *  The highest concurrency limit of a route; kDefaultMaxConcurrencyLimit by default.
+ */
+@property (assign) NSUInteger maxConcurrencyLimit;
+
+/**
+ *  The factor of the lowest observed latency beyond which the concurrency limit shrinks; kDefaultLatencyTolerance by
+ *  default.
+ */
+@property (assign) double latencyTolerance;
+
+/**
+ *  The block which maps a request to its route (e.g. host and first path component). Optional (the default), can be
+ *  nil to use the host.
+ */
+@property (copy) NSString *(^routeForRequest)(NSURLRequest *);
+
+/**
+ *  Retrieves the route of a request.
+ *
+ *  @param request The request. Must not be nil.
+ *
+ *  @return The route.
+ */
+- (NSString *)routeOfRequest:(NSURLRequest *)request;
+
+/**
+ *  Retrieves the state of the circuit of a route.
+ *
+ *  @param route The route. Must not be nil.
+ *
+ *  @return The state; closed for routes not seen yet.
+ */
+- (http_request_circuit_state)stateForRoute:(NSString *)route;
+
+/**
+ *  Retrieves the current concurrency limit of a route.
+ *
+ *  @param route The route. Must not be nil.
+ *
+ *  @return The concurrency limit.
+ */
+- (NSUInteger)concurrencyLimitForRoute:(NSString *)route;
+
+/**
+ *  Retrieves the number of requests in flight to a route.
+ *
+ *  @param route The route. Must not be nil.
+ *
+ *  @return The number of requests in flight.
+ */
+- (NSUInteger)inFlightCountForRoute:(NSString *)route;
+
+/**
+ *  Closes every circuit and forgets the observed latencies.
+ */
+- (void)reset;
+
+@end
@@ -0,0 +1,314 @@
+//
+//  http_request_circuit_breaker.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_circuit_breaker.h"
+
+#define kConcurrencyLimitDecrease       0.9
+#define kMinLatencyWindow               256
+
+/**
+ *  The circuit and concurrency bookkeeping of a route.
+ */
+@interface http_request_route_state : NSObject
+
+@property (assign) http_request_circuit_state state;
+@property (assign) NSUInteger consecutiveFailureCount;
+@property (assign) CFAbsoluteTime openTime;
+@property (assign) BOOL probing;
+@property (assign) NSUInteger probeToken;
+@property (assign) NSUInteger inFlightCount;
+@property (assign) double concurrencyLimit;
+@property (assign) NSTimeInterval minLatency;
+@property (assign) NSUInteger latencySampleCount;
+
+@end
+
+@implementation http_request_route_state
+@end
+
+@interface http_request_circuit_breaker()
+{
+    NSMutableDictionary *_routes;
+    NSUInteger _lastProbeToken;
+}
+
+- (void)releaseRoute:(NSString *)route
+          probeToken:(NSUInteger)probeToken
+           succeeded:(BOOL)succeeded
+             latency:(NSTimeInterval)latency;
+- (void)abandonRoute:(NSString *)route probeToken:(NSUInteger)probeToken;
+- (BOOL)isProbe:(NSUInteger)probeToken ofRoute:(http_request_route_state *)routeState;
+- (http_request_route_state *)stateOfRoute:(NSString *)route;
+- (void)openCircuit:(http_request_route_state *)routeState;
+
+@end
+
+@implementation http_request_circuit_breaker
+
+#pragma mark - Public API
+
+- (NSString *)routeOfRequest:(NSURLRequest *)request
+{
+    [http_request throwIfNil:request withName:@"request"];
+
+    NSString *(^routeForRequest)(NSURLRequest *) = self.routeForRequest;
+    NSString *route = routeForRequest ? routeForRequest(request) : [request.URL.host lowercaseString];
+    return route ?: @"";
+}
+
+- (http_request_circuit_state)stateForRoute:(NSString *)route
+{
+    [http_request throwIfNil:route withName:@"route"];
+
+    @synchronized(self)
+    {
+        http_request_route_state *routeState = [_routes objectForKey:route];
+        if (routeState.state == http_request_circuit_state_open
+            && CFAbsoluteTimeGetCurrent() - routeState.openTime >= self.openInterval)
+        {
+            return http_request_circuit_state_half_open;
+        }
+
+        return routeState ? routeState.state : http_request_circuit_state_closed;
+    }
+}
+
+- (NSUInteger)concurrencyLimitForRoute:(NSString *)route
+{
+    [http_request throwIfNil:route withName:@"route"];
+
+    @synchronized(self)
+    {
+        http_request_route_state *routeState = [_routes objectForKey:route];
+        return routeState ? (NSUInteger)routeState.concurrencyLimit : self.initialConcurrencyLimit;
+    }
+}
+
+- (NSUInteger)inFlightCountForRoute:(NSString *)route
+{
+    [http_request throwIfNil:route withName:@"route"];
+
+    @synchronized(self)
+    {
+        return [[_routes objectForKey:route] inFlightCount];
+    }
+}
+
+- (void)reset
+{
+    @synchronized(self)
+    {
+        [_routes removeAllObjects];
+    }
+}
+
+- (BOOL)acquireRoute:(NSString *)route probeToken:(NSUInteger *)probeToken error:(NSError *__autoreleasing *)error
+{
+    *probeToken = 0;
+    *error = nil;
+    @synchronized(self)
+    {
+        http_request_route_state *routeState = [self stateOfRoute:route];
+        if (routeState.state == http_request_circuit_state_open
+            && CFAbsoluteTimeGetCurrent() - routeState.openTime >= self.openInterval)
+        {
+            routeState.state = http_request_circuit_state_half_open;
+        }
+
+        BOOL admitted = NO;
+        if (routeState.state == http_request_circuit_state_half_open)
+        {
+            admitted = !routeState.probing;
+            if (admitted)
+            {
+                // Tokens are never reused, so that only the outcome of this very request decides the circuit.
+                routeState.probing = YES;
+                routeState.probeToken = ++_lastProbeToken;
+                *probeToken = routeState.probeToken;
+            }
+        }
+        else if (routeState.state == http_request_circuit_state_closed)
+        {
+            admitted = routeState.inFlightCount < MAX((NSUInteger)routeState.concurrencyLimit, (NSUInteger)1);
+            if (!admitted)
+            {
+                *error = [[NSError alloc]
+                          initWithDomain:kHttpRequestDomain
+                          code:-8
+                          userInfo:@{NSLocalizedDescriptionKey:@"Concurrency limit reached.", @"Route":route}];
+                return NO;
+            }
+        }
+
+        if (!admitted)
+        {
+            *error = [[NSError alloc]
+                      initWithDomain:kHttpRequestDomain
+                      code:-7
+                      userInfo:@{NSLocalizedDescriptionKey:@"Circuit open.", @"Route":route}];
+            return NO;
+        }
+
+        routeState.inFlightCount++;
+        return YES;
+    }
+}
+
+- (void)releaseRoute:(NSString *)route
+          probeToken:(NSUInteger)probeToken
+        withResponse:(NSURLResponse *)response
+               error:(NSError *)error
+             latency:(NSTimeInterval)latency
+{
+    if ([error.domain isEqualToString:NSURLErrorDomain] && error.code == NSURLErrorCancelled)
+    {
+        [self abandonRoute:route probeToken:probeToken];
+        return;
+    }
+
+    BOOL succeeded = !error;
+    if (succeeded && [response isKindOfClass:[NSHTTPURLResponse class]])
+    {
+        NSInteger statusCode = ((NSHTTPURLResponse *)response).statusCode;
+        succeeded = statusCode < 500 || statusCode >= 600;
+    }
+
+    [self releaseRoute:route probeToken:probeToken succeeded:succeeded latency:latency];
+}
+
+#pragma mark - Internal API
+
+- (void)releaseRoute:(NSString *)route
+          probeToken:(NSUInteger)probeToken
+           succeeded:(BOOL)succeeded
+             latency:(NSTimeInterval)latency
+{
+    @synchronized(self)
+    {
+        http_request_route_state *routeState = [self stateOfRoute:route];
+        routeState.inFlightCount -= routeState.inFlightCount > 0 ? 1 : 0;
+        if (routeState.state == http_request_circuit_state_half_open)
+        {
+            // Requests admitted before the circuit opened may still complete now; only the probe decides.
+            if (![self isProbe:probeToken ofRoute:routeState])
+            {
+                return;
+            }
+
+            routeState.probing = NO;
+            if (succeeded)
+            {
+                routeState.state = http_request_circuit_state_closed;
+                routeState.consecutiveFailureCount = 0;
+                routeState.concurrencyLimit = MAX((double)self.minConcurrencyLimit, routeState.concurrencyLimit);
+            }
+            else
+            {
+                [self openCircuit:routeState];
+            }
+
+            return;
+        }
+
+        if (routeState.state != http_request_circuit_state_closed)
+        {
+            return;
+        }
+
+        double minLimit = MAX((double)self.minConcurrencyLimit, 1);
+        double maxLimit = MAX((double)self.maxConcurrencyLimit, minLimit);
+        if (!succeeded)
+        {
+            routeState.concurrencyLimit = MAX(minLimit, routeState.concurrencyLimit * kConcurrencyLimitDecrease);
+            if (++routeState.consecutiveFailureCount >= self.failureThreshold)
+            {
+                [self openCircuit:routeState];
+            }
+
+            return;
+        }
+
+        // The lowest latency approximates the latency without queueing; it is re-sampled periodically so that it
+        // follows a backend which became slower for good.
+        routeState.consecutiveFailureCount = 0;
+        if (routeState.latencySampleCount++ % kMinLatencyWindow == 0 || latency < routeState.minLatency)
+        {
+            routeState.minLatency = latency;
+        }
+
+        if (latency > routeState.minLatency * self.latencyTolerance)
+        {
+            routeState.concurrencyLimit = MAX(minLimit, routeState.concurrencyLimit * kConcurrencyLimitDecrease);
+        }
+        else
+        {
+            routeState.concurrencyLimit = MIN(maxLimit, routeState.concurrencyLimit + 1.0 / routeState.concurrencyLimit);
+        }
+    }
+}
+
+- (void)abandonRoute:(NSString *)route probeToken:(NSUInteger)probeToken
+{
+    @synchronized(self)
+    {
+        http_request_route_state *routeState = [self stateOfRoute:route];
+        routeState.inFlightCount -= routeState.inFlightCount > 0 ? 1 : 0;
+        if (routeState.state == http_request_circuit_state_half_open && [self isProbe:probeToken ofRoute:routeState])
+        {
+            routeState.probing = NO;
+        }
+    }
+}
+
+- (BOOL)isProbe:(NSUInteger)probeToken ofRoute:(http_request_route_state *)routeState
+{
+    return probeToken != 0 && routeState.probing && routeState.probeToken == probeToken;
+}
+
+- (http_request_route_state *)stateOfRoute:(NSString *)route
+{
+    http_request_route_state *routeState = [_routes objectForKey:route];
+    if (!routeState)
+    {
+        routeState = [http_request_route_state new];
+        routeState.concurrencyLimit = MAX((double)self.initialConcurrencyLimit, 1);
+        [_routes setObject:routeState forKey:route];
+    }
+
+    return routeState;
+}
+
+- (void)openCircuit:(http_request_route_state *)routeState
+{
+    routeState.state = http_request_circuit_state_open;
+    routeState.openTime = CFAbsoluteTimeGetCurrent();
+    routeState.consecutiveFailureCount = 0;
+}
+
+#pragma mark - Initialization
+
+- (id)init
+{
+    self = [super init];
+    if (self)
+    {
+        _routes = [NSMutableDictionary new];
+        self.failureThreshold = kDefaultCircuitFailureThreshold;
+        self.openInterval = kDefaultCircuitOpenInterval;
+        self.initialConcurrencyLimit = kDefaultInitialConcurrencyLimit;
+        self.minConcurrencyLimit = kDefaultMinConcurrencyLimit;
+        self.maxConcurrencyLimit = kDefaultMaxConcurrencyLimit;
+        self.latencyTolerance = kDefaultLatencyTolerance;
+    }
+
+    return self;
+}
+
+@end
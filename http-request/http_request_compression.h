@@ -0,0 +1,50 @@
+//
+//  http_request_compression.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#define kGzipContentEncoding                @"gzip"
+#define kDeflateContentEncoding             @"deflate"
+#define kDefaultCompressionThreshold        1024
+#define kHttpRequestUncompressedLengthKey   @"http_request_uncompressed_length"
+
+/**
+ *  http_request_compression encodes and decodes bodies with the gzip and deflate (zlib) content codings.
+ */
+@interface http_request_compression : NSObject
+
+/**
+ *  Determines whether or not the content coding is supported.
+ *
+ *  @param encoding The content coding (e.g. gzip). Optional, can be nil.
+ *
+ *  @return YES if it is supported; otherwise, NO.
+ */
++ (BOOL)isSupportedEncoding:(NSString *)encoding;
+
+/**
+ *  Compresses the data.
+ *
+ *  @param data     The data to compress. Must not be nil.
+ *  @param encoding The content coding: gzip or deflate. Must not be nil.
+ *
+ *  @return The compressed data; otherwise, nil if the coding is not supported or compression failed.
+ */
++ (NSData *)compressData:(NSData *)data withEncoding:(NSString *)encoding;
+
+/**
+ *  Decompresses the data.
+ *
+ *  @param data     The data to decompress. Must not be nil.
+ *  @param encoding The content coding: gzip or deflate. Must not be nil.
+ *
+ *  @return The decompressed data; otherwise, nil if the coding is not supported or the data is corrupt.
+ */
++ (NSData *)decompressData:(NSData *)data withEncoding:(NSString *)encoding;
+
+@end
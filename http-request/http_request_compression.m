@@ -0,0 +1,113 @@
+//
+//  http_request_compression.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <zlib.h>
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_compression.h"
+
+#define kZlibWindowBits                 15
+#define kZlibGzipWindowBits             (kZlibWindowBits + 16)
+#define kZlibChunkLength                (16 * 1024)
+
+@interface http_request_compression()
+
++ (int)windowBitsForEncoding:(NSString *)encoding;
+
+@end
+
+@implementation http_request_compression
+
+#pragma mark - Public API
+
++ (BOOL)isSupportedEncoding:(NSString *)encoding
+{
+    return [http_request_compression windowBitsForEncoding:encoding] != 0;
+}
+
++ (NSData *)compressData:(NSData *)data withEncoding:(NSString *)encoding
+{
+    [http_request throwIfNil:data withName:@"data"];
+    [http_request throwIfNil:encoding withName:@"encoding"];
+
+    int windowBits = [http_request_compression windowBitsForEncoding:encoding];
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (windowBits == 0 || deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return nil;
+    }
+
+    NSMutableData *compressedData = [NSMutableData dataWithLength:deflateBound(&stream, (uLong)data.length)];
+    stream.next_in = (Bytef *)data.bytes;
+    stream.avail_in = (uInt)data.length;
+    stream.next_out = compressedData.mutableBytes;
+    stream.avail_out = (uInt)compressedData.length;
+    int status = deflate(&stream, Z_FINISH);
+    compressedData.length = stream.total_out;
+    deflateEnd(&stream);
+    return status == Z_STREAM_END ? compressedData : nil;
+}
+
++ (NSData *)decompressData:(NSData *)data withEncoding:(NSString *)encoding
+{
+    [http_request throwIfNil:data withName:@"data"];
+    [http_request throwIfNil:encoding withName:@"encoding"];
+
+    int windowBits = [http_request_compression windowBitsForEncoding:encoding];
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (windowBits == 0 || inflateInit2(&stream, windowBits) != Z_OK)
+    {
+        return nil;
+    }
+
+    NSMutableData *decompressedData = [NSMutableData dataWithLength:MAX(data.length * 2, (NSUInteger)kZlibChunkLength)];
+    stream.next_in = (Bytef *)data.bytes;
+    stream.avail_in = (uInt)data.length;
+    int status = Z_OK;
+    while (status == Z_OK)
+    {
+        if (stream.total_out >= decompressedData.length)
+        {
+            [decompressedData increaseLengthBy:decompressedData.length];
+        }
+
+        stream.next_out = (Bytef *)decompressedData.mutableBytes + stream.total_out;
+        stream.avail_out = (uInt)(decompressedData.length - stream.total_out);
+        status = inflate(&stream, Z_NO_FLUSH);
+    }
+
+    decompressedData.length = stream.total_out;
+    inflateEnd(&stream);
+    return status == Z_STREAM_END ? decompressedData : nil;
+}
+
+#pragma mark - Internal API
+
++ (int)windowBitsForEncoding:(NSString *)encoding
+{
+    if (!encoding)
+    {
+        return 0;
+    }
+
+    if ([encoding caseInsensitiveCompare:kGzipContentEncoding] == NSOrderedSame)
+    {
+        return kZlibGzipWindowBits;
+    }
+
+    if ([encoding caseInsensitiveCompare:kDeflateContentEncoding] == NSOrderedSame)
+    {
+        return kZlibWindowBits;
+    }
+
+    return 0;
+}
+
+@end
@@ -0,0 +1,119 @@
+//
+//  http_request_descriptor.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  The HTTP methods of a request descriptor.
+ */
+typedef NS_ENUM(NSInteger, http_request_method)
+{
+    /**
+     *  GET.
+     */
+    http_request_method_get,
+    /**
+     *  PUT.
+     */
+    http_request_method_put,
+    /**
+     *  POST.
+     */
+    http_request_method_post,
+    /**
+     *  PATCH.
+     */
+    http_request_method_patch,
+    /**
+     *  DELETE.
+     */
+    http_request_method_delete,
+    /**
+     *  HEAD.
+     */
+    http_request_method_head
+};
+
+/**
+ *  http_request_descriptor is an immutable description of an HTTP request: its method, URL, headers and body. A
+ *  descriptor is built once and shared; deriving a descriptor for another URL or body keeps the same header
+ *  dictionary, so templates of common headers are neither copied nor rebuilt per request.
+ */
+@interface http_request_descriptor : NSObject <NSCopying>
+
+/**
+ *  The HTTP method.
+ */
+@property (readonly) http_request_method method;
+
+/**
+ *  The uniform resource locator of the request.
+ */
+@property (readonly) NSURL *url;
+
+/**
+ *  The immutable HTTP headers of the request; otherwise, nil.
+ */
+@property (readonly) NSDictionary *headers;
+
+/**
+ *  The body of the request; otherwise, nil.
+ */
+@property (readonly) NSData *body;
+
+/**
+ *  Retrieves the name of an HTTP method (e.g. kGetHttpMethod) without allocating.
+ *
+ *  @param method The HTTP method.
+ *
+ *  @return The name of the method.
+ */
++ (NSString *)nameOfMethod:(http_request_method)method;
+
+/**
+ *  Creates a descriptor.
+ *
+ *  @param method  The HTTP method.
+ *  @param url     The uniform resource locator of the request. Must not be nil.
+ *  @param headers The HTTP headers of the request; copied once, which is free for immutable dictionaries. Optional,
+ *                 can be nil.
+ *  @param body    The body of the request. Optional, can be nil.
+ *
+ *  @return The descriptor.
+ */
++ (http_request_descriptor *)descriptorWithMethod:(http_request_method)method
+                                              url:(NSURL *)url
+                                          headers:(NSDictionary *)headers
+                                             body:(NSData *)body;
+
+/**
+ *  Derives a descriptor which differs only by its URL.
+ *
+ *  @param url The uniform resource locator of the request. Must not be nil.
+ *
+ *  @return The derived descriptor.
+ */
+- (http_request_descriptor *)descriptorWithUrl:(NSURL *)url;
+
+/**
+ *  Derives a descriptor which differs only by its body.
+ *
+ *  @param body The body of the request. Optional, can be nil.
+ *
+ *  @return The derived descriptor.
+ */
+- (http_request_descriptor *)descriptorWithBody:(NSData *)body;
+
+/**
+ *  Builds the HTTP request described.
+ *
+ *  @return The HTTP request.
+ */
+- (NSMutableURLRequest *)request;
+
+@end
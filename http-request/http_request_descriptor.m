@@ -0,0 +1,106 @@
+//
+//  http_request_descriptor.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_descriptor.h"
+
+@interface http_request_descriptor()
+
+- (id)initWithMethod:(http_request_method)method url:(NSURL *)url headers:(NSDictionary *)headers body:(NSData *)body;
+
+@end
+
+@implementation http_request_descriptor
+
+#pragma mark - Public API
+
++ (NSString *)nameOfMethod:(http_request_method)method
+{
+    switch (method)
+    {
+        case http_request_method_get:
+            return kGetHttpMethod;
+        case http_request_method_put:
+            return kPutHttpMethod;
+        case http_request_method_post:
+            return kPostHttpMethod;
+        case http_request_method_patch:
+            return kPatchHttpMethod;
+        case http_request_method_delete:
+            return kDeleteHttpMethod;
+        case http_request_method_head:
+            return kHeadHttpMethod;
+    }
+
+    [NSException raise:NSInvalidArgumentException format:@"Unknown HTTP method %ld", (long)method];
+    return nil;
+}
+
++ (http_request_descriptor *)descriptorWithMethod:(http_request_method)method
+                                              url:(NSURL *)url
+                                          headers:(NSDictionary *)headers
+                                             body:(NSData *)body
+{
+    [http_request throwIfNil:url withName:@"url"];
+    [http_request_descriptor nameOfMethod:method];
+
+    return [[http_request_descriptor alloc] initWithMethod:method url:url headers:[headers copy] body:[body copy]];
+}
+
+- (http_request_descriptor *)descriptorWithUrl:(NSURL *)url
+{
+    [http_request throwIfNil:url withName:@"url"];
+
+    return [[http_request_descriptor alloc] initWithMethod:_method url:url headers:_headers body:_body];
+}
+
+- (http_request_descriptor *)descriptorWithBody:(NSData *)body
+{
+    return [[http_request_descriptor alloc] initWithMethod:_method url:_url headers:_headers body:[body copy]];
+}
+
+- (NSMutableURLRequest *)request
+{
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:_url];
+    [request setHTTPMethod:[http_request_descriptor nameOfMethod:_method]];
+    if (_headers.count > 0)
+    {
+        [request setAllHTTPHeaderFields:_headers];
+    }
+
+    if (_body)
+    {
+        [request setHTTPBody:_body];
+    }
+
+    return request;
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    return self;
+}
+
+#pragma mark - Initialization
+
+- (id)initWithMethod:(http_request_method)method url:(NSURL *)url headers:(NSDictionary *)headers body:(NSData *)body
+{
+    self = [super init];
+    if (self)
+    {
+        _method = method;
+        _url = url;
+        _headers = headers;
+        _body = body;
+    }
+
+    return self;
+}
+
+@end
@@ -0,0 +1,40 @@
+//
+//  http_request_download.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#define kDefaultMinimumRangeLength      (4 * 1024 * 1024)
+
+/**
+ *  http_request_download represents a download to file which may be split into byte ranges fetched in parallel.
+ */
+@interface http_request_download : NSObject
+
+/**
+ *  The number of body bytes written so far across every range.
+ */
+@property (readonly) int64_t totalBytesWritten;
+
+/**
+ *  The expected size of the file; otherwise, NSURLSessionTransferSizeUnknown until known.
+ */
+@property (readonly) int64_t totalBytesExpected;
+
+/**
+ *  Retrieves the tasks issued so far.
+ *
+ *  @return The tasks.
+ */
+- (NSArray *)tasks;
+
+/**
+ *  Cancels every task of the download; the error callback is called once with a cancellation error.
+ */
+- (void)cancel;
+
+@end
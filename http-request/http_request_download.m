@@ -0,0 +1,131 @@
+//
+//  http_request_download.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_download.h"
+
+@interface http_request_download()
+{
+    NSMutableArray *_tasks;
+    NSMutableDictionary *_bytesWritten;
+    BOOL _cancelled;
+}
+
+@end
+
+@implementation http_request_download
+
+#pragma mark - Public API
+
+- (NSArray *)tasks
+{
+    @synchronized(self)
+    {
+        return [_tasks copy];
+    }
+}
+
+- (void)cancel
+{
+    NSArray *tasks = nil;
+    @synchronized(self)
+    {
+        _cancelled = YES;
+        tasks = [_tasks copy];
+    }
+
+    for (NSURLSessionTask *task in tasks)
+    {
+        [task cancel];
+    }
+}
+
+- (BOOL)addTask:(NSURLSessionTask *)task
+{
+    [http_request throwIfNil:task withName:@"task"];
+
+    @synchronized(self)
+    {
+        if (_cancelled)
+        {
+            return NO;
+        }
+
+        [_tasks addObject:task];
+        return YES;
+    }
+}
+
+- (BOOL)isCancelled
+{
+    @synchronized(self)
+    {
+        return _cancelled;
+    }
+}
+
+- (BOOL)reset
+{
+    NSArray *tasks = nil;
+    @synchronized(self)
+    {
+        if (_cancelled)
+        {
+            return NO;
+        }
+
+        tasks = [_tasks copy];
+        [_tasks removeAllObjects];
+        [_bytesWritten removeAllObjects];
+        _totalBytesWritten = 0;
+    }
+
+    for (NSURLSessionTask *task in tasks)
+    {
+        [task cancel];
+    }
+
+    return YES;
+}
+
+- (int64_t)setBytesWritten:(int64_t)bytesWritten forTask:(NSURLSessionTask *)task
+{
+    @synchronized(self)
+    {
+        NSNumber *key = @(task.taskIdentifier);
+        _totalBytesWritten += bytesWritten - [[_bytesWritten objectForKey:key] longLongValue];
+        [_bytesWritten setObject:@(bytesWritten) forKey:key];
+        return _totalBytesWritten;
+    }
+}
+
+- (void)setTotalBytesExpected:(int64_t)totalBytesExpected
+{
+    @synchronized(self)
+    {
+        _totalBytesExpected = totalBytesExpected;
+    }
+}
+
+#pragma mark - Initialization
+
+- (id)init
+{
+    self = [super init];
+    if (self)
+    {
+        _tasks = [NSMutableArray new];
+        _bytesWritten = [NSMutableDictionary new];
+        _totalBytesExpected = NSURLSessionTransferSizeUnknown;
+    }
+
+    return self;
+}
+
+@end
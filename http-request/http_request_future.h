@@ -0,0 +1,163 @@
+//
+//  http_request_future.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  http_request_future represents a value which becomes available later, such as the parsed body of a response. A
+ *  future completes exactly once: it is either fulfilled with a value or rejected with an error.
+ *
+ *  Continuations run synchronously on the thread which completes the future (the callback queue of the http_request for
+ *  the futures it returns), or right away on the calling thread if the future already completed; no extra dispatch
+ *  takes place. Continuations should therefore be short, or dispatch long work themselves.
+ *
+ *  Cancelling a future rejects it with NSURLErrorCancelled and cancels whatever it depends on: the task of a request,
+ *  the future a continuation chains from, or the futures combined by all: and race:.
+ */
+@interface http_request_future : NSObject
+
+/**
+ *  Determines whether or not the future completed.
+ */
+@property (readonly) BOOL isCompleted;
+
+/**
+ *  The value of a fulfilled future; otherwise, nil.
+ */
+@property (readonly) id value;
+
+/**
+ *  The error of a rejected future; otherwise, nil.
+ */
+@property (readonly) NSError *error;
+
+/**
+ *  The response which produced the value or the error, if any; continuations inherit the response of the future they
+ *  chain from unless they return a future of their own.
+ */
+@property (readonly) NSURLResponse *response;
+
+/**
+ *  Creates a future fulfilled with a value.
+ *
+ *  @param value The value. Optional, can be nil.
+ *
+ *  @return The fulfilled future.
+ */
++ (http_request_future *)futureWithValue:(id)value;
+
+/**
+ *  Creates a future rejected with an error.
+ *
+ *  @param error The error. Must not be nil.
+ *
+ *  @return The rejected future.
+ */
++ (http_request_future *)futureWithError:(NSError *)error;
+
+/**
+ *  Creates a future fulfilled with the values of every future, in the same order (NSNull stands for nil values), or
+ *  rejected with the first error; the other futures are then cancelled.
+ *
+ *  @param futures The futures to combine. Must not be nil.
+ *
+ *  @return The combined future.
+ */
++ (http_request_future *)all:(NSArray *)futures;
+
+/**
+ *  Creates a future completed like the first of the futures to complete; the other futures are then cancelled. It
+ *  never completes if there are no futures.
+ *
+ *  @param futures The futures to race. Must not be nil.
+ *
+ *  @return The combined future.
+ */
++ (http_request_future *)race:(NSArray *)futures;
+
+/**
+ *  The default instance initializer; creates a pending future to be completed through fulfillWithValue: or
+ *  rejectWithError:.
+ *
+ *  @return An instance of class.
+ */
+- (id)init;
+
+/**
+ *  Fulfills the future with a value, unless it already completed.
+ *
+ *  @param value The value. Optional, can be nil.
+ *
+ *  @return YES if the future was fulfilled; otherwise, NO.
+ */
+- (BOOL)fulfillWithValue:(id)value;
+
+/**
+ *  Rejects the future with an error, unless it already completed.
+ *
+ *  @param error The error. Must not be nil.
+ *
+ *  @return YES if the future was rejected; otherwise, NO.
+ */
+- (BOOL)rejectWithError:(NSError *)error;
+
+/**
+ *  Chains a continuation called with the value once the future is fulfilled; a rejection skips it.
+ *
+ *  @param continuation The continuation; passes the value and returns the value of the new future, or a future to wait
+ *                      for (e.g. the next request). Must not be nil.
+ *
+ *  @return The future of the continuation.
+ */
+- (http_request_future *)then:(id (^)(id))continuation;
+
+/**
+ *  Chains a recovery called with the error once the future is rejected; a fulfillment skips it.
+ *
+ *  @param recovery The recovery; passes the error and returns the value of the new future, or a future to wait for
+ *                  (e.g. futureWithError: to keep failing). Must not be nil.
+ *
+ *  @return The future of the recovery.
+ */
+- (http_request_future *)recover:(id (^)(NSError *))recovery;
+
+/**
+ *  Creates a future completed like this one, unless it takes longer than the timeout; the future is then rejected with
+ *  NSURLErrorTimedOut and this one cancelled.
+ *
+ *  @param timeout The timeout in seconds.
+ *
+ *  @return The future bounded by the timeout.
+ */
+- (http_request_future *)timeout:(NSTimeInterval)timeout;
+
+/**
+ *  Observes the completion of the future.
+ *
+ *  @param successCallback The callback called upon fulfillment; passes the response and the value. Must not be nil.
+ *  @param errorCallback   The callback called upon rejection; passes the error. Must not be nil.
+ */
+- (void)onSuccess:(void (^)(NSURLResponse *, id))successCallback onError:(void (^)(NSError *))errorCallback;
+
+/**
+ *  Blocks the calling thread until the future completes. Must not be called from the thread which completes the future
+ *  (e.g. the callback queue).
+ *
+ *  @param timeout The maximum time to wait in seconds.
+ *  @param error   The error of a rejected future, or NSURLErrorTimedOut if it did not complete in time. Must not be nil.
+ *
+ *  @return The value of a fulfilled future; otherwise, nil.
+ */
+- (id)waitWithTimeout:(NSTimeInterval)timeout error:(NSError *__autoreleasing *)error;
+
+/**
+ *  Cancels the future and whatever it depends on, unless it already completed.
+ */
+- (void)cancel;
+
+@end
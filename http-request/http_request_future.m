@@ -0,0 +1,362 @@
+//
+//  http_request_future.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_future.h"
+
+@interface http_request_future()
+{
+    NSMutableArray *_observers;
+    void (^_cancellation)(void);
+}
+
+- (void)whenCompleted:(void (^)(http_request_future *))observer;
+- (void)resolveWithResult:(id)result response:(NSURLResponse *)response;
+
+@end
+
+@implementation http_request_future
+
+#pragma mark - Public API
+
++ (http_request_future *)futureWithValue:(id)value
+{
+    http_request_future *future = [http_request_future new];
+    [future fulfillWithValue:value];
+    return future;
+}
+
++ (http_request_future *)futureWithError:(NSError *)error
+{
+    [http_request throwIfNil:error withName:@"error"];
+
+    http_request_future *future = [http_request_future new];
+    [future rejectWithError:error];
+    return future;
+}
+
++ (http_request_future *)all:(NSArray *)futures
+{
+    [http_request throwIfNil:futures withName:@"futures"];
+
+    http_request_future *combinedFuture = [http_request_future new];
+    NSArray *inputFutures = [futures copy];
+    if (inputFutures.count == 0)
+    {
+        [combinedFuture fulfillWithValue:@[]];
+        return combinedFuture;
+    }
+
+    NSMutableArray *values = [NSMutableArray arrayWithCapacity:inputFutures.count];
+    for (NSUInteger index = 0; index < inputFutures.count; index++)
+    {
+        [values addObject:[NSNull null]];
+    }
+
+    __block NSUInteger remainingCount = inputFutures.count;
+    void (^cancelInputs)(void) = ^
+    {
+        for (http_request_future *inputFuture in inputFutures)
+        {
+            [inputFuture cancel];
+        }
+    };
+    [combinedFuture setCancellation:cancelInputs];
+    [inputFutures enumerateObjectsUsingBlock:^(http_request_future *inputFuture, NSUInteger index, BOOL *stop)
+    {
+        [inputFuture whenCompleted:^(http_request_future *completedFuture)
+         {
+             if (completedFuture.error)
+             {
+                 if ([combinedFuture completeWithValue:nil error:completedFuture.error response:completedFuture.response])
+                 {
+                     cancelInputs();
+                 }
+
+                 return;
+             }
+
+             BOOL completed = NO;
+             @synchronized(values)
+             {
+                 values[index] = completedFuture.value ?: [NSNull null];
+                 completed = --remainingCount == 0;
+             }
+
+             if (completed)
+             {
+                 [combinedFuture completeWithValue:[values copy] error:nil response:nil];
+             }
+         }];
+    }];
+
+    return combinedFuture;
+}
+
++ (http_request_future *)race:(NSArray *)futures
+{
+    [http_request throwIfNil:futures withName:@"futures"];
+
+    http_request_future *combinedFuture = [http_request_future new];
+    NSArray *inputFutures = [futures copy];
+    void (^cancelInputs)(void) = ^
+    {
+        for (http_request_future *inputFuture in inputFutures)
+        {
+            [inputFuture cancel];
+        }
+    };
+    [combinedFuture setCancellation:cancelInputs];
+    for (http_request_future *inputFuture in inputFutures)
+    {
+        [inputFuture whenCompleted:^(http_request_future *completedFuture)
+         {
+             if ([combinedFuture
+                  completeWithValue:completedFuture.value
+                  error:completedFuture.error
+                  response:completedFuture.response])
+             {
+                 cancelInputs();
+             }
+         }];
+    }
+
+    return combinedFuture;
+}
+
+- (BOOL)fulfillWithValue:(id)value
+{
+    return [self completeWithValue:value error:nil response:nil];
+}
+
+- (BOOL)rejectWithError:(NSError *)error
+{
+    [http_request throwIfNil:error withName:@"error"];
+
+    return [self completeWithValue:nil error:error response:nil];
+}
+
+- (http_request_future *)then:(id (^)(id))continuation
+{
+    [http_request throwIfNil:continuation withName:@"continuation"];
+
+    http_request_future *future = [http_request_future new];
+    [future setCancellation:^
+     {
+         [self cancel];
+     }];
+    [self whenCompleted:^(http_request_future *completedFuture)
+     {
+         if (completedFuture.error)
+         {
+             [future completeWithValue:nil error:completedFuture.error response:completedFuture.response];
+             return;
+         }
+
+         [future resolveWithResult:continuation(completedFuture.value) response:completedFuture.response];
+     }];
+    return future;
+}
+
+- (http_request_future *)recover:(id (^)(NSError *))recovery
+{
+    [http_request throwIfNil:recovery withName:@"recovery"];
+
+    http_request_future *future = [http_request_future new];
+    [future setCancellation:^
+     {
+         [self cancel];
+     }];
+    [self whenCompleted:^(http_request_future *completedFuture)
+     {
+         if (!completedFuture.error)
+         {
+             [future completeWithValue:completedFuture.value error:nil response:completedFuture.response];
+             return;
+         }
+
+         [future resolveWithResult:recovery(completedFuture.error) response:completedFuture.response];
+     }];
+    return future;
+}
+
+- (http_request_future *)timeout:(NSTimeInterval)timeout
+{
+    http_request_future *future = [http_request_future new];
+    [future setCancellation:^
+     {
+         [self cancel];
+     }];
+    [self whenCompleted:^(http_request_future *completedFuture)
+     {
+         [future completeWithValue:completedFuture.value error:completedFuture.error response:completedFuture.response];
+     }];
+
+    // Weak so that the timer does not keep either future alive past its completion.
+    __weak http_request_future *weakFuture = future;
+    __weak http_request_future *weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(timeout * NSEC_PER_SEC)),
+                   dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^
+    {
+        NSError *timeoutError = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorTimedOut userInfo:nil];
+        if ([weakFuture completeWithValue:nil error:timeoutError response:nil])
+        {
+            [weakSelf cancel];
+        }
+    });
+    return future;
+}
+
+- (void)onSuccess:(void (^)(NSURLResponse *, id))successCallback onError:(void (^)(NSError *))errorCallback
+{
+    [http_request throwIfNil:successCallback withName:@"successCallback"];
+    [http_request throwIfNil:errorCallback withName:@"errorCallback"];
+
+    [self whenCompleted:^(http_request_future *completedFuture)
+     {
+         if (completedFuture.error)
+         {
+             errorCallback(completedFuture.error);
+         }
+         else
+         {
+             successCallback(completedFuture.response, completedFuture.value);
+         }
+     }];
+}
+
+- (id)waitWithTimeout:(NSTimeInterval)timeout error:(NSError *__autoreleasing *)error
+{
+    *error = nil;
+    dispatch_semaphore_t completed = dispatch_semaphore_create(0);
+    [self whenCompleted:^(http_request_future *completedFuture)
+     {
+         dispatch_semaphore_signal(completed);
+     }];
+    if (dispatch_semaphore_wait(completed, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(timeout * NSEC_PER_SEC))) != 0)
+    {
+        *error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorTimedOut userInfo:nil];
+        return nil;
+    }
+
+    *error = self.error;
+    return self.value;
+}
+
+- (void)cancel
+{
+    void (^cancellation)(void) = nil;
+    @synchronized(self)
+    {
+        if (_isCompleted)
+        {
+            return;
+        }
+
+        cancellation = _cancellation;
+    }
+
+    NSError *cancellationError = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil];
+    if ([self completeWithValue:nil error:cancellationError response:nil] && cancellation)
+    {
+        cancellation();
+    }
+}
+
+- (BOOL)completeWithValue:(id)value error:(NSError *)error response:(NSURLResponse *)response
+{
+    NSArray *observers = nil;
+    @synchronized(self)
+    {
+        if (_isCompleted)
+        {
+            return NO;
+        }
+
+        _isCompleted = YES;
+        _value = value;
+        _error = error;
+        _response = response;
+        observers = _observers;
+        _observers = nil;
+        _cancellation = nil;
+    }
+
+    for (void (^observer)(http_request_future *) in observers)
+    {
+        observer(self);
+    }
+
+    return YES;
+}
+
+- (void)setCancellation:(void (^)(void))cancellation
+{
+    @synchronized(self)
+    {
+        if (!_isCompleted)
+        {
+            _cancellation = [cancellation copy];
+        }
+    }
+}
+
+#pragma mark - Internal API
+
+- (void)whenCompleted:(void (^)(http_request_future *))observer
+{
+    BOOL completed = NO;
+    @synchronized(self)
+    {
+        completed = _isCompleted;
+        if (!completed)
+        {
+            [_observers addObject:[observer copy]];
+        }
+    }
+
+    if (completed)
+    {
+        observer(self);
+    }
+}
+
+- (void)resolveWithResult:(id)result response:(NSURLResponse *)response
+{
+    if (![result isKindOfClass:[http_request_future class]])
+    {
+        [self completeWithValue:result error:nil response:response];
+        return;
+    }
+
+    http_request_future *innerFuture = result;
+    [self setCancellation:^
+     {
+         [innerFuture cancel];
+     }];
+    [innerFuture whenCompleted:^(http_request_future *completedFuture)
+     {
+         [self completeWithValue:completedFuture.value error:completedFuture.error response:completedFuture.response];
+     }];
+}
+
+#pragma mark - Initialization
+
+- (id)init
+{
+    self = [super init];
+    if (self)
+    {
+        _observers = [NSMutableArray new];
+    }
+
+    return self;
+}
+
+@end
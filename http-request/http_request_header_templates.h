@@ -0,0 +1,73 @@
+//
+//  http_request_header_templates.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  http_request_header_templates holds the headers (e.g. authorization and tracing) to add to every request sent to a
+ *  host or below a base URL. Templates are merged once per host and base URL, from the host to the most specific base
+ *  URL, and the merged headers are cached until a template changes; headers set on a request take precedence.
+ *
+ *  Changing a template, such as refreshing a token, applies to the requests issued from then on without touching the
+ *  session or the requests in flight.
+ */
+@interface http_request_header_templates : NSObject
+
+/**
+ *  Sets the headers to add to the requests sent to a host, replacing the previous ones.
+ *
+ *  @param headers The headers. Optional, can be nil to remove the template.
+ *  @param host    The host, compared case insensitively (e.g. api.example.com). Must not be nil.
+ */
+- (void)setHeaders:(NSDictionary *)headers forHost:(NSString *)host;
+
+/**
+ *  Sets the headers to add to the requests sent to a base URL or below it, replacing the previous ones.
+ *
+ *  @param headers The headers. Optional, can be nil to remove the template.
+ *  @param baseUrl The base URL, which matches URLs starting with it at a path boundary
+ *                 (e.g. https://api.example.com/v1 matches https://api.example.com/v1/users but not
+ *                 https://api.example.com/v10). Must not be nil.
+ */
+- (void)setHeaders:(NSDictionary *)headers forBaseUrl:(NSURL *)baseUrl;
+
+/**
+ *  Sets a single header of the template of a host, such as a refreshed token, keeping the others.
+ *
+ *  @param value The value of the header. Optional, can be nil to remove the header.
+ *  @param name  The name of the header. Must not be nil.
+ *  @param host  The host, compared case insensitively. Must not be nil.
+ */
+- (void)setValue:(NSString *)value forHeader:(NSString *)name forHost:(NSString *)host;
+
+/**
+ *  Sets a single header of the template of a base URL, such as a refreshed token, keeping the others.
+ *
+ *  @param value   The value of the header. Optional, can be nil to remove the header.
+ *  @param name    The name of the header. Must not be nil.
+ *  @param baseUrl The base URL. Must not be nil.
+ */
+- (void)setValue:(NSString *)value forHeader:(NSString *)name forBaseUrl:(NSURL *)baseUrl;
+
+/**
+ *  Retrieves the merged headers of the templates which apply to a URL.
+ *
+ *  @param url The URL. Optional, can be nil.
+ *
+ *  @return The cached, immutable merged headers; otherwise, nil if no template applies.
+ */
+- (NSDictionary *)headersForUrl:(NSURL *)url;
+
+/**
+ *  Adds the merged headers of the templates which apply to the URL of a request, unless the request sets them already.
+ *
+ *  @param request The request. Must not be nil.
+ */
+- (void)applyToRequest:(NSMutableURLRequest *)request;
+
+@end
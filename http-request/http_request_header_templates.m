@@ -0,0 +1,217 @@
+//
+//  http_request_header_templates.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_header_templates.h"
+
+@interface http_request_header_templates()
+{
+    NSMutableDictionary *_hostTemplates;
+    NSMutableDictionary *_baseUrlTemplates;
+    NSArray *_sortedBaseUrls;
+    NSMutableDictionary *_mergedHeaders;
+}
+
++ (NSString *)keyForBaseUrl:(NSURL *)baseUrl;
++ (BOOL)url:(NSString *)url startsWithBaseUrl:(NSString *)baseUrl;
+
+- (void)setHeaders:(NSDictionary *)headers forKey:(NSString *)key inTemplates:(NSMutableDictionary *)templates;
+- (void)setValue:(NSString *)value forHeader:(NSString *)name forKey:(NSString *)key inTemplates:(NSMutableDictionary *)templates;
+
+@end
+
+@implementation http_request_header_templates
+
+#pragma mark - Public API
+
+- (void)setHeaders:(NSDictionary *)headers forHost:(NSString *)host
+{
+    [http_request throwIfNil:host withName:@"host"];
+
+    [self setHeaders:headers forKey:[host lowercaseString] inTemplates:_hostTemplates];
+}
+
+- (void)setHeaders:(NSDictionary *)headers forBaseUrl:(NSURL *)baseUrl
+{
+    [http_request throwIfNil:baseUrl withName:@"baseUrl"];
+
+    [self setHeaders:headers forKey:[http_request_header_templates keyForBaseUrl:baseUrl] inTemplates:_baseUrlTemplates];
+}
+
+- (void)setValue:(NSString *)value forHeader:(NSString *)name forHost:(NSString *)host
+{
+    [http_request throwIfNil:name withName:@"name"];
+    [http_request throwIfNil:host withName:@"host"];
+
+    [self setValue:value forHeader:name forKey:[host lowercaseString] inTemplates:_hostTemplates];
+}
+
+- (void)setValue:(NSString *)value forHeader:(NSString *)name forBaseUrl:(NSURL *)baseUrl
+{
+    [http_request throwIfNil:name withName:@"name"];
+    [http_request throwIfNil:baseUrl withName:@"baseUrl"];
+
+    [self
+     setValue:value
+     forHeader:name
+     forKey:[http_request_header_templates keyForBaseUrl:baseUrl]
+     inTemplates:_baseUrlTemplates];
+}
+
+- (NSDictionary *)headersForUrl:(NSURL *)url
+{
+    if (!url)
+    {
+        return nil;
+    }
+
+    NSString *host = [url.host lowercaseString] ?: @"";
+    NSString *absoluteUrl = [url absoluteString];
+    @synchronized(self)
+    {
+        // Base URLs matching a URL are prefixes of each other, so the longest one identifies every template merged.
+        NSString *longestBaseUrl = nil;
+        for (NSString *baseUrl in [_sortedBaseUrls reverseObjectEnumerator])
+        {
+            if ([http_request_header_templates url:absoluteUrl startsWithBaseUrl:baseUrl])
+            {
+                longestBaseUrl = baseUrl;
+                break;
+            }
+        }
+
+        NSString *key = longestBaseUrl ?: host;
+        id mergedHeaders = [_mergedHeaders objectForKey:key];
+        if (!mergedHeaders)
+        {
+            NSMutableDictionary *headers = [NSMutableDictionary new];
+            NSDictionary *hostHeaders = [_hostTemplates objectForKey:host];
+            if (hostHeaders)
+            {
+                [headers addEntriesFromDictionary:hostHeaders];
+            }
+
+            for (NSString *baseUrl in _sortedBaseUrls)
+            {
+                if (longestBaseUrl
+                    && baseUrl.length <= longestBaseUrl.length
+                    && [http_request_header_templates url:absoluteUrl startsWithBaseUrl:baseUrl])
+                {
+                    [headers addEntriesFromDictionary:[_baseUrlTemplates objectForKey:baseUrl]];
+                }
+            }
+
+            mergedHeaders = headers.count > 0 ? [headers copy] : [NSNull null];
+            [_mergedHeaders setObject:mergedHeaders forKey:key];
+        }
+
+        return mergedHeaders != [NSNull null] ? mergedHeaders : nil;
+    }
+}
+
+- (void)applyToRequest:(NSMutableURLRequest *)request
+{
+    [http_request throwIfNil:request withName:@"request"];
+
+    NSDictionary *headers = [self headersForUrl:request.URL];
+    for (NSString *name in headers)
+    {
+        if (![request valueForHTTPHeaderField:name])
+        {
+            [request setValue:[headers objectForKey:name] forHTTPHeaderField:name];
+        }
+    }
+}
+
+#pragma mark - Internal API
+
++ (NSString *)keyForBaseUrl:(NSURL *)baseUrl
+{
+    NSString *key = [baseUrl absoluteString];
+    while ([key hasSuffix:@"/"])
+    {
+        key = [key substringToIndex:key.length - 1];
+    }
+
+    return key;
+}
+
++ (BOOL)url:(NSString *)url startsWithBaseUrl:(NSString *)baseUrl
+{
+    if (url.length < baseUrl.length
+        || [url compare:baseUrl options:NSCaseInsensitiveSearch range:NSMakeRange(0, baseUrl.length)] != NSOrderedSame)
+    {
+        return NO;
+    }
+
+    if (url.length == baseUrl.length)
+    {
+        return YES;
+    }
+
+    unichar boundary = [url characterAtIndex:baseUrl.length];
+    return boundary == '/' || boundary == '?' || boundary == '#';
+}
+
+- (void)setHeaders:(NSDictionary *)headers forKey:(NSString *)key inTemplates:(NSMutableDictionary *)templates
+{
+    @synchronized(self)
+    {
+        if (headers.count > 0)
+        {
+            [templates setObject:[headers copy] forKey:key];
+        }
+        else
+        {
+            [templates removeObjectForKey:key];
+        }
+
+        _sortedBaseUrls = [[_baseUrlTemplates allKeys] sortedArrayUsingComparator:^NSComparisonResult(NSString *first, NSString *second)
+        {
+            return [@(first.length) compare:@(second.length)];
+        }];
+        [_mergedHeaders removeAllObjects];
+    }
+}
+
+- (void)setValue:(NSString *)value forHeader:(NSString *)name forKey:(NSString *)key inTemplates:(NSMutableDictionary *)templates
+{
+    @synchronized(self)
+    {
+        NSMutableDictionary *headers = [[templates objectForKey:key] mutableCopy] ?: [NSMutableDictionary new];
+        if (value)
+        {
+            [headers setObject:value forKey:name];
+        }
+        else
+        {
+            [headers removeObjectForKey:name];
+        }
+
+        [self setHeaders:headers forKey:key inTemplates:templates];
+    }
+}
+
+#pragma mark - Initialization
+
+- (id)init
+{
+    self = [super init];
+    if (self)
+    {
+        _hostTemplates = [NSMutableDictionary new];
+        _baseUrlTemplates = [NSMutableDictionary new];
+        _sortedBaseUrls = @[];
+        _mergedHeaders = [NSMutableDictionary new];
+    }
+
+    return self;
+}
+
+@end
@@ -0,0 +1,86 @@
+//
+//  http_request_hedging_policy.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class http_request_retry_budget;
+
+#define kDefaultHedgingPercentile       0.95
+#define kDefaultHedgingMinDelay         0.01
+#define kDefaultHedgingMinSampleCount   16
+#define kHedgingLatencyWindow           128
+
+/**
+ *  http_request_hedging_policy decides whether and when a second attempt of a slow request is issued. It keeps the
+ *  latencies of the last kHedgingLatencyWindow successful attempts and, once minSampleCount were observed, hedges a
+ *  request still in flight after the given percentile of them; the first attempt to succeed wins and the other one is
+ *  cancelled. Only idempotent requests are hedged unless told otherwise. Latencies are not kept per host: use an
+ *  instance of http_request per backend when their latencies differ widely.
+ */
+@interface http_request_hedging_policy : NSObject
+
+/**
+ *  The percentile of the observed latencies after which a request is hedged, between 0 and 1;
+ *  kDefaultHedgingPercentile by default.
+ */
+@property (assign) double percentile;
+
+/**
+ *  The minimum delay before hedging, in seconds; kDefaultHedgingMinDelay by default.
+ */
+@property (assign) NSTimeInterval minDelay;
+
+/**
+ *  The number of latencies to observe before hedging at all; kDefaultHedgingMinSampleCount by default.
+ */
+@property (assign) NSUInteger minSampleCount;
+
+/**
+ *  Determines whether or not requests with a non-idempotent method (e.g. POST, PATCH) are hedged. Defaults to NO.
+ */
+@property (assign) BOOL hedgesNonIdempotentRequests;
+
+/**
+ *  The budget hedges are withdrawn from. Defaults to the shared retry budget; can be nil to disable the budget.
+ */
+@property (strong) http_request_retry_budget *budget;
+
+/**
+ *  The number of hedges issued so far.
+ */
+@property (readonly) NSUInteger hedgeCount;
+
+/**
+ *  The number of hedges which succeeded before the attempt they hedged.
+ */
+@property (readonly) NSUInteger hedgeWinCount;
+
+/**
+ *  Determines whether or not the request may be hedged, not taking the observed latencies into account.
+ *
+ *  @param request The request. Must not be nil.
+ *
+ *  @return YES if it may be hedged; otherwise, NO.
+ */
+- (BOOL)shouldHedgeRequest:(NSURLRequest *)request;
+
+/**
+ *  Computes the delay after which a request still in flight is hedged.
+ *
+ *  @return The delay in seconds; otherwise, a negative value if fewer than minSampleCount latencies were observed.
+ */
+- (NSTimeInterval)hedgeDelay;
+
+/**
+ *  Records the latency of a successful attempt, e.g. to seed the policy with known latencies.
+ *
+ *  @param latency The latency in seconds.
+ */
+- (void)recordLatency:(NSTimeInterval)latency;
+
+@end
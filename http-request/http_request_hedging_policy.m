@@ -0,0 +1,104 @@
+//
+//  http_request_hedging_policy.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_hedging_policy.h"
+
+static int compare_latencies(const void *left, const void *right)
+{
+    NSTimeInterval leftLatency = *(const NSTimeInterval *)left;
+    NSTimeInterval rightLatency = *(const NSTimeInterval *)right;
+    return leftLatency < rightLatency ? -1 : (leftLatency > rightLatency ? 1 : 0);
+}
+
+@interface http_request_hedging_policy()
+{
+    NSTimeInterval _latencies[kHedgingLatencyWindow];
+    NSUInteger _latencyCount;
+    NSUInteger _nextLatencyIndex;
+}
+
+@end
+
+@implementation http_request_hedging_policy
+
+#pragma mark - Public API
+
+- (BOOL)shouldHedgeRequest:(NSURLRequest *)request
+{
+    [http_request throwIfNil:request withName:@"request"];
+
+    return self.hedgesNonIdempotentRequests
+           || [http_request_retry_policy isIdempotentMethod:request.HTTPMethod ?: kGetHttpMethod];
+}
+
+- (NSTimeInterval)hedgeDelay
+{
+    NSTimeInterval latencies[kHedgingLatencyWindow];
+    NSUInteger latencyCount = 0;
+    @synchronized(self)
+    {
+        latencyCount = _latencyCount;
+        memcpy(latencies, _latencies, latencyCount * sizeof(NSTimeInterval));
+    }
+
+    if (latencyCount == 0 || latencyCount < self.minSampleCount)
+    {
+        return -1;
+    }
+
+    qsort(latencies, latencyCount, sizeof(NSTimeInterval), compare_latencies);
+    double percentile = MIN(MAX(self.percentile, 0.0), 1.0);
+    NSUInteger index = MIN((NSUInteger)(percentile * latencyCount), latencyCount - 1);
+    return MAX(latencies[index], self.minDelay);
+}
+
+- (void)recordLatency:(NSTimeInterval)latency
+{
+    @synchronized(self)
+    {
+        _latencies[_nextLatencyIndex] = latency;
+        _nextLatencyIndex = (_nextLatencyIndex + 1) % kHedgingLatencyWindow;
+        _latencyCount = MIN(_latencyCount + 1, (NSUInteger)kHedgingLatencyWindow);
+    }
+}
+
+- (void)recordHedge
+{
+    @synchronized(self)
+    {
+        _hedgeCount++;
+    }
+}
+
+- (void)recordHedgeWin
+{
+    @synchronized(self)
+    {
+        _hedgeWinCount++;
+    }
+}
+
+#pragma mark - Initialization
+
+- (id)init
+{
+    self = [super init];
+    if (self)
+    {
+        _percentile = kDefaultHedgingPercentile;
+        _minDelay = kDefaultHedgingMinDelay;
+        _minSampleCount = kDefaultHedgingMinSampleCount;
+        _budget = [http_request_retry_budget sharedBudget];
+    }
+
+    return self;
+}
+
+@end
@@ -0,0 +1,55 @@
+//
+//  http_request_json_codec.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "http_request_json_document.h"
+
+/**
+ *  A JSON codec, through which http_request parses JSON bodies and serializes JSON ones (see http_request setJsonCodec:).
+ *  Codecs must be safe to use from multiple threads at once.
+ */
+@protocol http_request_json_codec <NSObject>
+
+/**
+ *  Decodes JSON data.
+ *
+ *  @param data  The data to decode. Must not be nil.
+ *  @param error The error, if any. Must not be nil.
+ *
+ *  @return The decoded value; otherwise, nil if the data is malformed.
+ */
+- (id)decodeData:(NSData *)data error:(NSError *__autoreleasing *)error;
+
+/**
+ *  Encodes an object as JSON data.
+ *
+ *  @param object The object to encode. Must not be nil.
+ *  @param error  The error, if any. Must not be nil.
+ *
+ *  @return The encoded data; otherwise, nil if the object cannot be encoded.
+ */
+- (NSData *)encodeObject:(id)object error:(NSError *__autoreleasing *)error;
+
+@end
+
+/**
+ *  http_request_foundation_json_codec decodes JSON into a tree of NSDictionary, NSArray, NSString, NSNumber and NSNull
+ *  with NSJSONSerialization. It is the default codec.
+ */
+@interface http_request_foundation_json_codec : NSObject <http_request_json_codec>
+
+@end
+
+/**
+ *  http_request_lazy_json_codec decodes JSON into an http_request_json_document, which only converts the values
+ *  accessed; it suits large responses of which only a few fields are read. Documents are encoded as their raw data and
+ *  any other object with NSJSONSerialization.
+ */
+@interface http_request_lazy_json_codec : NSObject <http_request_json_codec>
+
+@end
@@ -0,0 +1,63 @@
+//
+//  http_request_json_codec.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_json_codec.h"
+
+@implementation http_request_foundation_json_codec
+
+#pragma mark - Public API
+
+- (id)decodeData:(NSData *)data error:(NSError *__autoreleasing *)error
+{
+    [http_request throwIfNil:data withName:@"data"];
+
+    return [NSJSONSerialization JSONObjectWithData:data options:kNilOptions error:error];
+}
+
+- (NSData *)encodeObject:(id)object error:(NSError *__autoreleasing *)error
+{
+    [http_request throwIfNil:object withName:@"object"];
+
+    if ([object isKindOfClass:[http_request_json_document class]])
+    {
+        *error = nil;
+        return [object data];
+    }
+
+    return [NSJSONSerialization dataWithJSONObject:object options:kNilOptions error:error];
+}
+
+@end
+
+@implementation http_request_lazy_json_codec
+
+#pragma mark - Public API
+
+- (id)decodeData:(NSData *)data error:(NSError *__autoreleasing *)error
+{
+    [http_request throwIfNil:data withName:@"data"];
+
+    return [http_request_json_document documentWithData:data error:error];
+}
+
+- (NSData *)encodeObject:(id)object error:(NSError *__autoreleasing *)error
+{
+    [http_request throwIfNil:object withName:@"object"];
+
+    if ([object isKindOfClass:[http_request_json_document class]])
+    {
+        *error = nil;
+        return [object data];
+    }
+
+    return [NSJSONSerialization dataWithJSONObject:object options:kNilOptions error:error];
+}
+
+@end
@@ -0,0 +1,116 @@
+//
+//  http_request_json_document.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  The types of JSON values.
+ */
+typedef NS_ENUM(NSInteger, http_request_json_type)
+{
+    http_request_json_type_invalid,
+    http_request_json_type_object,
+    http_request_json_type_array,
+    http_request_json_type_string,
+    http_request_json_type_number,
+    http_request_json_type_boolean,
+    http_request_json_type_null
+};
+
+/**
+ *  http_request_json_document is a lazy, read-only view of a JSON value over its raw data. Nothing is parsed up front:
+ *  the members of an object or array are indexed the first time one of them is accessed, and only the values accessed
+ *  are converted. Nested objects and arrays are returned as documents sharing the same data, strings, numbers, booleans
+ *  and null as their Foundation counterparts (NSString, NSNumber and NSNull).
+ *
+ *  The data is only checked for balanced brackets and terminated strings when the document is created; a malformed
+ *  value is reported when it is accessed (nil) or materialized (an error).
+ */
+@interface http_request_json_document : NSObject
+
+/**
+ *  The raw data of the value.
+ */
+@property (readonly) NSData *data;
+
+/**
+ *  The type of the value.
+ */
+@property (readonly) http_request_json_type type;
+
+/**
+ *  Creates a document viewing the JSON data.
+ *
+ *  @param data  The JSON data. Must not be nil.
+ *  @param error The error, if any. Must not be nil.
+ *
+ *  @return The document; otherwise, nil if the data does not hold a single JSON value.
+ */
++ (http_request_json_document *)documentWithData:(NSData *)data error:(NSError *__autoreleasing *)error;
+
+/**
+ *  Retrieves the number of members of an object or elements of an array.
+ *
+ *  @return The count; otherwise, zero if the value is neither.
+ */
+- (NSUInteger)count;
+
+/**
+ *  Retrieves the keys of an object, in the order they appear.
+ *
+ *  @return The keys; otherwise, nil if the value is not an object.
+ */
+- (NSArray *)allKeys;
+
+/**
+ *  Retrieves the value of a member of an object; the last one wins if the key is repeated.
+ *
+ *  @param key The key. Must not be nil.
+ *
+ *  @return The value; otherwise, nil if the value is not an object or the key is missing.
+ */
+- (id)objectForKey:(NSString *)key;
+
+/**
+ *  Retrieves the value of an element of an array.
+ *
+ *  @param index The index.
+ *
+ *  @return The value; otherwise, nil if the value is not an array or the index is out of bounds.
+ */
+- (id)objectAtIndex:(NSUInteger)index;
+
+/**
+ *  Retrieves the value at a path of keys and array indexes separated by dots (e.g. @"items.0.name").
+ *
+ *  @param keyPath The path. Must not be nil.
+ *
+ *  @return The value; otherwise, nil if the path does not exist.
+ */
+- (id)objectForKeyPath:(NSString *)keyPath;
+
+/**
+ *  Subscripting support for objectForKey:.
+ */
+- (id)objectForKeyedSubscript:(NSString *)key;
+
+/**
+ *  Subscripting support for objectAtIndex:.
+ */
+- (id)objectAtIndexedSubscript:(NSUInteger)index;
+
+/**
+ *  Converts the whole value into its Foundation representation, as NSJSONSerialization would.
+ *
+ *  @param error The error, if any. Must not be nil.
+ *
+ *  @return The Foundation representation; otherwise, nil if the value is malformed.
+ */
+- (id)materialize:(NSError *__autoreleasing *)error;
+
+@end
@@ -0,0 +1,436 @@
+//
+//  http_request_json_document.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_json_document.h"
+
+#define kMaxInlineNumberLength          63
+
+static NSUInteger skip_whitespace(const uint8_t *bytes, NSUInteger length, NSUInteger offset)
+{
+    while (offset < length && (bytes[offset] == ' ' || bytes[offset] == '\n' || bytes[offset] == '\r' || bytes[offset] == '\t'))
+    {
+        offset++;
+    }
+
+    return offset;
+}
+
+static NSUInteger end_of_string(const uint8_t *bytes, NSUInteger length, NSUInteger offset, BOOL *escaped)
+{
+    for (NSUInteger index = offset + 1; index < length; index++)
+    {
+        if (bytes[index] == '\\')
+        {
+            *escaped = YES;
+            index++;
+        }
+        else if (bytes[index] == '"')
+        {
+            return index + 1;
+        }
+    }
+
+    return NSNotFound;
+}
+
+static NSUInteger end_of_value(const uint8_t *bytes, NSUInteger length, NSUInteger offset)
+{
+    if (offset >= length)
+    {
+        return NSNotFound;
+    }
+
+    BOOL escaped = NO;
+    uint8_t first = bytes[offset];
+    if (first == '"')
+    {
+        return end_of_string(bytes, length, offset, &escaped);
+    }
+
+    if (first == '{' || first == '[')
+    {
+        NSUInteger depth = 0;
+        for (NSUInteger index = offset; index < length; index++)
+        {
+            uint8_t byte = bytes[index];
+            if (byte == '"')
+            {
+                index = end_of_string(bytes, length, index, &escaped);
+                if (index == NSNotFound)
+                {
+                    return NSNotFound;
+                }
+
+                index--;
+            }
+            else if (byte == '{' || byte == '[')
+            {
+                depth++;
+            }
+            else if ((byte == '}' || byte == ']') && --depth == 0)
+            {
+                return index + 1;
+            }
+        }
+
+        return NSNotFound;
+    }
+
+    NSUInteger index = offset;
+    while (index < length
+           && bytes[index] != ','
+           && bytes[index] != '}'
+           && bytes[index] != ']'
+           && bytes[index] != ' '
+           && bytes[index] != '\n'
+           && bytes[index] != '\r'
+           && bytes[index] != '\t')
+    {
+        index++;
+    }
+
+    return index;
+}
+
+static http_request_json_type type_of_value(const uint8_t *bytes, NSUInteger length, NSUInteger offset)
+{
+    if (offset >= length)
+    {
+        return http_request_json_type_invalid;
+    }
+
+    switch (bytes[offset])
+    {
+        case '{':
+            return http_request_json_type_object;
+        case '[':
+            return http_request_json_type_array;
+        case '"':
+            return http_request_json_type_string;
+        case 't':
+        case 'f':
+            return http_request_json_type_boolean;
+        case 'n':
+            return http_request_json_type_null;
+        default:
+            return bytes[offset] == '-' || (bytes[offset] >= '0' && bytes[offset] <= '9')
+                   ? http_request_json_type_number
+                   : http_request_json_type_invalid;
+    }
+}
+
+@interface http_request_json_document()
+{
+    NSData *_source;
+    NSRange _range;
+    NSMutableArray *_keys;
+    NSMutableDictionary *_memberRanges;
+    NSMutableArray *_elementRanges;
+    BOOL _indexed;
+}
+
++ (NSString *)stringInData:(NSData *)source withRange:(NSRange)range;
++ (NSNumber *)numberInData:(NSData *)source withRange:(NSRange)range;
+
+- (id)initWithSource:(NSData *)source range:(NSRange)range;
+- (void)indexMembers;
+- (id)valueWithRange:(NSRange)range;
+
+@end
+
+@implementation http_request_json_document
+
+#pragma mark - Public API
+
++ (http_request_json_document *)documentWithData:(NSData *)data error:(NSError *__autoreleasing *)error
+{
+    [http_request throwIfNil:data withName:@"data"];
+
+    *error = nil;
+    const uint8_t *bytes = data.bytes;
+    NSUInteger start = skip_whitespace(bytes, data.length, 0);
+    NSUInteger end = end_of_value(bytes, data.length, start);
+    if (end == NSNotFound
+        || end == start
+        || skip_whitespace(bytes, data.length, end) != data.length
+        || type_of_value(bytes, data.length, start) == http_request_json_type_invalid)
+    {
+        *error = [[NSError alloc]
+                  initWithDomain:kHttpRequestDomain
+                  code:-3
+                  userInfo:@{NSLocalizedDescriptionKey:@"Malformed JSON document."}];
+        return nil;
+    }
+
+    return [[http_request_json_document alloc] initWithSource:data range:NSMakeRange(start, end - start)];
+}
+
+- (NSData *)data
+{
+    return _range.location == 0 && _range.length == _source.length ? _source : [_source subdataWithRange:_range];
+}
+
+- (NSUInteger)count
+{
+    [self indexMembers];
+    return _type == http_request_json_type_object ? _keys.count : _elementRanges.count;
+}
+
+- (NSArray *)allKeys
+{
+    [self indexMembers];
+    return _type == http_request_json_type_object ? [_keys copy] : nil;
+}
+
+- (id)objectForKey:(NSString *)key
+{
+    [http_request throwIfNil:key withName:@"key"];
+
+    [self indexMembers];
+    NSValue *range = [_memberRanges objectForKey:key];
+    return range ? [self valueWithRange:[range rangeValue]] : nil;
+}
+
+- (id)objectAtIndex:(NSUInteger)index
+{
+    [self indexMembers];
+    return index < _elementRanges.count ? [self valueWithRange:[_elementRanges[index] rangeValue]] : nil;
+}
+
+- (id)objectForKeyPath:(NSString *)keyPath
+{
+    [http_request throwIfNil:keyPath withName:@"keyPath"];
+
+    id value = self;
+    for (NSString *component in [keyPath componentsSeparatedByString:@"."])
+    {
+        if (![value isKindOfClass:[http_request_json_document class]])
+        {
+            return nil;
+        }
+
+        http_request_json_document *document = value;
+        if (document.type == http_request_json_type_array)
+        {
+            NSScanner *scanner = [NSScanner scannerWithString:component];
+            NSInteger index = 0;
+            if (![scanner scanInteger:&index] || ![scanner isAtEnd] || index < 0)
+            {
+                return nil;
+            }
+
+            value = [document objectAtIndex:(NSUInteger)index];
+        }
+        else
+        {
+            value = [document objectForKey:component];
+        }
+    }
+
+    return value;
+}
+
+- (id)objectForKeyedSubscript:(NSString *)key
+{
+    return [self objectForKey:key];
+}
+
+- (id)objectAtIndexedSubscript:(NSUInteger)index
+{
+    return [self objectAtIndex:index];
+}
+
+- (id)materialize:(NSError *__autoreleasing *)error
+{
+    return [NSJSONSerialization JSONObjectWithData:self.data options:NSJSONReadingAllowFragments error:error];
+}
+
+- (NSString *)description
+{
+    NSString *json = [[NSString alloc] initWithData:self.data encoding:NSUTF8StringEncoding];
+    return json ?: [super description];
+}
+
+#pragma mark - Internal API
+
++ (NSString *)stringInData:(NSData *)source withRange:(NSRange)range
+{
+    BOOL escaped = NO;
+    if (end_of_string(source.bytes, NSMaxRange(range), range.location, &escaped) != NSMaxRange(range))
+    {
+        return nil;
+    }
+
+    if (escaped)
+    {
+        id string = [NSJSONSerialization
+                     JSONObjectWithData:[source subdataWithRange:range]
+                     options:NSJSONReadingAllowFragments
+                     error:nil];
+        return [string isKindOfClass:[NSString class]] ? string : nil;
+    }
+
+    return [[NSString alloc]
+            initWithBytes:(const uint8_t *)source.bytes + range.location + 1
+            length:range.length - 2
+            encoding:NSUTF8StringEncoding];
+}
+
++ (NSNumber *)numberInData:(NSData *)source withRange:(NSRange)range
+{
+    if (range.length > kMaxInlineNumberLength)
+    {
+        id number = [NSJSONSerialization
+                     JSONObjectWithData:[source subdataWithRange:range]
+                     options:NSJSONReadingAllowFragments
+                     error:nil];
+        return [number isKindOfClass:[NSNumber class]] ? number : nil;
+    }
+
+    char buffer[kMaxInlineNumberLength + 1];
+    memcpy(buffer, (const uint8_t *)source.bytes + range.location, range.length);
+    buffer[range.length] = '\0';
+    char *end = NULL;
+    if (strpbrk(buffer, ".eE"))
+    {
+        double value = strtod(buffer, &end);
+        return end == buffer + range.length ? @(value) : nil;
+    }
+
+    long long value = strtoll(buffer, &end, 10);
+    return end == buffer + range.length ? @(value) : nil;
+}
+
+- (id)initWithSource:(NSData *)source range:(NSRange)range
+{
+    self = [super init];
+    if (self)
+    {
+        _source = source;
+        _range = range;
+        _type = type_of_value(source.bytes, NSMaxRange(range), range.location);
+    }
+
+    return self;
+}
+
+- (void)indexMembers
+{
+    if (_type != http_request_json_type_object && _type != http_request_json_type_array)
+    {
+        return;
+    }
+
+    @synchronized(self)
+    {
+        if (_indexed)
+        {
+            return;
+        }
+
+        _indexed = YES;
+        BOOL isObject = _type == http_request_json_type_object;
+        NSMutableArray *keys = isObject ? [NSMutableArray new] : nil;
+        NSMutableDictionary *memberRanges = isObject ? [NSMutableDictionary new] : nil;
+        NSMutableArray *elementRanges = isObject ? nil : [NSMutableArray new];
+        const uint8_t *bytes = _source.bytes;
+        NSUInteger length = NSMaxRange(_range) - 1;
+        uint8_t closing = isObject ? '}' : ']';
+        NSUInteger offset = skip_whitespace(bytes, length, _range.location + 1);
+        BOOL wellFormed = offset == length;
+        while (offset < length)
+        {
+            NSString *key = nil;
+            if (isObject)
+            {
+                BOOL escaped = NO;
+                NSUInteger keyEnd = bytes[offset] == '"' ? end_of_string(bytes, length, offset, &escaped) : NSNotFound;
+                key = keyEnd != NSNotFound
+                      ? [http_request_json_document stringInData:_source withRange:NSMakeRange(offset, keyEnd - offset)]
+                      : nil;
+                offset = key ? skip_whitespace(bytes, length, keyEnd) : length;
+                if (offset >= length || bytes[offset] != ':')
+                {
+                    break;
+                }
+
+                offset = skip_whitespace(bytes, length, offset + 1);
+            }
+
+            NSUInteger valueEnd = end_of_value(bytes, length, offset);
+            if (valueEnd == NSNotFound || valueEnd == offset)
+            {
+                break;
+            }
+
+            NSValue *valueRange = [NSValue valueWithRange:NSMakeRange(offset, valueEnd - offset)];
+            if (isObject)
+            {
+                if (![memberRanges objectForKey:key])
+                {
+                    [keys addObject:key];
+                }
+
+                [memberRanges setObject:valueRange forKey:key];
+            }
+            else
+            {
+                [elementRanges addObject:valueRange];
+            }
+
+            offset = skip_whitespace(bytes, length, valueEnd);
+            if (offset == length)
+            {
+                wellFormed = bytes[length] == closing;
+                break;
+            }
+
+            if (bytes[offset] != ',')
+            {
+                break;
+            }
+
+            offset = skip_whitespace(bytes, length, offset + 1);
+        }
+
+        // A malformed container is viewed as empty rather than partially.
+        _keys = wellFormed ? keys : (isObject ? [NSMutableArray new] : nil);
+        _memberRanges = wellFormed ? memberRanges : (isObject ? [NSMutableDictionary new] : nil);
+        _elementRanges = wellFormed ? elementRanges : (isObject ? nil : [NSMutableArray new]);
+    }
+}
+
+- (id)valueWithRange:(NSRange)range
+{
+    const uint8_t *bytes = _source.bytes;
+    switch (type_of_value(bytes, NSMaxRange(range), range.location))
+    {
+        case http_request_json_type_object:
+        case http_request_json_type_array:
+            return [[http_request_json_document alloc] initWithSource:_source range:range];
+        case http_request_json_type_string:
+            return [http_request_json_document stringInData:_source withRange:range];
+        case http_request_json_type_number:
+            return [http_request_json_document numberInData:_source withRange:range];
+        case http_request_json_type_boolean:
+            if (range.length == 4 && memcmp(bytes + range.location, "true", 4) == 0)
+            {
+                return @YES;
+            }
+
+            return range.length == 5 && memcmp(bytes + range.location, "false", 5) == 0 ? @NO : nil;
+        case http_request_json_type_null:
+            return range.length == 4 && memcmp(bytes + range.location, "null", 4) == 0 ? [NSNull null] : nil;
+        default:
+            return nil;
+    }
+}
+
+@end
@@ -0,0 +1,68 @@
+//
+//  http_request_json_stream_parser.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#define kApplicationNdjsonContentType   @"application/x-ndjson"
+
+/**
+ *  The layouts of a JSON body which can be parsed incrementally.
+ */
+typedef NS_ENUM(NSInteger, http_request_json_stream_format)
+{
+    /**
+     *  Newline delimited JSON: one record per line.
+     */
+    http_request_json_stream_format_ndjson,
+    /**
+     *  A JSON array: one record per element. Any other JSON document is emitted as a single record once complete.
+     */
+    http_request_json_stream_format_array
+};
+
+/**
+ *  http_request_json_stream_parser incrementally parses a JSON body, emitting each record as soon as its bytes arrived.
+ *  Only the bytes of the record being received are retained, so memory is proportional to a single record.
+ */
+@interface http_request_json_stream_parser : NSObject
+
+/**
+ *  The number of records emitted so far.
+ */
+@property (readonly) NSUInteger recordCount;
+
+/**
+ *  Initializes the parser.
+ *
+ *  @param format The layout of the body to parse.
+ *  @param record The callback called for each parsed record; passes the record. Must not be nil.
+ *
+ *  @return An instance of class.
+ */
+- (id)initWithFormat:(http_request_json_stream_format)format onRecord:(void(^)(id))record;
+
+/**
+ *  Parses the next chunk of the body, emitting every record completed by it.
+ *
+ *  @param data  The next chunk of the body. Optional, can be nil.
+ *  @param error The error, if any. Must not be nil.
+ *
+ *  @return YES if the chunk was parsed; otherwise, NO.
+ */
+- (BOOL)appendData:(NSData *)data error:(NSError *__autoreleasing *)error;
+
+/**
+ *  Signals the end of the body, emitting the last record if any.
+ *
+ *  @param error The error, if any. Must not be nil.
+ *
+ *  @return YES if the body was complete and well formed; otherwise, NO.
+ */
+- (BOOL)finish:(NSError *__autoreleasing *)error;
+
+@end
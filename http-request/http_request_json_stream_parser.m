@@ -0,0 +1,299 @@
+//
+//  http_request_json_stream_parser.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_json_stream_parser.h"
+
+typedef NS_ENUM(NSInteger, http_request_json_stream_state)
+{
+    http_request_json_stream_state_array_start,
+    http_request_json_stream_state_element_start,
+    http_request_json_stream_state_element,
+    http_request_json_stream_state_array_end,
+    http_request_json_stream_state_document
+};
+
+@interface http_request_json_stream_parser()
+{
+    http_request_json_stream_format _format;
+    http_request_json_stream_state _state;
+    void (^_recordCallback)(id);
+    NSMutableData *_pending;
+    NSUInteger _depth;
+    BOOL _inString;
+    BOOL _escaped;
+}
+
++ (BOOL)isWhitespace:(const char)character;
++ (BOOL)isBlank:(const char *)bytes length:(NSUInteger)length;
+
+- (BOOL)appendNdjsonBytes:(const char *)bytes length:(NSUInteger)length error:(NSError *__autoreleasing *)error;
+- (BOOL)appendArrayBytes:(const char *)bytes length:(NSUInteger)length error:(NSError *__autoreleasing *)error;
+- (BOOL)emitBytes:(const char *)bytes length:(NSUInteger)length error:(NSError *__autoreleasing *)error;
+
+@end
+
+@implementation http_request_json_stream_parser
+
+#pragma mark - Public API
+
+- (BOOL)appendData:(NSData *)data error:(NSError *__autoreleasing *)error
+{
+    __block BOOL parsed = YES;
+    __block NSError *parsingError = nil;
+    [data enumerateByteRangesUsingBlock:^(const void *bytes, NSRange byteRange, BOOL *stop)
+    {
+        NSError *rangeError = nil;
+        parsed = _format == http_request_json_stream_format_ndjson
+                 ? [self appendNdjsonBytes:bytes length:byteRange.length error:&rangeError]
+                 : [self appendArrayBytes:bytes length:byteRange.length error:&rangeError];
+        parsingError = rangeError;
+        *stop = !parsed;
+    }];
+
+    *error = parsingError;
+    return parsed;
+}
+
+- (BOOL)finish:(NSError *__autoreleasing *)error
+{
+    *error = nil;
+    BOOL finished = YES;
+    if (_format == http_request_json_stream_format_ndjson
+        || _state == http_request_json_stream_state_document)
+    {
+        finished = [self emitBytes:NULL length:0 error:error];
+    }
+    else if (_state != http_request_json_stream_state_array_end)
+    {
+        *error = [[NSError alloc]
+                  initWithDomain:kHttpRequestDomain
+                  code:-3
+                  userInfo:@{NSLocalizedDescriptionKey:@"Unsuccessful record parsing: truncated JSON array."}];
+        finished = NO;
+    }
+
+    return finished;
+}
+
+#pragma mark - Internal API
+
++ (BOOL)isWhitespace:(const char)character
+{
+    return character == ' ' || character == '\n' || character == '\r' || character == '\t';
+}
+
++ (BOOL)isBlank:(const char *)bytes length:(NSUInteger)length
+{
+    for (NSUInteger index = 0; index < length; index++)
+    {
+        if (![http_request_json_stream_parser isWhitespace:bytes[index]])
+        {
+            return NO;
+        }
+    }
+
+    return YES;
+}
+
+- (BOOL)appendNdjsonBytes:(const char *)bytes length:(NSUInteger)length error:(NSError *__autoreleasing *)error
+{
+    NSUInteger lineStart = 0;
+    const char *newline = NULL;
+    while (lineStart < length && (newline = memchr(bytes + lineStart, '\n', length - lineStart)))
+    {
+        NSUInteger lineEnd = newline - bytes;
+        if (![self emitBytes:bytes + lineStart length:lineEnd - lineStart error:error])
+        {
+            return NO;
+        }
+
+        lineStart = lineEnd + 1;
+    }
+
+    if (lineStart < length)
+    {
+        [_pending appendBytes:bytes + lineStart length:length - lineStart];
+    }
+
+    return YES;
+}
+
+- (BOOL)appendArrayBytes:(const char *)bytes length:(NSUInteger)length error:(NSError *__autoreleasing *)error
+{
+    NSUInteger elementStart = 0;
+    NSUInteger index = 0;
+    while (index < length)
+    {
+        const char character = bytes[index];
+        switch (_state)
+        {
+            case http_request_json_stream_state_array_start:
+                if (character == '[')
+                {
+                    _state = http_request_json_stream_state_element_start;
+                }
+                else if (![http_request_json_stream_parser isWhitespace:character])
+                {
+                    // Not an array: the whole document is a single record.
+                    _state = http_request_json_stream_state_document;
+                    [_pending appendBytes:bytes + index length:length - index];
+                    return YES;
+                }
+
+                index++;
+                break;
+            case http_request_json_stream_state_element_start:
+                if (character == ']')
+                {
+                    _state = http_request_json_stream_state_array_end;
+                    index++;
+                }
+                else if ([http_request_json_stream_parser isWhitespace:character])
+                {
+                    index++;
+                }
+                else
+                {
+                    _state = http_request_json_stream_state_element;
+                    elementStart = index;
+                }
+
+                break;
+            case http_request_json_stream_state_element:
+                if (_inString)
+                {
+                    if (_escaped)
+                    {
+                        _escaped = NO;
+                    }
+                    else if (character == '\\')
+                    {
+                        _escaped = YES;
+                    }
+                    else if (character == '"')
+                    {
+                        _inString = NO;
+                    }
+                }
+                else if (character == '"')
+                {
+                    _inString = YES;
+                }
+                else if (character == '{' || character == '[')
+                {
+                    _depth++;
+                }
+                else if (_depth > 0 && (character == '}' || character == ']'))
+                {
+                    _depth--;
+                }
+                else if (_depth == 0 && (character == ',' || character == ']'))
+                {
+                    if (![self emitBytes:bytes + elementStart length:index - elementStart error:error])
+                    {
+                        return NO;
+                    }
+
+                    _state = character == ','
+                             ? http_request_json_stream_state_element_start
+                             : http_request_json_stream_state_array_end;
+                }
+
+                index++;
+                break;
+            case http_request_json_stream_state_array_end:
+                if (![http_request_json_stream_parser isWhitespace:character])
+                {
+                    *error = [[NSError alloc]
+                              initWithDomain:kHttpRequestDomain
+                              code:-3
+                              userInfo:@{NSLocalizedDescriptionKey:@"Unsuccessful record parsing: trailing data after JSON array."}];
+                    return NO;
+                }
+
+                index++;
+                break;
+            case http_request_json_stream_state_document:
+                [_pending appendBytes:bytes + index length:length - index];
+                return YES;
+        }
+    }
+
+    if (_state == http_request_json_stream_state_element)
+    {
+        // The element continues in the next chunk; keep only its bytes.
+        [_pending appendBytes:bytes + elementStart length:length - elementStart];
+    }
+
+    return YES;
+}
+
+- (BOOL)emitBytes:(const char *)bytes length:(NSUInteger)length error:(NSError *__autoreleasing *)error
+{
+    NSData *recordData = nil;
+    if (_pending.length > 0)
+    {
+        if (length > 0)
+        {
+            [_pending appendBytes:bytes length:length];
+        }
+
+        recordData = _pending;
+    }
+    else
+    {
+        recordData = [NSData dataWithBytesNoCopy:(void *)bytes length:length freeWhenDone:NO];
+    }
+
+    BOOL emitted = YES;
+    if (![http_request_json_stream_parser isBlank:recordData.bytes length:recordData.length])
+    {
+        NSError *jsonError = nil;
+        id record = [NSJSONSerialization JSONObjectWithData:recordData options:NSJSONReadingAllowFragments error:&jsonError];
+        if (record)
+        {
+            _recordCount++;
+            _recordCallback(record);
+        }
+        else
+        {
+            *error = [[NSError alloc]
+                      initWithDomain:kHttpRequestDomain
+                      code:-3
+                      userInfo:@{NSLocalizedDescriptionKey:@"Unsuccessful record parsing.",
+                                 @"Error":jsonError,
+                                 @"Record":@(_recordCount)}];
+            emitted = NO;
+        }
+    }
+
+    [_pending setLength:0];
+    return emitted;
+}
+
+#pragma mark - Initialization
+
+- (id)initWithFormat:(http_request_json_stream_format)format onRecord:(void (^)(id))record
+{
+    [http_request throwIfNil:record withName:@"record"];
+
+    self = [super init];
+    if (self)
+    {
+        _format = format;
+        _state = http_request_json_stream_state_array_start;
+        _recordCallback = [record copy];
+        _pending = [NSMutableData new];
+    }
+
+    return self;
+}
+
+@end
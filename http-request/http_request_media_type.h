@@ -0,0 +1,74 @@
+//
+//  http_request_media_type.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  http_request_media_type is a parsed media type such as the value of a Content-Type header
+ *  (e.g. application/vnd.api+json; charset=utf-8).
+ */
+@interface http_request_media_type : NSObject
+
+/**
+ *  The lower case type (e.g. application).
+ */
+@property (readonly) NSString *type;
+
+/**
+ *  The lower case subtype (e.g. vnd.api+json).
+ */
+@property (readonly) NSString *subtype;
+
+/**
+ *  The lower case structured syntax suffix of the subtype, without the plus sign (e.g. json); otherwise, nil.
+ */
+@property (readonly) NSString *suffix;
+
+/**
+ *  The lower case type and subtype without parameters (e.g. application/vnd.api+json).
+ */
+@property (readonly) NSString *essence;
+
+/**
+ *  The parameters, keyed by lower case name and with quotes removed from the values.
+ */
+@property (readonly) NSDictionary *parameters;
+
+/**
+ *  The value of the charset parameter; otherwise, nil.
+ */
+@property (readonly) NSString *charset;
+
+/**
+ *  Parses a media type.
+ *
+ *  @param string The media type. Optional, can be nil.
+ *
+ *  @return The media type; otherwise, nil if the string is not a media type.
+ */
++ (http_request_media_type *)mediaTypeWithString:(NSString *)string;
+
+/**
+ *  Retrieves the media type of a response from its Content-Type header, or from its MIME type if it has none.
+ *
+ *  @param response The response. Optional, can be nil.
+ *
+ *  @return The media type; otherwise, nil if the response has none.
+ */
++ (http_request_media_type *)mediaTypeForResponse:(NSURLResponse *)response;
+
+/**
+ *  Retrieves the string encoding named by the charset.
+ *
+ *  @param defaultEncoding The encoding to use when there is no charset or it is unknown.
+ *
+ *  @return The string encoding.
+ */
+- (NSStringEncoding)stringEncodingWithDefault:(NSStringEncoding)defaultEncoding;
+
+@end
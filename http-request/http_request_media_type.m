@@ -0,0 +1,132 @@
+//
+//  http_request_media_type.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_media_type.h"
+
+@interface http_request_media_type()
+
+- (id)initWithType:(NSString *)type subtype:(NSString *)subtype parameters:(NSDictionary *)parameters;
+
+@end
+
+@implementation http_request_media_type
+
+#pragma mark - Public API
+
++ (http_request_media_type *)mediaTypeWithString:(NSString *)string
+{
+    if (![http_request isNotNil:string])
+    {
+        return nil;
+    }
+
+    NSCharacterSet *whitespace = [NSCharacterSet whitespaceCharacterSet];
+    NSArray *components = [string componentsSeparatedByString:@";"];
+    NSString *essence = [[components[0] stringByTrimmingCharactersInSet:whitespace] lowercaseString];
+    NSRange slash = [essence rangeOfString:@"/"];
+    if (slash.location == NSNotFound || slash.location == 0 || NSMaxRange(slash) == essence.length)
+    {
+        return nil;
+    }
+
+    NSMutableDictionary *parameters = [NSMutableDictionary new];
+    for (NSUInteger index = 1; index < components.count; index++)
+    {
+        NSString *parameter = components[index];
+        NSRange equals = [parameter rangeOfString:@"="];
+        if (equals.location == NSNotFound)
+        {
+            continue;
+        }
+
+        NSString *name = [[[parameter substringToIndex:equals.location] stringByTrimmingCharactersInSet:whitespace] lowercaseString];
+        NSString *value = [[parameter substringFromIndex:NSMaxRange(equals)] stringByTrimmingCharactersInSet:whitespace];
+        if (value.length >= 2 && [value hasPrefix:@"\""] && [value hasSuffix:@"\""])
+        {
+            value = [value substringWithRange:NSMakeRange(1, value.length - 2)];
+        }
+
+        if (name.length > 0)
+        {
+            [parameters setObject:value forKey:name];
+        }
+    }
+
+    return [[http_request_media_type alloc]
+            initWithType:[essence substringToIndex:slash.location]
+            subtype:[essence substringFromIndex:NSMaxRange(slash)]
+            parameters:parameters];
+}
+
++ (http_request_media_type *)mediaTypeForResponse:(NSURLResponse *)response
+{
+    NSString *contentType = nil;
+    if ([response isKindOfClass:[NSHTTPURLResponse class]])
+    {
+        contentType = [[(NSHTTPURLResponse *)response allHeaderFields] valueForKey:@"Content-Type"];
+    }
+
+    if (![http_request isNotNil:contentType] && [http_request isNotNil:response.MIMEType])
+    {
+        contentType = response.textEncodingName
+                      ? [NSString stringWithFormat:@"%@; charset=%@", response.MIMEType, response.textEncodingName]
+                      : response.MIMEType;
+    }
+
+    return [http_request_media_type mediaTypeWithString:contentType];
+}
+
+- (NSString *)charset
+{
+    return [self.parameters objectForKey:@"charset"];
+}
+
+- (NSStringEncoding)stringEncodingWithDefault:(NSStringEncoding)defaultEncoding
+{
+    NSString *charset = self.charset;
+    if (!charset)
+    {
+        return defaultEncoding;
+    }
+
+    CFStringEncoding encoding = CFStringConvertIANACharSetNameToEncoding((__bridge CFStringRef)charset);
+    return encoding != kCFStringEncodingInvalidId ? CFStringConvertEncodingToNSStringEncoding(encoding) : defaultEncoding;
+}
+
+- (NSString *)description
+{
+    NSMutableString *description = [NSMutableString stringWithString:self.essence];
+    for (NSString *name in self.parameters)
+    {
+        [description appendFormat:@"; %@=%@", name, self.parameters[name]];
+    }
+
+    return description;
+}
+
+#pragma mark - Initialization
+
+- (id)initWithType:(NSString *)type subtype:(NSString *)subtype parameters:(NSDictionary *)parameters
+{
+    self = [super init];
+    if (self)
+    {
+        _type = [type copy];
+        _subtype = [subtype copy];
+        _essence = [NSString stringWithFormat:@"%@/%@", type, subtype];
+        _parameters = [parameters copy];
+        NSRange plus = [subtype rangeOfString:@"+" options:NSBackwardsSearch];
+        _suffix = plus.location != NSNotFound && NSMaxRange(plus) < subtype.length ? [subtype substringFromIndex:NSMaxRange(plus)] : nil;
+    }
+
+    return self;
+}
+
+@end
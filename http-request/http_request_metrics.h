@@ -0,0 +1,218 @@
+//
+//  http_request_metrics.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  The phases a request is broken into.
+ */
+typedef NS_ENUM(NSInteger, http_request_metrics_phase)
+{
+    /**
+     *  From the request being issued until its task is resumed.
+     */
+    http_request_metrics_phase_queue_wait,
+    /**
+     *  From the task being resumed until the whole response was received.
+     */
+    http_request_metrics_phase_network,
+    /**
+     *  Time spent waiting on the parsing and callback queues.
+     */
+    http_request_metrics_phase_dispatch_wait,
+    /**
+     *  Time spent in the body parser.
+     */
+    http_request_metrics_phase_parse,
+    /**
+     *  Time spent in the response validator.
+     */
+    http_request_metrics_phase_validation,
+    /**
+     *  Time spent in the success or error callback.
+     */
+    http_request_metrics_phase_callback,
+    /**
+     *  From the request being issued until its callback returned.
+     */
+    http_request_metrics_phase_total
+};
+
+/**
+ *  The timings and sizes of a single request.
+ */
+@interface http_request_metrics : NSObject
+
+/**
+ *  The HTTP method of the request.
+ */
+@property (copy) NSString *method;
+
+/**
+ *  The host of the request.
+ */
+@property (copy) NSString *host;
+
+/**
+ *  The time at which the request was issued, in seconds since the reference date.
+ */
+@property (assign) NSTimeInterval issueTime;
+
+/**
+ *  The status code of the response; otherwise, zero if none was received.
+ */
+@property (assign) NSInteger statusCode;
+
+/**
+ *  Determines whether or not the response was served from the cache.
+ */
+@property (assign) BOOL cached;
+
+/**
+ *  Determines whether or not the error callback was called.
+ */
+@property (assign) BOOL failed;
+
+/**
+ *  The number of body bytes sent.
+ */
+@property (assign) unsigned long long bytesSent;
+
+/**
+ *  The number of body bytes before the request body was compressed; equals bytesSent when it was not.
+ */
+@property (assign) unsigned long long uncompressedBytesSent;
+
+/**
+ *  The number of body bytes received.
+ */
+@property (assign) unsigned long long bytesReceived;
+
+/**
+ *  The number of body bytes received before content decoding, as announced by the Content-Length of an encoded
+ *  response; equals bytesReceived when the response was not encoded or its encoded length is unknown.
+ */
+@property (assign) unsigned long long encodedBytesReceived;
+
+/**
+ *  Retrieves the compression ratio of the request body.
+ *
+ *  @return The uncompressed size divided by the size sent; 1 when it was not compressed.
+ */
+- (double)requestCompressionRatio;
+
+/**
+ *  Retrieves the compression ratio of the response body.
+ *
+ *  @return The decoded size divided by the encoded size; 1 when it was not encoded.
+ */
+- (double)responseCompressionRatio;
+
+/**
+ *  Retrieves the duration of the phase.
+ *
+ *  @param phase The phase.
+ *
+ *  @return The duration in seconds.
+ */
+- (NSTimeInterval)durationOfPhase:(http_request_metrics_phase)phase;
+
+/**
+ *  Adds to the duration of the phase.
+ *
+ *  @param duration The duration in seconds.
+ *  @param phase    The phase.
+ */
+- (void)addDuration:(NSTimeInterval)duration toPhase:(http_request_metrics_phase)phase;
+
+@end
+
+/**
+ *  A destination for the metrics of completed requests.
+ */
+@protocol http_request_metrics_sink <NSObject>
+
+/**
+ *  Records the metrics of a completed request. Called on the callback queue once the callback returned.
+ *
+ *  @param metrics The metrics of the request.
+ */
+- (void)recordMetrics:(http_request_metrics *)metrics;
+
+@end
+
+/**
+ *  http_request_metrics_collector aggregates the metrics of requests into histograms per method and host. Histograms
+ *  use logarithmic buckets, so memory does not grow with the number of requests and percentiles are accurate to
+ *  within 10%.
+ */
+@interface http_request_metrics_collector : NSObject <http_request_metrics_sink>
+
+/**
+ *  Another sink to which every recorded metrics is forwarded. Optional, can be nil.
+ */
+@property (strong) id<http_request_metrics_sink> forwardingSink;
+
+/**
+ *  Retrieves the "METHOD host" keys for which requests were recorded.
+ *
+ *  @return The keys.
+ */
+- (NSArray *)keys;
+
+/**
+ *  Retrieves the number of requests recorded for the method and host.
+ *
+ *  @param method The HTTP method. Must not be nil.
+ *  @param host   The host. Must not be nil.
+ *
+ *  @return The number of requests.
+ */
+- (NSUInteger)requestCountForMethod:(NSString *)method host:(NSString *)host;
+
+/**
+ *  Retrieves the number of body bytes received for the method and host.
+ *
+ *  @param method The HTTP method. Must not be nil.
+ *  @param host   The host. Must not be nil.
+ *
+ *  @return The number of bytes.
+ */
+- (unsigned long long)bytesReceivedForMethod:(NSString *)method host:(NSString *)host;
+
+/**
+ *  Retrieves the number of body bytes sent for the method and host.
+ *
+ *  @param method The HTTP method. Must not be nil.
+ *  @param host   The host. Must not be nil.
+ *
+ *  @return The number of bytes.
+ */
+- (unsigned long long)bytesSentForMethod:(NSString *)method host:(NSString *)host;
+
+/**
+ *  Retrieves the percentile of the duration of the phase for the method and host.
+ *
+ *  @param percentile The percentile, between 0 and 100 (e.g. 50 or 99).
+ *  @param phase      The phase.
+ *  @param method     The HTTP method. Must not be nil.
+ *  @param host       The host. Must not be nil.
+ *
+ *  @return The duration in seconds; otherwise, zero if no request was recorded.
+ */
+- (NSTimeInterval)percentile:(double)percentile
+                     ofPhase:(http_request_metrics_phase)phase
+                   forMethod:(NSString *)method
+                        host:(NSString *)host;
+
+/**
+ *  Discards everything recorded so far.
+ */
+- (void)reset;
+
+@end
@@ -0,0 +1,240 @@
+//
+//  http_request_metrics.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_metrics.h"
+
+#define kMetricsPhaseCount              (http_request_metrics_phase_total + 1)
+#define kHistogramBucketCount           128
+#define kHistogramBucketGrowth          1.2
+
+@interface http_request_metrics()
+{
+    NSTimeInterval _durations[kMetricsPhaseCount];
+}
+
+@end
+
+@implementation http_request_metrics
+
+#pragma mark - Public API
+
+- (NSTimeInterval)durationOfPhase:(http_request_metrics_phase)phase
+{
+    return _durations[phase];
+}
+
+- (void)addDuration:(NSTimeInterval)duration toPhase:(http_request_metrics_phase)phase
+{
+    _durations[phase] += MAX(duration, 0);
+}
+
+- (double)requestCompressionRatio
+{
+    return self.bytesSent > 0 && self.uncompressedBytesSent > 0 ? (double)self.uncompressedBytesSent / self.bytesSent : 1;
+}
+
+- (double)responseCompressionRatio
+{
+    return self.encodedBytesReceived > 0 && self.bytesReceived > 0 ? (double)self.bytesReceived / self.encodedBytesReceived : 1;
+}
+
+@end
+
+/**
+ *  The aggregated metrics of the requests sharing a method and host.
+ */
+@interface http_request_metrics_aggregate : NSObject
+{
+@public
+    NSUInteger _requestCount;
+    unsigned long long _bytesReceived;
+    unsigned long long _bytesSent;
+    uint32_t _buckets[kMetricsPhaseCount][kHistogramBucketCount];
+}
+
+@end
+
+@implementation http_request_metrics_aggregate
+@end
+
+@interface http_request_metrics_collector()
+{
+    NSMutableDictionary *_aggregates;
+}
+
++ (NSString *)keyForMethod:(NSString *)method host:(NSString *)host;
++ (NSUInteger)bucketForDuration:(NSTimeInterval)duration;
++ (NSTimeInterval)durationForBucket:(NSUInteger)bucket;
+
+@end
+
+@implementation http_request_metrics_collector
+
+#pragma mark - Public API
+
+- (void)recordMetrics:(http_request_metrics *)metrics
+{
+    [http_request throwIfNil:metrics withName:@"metrics"];
+
+    NSString *key = [http_request_metrics_collector keyForMethod:metrics.method host:metrics.host];
+    @synchronized(_aggregates)
+    {
+        http_request_metrics_aggregate *aggregate = [_aggregates objectForKey:key];
+        if (!aggregate)
+        {
+            aggregate = [http_request_metrics_aggregate new];
+            [_aggregates setObject:aggregate forKey:key];
+        }
+
+        aggregate->_requestCount++;
+        aggregate->_bytesReceived += metrics.bytesReceived;
+        aggregate->_bytesSent += metrics.bytesSent;
+        for (NSInteger phase = 0; phase < kMetricsPhaseCount; phase++)
+        {
+            NSUInteger bucket = [http_request_metrics_collector bucketForDuration:[metrics durationOfPhase:phase]];
+            aggregate->_buckets[phase][bucket]++;
+        }
+    }
+
+    [self.forwardingSink recordMetrics:metrics];
+}
+
+- (NSArray *)keys
+{
+    @synchronized(_aggregates)
+    {
+        return [_aggregates allKeys];
+    }
+}
+
+- (NSUInteger)requestCountForMethod:(NSString *)method host:(NSString *)host
+{
+    [http_request throwIfNil:method withName:@"method"];
+    [http_request throwIfNil:host withName:@"host"];
+
+    NSString *key = [http_request_metrics_collector keyForMethod:method host:host];
+    @synchronized(_aggregates)
+    {
+        http_request_metrics_aggregate *aggregate = [_aggregates objectForKey:key];
+        return aggregate ? aggregate->_requestCount : 0;
+    }
+}
+
+- (unsigned long long)bytesReceivedForMethod:(NSString *)method host:(NSString *)host
+{
+    [http_request throwIfNil:method withName:@"method"];
+    [http_request throwIfNil:host withName:@"host"];
+
+    NSString *key = [http_request_metrics_collector keyForMethod:method host:host];
+    @synchronized(_aggregates)
+    {
+        http_request_metrics_aggregate *aggregate = [_aggregates objectForKey:key];
+        return aggregate ? aggregate->_bytesReceived : 0;
+    }
+}
+
+- (unsigned long long)bytesSentForMethod:(NSString *)method host:(NSString *)host
+{
+    [http_request throwIfNil:method withName:@"method"];
+    [http_request throwIfNil:host withName:@"host"];
+
+    NSString *key = [http_request_metrics_collector keyForMethod:method host:host];
+    @synchronized(_aggregates)
+    {
+        http_request_metrics_aggregate *aggregate = [_aggregates objectForKey:key];
+        return aggregate ? aggregate->_bytesSent : 0;
+    }
+}
+
+- (NSTimeInterval)percentile:(double)percentile
+                     ofPhase:(http_request_metrics_phase)phase
+                   forMethod:(NSString *)method
+                        host:(NSString *)host
+{
+    [http_request throwIfNil:method withName:@"method"];
+    [http_request throwIfNil:host withName:@"host"];
+
+    NSString *key = [http_request_metrics_collector keyForMethod:method host:host];
+    @synchronized(_aggregates)
+    {
+        http_request_metrics_aggregate *aggregate = [_aggregates objectForKey:key];
+        if (!aggregate || aggregate->_requestCount == 0)
+        {
+            return 0;
+        }
+
+        double rank = MAX(1, ceil(MIN(MAX(percentile, 0), 100) / 100.0 * aggregate->_requestCount));
+        NSUInteger cumulativeCount = 0;
+        for (NSUInteger bucket = 0; bucket < kHistogramBucketCount; bucket++)
+        {
+            cumulativeCount += aggregate->_buckets[phase][bucket];
+            if (cumulativeCount >= rank)
+            {
+                return [http_request_metrics_collector durationForBucket:bucket];
+            }
+        }
+
+        return [http_request_metrics_collector durationForBucket:kHistogramBucketCount - 1];
+    }
+}
+
+- (void)reset
+{
+    @synchronized(_aggregates)
+    {
+        [_aggregates removeAllObjects];
+    }
+}
+
+#pragma mark - Internal API
+
++ (NSString *)keyForMethod:(NSString *)method host:(NSString *)host
+{
+    return [NSString stringWithFormat:@"%@ %@", [method uppercaseString] ?: @"", [host lowercaseString] ?: @""];
+}
+
++ (NSUInteger)bucketForDuration:(NSTimeInterval)duration
+{
+    // Bucket zero holds everything up to a microsecond; each following bucket is 20% wider than the previous one.
+    double microseconds = duration * 1000000.0;
+    if (microseconds <= 1.0)
+    {
+        return 0;
+    }
+
+    NSUInteger bucket = (NSUInteger)(log(microseconds) / log(kHistogramBucketGrowth)) + 1;
+    return MIN(bucket, kHistogramBucketCount - 1);
+}
+
++ (NSTimeInterval)durationForBucket:(NSUInteger)bucket
+{
+    if (bucket == 0)
+    {
+        return 0;
+    }
+
+    // The geometric middle of the bucket.
+    return pow(kHistogramBucketGrowth, bucket - 0.5) / 1000000.0;
+}
+
+#pragma mark - Initialization
+
+- (id)init
+{
+    self = [super init];
+    if (self)
+    {
+        _aggregates = [NSMutableDictionary new];
+    }
+
+    return self;
+}
+
+@end
@@ -0,0 +1,30 @@
+//
+//  http_request_msgpack.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#define kApplicationMsgpackContentType      @"application/msgpack"
+
+/**
+ *  http_request_msgpack_decoder decodes MessagePack into Foundation objects: maps into NSDictionary, arrays into
+ *  NSArray, strings into NSString, integers, floats and booleans into NSNumber, nil into NSNull, and binary and
+ *  extension values into NSData.
+ */
+@interface http_request_msgpack_decoder : NSObject
+
+/**
+ *  Decodes a single MessagePack value.
+ *
+ *  @param data  The data to decode. Must not be nil.
+ *  @param error The error, if any. Must not be nil.
+ *
+ *  @return The decoded value; otherwise, nil if the data is malformed or holds more than one value.
+ */
++ (id)decodeData:(NSData *)data error:(NSError *__autoreleasing *)error;
+
+@end
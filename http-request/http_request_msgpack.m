@@ -0,0 +1,227 @@
+//
+//  http_request_msgpack.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_msgpack.h"
+
+/**
+ *  The position of the decoder within the data.
+ */
+typedef struct
+{
+    const uint8_t *bytes;
+    NSUInteger length;
+    NSUInteger offset;
+} http_request_msgpack_cursor;
+
+static BOOL msgpack_read(http_request_msgpack_cursor *cursor, NSUInteger count, uint64_t *value)
+{
+    if (cursor->length - cursor->offset < count)
+    {
+        return NO;
+    }
+
+    // MessagePack is big endian.
+    *value = 0;
+    for (NSUInteger index = 0; index < count; index++)
+    {
+        *value = (*value << 8) | cursor->bytes[cursor->offset++];
+    }
+
+    return YES;
+}
+
+static id msgpack_bytes(http_request_msgpack_cursor *cursor, uint64_t count, BOOL string)
+{
+    if (cursor->length - cursor->offset < count)
+    {
+        return nil;
+    }
+
+    const uint8_t *start = cursor->bytes + cursor->offset;
+    cursor->offset += (NSUInteger)count;
+    return string
+           ? [[NSString alloc] initWithBytes:start length:(NSUInteger)count encoding:NSUTF8StringEncoding]
+           : [NSData dataWithBytes:start length:(NSUInteger)count];
+}
+
+static id msgpack_value(http_request_msgpack_cursor *cursor, NSUInteger depth);
+
+static id msgpack_array(http_request_msgpack_cursor *cursor, uint64_t count, NSUInteger depth)
+{
+    // Every element takes at least a byte, which bounds the capacity of a malicious count.
+    if (cursor->length - cursor->offset < count)
+    {
+        return nil;
+    }
+
+    NSMutableArray *array = [NSMutableArray arrayWithCapacity:(NSUInteger)count];
+    for (uint64_t index = 0; index < count; index++)
+    {
+        id element = msgpack_value(cursor, depth + 1);
+        if (!element)
+        {
+            return nil;
+        }
+
+        [array addObject:element];
+    }
+
+    return array;
+}
+
+static id msgpack_map(http_request_msgpack_cursor *cursor, uint64_t count, NSUInteger depth)
+{
+    if ((cursor->length - cursor->offset) / 2 < count)
+    {
+        return nil;
+    }
+
+    NSMutableDictionary *map = [NSMutableDictionary dictionaryWithCapacity:(NSUInteger)count];
+    for (uint64_t index = 0; index < count; index++)
+    {
+        id key = msgpack_value(cursor, depth + 1);
+        id value = key ? msgpack_value(cursor, depth + 1) : nil;
+        if (!value || ![key conformsToProtocol:@protocol(NSCopying)])
+        {
+            return nil;
+        }
+
+        [map setObject:value forKey:key];
+    }
+
+    return map;
+}
+
+static id msgpack_value(http_request_msgpack_cursor *cursor, NSUInteger depth)
+{
+    uint64_t type = 0;
+    if (depth > kMaxBinaryDecodingDepth || !msgpack_read(cursor, 1, &type))
+    {
+        return nil;
+    }
+
+    uint64_t value = 0;
+    if (type <= 0x7f)
+    {
+        return @(type);
+    }
+    else if (type >= 0xe0)
+    {
+        return @((int8_t)type);
+    }
+    else if (type >= 0x80 && type <= 0x8f)
+    {
+        return msgpack_map(cursor, type & 0x0f, depth);
+    }
+    else if (type >= 0x90 && type <= 0x9f)
+    {
+        return msgpack_array(cursor, type & 0x0f, depth);
+    }
+    else if (type >= 0xa0 && type <= 0xbf)
+    {
+        return msgpack_bytes(cursor, type & 0x1f, YES);
+    }
+
+    switch (type)
+    {
+        case 0xc0:
+            return [NSNull null];
+        case 0xc2:
+            return @NO;
+        case 0xc3:
+            return @YES;
+        case 0xc4:
+        case 0xc5:
+        case 0xc6:
+            return msgpack_read(cursor, 1 << (type - 0xc4), &value) ? msgpack_bytes(cursor, value, NO) : nil;
+        case 0xc7:
+        case 0xc8:
+        case 0xc9:
+            // Extension values are returned as their payload, without their type.
+            return msgpack_read(cursor, 1 << (type - 0xc7), &value) && msgpack_read(cursor, 1, &type)
+                   ? msgpack_bytes(cursor, value, NO)
+                   : nil;
+        case 0xca:
+            if (msgpack_read(cursor, 4, &value))
+            {
+                uint32_t bits = (uint32_t)value;
+                float number = 0;
+                memcpy(&number, &bits, sizeof(number));
+                return @(number);
+            }
+
+            return nil;
+        case 0xcb:
+            if (msgpack_read(cursor, 8, &value))
+            {
+                double number = 0;
+                memcpy(&number, &value, sizeof(number));
+                return @(number);
+            }
+
+            return nil;
+        case 0xcc:
+        case 0xcd:
+        case 0xce:
+        case 0xcf:
+            return msgpack_read(cursor, 1 << (type - 0xcc), &value) ? @(value) : nil;
+        case 0xd0:
+            return msgpack_read(cursor, 1, &value) ? @((int8_t)value) : nil;
+        case 0xd1:
+            return msgpack_read(cursor, 2, &value) ? @((int16_t)value) : nil;
+        case 0xd2:
+            return msgpack_read(cursor, 4, &value) ? @((int32_t)value) : nil;
+        case 0xd3:
+            return msgpack_read(cursor, 8, &value) ? @((int64_t)value) : nil;
+        case 0xd4:
+        case 0xd5:
+        case 0xd6:
+        case 0xd7:
+        case 0xd8:
+            return msgpack_read(cursor, 1, &value) ? msgpack_bytes(cursor, 1 << (type - 0xd4), NO) : nil;
+        case 0xd9:
+        case 0xda:
+        case 0xdb:
+            return msgpack_read(cursor, 1 << (type - 0xd9), &value) ? msgpack_bytes(cursor, value, YES) : nil;
+        case 0xdc:
+        case 0xdd:
+            return msgpack_read(cursor, 2 << (type - 0xdc), &value) ? msgpack_array(cursor, value, depth) : nil;
+        case 0xde:
+        case 0xdf:
+            return msgpack_read(cursor, 2 << (type - 0xde), &value) ? msgpack_map(cursor, value, depth) : nil;
+        default:
+            return nil;
+    }
+}
+
+@implementation http_request_msgpack_decoder
+
+#pragma mark - Public API
+
++ (id)decodeData:(NSData *)data error:(NSError *__autoreleasing *)error
+{
+    [http_request throwIfNil:data withName:@"data"];
+
+    *error = nil;
+    http_request_msgpack_cursor cursor = { data.bytes, data.length, 0 };
+    id value = msgpack_value(&cursor, 0);
+    if (!value || cursor.offset != cursor.length)
+    {
+        *error = [[NSError alloc]
+                  initWithDomain:kHttpRequestDomain
+                  code:-3
+                  userInfo:@{NSLocalizedDescriptionKey:@"Malformed MessagePack data."}];
+        return nil;
+    }
+
+    return value;
+}
+
+@end
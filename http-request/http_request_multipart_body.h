@@ -0,0 +1,133 @@
+//
+//  http_request_multipart_body.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#define kMultipartFormDataContentType   @"multipart/form-data"
+#define kOctetStreamContentType         @"application/octet-stream"
+#define kMultipartReadLength            (16 * 1024)
+
+/**
+ *  http_request_multipart_body builds a multipart/form-data body out of strings, data, files and streams, and streams
+ *  it part after part instead of concatenating it: data is referenced rather than copied, files are only opened once
+ *  their turn comes and read in chunks of kMultipartReadLength as the session consumes them, so memory use does not
+ *  depend on the size of the parts. The length of the body is known, and sent as Content-Length, unless a part is a stream of unknown length;
+ *  the body is then sent chunked.
+ *
+ *  Passed to uploadAsync:fromMultipartBody: or as the body of sendAsync:withBody: or sendFuture:withBody:, it is
+ *  streamed through an upload task; it is never read into a single buffer, so the bodySerializer does not accept it.
+ */
+@interface http_request_multipart_body : NSObject
+
+/**
+ *  The boundary delimiting the parts.
+ */
+@property (readonly) NSString *boundary;
+
+/**
+ *  The Content-Type of the body, including its boundary.
+ */
+@property (readonly) NSString *contentType;
+
+/**
+ *  The length of the body in bytes; otherwise, a negative value if a part is a stream of unknown length.
+ */
+@property (readonly) int64_t contentLength;
+
+/**
+ *  Determines whether or not inputStream can be called more than once, i.e. no part is a stream.
+ */
+@property (readonly) BOOL repeatable;
+
+/**
+ *  Initializes the body with a random boundary.
+ *
+ *  @return An instance of class.
+ */
+- (id)init;
+
+/**
+ *  Initializes the body with a boundary.
+ *
+ *  @param boundary The boundary, which must not occur in any part. Must not be nil.
+ *
+ *  @return An instance of class.
+ */
+- (id)initWithBoundary:(NSString *)boundary;
+
+/**
+ *  Appends a form field.
+ *
+ *  @param name   The name of the field. Must not be nil.
+ *  @param string The value of the field, sent as UTF-8. Must not be nil.
+ */
+- (void)appendPartWithName:(NSString *)name string:(NSString *)string;
+
+/**
+ *  Appends a part whose content is data. The data is referenced, not copied, and must not be mutated until the body
+ *  was sent.
+ *
+ *  @param name        The name of the part. Must not be nil.
+ *  @param data        The content of the part. Must not be nil.
+ *  @param fileName    The file name of the part. Optional, can be nil.
+ *  @param contentType The Content-Type of the part. Optional, can be nil for kOctetStreamContentType.
+ */
+- (void)appendPartWithName:(NSString *)name
+                      data:(NSData *)data
+                  fileName:(NSString *)fileName
+               contentType:(NSString *)contentType;
+
+/**
+ *  Appends a part whose content is a file, read when its turn comes.
+ *
+ *  @param name        The name of the part. Must not be nil.
+ *  @param fileUrl     The file URL of the content of the part. Must not be nil.
+ *  @param fileName    The file name of the part. Optional, can be nil for the last path component of fileUrl.
+ *  @param contentType The Content-Type of the part. Optional, can be nil for kOctetStreamContentType.
+ *  @param error       The error which occurred, if any. Must not be nil.
+ *
+ *  @return YES if the part was appended; otherwise, NO if the size of the file cannot be read.
+ */
+- (BOOL)appendPartWithName:(NSString *)name
+                   fileUrl:(NSURL *)fileUrl
+                  fileName:(NSString *)fileName
+               contentType:(NSString *)contentType
+                     error:(NSError *__autoreleasing *)error;
+
+/**
+ *  Appends a part whose content is read from a stream. The stream is read once, so the body is no longer repeatable.
+ *
+ *  @param name        The name of the part. Must not be nil.
+ *  @param stream      The unopened stream from which to read the content of the part. Must not be nil.
+ *  @param length      The length of the content in bytes; otherwise, a negative value if unknown.
+ *  @param fileName    The file name of the part. Optional, can be nil.
+ *  @param contentType The Content-Type of the part. Optional, can be nil for kOctetStreamContentType.
+ */
+- (void)appendPartWithName:(NSString *)name
+                    stream:(NSInputStream *)stream
+                    length:(int64_t)length
+                  fileName:(NSString *)fileName
+               contentType:(NSString *)contentType;
+
+/**
+ *  Creates a stream which reads the body, part after part. It is the read end of a bound stream pair whose write end is
+ *  filled from a background thread as the stream is read. A part which cannot be read ends the stream early, so prefer
+ *  uploadAsync:fromMultipartBody:, which fails the upload with the error of the part instead.
+ *
+ *  @return The unopened stream.
+ */
+- (NSInputStream *)inputStream;
+
+/**
+ *  Sets the Content-Type and, if known, the Content-Length headers of a request to those of the body.
+ *
+ *  @param request The request. Must not be nil.
+ */
+- (void)applyToRequest:(NSMutableURLRequest *)request;
+
+@end
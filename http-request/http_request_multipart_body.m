@@ -0,0 +1,476 @@
+//
+//  http_request_multipart_body.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_multipart_body.h"
+
+/**
+ *  The writer which fills the write end of a bound stream pair with the segments, one chunk at a time as the reader
+ *  frees up space: NSData is copied straight into the buffer, NSURL is opened as a file stream once reached and
+ *  NSInputStream is read as is. Writers run on a thread of their own, driven by its run loop, and keep themselves
+ *  alive until the body was written or the reader went away.
+ */
+@interface http_request_multipart_writer : NSObject <NSStreamDelegate>
+{
+    NSArray *_segments;
+    NSUInteger _segmentIndex;
+    NSUInteger _segmentOffset;
+    NSInputStream *_segmentStream;
+    NSOutputStream *_outputStream;
+    void (^_errorCallback)(NSError *);
+    uint8_t _buffer[kMultipartReadLength];
+    NSUInteger _bufferOffset;
+    NSUInteger _bufferLength;
+    BOOL _failed;
+}
+
++ (NSThread *)writerThread;
++ (void)runWriterThread;
++ (NSMutableSet *)activeWriters;
+- (id)initWithSegments:(NSArray *)segments outputStream:(NSOutputStream *)outputStream onError:(void(^)(NSError *))errorCallback;
+- (void)start;
+- (void)open;
+- (void)writeAvailable;
+- (NSInteger)readSegments:(uint8_t *)buffer maxLength:(NSUInteger)length error:(NSError *__autoreleasing *)error;
+- (void)advanceSegment;
+- (void)finish;
+
+@end
+
+@implementation http_request_multipart_writer
+
+#pragma mark - Public API
+
+- (void)start
+{
+    [self performSelector:@selector(open) onThread:[http_request_multipart_writer writerThread] withObject:nil waitUntilDone:NO];
+}
+
+- (void)stream:(NSStream *)stream handleEvent:(NSStreamEvent)event
+{
+    if (event & (NSStreamEventErrorOccurred | NSStreamEventEndEncountered))
+    {
+        // The reader closed its end, e.g. the task was cancelled.
+        [self finish];
+    }
+    else if (event & NSStreamEventHasSpaceAvailable)
+    {
+        [self writeAvailable];
+    }
+}
+
+#pragma mark - Internal API
+
++ (NSThread *)writerThread
+{
+    static NSThread *writerThread = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^
+    {
+        writerThread = [[NSThread alloc] initWithTarget:self selector:@selector(runWriterThread) object:nil];
+        writerThread.name = @"http-request.multipart";
+        [writerThread start];
+    });
+
+    return writerThread;
+}
+
++ (void)runWriterThread
+{
+    @autoreleasepool
+    {
+        // The port keeps the run loop running while no stream is scheduled.
+        NSRunLoop *runLoop = [NSRunLoop currentRunLoop];
+        [runLoop addPort:[NSMachPort port] forMode:NSDefaultRunLoopMode];
+        [runLoop run];
+    }
+}
+
++ (NSMutableSet *)activeWriters
+{
+    // Only accessed from the writer thread.
+    static NSMutableSet *activeWriters = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^
+    {
+        activeWriters = [NSMutableSet new];
+    });
+
+    return activeWriters;
+}
+
+- (void)open
+{
+    [[http_request_multipart_writer activeWriters] addObject:self];
+    _outputStream.delegate = self;
+    [_outputStream scheduleInRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
+    [_outputStream open];
+}
+
+- (void)writeAvailable
+{
+    while (!_failed && _outputStream && [_outputStream hasSpaceAvailable])
+    {
+        if (_bufferOffset == _bufferLength)
+        {
+            NSError *error = nil;
+            NSInteger readLength = [self readSegments:_buffer maxLength:sizeof(_buffer) error:&error];
+            if (readLength < 0)
+            {
+                // Ending the stream would pass a truncated body off as complete, so it is left to the error callback
+                // to abort the upload; without one, the reader is left with what was written so far.
+                _failed = YES;
+                if (_errorCallback)
+                {
+                    _errorCallback(error);
+                }
+                else
+                {
+                    [self finish];
+                }
+
+                return;
+            }
+
+            if (readLength == 0)
+            {
+                [self finish];
+                return;
+            }
+
+            _bufferOffset = 0;
+            _bufferLength = (NSUInteger)readLength;
+        }
+
+        NSInteger writtenLength = [_outputStream write:_buffer + _bufferOffset maxLength:_bufferLength - _bufferOffset];
+        if (writtenLength < 0)
+        {
+            [self finish];
+            return;
+        }
+
+        _bufferOffset += (NSUInteger)writtenLength;
+    }
+}
+
+- (NSInteger)readSegments:(uint8_t *)buffer maxLength:(NSUInteger)length error:(NSError *__autoreleasing *)error
+{
+    *error = nil;
+    NSUInteger readLength = 0;
+    while (readLength < length && _segmentIndex < _segments.count)
+    {
+        id segment = [_segments objectAtIndex:_segmentIndex];
+        if ([segment isKindOfClass:[NSData class]])
+        {
+            NSData *data = segment;
+            NSUInteger copyLength = MIN(data.length - _segmentOffset, length - readLength);
+            [data getBytes:buffer + readLength range:NSMakeRange(_segmentOffset, copyLength)];
+            _segmentOffset += copyLength;
+            readLength += copyLength;
+            if (_segmentOffset == data.length)
+            {
+                [self advanceSegment];
+            }
+
+            continue;
+        }
+
+        if (!_segmentStream)
+        {
+            _segmentStream = [segment isKindOfClass:[NSURL class]] ? [NSInputStream inputStreamWithURL:segment] : segment;
+            [_segmentStream open];
+        }
+
+        NSInteger streamReadLength = [_segmentStream read:buffer + readLength maxLength:length - readLength];
+        if (streamReadLength < 0)
+        {
+            *error = _segmentStream.streamError ?: [[NSError alloc]
+                                                    initWithDomain:NSURLErrorDomain
+                                                    code:NSURLErrorCannotOpenFile
+                                                    userInfo:@{NSLocalizedDescriptionKey:@"Unreadable part."}];
+            [_segmentStream close];
+            _segmentStream = nil;
+            return -1;
+        }
+
+        if (streamReadLength == 0)
+        {
+            [_segmentStream close];
+            _segmentStream = nil;
+            [self advanceSegment];
+            continue;
+        }
+
+        // Hand over what the part stream had rather than block on it again.
+        readLength += streamReadLength;
+        break;
+    }
+
+    return readLength;
+}
+
+- (void)advanceSegment
+{
+    _segmentIndex++;
+    _segmentOffset = 0;
+}
+
+- (void)finish
+{
+    [_segmentStream close];
+    _segmentStream = nil;
+    _outputStream.delegate = nil;
+    [_outputStream removeFromRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
+    [_outputStream close];
+    _outputStream = nil;
+    [[http_request_multipart_writer activeWriters] removeObject:self];
+}
+
+#pragma mark - Initialization
+
+- (id)initWithSegments:(NSArray *)segments outputStream:(NSOutputStream *)outputStream onError:(void (^)(NSError *))errorCallback
+{
+    self = [super init];
+    if (self)
+    {
+        _segments = segments;
+        _outputStream = outputStream;
+        _errorCallback = [errorCallback copy];
+    }
+
+    return self;
+}
+
+@end
+
+@interface http_request_multipart_body()
+{
+    NSMutableArray *_segments;
+    int64_t _partsLength;
+    BOOL _streamCreated;
+}
+
++ (NSString *)quotedParameter:(NSString *)parameter;
+- (void)appendPartWithName:(NSString *)name
+                   payload:(id)payload
+                    length:(int64_t)length
+                  fileName:(NSString *)fileName
+               contentType:(NSString *)contentType;
+
+@end
+
+@implementation http_request_multipart_body
+
+#pragma mark - Public API
+
+- (NSString *)contentType
+{
+    return [NSString stringWithFormat:@"%@; boundary=%@", kMultipartFormDataContentType, self.boundary];
+}
+
+- (int64_t)contentLength
+{
+    @synchronized(self)
+    {
+        return _partsLength >= 0 ? _partsLength + self.boundary.length + 6 : -1;
+    }
+}
+
+- (void)appendPartWithName:(NSString *)name string:(NSString *)string
+{
+    [http_request throwIfNil:string withName:@"string"];
+
+    NSData *data = [string dataUsingEncoding:NSUTF8StringEncoding];
+    [self appendPartWithName:name payload:data length:data.length fileName:nil contentType:nil];
+}
+
+- (void)appendPartWithName:(NSString *)name
+                      data:(NSData *)data
+                  fileName:(NSString *)fileName
+               contentType:(NSString *)contentType
+{
+    [http_request throwIfNil:data withName:@"data"];
+
+    [self
+     appendPartWithName:name
+     payload:data
+     length:data.length
+     fileName:fileName
+     contentType:contentType ?: kOctetStreamContentType];
+}
+
+- (BOOL)appendPartWithName:(NSString *)name
+                   fileUrl:(NSURL *)fileUrl
+                  fileName:(NSString *)fileName
+               contentType:(NSString *)contentType
+                     error:(NSError *__autoreleasing *)error
+{
+    [http_request throwIfNil:fileUrl withName:@"fileUrl"];
+
+    *error = nil;
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:[fileUrl path] error:error];
+    if (!attributes)
+    {
+        return NO;
+    }
+
+    [self
+     appendPartWithName:name
+     payload:fileUrl
+     length:(int64_t)[attributes fileSize]
+     fileName:fileName ?: [fileUrl lastPathComponent]
+     contentType:contentType ?: kOctetStreamContentType];
+    return YES;
+}
+
+- (void)appendPartWithName:(NSString *)name
+                    stream:(NSInputStream *)stream
+                    length:(int64_t)length
+                  fileName:(NSString *)fileName
+               contentType:(NSString *)contentType
+{
+    [http_request throwIfNil:stream withName:@"stream"];
+
+    @synchronized(self)
+    {
+        _repeatable = NO;
+    }
+
+    [self
+     appendPartWithName:name
+     payload:stream
+     length:length
+     fileName:fileName
+     contentType:contentType ?: kOctetStreamContentType];
+}
+
+- (NSInputStream *)inputStream
+{
+    return [self inputStreamOnError:nil];
+}
+
+- (NSInputStream *)inputStreamOnError:(void (^)(NSError *))errorCallback
+{
+    NSArray *segments = nil;
+    @synchronized(self)
+    {
+        if (_streamCreated && !self.repeatable)
+        {
+            @throw [NSException exceptionWithName:NSInternalInconsistencyException
+                                           reason:@"The body has a stream part and can only be read once"
+                                         userInfo:nil];
+        }
+
+        _streamCreated = YES;
+        segments = [_segments arrayByAddingObject:[[NSString stringWithFormat:@"--%@--\r\n", self.boundary]
+                                                   dataUsingEncoding:NSUTF8StringEncoding]];
+    }
+
+    // The session reads the body from one end of a bound pair while the writer fills the other, a chunk at a time.
+    CFReadStreamRef readStream = NULL;
+    CFWriteStreamRef writeStream = NULL;
+    CFStreamCreateBoundPair(kCFAllocatorDefault, &readStream, &writeStream, kMultipartReadLength);
+    NSInputStream *inputStream = CFBridgingRelease(readStream);
+    NSOutputStream *outputStream = CFBridgingRelease(writeStream);
+    http_request_multipart_writer *writer = [[http_request_multipart_writer alloc]
+                                             initWithSegments:segments
+                                             outputStream:outputStream
+                                             onError:errorCallback];
+    [writer start];
+    return inputStream;
+}
+
+- (void)applyToRequest:(NSMutableURLRequest *)request
+{
+    [http_request throwIfNil:request withName:@"request"];
+
+    [request setValue:self.contentType forHTTPHeaderField:@"Content-Type"];
+    int64_t contentLength = self.contentLength;
+    if (contentLength >= 0)
+    {
+        [request setValue:[NSString stringWithFormat:@"%lld", contentLength] forHTTPHeaderField:@"Content-Length"];
+    }
+    else
+    {
+        [request setValue:nil forHTTPHeaderField:@"Content-Length"];
+    }
+}
+
+#pragma mark - Internal API
+
++ (NSString *)quotedParameter:(NSString *)parameter
+{
+    // As browsers do, quotes and line breaks are percent-encoded rather than escaped.
+    NSString *quotedParameter = [parameter stringByReplacingOccurrencesOfString:@"\"" withString:@"%22"];
+    quotedParameter = [quotedParameter stringByReplacingOccurrencesOfString:@"\r" withString:@"%0D"];
+    quotedParameter = [quotedParameter stringByReplacingOccurrencesOfString:@"\n" withString:@"%0A"];
+    return [NSString stringWithFormat:@"\"%@\"", quotedParameter];
+}
+
+- (void)appendPartWithName:(NSString *)name
+                   payload:(id)payload
+                    length:(int64_t)length
+                  fileName:(NSString *)fileName
+               contentType:(NSString *)contentType
+{
+    [http_request throwIfNil:name withName:@"name"];
+
+    NSMutableString *header = [NSMutableString new];
+    [header appendFormat:@"--%@\r\n", self.boundary];
+    [header appendFormat:@"Content-Disposition: form-data; name=%@", [http_request_multipart_body quotedParameter:name]];
+    if (fileName)
+    {
+        [header appendFormat:@"; filename=%@", [http_request_multipart_body quotedParameter:fileName]];
+    }
+
+    [header appendString:@"\r\n"];
+    if (contentType)
+    {
+        [header appendFormat:@"Content-Type: %@\r\n", contentType];
+    }
+
+    [header appendString:@"\r\n"];
+    NSData *headerData = [header dataUsingEncoding:NSUTF8StringEncoding];
+    NSData *lineBreakData = [@"\r\n" dataUsingEncoding:NSUTF8StringEncoding];
+    @synchronized(self)
+    {
+        [_segments addObject:headerData];
+        [_segments addObject:payload];
+        [_segments addObject:lineBreakData];
+        if (_partsLength >= 0)
+        {
+            _partsLength = length >= 0 ? _partsLength + headerData.length + length + lineBreakData.length : -1;
+        }
+    }
+}
+
+#pragma mark - Initialization
+
+- (id)init
+{
+    NSString *boundary = [NSString stringWithFormat:@"http-request-boundary-%08x%08x", arc4random(), arc4random()];
+    return [self initWithBoundary:boundary];
+}
+
+- (id)initWithBoundary:(NSString *)boundary
+{
+    [http_request throwIfNil:boundary withName:@"boundary"];
+
+    self = [super init];
+    if (self)
+    {
+        _boundary = [boundary copy];
+        _segments = [NSMutableArray new];
+        _repeatable = YES;
+    }
+
+    return self;
+}
+
+@end
@@ -0,0 +1,77 @@
+//
+//  http_request_parser_registry.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "http_request_media_type.h"
+
+#define kApplicationProtobufContentType     @"application/x-protobuf"
+#define kMaxBinaryDecodingDepth             512
+
+/**
+ *  http_request_parser_registry dispatches response bodies to the parser registered for their media type. A media
+ *  type is looked up by its essence (e.g. application/vnd.api+json), then by its structured syntax suffix (+json) and
+ *  last by its type (application/\*), each lookup being a single dictionary access; bodies without a parser are returned
+ *  as NSData.
+ *
+ *  By default JSON (application/json and +json) is parsed through the JSON codec, text/html into an NSString of the
+ *  charset of the response, MessagePack (application/msgpack and application/x-msgpack) and CBOR (application/cbor and
+ *  +cbor) into Foundation objects. Other formats such as protobuf are registered with a parser wrapping their decoder.
+ */
+@interface http_request_parser_registry : NSObject
+
+/**
+ *  Retrieves the registry used by http_request parseBody:withBody:error:.
+ *
+ *  @return The shared registry.
+ */
++ (http_request_parser_registry *)defaultRegistry;
+
+/**
+ *  The default instance initializer; registers the default parsers.
+ *
+ *  @return An instance of class.
+ */
+- (id)init;
+
+/**
+ *  Registers the parser of a media type, replacing the current one if any.
+ *
+ *  @param parser    The parser; it is passed the response and its body. Must not be nil.
+ *  @param mediaType The media type essence (e.g. application/json), a structured syntax suffix (e.g. +json) or a type
+ *                   wildcard (e.g. text/\*). Must not be nil.
+ */
+- (void)registerParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))parser forMediaType:(NSString *)mediaType;
+
+/**
+ *  Removes the parser of a media type.
+ *
+ *  @param mediaType The media type essence, structured syntax suffix or type wildcard. Must not be nil.
+ */
+- (void)removeParserForMediaType:(NSString *)mediaType;
+
+/**
+ *  Retrieves the parser which handles a media type.
+ *
+ *  @param mediaType The media type. Optional, can be nil.
+ *
+ *  @return The parser; otherwise, nil if there is none.
+ */
+- (id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))parserForMediaType:(http_request_media_type *)mediaType;
+
+/**
+ *  Parses the body of a response with the parser of its media type.
+ *
+ *  @param response The response. Must not be nil.
+ *  @param data     The body. Optional, can be nil.
+ *  @param error    The error, if any. Must not be nil.
+ *
+ *  @return The parsed body; otherwise, the data itself if there is no parser for its media type.
+ */
+- (id)parseResponse:(NSURLResponse *)response withBody:(NSData *)data error:(NSError *__autoreleasing *)error;
+
+@end
@@ -0,0 +1,153 @@
+//
+//  http_request_parser_registry.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_parser_registry.h"
+
+@interface http_request_parser_registry()
+
+// Replaced as a whole on registration so that lookups, which vastly outnumber registrations, take no lock.
+@property (atomic, copy) NSDictionary *parsers;
+
++ (NSString *)keyForMediaType:(NSString *)mediaType;
+
+- (void)registerDefaultParsers;
+
+@end
+
+@implementation http_request_parser_registry
+
+#pragma mark - Public API
+
++ (http_request_parser_registry *)defaultRegistry
+{
+    static http_request_parser_registry *defaultRegistry = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^
+    {
+        defaultRegistry = [http_request_parser_registry new];
+    });
+
+    return defaultRegistry;
+}
+
+- (void)registerParser:(id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))parser forMediaType:(NSString *)mediaType
+{
+    [http_request throwIfNil:parser withName:@"parser"];
+    [http_request throwIfNil:mediaType withName:@"mediaType"];
+
+    @synchronized(self)
+    {
+        NSMutableDictionary *parsers = [self.parsers mutableCopy];
+        [parsers setObject:[parser copy] forKey:[http_request_parser_registry keyForMediaType:mediaType]];
+        self.parsers = parsers;
+    }
+}
+
+- (void)removeParserForMediaType:(NSString *)mediaType
+{
+    [http_request throwIfNil:mediaType withName:@"mediaType"];
+
+    @synchronized(self)
+    {
+        NSMutableDictionary *parsers = [self.parsers mutableCopy];
+        [parsers removeObjectForKey:[http_request_parser_registry keyForMediaType:mediaType]];
+        self.parsers = parsers;
+    }
+}
+
+- (id (^)(NSURLResponse *, NSData *, NSError *__autoreleasing *))parserForMediaType:(http_request_media_type *)mediaType
+{
+    if (!mediaType)
+    {
+        return nil;
+    }
+
+    NSDictionary *parsers = self.parsers;
+    id (^parser)(NSURLResponse *, NSData *, NSError *__autoreleasing *) = [parsers objectForKey:mediaType.essence];
+    if (!parser && mediaType.suffix)
+    {
+        parser = [parsers objectForKey:[@"+" stringByAppendingString:mediaType.suffix]];
+    }
+
+    if (!parser)
+    {
+        parser = [parsers objectForKey:[mediaType.type stringByAppendingString:@"/*"]];
+    }
+
+    return parser;
+}
+
+- (id)parseResponse:(NSURLResponse *)response withBody:(NSData *)data error:(NSError *__autoreleasing *)error
+{
+    [http_request throwIfNil:response withName:@"response"];
+
+    *error = nil;
+    if (![http_request isNotNil:data])
+    {
+        return data;
+    }
+
+    id (^parser)(NSURLResponse *, NSData *, NSError *__autoreleasing *) = [self
+                                                                         parserForMediaType:[http_request_media_type
+                                                                                             mediaTypeForResponse:response]];
+    return parser ? parser(response, data, error) : data;
+}
+
+#pragma mark - Internal API
+
++ (NSString *)keyForMediaType:(NSString *)mediaType
+{
+    return [[mediaType stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] lowercaseString];
+}
+
+- (void)registerDefaultParsers
+{
+    id (^jsonParser)(NSURLResponse *, NSData *, NSError *__autoreleasing *) = ^id (NSURLResponse *response, NSData *data, NSError *__autoreleasing *error)
+    {
+        return [http_request jsonDataParser:data error:error];
+    };
+    id (^textParser)(NSURLResponse *, NSData *, NSError *__autoreleasing *) = ^id (NSURLResponse *response, NSData *data, NSError *__autoreleasing *error)
+    {
+        *error = nil;
+        http_request_media_type *mediaType = [http_request_media_type mediaTypeForResponse:response];
+        return [[NSString alloc] initWithData:data encoding:[mediaType stringEncodingWithDefault:NSUTF8StringEncoding]];
+    };
+    id (^msgpackParser)(NSURLResponse *, NSData *, NSError *__autoreleasing *) = ^id (NSURLResponse *response, NSData *data, NSError *__autoreleasing *error)
+    {
+        return [http_request_msgpack_decoder decodeData:data error:error];
+    };
+    id (^cborParser)(NSURLResponse *, NSData *, NSError *__autoreleasing *) = ^id (NSURLResponse *response, NSData *data, NSError *__autoreleasing *error)
+    {
+        return [http_request_cbor_decoder decodeData:data error:error];
+    };
+
+    self.parsers = @{kApplicationJsonContentType:jsonParser,
+                     @"+json":jsonParser,
+                     kTextHtmlContentType:textParser,
+                     kApplicationMsgpackContentType:msgpackParser,
+                     @"application/x-msgpack":msgpackParser,
+                     kApplicationCborContentType:cborParser,
+                     @"+cbor":cborParser};
+}
+
+#pragma mark - Initialization
+
+- (id)init
+{
+    self = [super init];
+    if (self)
+    {
+        [self registerDefaultParsers];
+    }
+
+    return self;
+}
+
+@end
@@ -0,0 +1,123 @@
+//
+//  http_request_private.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+
+/**
+ *  The internal helpers shared by the http_request classes.
+ */
+@interface http_request()
+
++ (void)throwIfNil:(id)parameter withName:(NSString *)parameterName;
++ (BOOL)isNotNil:(id)value;
+
+@end
+
+/**
+ *  The internal construction of batch results.
+ */
+@interface http_request_batch_result()
+
+- (id)initWithIndex:(NSUInteger)index
+            request:(NSURLRequest *)request
+           response:(NSURLResponse *)response
+               body:(id)body
+              error:(NSError *)error;
+
+@end
+
+/**
+ *  The internal construction and start of batches.
+ */
+@interface http_request_batch()
+
+- (id)initWithRequests:(NSArray *)requests
+        maxConcurrency:(NSUInteger)maxConcurrency
+              delivery:(http_request_batch_delivery)delivery
+              onResult:(void (^)(http_request_batch_result *))resultCallback
+            onComplete:(void (^)(NSArray *))completeCallback;
+- (void)startWithHttpRequest:(http_request *)httpRequest;
+
+@end
+
+/**
+ *  The internal bookkeeping of downloads.
+ */
+@interface http_request_download()
+
+- (BOOL)addTask:(NSURLSessionTask *)task;
+- (BOOL)isCancelled;
+- (BOOL)reset;
+- (int64_t)setBytesWritten:(int64_t)bytesWritten forTask:(NSURLSessionTask *)task;
+- (void)setTotalBytesExpected:(int64_t)totalBytesExpected;
+
+@end
+
+/**
+ *  The internal scheduling of the tasks of http_request.
+ */
+@interface http_request_scheduler()
+
+- (void)scheduleTask:(NSURLSessionTask *)task
+        withPriority:(http_request_priority)priority
+            onResume:(void (^)(void))resumeCallback;
+- (void)taskDidComplete:(NSURLSessionTask *)task;
+
+@end
+
+/**
+ *  The internal completion and cancellation of futures.
+ */
+@interface http_request_future()
+
+- (BOOL)completeWithValue:(id)value error:(NSError *)error response:(NSURLResponse *)response;
+- (void)setCancellation:(void (^)(void))cancellation;
+
+@end
+
+/**
+ *  The internal validation of recordings, shared with the recorder which appends to them.
+ */
+@interface http_request_recording()
+
++ (NSUInteger)lengthOfCompleteRecordsInData:(NSData *)data;
+
+@end
+
+/**
+ *  The internal admission and outcome reporting of the requests guarded by a circuit breaker.
+ */
+@interface http_request_circuit_breaker()
+
+- (BOOL)acquireRoute:(NSString *)route probeToken:(NSUInteger *)probeToken error:(NSError *__autoreleasing *)error;
+- (void)releaseRoute:(NSString *)route
+          probeToken:(NSUInteger)probeToken
+        withResponse:(NSURLResponse *)response
+               error:(NSError *)error
+             latency:(NSTimeInterval)latency;
+
+@end
+
+/**
+ *  The internal accounting of hedges.
+ */
+@interface http_request_hedging_policy()
+
+- (void)recordHedge;
+- (void)recordHedgeWin;
+
+@end
+
+/**
+ *  The internal streaming of multipart bodies, reporting a part which cannot be read.
+ */
+@interface http_request_multipart_body()
+
+- (NSInputStream *)inputStreamOnError:(void (^)(NSError *))errorCallback;
+
+@end
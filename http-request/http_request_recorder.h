@@ -0,0 +1,58 @@
+//
+//  http_request_recorder.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  http_request_recorder captures requests, their responses and their timings into a compact, append-only file which
+ *  http_request_recording reads back and http_request_replay_protocol serves. Records are written serially on a
+ *  background queue, each with a single write; reopening a file appends to it after dropping a truncated last record.
+ */
+@interface http_request_recorder : NSObject
+
+/**
+ *  The file being written.
+ */
+@property (readonly) NSURL *fileUrl;
+
+/**
+ *  The number of records written so far.
+ */
+@property (readonly) NSUInteger recordCount;
+
+/**
+ *  Opens a file to record into, creating it if needed.
+ *
+ *  @param fileUrl The file to record into. Must not be nil.
+ *  @param error   The error which occurred, if any. Must not be nil.
+ *
+ *  @return An instance of class; otherwise, nil if the file cannot be written or is not a recording.
+ */
+- (id)initWithFileUrl:(NSURL *)fileUrl error:(NSError *__autoreleasing *)error;
+
+/**
+ *  Records a request and its response; does nothing once closed.
+ *
+ *  @param request   The request. Must not be nil.
+ *  @param response  The response. Must not be nil.
+ *  @param body      The body of the response. Optional, can be nil.
+ *  @param startTime The absolute time at which the request started on the network.
+ *  @param duration  The time the request took on the network, in seconds.
+ */
+- (void)recordRequest:(NSURLRequest *)request
+             response:(NSURLResponse *)response
+                 body:(NSData *)body
+            startTime:(CFAbsoluteTime)startTime
+             duration:(NSTimeInterval)duration;
+
+/**
+ *  Waits for the pending records to be written and closes the file.
+ */
+- (void)close;
+
+@end
@@ -0,0 +1,184 @@
+//
+//  http_request_recorder.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <libkern/OSByteOrder.h>
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_recorder.h"
+
+static void append_uint32(NSMutableData *data, uint32_t value)
+{
+    uint32_t raw = OSSwapHostToLittleInt32(value);
+    [data appendBytes:&raw length:sizeof(raw)];
+}
+
+static void append_double(NSMutableData *data, double value)
+{
+    uint64_t raw = 0;
+    memcpy(&raw, &value, sizeof(raw));
+    raw = OSSwapHostToLittleInt64(raw);
+    [data appendBytes:&raw length:sizeof(raw)];
+}
+
+static void append_blob(NSMutableData *data, NSData *blob)
+{
+    append_uint32(data, (uint32_t)blob.length);
+    if (blob.length > 0)
+    {
+        [data appendData:blob];
+    }
+}
+
+@interface http_request_recorder()
+{
+    NSFileHandle *_fileHandle;
+    dispatch_queue_t _writeQueue;
+    CFAbsoluteTime _recordingStartTime;
+}
+
++ (NSData *)dataWithHeaders:(NSDictionary *)headers;
+
+@end
+
+@implementation http_request_recorder
+
+#pragma mark - Public API
+
+- (void)recordRequest:(NSURLRequest *)request
+             response:(NSURLResponse *)response
+                 body:(NSData *)body
+            startTime:(CFAbsoluteTime)startTime
+             duration:(NSTimeInterval)duration
+{
+    [http_request throwIfNil:request withName:@"request"];
+    [http_request throwIfNil:response withName:@"response"];
+
+    if ((unsigned long long)body.length + request.HTTPBody.length >= UINT32_MAX)
+    {
+        return;
+    }
+
+    NSHTTPURLResponse *httpResponse = [response isKindOfClass:[NSHTTPURLResponse class]] ? (NSHTTPURLResponse *)response : nil;
+    NSMutableData *record = [NSMutableData dataWithLength:sizeof(uint32_t)];
+    append_double(record, startTime - _recordingStartTime);
+    append_double(record, duration);
+    append_uint32(record, (uint32_t)(int32_t)httpResponse.statusCode);
+    append_blob(record, [(request.HTTPMethod ?: kGetHttpMethod) dataUsingEncoding:NSUTF8StringEncoding]);
+    append_blob(record, [[request.URL absoluteString] dataUsingEncoding:NSUTF8StringEncoding]);
+    append_blob(record, [http_request_recorder dataWithHeaders:[request allHTTPHeaderFields]]);
+    append_blob(record, request.HTTPBody);
+    append_blob(record, [http_request_recorder dataWithHeaders:[httpResponse allHeaderFields]]);
+    append_blob(record, body);
+    uint32_t recordLength = OSSwapHostToLittleInt32((uint32_t)(record.length - sizeof(uint32_t)));
+    [record replaceBytesInRange:NSMakeRange(0, sizeof(recordLength)) withBytes:&recordLength];
+    dispatch_async(_writeQueue, ^
+    {
+        if (!_fileHandle)
+        {
+            return;
+        }
+
+        @try
+        {
+            [_fileHandle writeData:record];
+            _recordCount++;
+        }
+        @catch (NSException *exception)
+        {
+            // A failed write may have left a partial record, which the next open drops; stop recording after it.
+            [_fileHandle closeFile];
+            _fileHandle = nil;
+        }
+    });
+}
+
+- (void)close
+{
+    dispatch_sync(_writeQueue, ^
+    {
+        [_fileHandle closeFile];
+        _fileHandle = nil;
+    });
+}
+
+#pragma mark - Internal API
+
++ (NSData *)dataWithHeaders:(NSDictionary *)headers
+{
+    NSMutableString *lines = [NSMutableString new];
+    for (NSString *name in headers)
+    {
+        [lines appendFormat:@"%@%@: %@", lines.length > 0 ? @"\n" : @"", name, [headers objectForKey:name]];
+    }
+
+    return [lines dataUsingEncoding:NSUTF8StringEncoding];
+}
+
+#pragma mark - Initialization
+
+- (id)initWithFileUrl:(NSURL *)fileUrl error:(NSError *__autoreleasing *)error
+{
+    [http_request throwIfNil:fileUrl withName:@"fileUrl"];
+
+    *error = nil;
+    self = [super init];
+    if (self)
+    {
+        NSFileManager *fileManager = [NSFileManager defaultManager];
+        unsigned long long validLength = 0;
+        if ([fileManager fileExistsAtPath:[fileUrl path]])
+        {
+            NSData *data = [NSData dataWithContentsOfURL:fileUrl options:NSDataReadingMappedAlways error:error];
+            if (!data)
+            {
+                return nil;
+            }
+
+            validLength = data.length > 0 ? [http_request_recording lengthOfCompleteRecordsInData:data] : 0;
+            if (data.length > 0 && validLength == 0)
+            {
+                *error = [[NSError alloc]
+                          initWithDomain:kHttpRequestDomain
+                          code:-6
+                          userInfo:@{NSLocalizedDescriptionKey:@"Malformed recording."}];
+                return nil;
+            }
+        }
+        else
+        {
+            [fileManager createFileAtPath:[fileUrl path] contents:nil attributes:nil];
+        }
+
+        _fileHandle = [NSFileHandle fileHandleForWritingToURL:fileUrl error:error];
+        if (!_fileHandle)
+        {
+            return nil;
+        }
+
+        [_fileHandle truncateFileAtOffset:validLength];
+        if (validLength == 0)
+        {
+            NSMutableData *header = [NSMutableData dataWithBytes:kHttpRequestRecordingMagic length:strlen(kHttpRequestRecordingMagic)];
+            append_uint32(header, kHttpRequestRecordingVersion);
+            [_fileHandle writeData:header];
+        }
+
+        _fileUrl = fileUrl;
+        _writeQueue = dispatch_queue_create("http-request.recorder", DISPATCH_QUEUE_SERIAL);
+        _recordingStartTime = CFAbsoluteTimeGetCurrent();
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    [_fileHandle closeFile];
+}
+
+@end
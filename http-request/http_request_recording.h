@@ -0,0 +1,120 @@
+//
+//  http_request_recording.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#define kHttpRequestRecordingMagic      "HRRC"
+#define kHttpRequestRecordingVersion    1
+
+/**
+ *  http_request_recording_entry is a request and its response as captured by http_request_recorder.
+ */
+@interface http_request_recording_entry : NSObject
+
+/**
+ *  The time at which the request started, in seconds since the recorder which captured it was opened.
+ */
+@property (readonly) NSTimeInterval offset;
+
+/**
+ *  The time the request took on the network, in seconds.
+ */
+@property (readonly) NSTimeInterval duration;
+
+/**
+ *  The HTTP method of the request.
+ */
+@property (readonly) NSString *method;
+
+/**
+ *  The URL of the request.
+ */
+@property (readonly) NSURL *url;
+
+/**
+ *  The headers of the request.
+ */
+@property (readonly) NSDictionary *requestHeaders;
+
+/**
+ *  The body of the request; otherwise, nil.
+ */
+@property (readonly) NSData *requestBody;
+
+/**
+ *  The status code of the response.
+ */
+@property (readonly) NSInteger statusCode;
+
+/**
+ *  The headers of the response.
+ */
+@property (readonly) NSDictionary *responseHeaders;
+
+/**
+ *  The body of the response, as delivered by the session (i.e. decoded).
+ */
+@property (readonly) NSData *responseBody;
+
+@end
+
+/**
+ *  http_request_recording reads the file written by http_request_recorder. The file is memory mapped and only the
+ *  position of each entry is indexed up front; entries are decoded when retrieved. The file format is a header
+ *  (kHttpRequestRecordingMagic and kHttpRequestRecordingVersion as a little endian uint32) followed by records, each
+ *  a little endian uint32 length, the offset and the duration as little endian doubles, the status code as a little
+ *  endian int32, then the method, URL, request headers, request body, response headers and response body, each a
+ *  little endian uint32 length followed by the bytes. Headers are UTF-8 "Name: value" lines. A truncated last record,
+ *  as left by a crash, is ignored.
+ */
+@interface http_request_recording : NSObject
+
+/**
+ *  The number of entries.
+ */
+@property (readonly) NSUInteger count;
+
+/**
+ *  Opens a recording.
+ *
+ *  @param fileUrl The file of the recording. Must not be nil.
+ *  @param error   The error which occurred, if any. Must not be nil.
+ *
+ *  @return The recording; otherwise, nil if the file cannot be read or is not a recording.
+ */
++ (http_request_recording *)recordingWithContentsOfUrl:(NSURL *)fileUrl error:(NSError *__autoreleasing *)error;
+
+/**
+ *  Retrieves an entry.
+ *
+ *  @param index The index of the entry, in recording order.
+ *
+ *  @return The entry.
+ */
+- (http_request_recording_entry *)entryAtIndex:(NSUInteger)index;
+
+/**
+ *  Retrieves the next entry recorded for the method and URL of a request. Successive requests for the same method and
+ *  URL are served the entries recorded for them in order, cycling once exhausted.
+ *
+ *  @param request The request. Must not be nil.
+ *
+ *  @return The entry; otherwise, nil if none was recorded for the request.
+ */
+- (http_request_recording_entry *)nextEntryForRequest:(NSURLRequest *)request;
+
+/**
+ *  Determines whether or not any entry was recorded for the method and URL of a request.
+ *
+ *  @param request The request. Must not be nil.
+ *
+ *  @return YES if an entry was recorded for the request; otherwise, NO.
+ */
+- (BOOL)hasEntryForRequest:(NSURLRequest *)request;
+
+@end
@@ -0,0 +1,319 @@
+//
+//  http_request_recording.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <libkern/OSByteOrder.h>
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_recording.h"
+
+#define kRecordingHeaderLength          8
+#define kRecordFixedLength              20
+#define kRecordBlobCount                6
+
+static BOOL read_uint32(const uint8_t *bytes, NSUInteger length, NSUInteger *offset, uint32_t *value)
+{
+    if (length - *offset < sizeof(uint32_t))
+    {
+        return NO;
+    }
+
+    uint32_t raw = 0;
+    memcpy(&raw, bytes + *offset, sizeof(raw));
+    *value = OSSwapLittleToHostInt32(raw);
+    *offset += sizeof(raw);
+    return YES;
+}
+
+static BOOL read_double(const uint8_t *bytes, NSUInteger length, NSUInteger *offset, double *value)
+{
+    if (length - *offset < sizeof(uint64_t))
+    {
+        return NO;
+    }
+
+    uint64_t raw = 0;
+    memcpy(&raw, bytes + *offset, sizeof(raw));
+    raw = OSSwapLittleToHostInt64(raw);
+    memcpy(value, &raw, sizeof(raw));
+    *offset += sizeof(raw);
+    return YES;
+}
+
+static BOOL read_blob(const uint8_t *bytes, NSUInteger length, NSUInteger *offset, NSRange *range)
+{
+    uint32_t blobLength = 0;
+    if (!read_uint32(bytes, length, offset, &blobLength) || length - *offset < blobLength)
+    {
+        return NO;
+    }
+
+    *range = NSMakeRange(*offset, blobLength);
+    *offset += blobLength;
+    return YES;
+}
+
+@interface http_request_recording_entry()
+
+- (id)initWithOffset:(NSTimeInterval)offset
+            duration:(NSTimeInterval)duration
+              method:(NSString *)method
+                 url:(NSURL *)url
+      requestHeaders:(NSDictionary *)requestHeaders
+         requestBody:(NSData *)requestBody
+          statusCode:(NSInteger)statusCode
+     responseHeaders:(NSDictionary *)responseHeaders
+        responseBody:(NSData *)responseBody;
+
+@end
+
+@implementation http_request_recording_entry
+
+#pragma mark - Initialization
+
+- (id)initWithOffset:(NSTimeInterval)offset
+            duration:(NSTimeInterval)duration
+              method:(NSString *)method
+                 url:(NSURL *)url
+      requestHeaders:(NSDictionary *)requestHeaders
+         requestBody:(NSData *)requestBody
+          statusCode:(NSInteger)statusCode
+     responseHeaders:(NSDictionary *)responseHeaders
+        responseBody:(NSData *)responseBody
+{
+    self = [super init];
+    if (self)
+    {
+        _offset = offset;
+        _duration = duration;
+        _method = method;
+        _url = url;
+        _requestHeaders = requestHeaders;
+        _requestBody = requestBody;
+        _statusCode = statusCode;
+        _responseHeaders = responseHeaders;
+        _responseBody = responseBody;
+    }
+
+    return self;
+}
+
+@end
+
+@interface http_request_recording()
+{
+    NSData *_data;
+    NSMutableArray *_recordRanges;
+    NSMutableDictionary *_entryIndexes;
+    NSMutableDictionary *_nextEntryIndexes;
+}
+
++ (NSString *)keyForMethod:(NSString *)method url:(NSString *)url;
++ (NSDictionary *)headersInData:(NSData *)data withRange:(NSRange)range;
+
+- (id)initWithData:(NSData *)data;
+
+@end
+
+@implementation http_request_recording
+
+#pragma mark - Public API
+
++ (http_request_recording *)recordingWithContentsOfUrl:(NSURL *)fileUrl error:(NSError *__autoreleasing *)error
+{
+    [http_request throwIfNil:fileUrl withName:@"fileUrl"];
+
+    *error = nil;
+    NSData *data = [NSData dataWithContentsOfURL:fileUrl options:NSDataReadingMappedAlways error:error];
+    if (!data)
+    {
+        return nil;
+    }
+
+    if ([http_request_recording lengthOfCompleteRecordsInData:data] == 0)
+    {
+        *error = [[NSError alloc]
+                  initWithDomain:kHttpRequestDomain
+                  code:-6
+                  userInfo:@{NSLocalizedDescriptionKey:@"Malformed recording."}];
+        return nil;
+    }
+
+    return [[http_request_recording alloc] initWithData:data];
+}
+
+- (NSUInteger)count
+{
+    return _recordRanges.count;
+}
+
+- (http_request_recording_entry *)entryAtIndex:(NSUInteger)index
+{
+    NSRange recordRange = [_recordRanges[index] rangeValue];
+    const uint8_t *bytes = _data.bytes;
+    NSUInteger length = NSMaxRange(recordRange);
+    NSUInteger offset = recordRange.location;
+    double startOffset = 0;
+    double duration = 0;
+    uint32_t statusCode = 0;
+    NSRange blobs[kRecordBlobCount];
+    read_double(bytes, length, &offset, &startOffset);
+    read_double(bytes, length, &offset, &duration);
+    read_uint32(bytes, length, &offset, &statusCode);
+    for (NSUInteger blob = 0; blob < kRecordBlobCount; blob++)
+    {
+        read_blob(bytes, length, &offset, &blobs[blob]);
+    }
+
+    NSString *method = [[NSString alloc] initWithData:[_data subdataWithRange:blobs[0]] encoding:NSUTF8StringEncoding];
+    NSString *url = [[NSString alloc] initWithData:[_data subdataWithRange:blobs[1]] encoding:NSUTF8StringEncoding];
+    return [[http_request_recording_entry alloc]
+            initWithOffset:startOffset
+            duration:duration
+            method:method
+            url:[NSURL URLWithString:url]
+            requestHeaders:[http_request_recording headersInData:_data withRange:blobs[2]]
+            requestBody:blobs[3].length > 0 ? [_data subdataWithRange:blobs[3]] : nil
+            statusCode:(int32_t)statusCode
+            responseHeaders:[http_request_recording headersInData:_data withRange:blobs[4]]
+            responseBody:[_data subdataWithRange:blobs[5]]];
+}
+
+- (http_request_recording_entry *)nextEntryForRequest:(NSURLRequest *)request
+{
+    [http_request throwIfNil:request withName:@"request"];
+
+    NSString *key = [http_request_recording keyForMethod:request.HTTPMethod ?: kGetHttpMethod url:[request.URL absoluteString]];
+    NSUInteger index = NSNotFound;
+    @synchronized(self)
+    {
+        NSArray *indexes = [_entryIndexes objectForKey:key];
+        if (indexes.count == 0)
+        {
+            return nil;
+        }
+
+        NSUInteger next = [[_nextEntryIndexes objectForKey:key] unsignedIntegerValue];
+        index = [indexes[next % indexes.count] unsignedIntegerValue];
+        [_nextEntryIndexes setObject:@(next + 1) forKey:key];
+    }
+
+    return [self entryAtIndex:index];
+}
+
+- (BOOL)hasEntryForRequest:(NSURLRequest *)request
+{
+    [http_request throwIfNil:request withName:@"request"];
+
+    NSString *key = [http_request_recording keyForMethod:request.HTTPMethod ?: kGetHttpMethod url:[request.URL absoluteString]];
+    return [_entryIndexes objectForKey:key] != nil;
+}
+
+#pragma mark - Internal API
+
++ (NSUInteger)lengthOfCompleteRecordsInData:(NSData *)data
+{
+    const uint8_t *bytes = data.bytes;
+    NSUInteger length = data.length;
+    uint32_t version = 0;
+    NSUInteger offset = strlen(kHttpRequestRecordingMagic);
+    if (length < kRecordingHeaderLength
+        || memcmp(bytes, kHttpRequestRecordingMagic, offset) != 0
+        || !read_uint32(bytes, length, &offset, &version)
+        || version != kHttpRequestRecordingVersion)
+    {
+        return 0;
+    }
+
+    uint32_t recordLength = 0;
+    NSUInteger recordStart = offset;
+    while (read_uint32(bytes, length, &offset, &recordLength) && length - offset >= recordLength)
+    {
+        // Every blob must fit the record, so that a record cut short is never mistaken for a complete one.
+        NSUInteger recordEnd = offset + recordLength;
+        NSUInteger blobOffset = offset + kRecordFixedLength;
+        NSRange blob;
+        BOOL complete = recordLength >= kRecordFixedLength;
+        for (NSUInteger index = 0; complete && index < kRecordBlobCount; index++)
+        {
+            complete = read_blob(bytes, recordEnd, &blobOffset, &blob);
+        }
+
+        if (!complete || blobOffset != recordEnd)
+        {
+            break;
+        }
+
+        offset = recordEnd;
+        recordStart = offset;
+    }
+
+    return recordStart;
+}
+
++ (NSString *)keyForMethod:(NSString *)method url:(NSString *)url
+{
+    return [NSString stringWithFormat:@"%@ %@", [method uppercaseString], url];
+}
+
++ (NSDictionary *)headersInData:(NSData *)data withRange:(NSRange)range
+{
+    NSMutableDictionary *headers = [NSMutableDictionary new];
+    NSString *lines = [[NSString alloc] initWithData:[data subdataWithRange:range] encoding:NSUTF8StringEncoding];
+    for (NSString *line in [lines componentsSeparatedByString:@"\n"])
+    {
+        NSRange separator = [line rangeOfString:@": "];
+        if (separator.location != NSNotFound)
+        {
+            [headers setObject:[line substringFromIndex:NSMaxRange(separator)] forKey:[line substringToIndex:separator.location]];
+        }
+    }
+
+    return headers;
+}
+
+- (id)initWithData:(NSData *)data
+{
+    self = [super init];
+    if (self)
+    {
+        _data = data;
+        _recordRanges = [NSMutableArray new];
+        _entryIndexes = [NSMutableDictionary new];
+        _nextEntryIndexes = [NSMutableDictionary new];
+        const uint8_t *bytes = data.bytes;
+        NSUInteger length = [http_request_recording lengthOfCompleteRecordsInData:data];
+        NSUInteger offset = kRecordingHeaderLength;
+        uint32_t recordLength = 0;
+        while (read_uint32(bytes, length, &offset, &recordLength))
+        {
+            NSRange recordRange = NSMakeRange(offset, recordLength);
+            NSUInteger blobOffset = offset + kRecordFixedLength;
+            NSRange methodRange;
+            NSRange urlRange;
+            read_blob(bytes, NSMaxRange(recordRange), &blobOffset, &methodRange);
+            read_blob(bytes, NSMaxRange(recordRange), &blobOffset, &urlRange);
+            NSString *method = [[NSString alloc] initWithBytes:bytes + methodRange.location length:methodRange.length encoding:NSUTF8StringEncoding];
+            NSString *url = [[NSString alloc] initWithBytes:bytes + urlRange.location length:urlRange.length encoding:NSUTF8StringEncoding];
+            NSString *key = [http_request_recording keyForMethod:method url:url];
+            NSMutableArray *indexes = [_entryIndexes objectForKey:key];
+            if (!indexes)
+            {
+                indexes = [NSMutableArray new];
+                [_entryIndexes setObject:indexes forKey:key];
+            }
+
+            [indexes addObject:@(_recordRanges.count)];
+            [_recordRanges addObject:[NSValue valueWithRange:recordRange]];
+            offset = NSMaxRange(recordRange);
+        }
+    }
+
+    return self;
+}
+
+@end
@@ -0,0 +1,42 @@
+//
+//  http_request_replay_protocol.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "http_request_recording.h"
+
+/**
+ *  http_request_replay_protocol is a URL protocol which serves the responses of a recording instead of the network,
+ *  for the requests whose method and URL were recorded; other requests go to the network as usual. Each response is
+ *  delivered after its recorded duration multiplied by the time scale, so that parsers and callbacks can be load
+ *  tested deterministically, offline, at the original pace or faster.
+ */
+@interface http_request_replay_protocol : NSURLProtocol
+
+/**
+ *  Starts serving a recording, replacing the one being served if any.
+ *
+ *  @param recording The recording to serve. Must not be nil.
+ *  @param timeScale The factor applied to the recorded durations: 1 replays at the original pace, 0.1 ten times
+ *                   faster and 0 without delay.
+ */
++ (void)startReplaying:(http_request_recording *)recording withTimeScale:(double)timeScale;
+
+/**
+ *  Stops serving the recording; requests go to the network again.
+ */
++ (void)stopReplaying;
+
+/**
+ *  Adds the protocol to a session configuration, ahead of its other protocols; required for the sessions created
+ *  with it, since sessions do not consult globally registered protocols.
+ *
+ *  @param configuration The session configuration. Must not be nil.
+ */
++ (void)addToConfiguration:(NSURLSessionConfiguration *)configuration;
+
+@end
@@ -0,0 +1,140 @@
+//
+//  http_request_replay_protocol.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_replay_protocol.h"
+
+static http_request_recording *_replayedRecording = nil;
+static double _replayTimeScale = 1;
+
+@interface http_request_replay_protocol()
+
++ (http_request_recording *)replayedRecording;
+
+- (void)deliverEntry:(http_request_recording_entry *)entry;
+
+@end
+
+@implementation http_request_replay_protocol
+
+#pragma mark - Public API
+
++ (void)startReplaying:(http_request_recording *)recording withTimeScale:(double)timeScale
+{
+    [http_request throwIfNil:recording withName:@"recording"];
+
+    @synchronized([http_request_replay_protocol class])
+    {
+        _replayedRecording = recording;
+        _replayTimeScale = MAX(timeScale, 0);
+    }
+}
+
++ (void)stopReplaying
+{
+    @synchronized([http_request_replay_protocol class])
+    {
+        _replayedRecording = nil;
+    }
+}
+
++ (void)addToConfiguration:(NSURLSessionConfiguration *)configuration
+{
+    [http_request throwIfNil:configuration withName:@"configuration"];
+
+    NSMutableArray *protocolClasses = [NSMutableArray arrayWithObject:[http_request_replay_protocol class]];
+    for (Class protocolClass in configuration.protocolClasses)
+    {
+        if (protocolClass != [http_request_replay_protocol class])
+        {
+            [protocolClasses addObject:protocolClass];
+        }
+    }
+
+    configuration.protocolClasses = protocolClasses;
+}
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request
+{
+    return [[http_request_replay_protocol replayedRecording] hasEntryForRequest:request];
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request
+{
+    return request;
+}
+
+- (void)startLoading
+{
+    double timeScale = 1;
+    http_request_recording *recording = nil;
+    @synchronized([http_request_replay_protocol class])
+    {
+        recording = _replayedRecording;
+        timeScale = _replayTimeScale;
+    }
+
+    http_request_recording_entry *entry = [recording nextEntryForRequest:self.request];
+    if (!entry)
+    {
+        [self.client
+         URLProtocol:self
+         didFailWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorResourceUnavailable userInfo:nil]];
+        return;
+    }
+
+    // Delivered through the run loop of the loading thread, on which stopLoading is called as well.
+    [self performSelector:@selector(deliverEntry:) withObject:entry afterDelay:entry.duration * timeScale];
+}
+
+- (void)stopLoading
+{
+    [NSObject cancelPreviousPerformRequestsWithTarget:self];
+}
+
+#pragma mark - Internal API
+
++ (http_request_recording *)replayedRecording
+{
+    @synchronized([http_request_replay_protocol class])
+    {
+        return _replayedRecording;
+    }
+}
+
+- (void)deliverEntry:(http_request_recording_entry *)entry
+{
+    // The recorded body is already decoded, so the headers describing its encoding no longer apply.
+    NSMutableDictionary *headers = [NSMutableDictionary new];
+    for (NSString *name in entry.responseHeaders)
+    {
+        if ([name caseInsensitiveCompare:@"Content-Encoding"] != NSOrderedSame
+            && [name caseInsensitiveCompare:@"Content-Length"] != NSOrderedSame
+            && [name caseInsensitiveCompare:@"Transfer-Encoding"] != NSOrderedSame)
+        {
+            [headers setObject:[entry.responseHeaders objectForKey:name] forKey:name];
+        }
+    }
+
+    [headers setObject:[NSString stringWithFormat:@"%lu", (unsigned long)entry.responseBody.length] forKey:@"Content-Length"];
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc]
+                                   initWithURL:self.request.URL
+                                   statusCode:entry.statusCode
+                                   HTTPVersion:@"HTTP/1.1"
+                                   headerFields:headers];
+    [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    if (entry.responseBody.length > 0)
+    {
+        [self.client URLProtocol:self didLoadData:entry.responseBody];
+    }
+
+    [self.client URLProtocolDidFinishLoading:self];
+}
+
+@end
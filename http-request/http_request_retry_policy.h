@@ -0,0 +1,159 @@
+//
+//  http_request_retry_policy.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#define kDefaultMaxRetryCount           3
+#define kDefaultRetryBaseDelay          0.5
+#define kDefaultRetryMaxDelay           30.0
+#define kDefaultRetryRatio              0.2
+#define kDefaultRetryMaxBalance         10.0
+
+/**
+ *  http_request_retry_budget bounds the number of retries relative to the number of requests: every request deposits
+ *  a fraction of a token and every retry withdraws a whole one. During an outage the balance drains and retries stop,
+ *  so they cannot multiply the load on a struggling backend.
+ */
+@interface http_request_retry_budget : NSObject
+
+/**
+ *  The number of tokens currently available to retries.
+ */
+@property (readonly) double balance;
+
+/**
+ *  The number of retries allowed so far.
+ */
+@property (readonly) NSUInteger retryCount;
+
+/**
+ *  The number of retries refused because the budget was exhausted.
+ */
+@property (readonly) NSUInteger rejectedRetryCount;
+
+/**
+ *  Retrieves the budget shared by every retry policy which was not given its own.
+ *
+ *  @return The shared budget.
+ */
++ (http_request_retry_budget *)sharedBudget;
+
+/**
+ *  The default instance initializer; allows retries for 20% of the requests, with a balance of up to ten retries.
+ *
+ *  @return An instance of class.
+ */
+- (id)init;
+
+/**
+ *  Initializes the budget.
+ *
+ *  @param retryRatio The fraction of a token deposited by every request (e.g. 0.2 allows one retry per five requests).
+ *  @param maxBalance The maximum number of tokens, which is also the initial balance.
+ *
+ *  @return An instance of class.
+ */
+- (id)initWithRetryRatio:(double)retryRatio maxBalance:(double)maxBalance;
+
+/**
+ *  Deposits the share of a request.
+ */
+- (void)depositForRequest;
+
+/**
+ *  Withdraws a token for a retry, if available.
+ *
+ *  @return YES if the retry is allowed; otherwise, NO.
+ */
+- (BOOL)withdrawForRetry;
+
+@end
+
+/**
+ *  http_request_retry_policy decides whether and when a failed request is retried. By default it retries transport
+ *  errors, server errors (5xx) and 429 responses of idempotent requests up to three times, with exponential backoff
+ *  and full jitter, honoring Retry-After, and within the shared retry budget.
+ */
+@interface http_request_retry_policy : NSObject
+
+/**
+ *  The maximum number of retries of a request.
+ */
+@property (assign) NSUInteger maxRetryCount;
+
+/**
+ *  The delay ceiling of the first retry, in seconds; it doubles with every retry.
+ */
+@property (assign) NSTimeInterval baseDelay;
+
+/**
+ *  The maximum delay before a retry, in seconds. A Retry-After longer than this is not waited for.
+ */
+@property (assign) NSTimeInterval maxDelay;
+
+/**
+ *  Determines whether or not requests with a non-idempotent method (e.g. POST, PATCH) are retried. Defaults to NO.
+ */
+@property (assign) BOOL retriesNonIdempotentRequests;
+
+/**
+ *  The budget retries are withdrawn from. Defaults to the shared budget; can be nil to disable the budget.
+ */
+@property (strong) http_request_retry_budget *budget;
+
+/**
+ *  Determines whether or not the HTTP method is idempotent.
+ *
+ *  @param method The HTTP method. Must not be nil.
+ *
+ *  @return YES if it is idempotent; otherwise, NO.
+ */
++ (BOOL)isIdempotentMethod:(NSString *)method;
+
+/**
+ *  Retrieves the delay requested by the Retry-After header of the response, either in seconds or as an HTTP date.
+ *
+ *  @param response The response. Optional, can be nil.
+ *
+ *  @return The delay in seconds; otherwise, a negative value if there is none.
+ */
++ (NSTimeInterval)retryAfterForResponse:(NSHTTPURLResponse *)response;
+
+/**
+ *  Determines whether or not the error is transient: a transport error other than a cancellation, a server error or
+ *  a 429 response.
+ *
+ *  @param error The error passed to the error callback. Must not be nil.
+ *
+ *  @return YES if it is worth retrying; otherwise, NO.
+ */
+- (BOOL)isRetryableError:(NSError *)error;
+
+/**
+ *  Determines whether or not the request is retried after the error, not taking the budget into account.
+ *
+ *  @param request The failed request. Must not be nil.
+ *  @param error   The error passed to the error callback. Must not be nil.
+ *  @param retry   The number of the upcoming retry, starting at one.
+ *
+ *  @return YES if it is retried; otherwise, NO.
+ */
+- (BOOL)shouldRetryRequest:(NSURLRequest *)request afterError:(NSError *)error retry:(NSUInteger)retry;
+
+/**
+ *  Computes the delay before the retry: the Retry-After of the response if any; otherwise, a random delay between zero
+ *  and baseDelay * 2^(retry - 1), capped at maxDelay.
+ *
+ *  @param retry The number of the upcoming retry, starting at one.
+ *  @param error The error passed to the error callback. Must not be nil.
+ *
+ *  @return The delay in seconds; otherwise, a negative value if the requested Retry-After exceeds maxDelay.
+ */
+- (NSTimeInterval)delayBeforeRetry:(NSUInteger)retry afterError:(NSError *)error;
+
+@end
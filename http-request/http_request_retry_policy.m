@@ -0,0 +1,186 @@
+//
+//  http_request_retry_policy.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_retry_policy.h"
+
+@interface http_request_retry_budget()
+{
+    double _retryRatio;
+    double _maxBalance;
+}
+
+@end
+
+@implementation http_request_retry_budget
+
+#pragma mark - Public API
+
++ (http_request_retry_budget *)sharedBudget
+{
+    static http_request_retry_budget *sharedBudget = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^
+    {
+        sharedBudget = [http_request_retry_budget new];
+    });
+
+    return sharedBudget;
+}
+
+- (void)depositForRequest
+{
+    @synchronized(self)
+    {
+        _balance = MIN(_maxBalance, _balance + _retryRatio);
+    }
+}
+
+- (BOOL)withdrawForRetry
+{
+    @synchronized(self)
+    {
+        if (_balance < 1.0)
+        {
+            _rejectedRetryCount++;
+            return NO;
+        }
+
+        _balance -= 1.0;
+        _retryCount++;
+        return YES;
+    }
+}
+
+#pragma mark - Initialization
+
+- (id)init
+{
+    return [self initWithRetryRatio:kDefaultRetryRatio maxBalance:kDefaultRetryMaxBalance];
+}
+
+- (id)initWithRetryRatio:(double)retryRatio maxBalance:(double)maxBalance
+{
+    self = [super init];
+    if (self)
+    {
+        _retryRatio = retryRatio;
+        _maxBalance = maxBalance;
+        _balance = maxBalance;
+    }
+
+    return self;
+}
+
+@end
+
+@implementation http_request_retry_policy
+
+#pragma mark - Public API
+
++ (BOOL)isIdempotentMethod:(NSString *)method
+{
+    [http_request throwIfNil:method withName:@"method"];
+
+    NSString *upperCaseMethod = [method uppercaseString];
+    return [upperCaseMethod isEqualToString:kGetHttpMethod]
+           || [upperCaseMethod isEqualToString:kHeadHttpMethod]
+           || [upperCaseMethod isEqualToString:kPutHttpMethod]
+           || [upperCaseMethod isEqualToString:kDeleteHttpMethod]
+           || [upperCaseMethod isEqualToString:@"OPTIONS"]
+           || [upperCaseMethod isEqualToString:@"TRACE"];
+}
+
++ (NSTimeInterval)retryAfterForResponse:(NSHTTPURLResponse *)response
+{
+    NSString *retryAfter = [[response allHeaderFields] valueForKey:@"Retry-After"];
+    if (![http_request isNotNil:retryAfter])
+    {
+        return -1;
+    }
+
+    NSScanner *scanner = [NSScanner scannerWithString:retryAfter];
+    NSInteger seconds = 0;
+    if ([scanner scanInteger:&seconds] && [scanner isAtEnd])
+    {
+        return MAX(seconds, 0);
+    }
+
+    NSDateFormatter *formatter = [NSDateFormatter new];
+    formatter.locale = [[NSLocale alloc] initWithLocaleIdentifier:@"en_US_POSIX"];
+    formatter.timeZone = [NSTimeZone timeZoneWithAbbreviation:@"GMT"];
+    formatter.dateFormat = @"EEE',' dd MMM yyyy HH':'mm':'ss 'GMT'";
+    NSDate *date = [formatter dateFromString:retryAfter];
+    return date ? MAX([date timeIntervalSinceNow], 0) : -1;
+}
+
+- (BOOL)isRetryableError:(NSError *)error
+{
+    [http_request throwIfNil:error withName:@"error"];
+
+    if ([error.domain isEqualToString:NSURLErrorDomain])
+    {
+        return error.code != NSURLErrorCancelled
+               && error.code != NSURLErrorBadURL
+               && error.code != NSURLErrorUnsupportedURL
+               && error.code != NSURLErrorUserCancelledAuthentication;
+    }
+
+    NSHTTPURLResponse *response = error.userInfo[@"Response"];
+    if ([error.domain isEqualToString:kHttpRequestDomain] && error.code == -1011 && response)
+    {
+        int statusCode = (int)response.statusCode;
+        return [http_request isServerErrorStatusCode:statusCode] || statusCode == 429;
+    }
+
+    return NO;
+}
+
+- (BOOL)shouldRetryRequest:(NSURLRequest *)request afterError:(NSError *)error retry:(NSUInteger)retry
+{
+    [http_request throwIfNil:request withName:@"request"];
+    [http_request throwIfNil:error withName:@"error"];
+
+    return retry <= self.maxRetryCount
+           && (self.retriesNonIdempotentRequests || [http_request_retry_policy isIdempotentMethod:request.HTTPMethod])
+           && [self isRetryableError:error];
+}
+
+- (NSTimeInterval)delayBeforeRetry:(NSUInteger)retry afterError:(NSError *)error
+{
+    [http_request throwIfNil:error withName:@"error"];
+
+    NSTimeInterval retryAfter = [http_request_retry_policy retryAfterForResponse:error.userInfo[@"Response"]];
+    if (retryAfter >= 0)
+    {
+        return retryAfter <= self.maxDelay ? retryAfter : -1;
+    }
+
+    // Full jitter: spreads the retries of clients which failed together over the whole backoff window.
+    NSTimeInterval ceiling = MIN(self.maxDelay, self.baseDelay * pow(2, MAX(retry, 1) - 1));
+    return ceiling * ((double)arc4random() / UINT32_MAX);
+}
+
+#pragma mark - Initialization
+
+- (id)init
+{
+    self = [super init];
+    if (self)
+    {
+        _maxRetryCount = kDefaultMaxRetryCount;
+        _baseDelay = kDefaultRetryBaseDelay;
+        _maxDelay = kDefaultRetryMaxDelay;
+        _budget = [http_request_retry_budget sharedBudget];
+    }
+
+    return self;
+}
+
+@end
@@ -0,0 +1,159 @@
+//
+//  http_request_scheduler.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+#define kDefaultMaxConcurrentRequestsPerHost    4
+#define kHttpRequestPriorityKey                 @"http_request_priority"
+
+/**
+ *  The priority with which a request is scheduled. Queued requests of a host are started from the highest priority down,
+ *  in the order they were issued within a priority.
+ */
+typedef NS_ENUM(NSInteger, http_request_priority)
+{
+    /**
+     *  Requests the user is waiting on.
+     */
+    http_request_priority_interactive,
+    /**
+     *  Requests without a priority.
+     */
+    http_request_priority_default,
+    /**
+     *  Requests nobody is waiting on, such as prefetching and synchronization.
+     */
+    http_request_priority_background
+};
+
+/**
+ *  http_request_scheduler limits the number of requests running against every host and queues the rest by priority, so
+ *  that background traffic cannot starve latency sensitive requests. Queued tasks are created suspended and only resumed
+ *  once a slot of their host frees up.
+ */
+@interface http_request_scheduler : NSObject
+
+/**
+ *  The maximum number of requests running concurrently against a single host.
+ */
+@property (readonly) NSUInteger maxConcurrentRequestsPerHost;
+
+/**
+ *  Sets the priority with which the request is scheduled; requests without one use the default priority.
+ *
+ *  @param priority The priority.
+ *  @param request  The request. Must not be nil.
+ */
++ (void)setPriority:(http_request_priority)priority forRequest:(NSMutableURLRequest *)request;
+
+/**
+ *  Retrieves the priority with which the request is scheduled.
+ *
+ *  @param request The request. Must not be nil.
+ *
+ *  @return The priority.
+ */
++ (http_request_priority)priorityForRequest:(NSURLRequest *)request;
+
+/**
+ *  The default instance initializer; allows four concurrent requests per host.
+ *
+ *  @return An instance of class.
+ */
+- (id)init;
+
+/**
+ *  Initializes the scheduler.
+ *
+ *  @param maxConcurrentRequestsPerHost The maximum number of requests running concurrently against a single host.
+ *
+ *  @return An instance of class.
+ */
+- (id)initWithMaxConcurrentRequestsPerHost:(NSUInteger)maxConcurrentRequestsPerHost;
+
+/**
+ *  Changes the priority of a queued task; it moves to the back of its new priority.
+ *
+ *  Only tasks which are themselves scheduled are known to the scheduler. The task returned for a request issued with a
+ *  retry or hedging policy, with a deadline, coalesced with an identical request in flight or answered from the cache
+ *  merely represents the operation and is never queued, so this returns NO for it; set the priority of such a request
+ *  through setPriority:forRequest: before issuing it instead.
+ *
+ *  @param priority The new priority.
+ *  @param task     The task returned when the request was issued. Must not be nil.
+ *
+ *  @return YES if the task was still queued; otherwise, NO (including for tasks which are never queued).
+ */
+- (BOOL)setPriority:(http_request_priority)priority forTask:(NSURLSessionTask *)task;
+
+/**
+ *  Removes a task from the queue and cancels it; its error callback is called with a cancellation error.
+ *
+ *  As with setPriority:forTask:, the task returned for a request issued with a retry or hedging policy, with a deadline,
+ *  coalesced or answered from the cache is never queued, so this returns NO and leaves it running; cancel such a task
+ *  directly instead, which stops the operation it represents whether an attempt is queued or not.
+ *
+ *  @param task The task returned when the request was issued. Must not be nil.
+ *
+ *  @return YES if the task was still queued; otherwise, NO (including for tasks which are never queued).
+ */
+- (BOOL)cancelQueuedTask:(NSURLSessionTask *)task;
+
+/**
+ *  Retrieves the number of queued tasks.
+ *
+ *  @return The number of queued tasks.
+ */
+- (NSUInteger)queuedCount;
+
+/**
+ *  Retrieves the number of queued tasks of a priority.
+ *
+ *  @param priority The priority.
+ *
+ *  @return The number of queued tasks.
+ */
+- (NSUInteger)queuedCountForPriority:(http_request_priority)priority;
+
+/**
+ *  Retrieves the number of queued tasks of a host.
+ *
+ *  @param host The host. Must not be nil.
+ *
+ *  @return The number of queued tasks.
+ */
+- (NSUInteger)queuedCountForHost:(NSString *)host;
+
+/**
+ *  Retrieves the number of running tasks of a host.
+ *
+ *  @param host The host. Must not be nil.
+ *
+ *  @return The number of running tasks.
+ */
+- (NSUInteger)runningCountForHost:(NSString *)host;
+
+/**
+ *  Retrieves the average time the started tasks of a priority spent queued.
+ *
+ *  @param priority The priority.
+ *
+ *  @return The average wait in seconds.
+ */
+- (NSTimeInterval)averageWaitTimeForPriority:(http_request_priority)priority;
+
+/**
+ *  Retrieves the longest time a started task of a priority spent queued.
+ *
+ *  @param priority The priority.
+ *
+ *  @return The maximum wait in seconds.
+ */
+- (NSTimeInterval)maxWaitTimeForPriority:(http_request_priority)priority;
+
+@end
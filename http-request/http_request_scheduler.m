@@ -0,0 +1,341 @@
+//
+//  http_request_scheduler.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request.h"
+#import "http_request_private.h"
+#import "http_request_scheduler.h"
+
+#define kPriorityCount  (http_request_priority_background + 1)
+
+/**
+ *  A task waiting for a slot of its host.
+ */
+@interface http_request_scheduled_task : NSObject
+
+@property (strong) NSURLSessionTask *task;
+@property (copy) NSString *host;
+@property (assign) http_request_priority priority;
+@property (assign) CFAbsoluteTime enqueueTime;
+@property (copy) void (^resumeCallback)(void);
+
+@end
+
+@implementation http_request_scheduled_task
+@end
+
+/**
+ *  The running and queued tasks of a host.
+ */
+@interface http_request_scheduled_host : NSObject
+
+@property (strong) NSMutableArray *queues;
+@property (assign) NSUInteger runningCount;
+
+@end
+
+@implementation http_request_scheduled_host
+@end
+
+@interface http_request_scheduler()
+{
+    NSMutableDictionary *_hosts;
+    NSMapTable *_queuedTasks;
+    NSMapTable *_runningTasks;
+    NSUInteger _startedCounts[kPriorityCount];
+    NSTimeInterval _totalWaitTimes[kPriorityCount];
+    NSTimeInterval _maxWaitTimes[kPriorityCount];
+}
+
++ (NSString *)hostForTask:(NSURLSessionTask *)task;
+
+- (http_request_scheduled_host *)scheduledHost:(NSString *)host;
+- (NSArray *)dequeueStartableTasksOfHost:(NSString *)host;
+- (void)startScheduledTasks:(NSArray *)scheduledTasks;
+
+@end
+
+@implementation http_request_scheduler
+
+#pragma mark - Public API
+
++ (void)setPriority:(http_request_priority)priority forRequest:(NSMutableURLRequest *)request
+{
+    [http_request throwIfNil:request withName:@"request"];
+
+    [NSURLProtocol setProperty:@(priority) forKey:kHttpRequestPriorityKey inRequest:request];
+}
+
++ (http_request_priority)priorityForRequest:(NSURLRequest *)request
+{
+    [http_request throwIfNil:request withName:@"request"];
+
+    NSNumber *priority = [NSURLProtocol propertyForKey:kHttpRequestPriorityKey inRequest:request];
+    if (!priority || [priority integerValue] < 0 || [priority integerValue] >= kPriorityCount)
+    {
+        return http_request_priority_default;
+    }
+
+    return (http_request_priority)[priority integerValue];
+}
+
+- (BOOL)setPriority:(http_request_priority)priority forTask:(NSURLSessionTask *)task
+{
+    [http_request throwIfNil:task withName:@"task"];
+
+    @synchronized(self)
+    {
+        http_request_scheduled_task *scheduledTask = [_queuedTasks objectForKey:task];
+        if (!scheduledTask || priority < 0 || priority >= kPriorityCount)
+        {
+            return NO;
+        }
+
+        http_request_scheduled_host *scheduledHost = [self scheduledHost:scheduledTask.host];
+        [scheduledHost.queues[scheduledTask.priority] removeObjectIdenticalTo:scheduledTask];
+        scheduledTask.priority = priority;
+        [scheduledHost.queues[priority] addObject:scheduledTask];
+        return YES;
+    }
+}
+
+- (BOOL)cancelQueuedTask:(NSURLSessionTask *)task
+{
+    [http_request throwIfNil:task withName:@"task"];
+
+    @synchronized(self)
+    {
+        http_request_scheduled_task *scheduledTask = [_queuedTasks objectForKey:task];
+        if (!scheduledTask)
+        {
+            return NO;
+        }
+
+        [[self scheduledHost:scheduledTask.host].queues[scheduledTask.priority] removeObjectIdenticalTo:scheduledTask];
+        [_queuedTasks removeObjectForKey:task];
+    }
+
+    [task cancel];
+    return YES;
+}
+
+- (NSUInteger)queuedCount
+{
+    @synchronized(self)
+    {
+        return _queuedTasks.count;
+    }
+}
+
+- (NSUInteger)queuedCountForPriority:(http_request_priority)priority
+{
+    @synchronized(self)
+    {
+        NSUInteger count = 0;
+        for (http_request_scheduled_host *scheduledHost in [_hosts allValues])
+        {
+            count += priority >= 0 && priority < kPriorityCount ? [scheduledHost.queues[priority] count] : 0;
+        }
+
+        return count;
+    }
+}
+
+- (NSUInteger)queuedCountForHost:(NSString *)host
+{
+    [http_request throwIfNil:host withName:@"host"];
+
+    @synchronized(self)
+    {
+        NSUInteger count = 0;
+        for (NSMutableArray *queue in [[_hosts objectForKey:[host lowercaseString]] queues])
+        {
+            count += queue.count;
+        }
+
+        return count;
+    }
+}
+
+- (NSUInteger)runningCountForHost:(NSString *)host
+{
+    [http_request throwIfNil:host withName:@"host"];
+
+    @synchronized(self)
+    {
+        return [[_hosts objectForKey:[host lowercaseString]] runningCount];
+    }
+}
+
+- (NSTimeInterval)averageWaitTimeForPriority:(http_request_priority)priority
+{
+    @synchronized(self)
+    {
+        if (priority < 0 || priority >= kPriorityCount || _startedCounts[priority] == 0)
+        {
+            return 0;
+        }
+
+        return _totalWaitTimes[priority] / _startedCounts[priority];
+    }
+}
+
+- (NSTimeInterval)maxWaitTimeForPriority:(http_request_priority)priority
+{
+    @synchronized(self)
+    {
+        return priority >= 0 && priority < kPriorityCount ? _maxWaitTimes[priority] : 0;
+    }
+}
+
+- (void)scheduleTask:(NSURLSessionTask *)task
+        withPriority:(http_request_priority)priority
+            onResume:(void (^)(void))resumeCallback
+{
+    [http_request throwIfNil:task withName:@"task"];
+
+    http_request_scheduled_task *scheduledTask = [http_request_scheduled_task new];
+    scheduledTask.task = task;
+    scheduledTask.host = [http_request_scheduler hostForTask:task];
+    scheduledTask.priority = priority >= 0 && priority < kPriorityCount ? priority : http_request_priority_default;
+    scheduledTask.enqueueTime = CFAbsoluteTimeGetCurrent();
+    scheduledTask.resumeCallback = resumeCallback;
+    NSArray *startableTasks = nil;
+    @synchronized(self)
+    {
+        [[self scheduledHost:scheduledTask.host].queues[scheduledTask.priority] addObject:scheduledTask];
+        [_queuedTasks setObject:scheduledTask forKey:task];
+        startableTasks = [self dequeueStartableTasksOfHost:scheduledTask.host];
+    }
+
+    [self startScheduledTasks:startableTasks];
+}
+
+- (void)taskDidComplete:(NSURLSessionTask *)task
+{
+    [http_request throwIfNil:task withName:@"task"];
+
+    NSArray *startableTasks = nil;
+    @synchronized(self)
+    {
+        // A queued task only completes when it was cancelled before it started.
+        http_request_scheduled_task *scheduledTask = [_queuedTasks objectForKey:task];
+        if (scheduledTask)
+        {
+            [[self scheduledHost:scheduledTask.host].queues[scheduledTask.priority] removeObjectIdenticalTo:scheduledTask];
+            [_queuedTasks removeObjectForKey:task];
+            return;
+        }
+
+        NSString *host = [_runningTasks objectForKey:task];
+        if (!host)
+        {
+            return;
+        }
+
+        [_runningTasks removeObjectForKey:task];
+        http_request_scheduled_host *scheduledHost = [self scheduledHost:host];
+        scheduledHost.runningCount--;
+        startableTasks = [self dequeueStartableTasksOfHost:host];
+    }
+
+    [self startScheduledTasks:startableTasks];
+}
+
+#pragma mark - Internal API
+
++ (NSString *)hostForTask:(NSURLSessionTask *)task
+{
+    NSString *host = [task.originalRequest.URL host];
+    return host ? [host lowercaseString] : @"";
+}
+
+- (http_request_scheduled_host *)scheduledHost:(NSString *)host
+{
+    http_request_scheduled_host *scheduledHost = [_hosts objectForKey:host];
+    if (!scheduledHost)
+    {
+        scheduledHost = [http_request_scheduled_host new];
+        scheduledHost.queues = [NSMutableArray arrayWithCapacity:kPriorityCount];
+        for (NSUInteger priority = 0; priority < kPriorityCount; priority++)
+        {
+            [scheduledHost.queues addObject:[NSMutableArray new]];
+        }
+
+        [_hosts setObject:scheduledHost forKey:host];
+    }
+
+    return scheduledHost;
+}
+
+- (NSArray *)dequeueStartableTasksOfHost:(NSString *)host
+{
+    NSMutableArray *startableTasks = [NSMutableArray new];
+    http_request_scheduled_host *scheduledHost = [self scheduledHost:host];
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    for (NSMutableArray *queue in scheduledHost.queues)
+    {
+        while (queue.count > 0 && scheduledHost.runningCount < _maxConcurrentRequestsPerHost)
+        {
+            http_request_scheduled_task *scheduledTask = queue[0];
+            [queue removeObjectAtIndex:0];
+            [_queuedTasks removeObjectForKey:scheduledTask.task];
+            [_runningTasks setObject:host forKey:scheduledTask.task];
+            scheduledHost.runningCount++;
+
+            NSTimeInterval waitTime = now - scheduledTask.enqueueTime;
+            _startedCounts[scheduledTask.priority]++;
+            _totalWaitTimes[scheduledTask.priority] += waitTime;
+            _maxWaitTimes[scheduledTask.priority] = MAX(_maxWaitTimes[scheduledTask.priority], waitTime);
+            [startableTasks addObject:scheduledTask];
+        }
+    }
+
+    // Keeps the table of hosts from growing with every host ever contacted.
+    if (scheduledHost.runningCount == 0)
+    {
+        [_hosts removeObjectForKey:host];
+    }
+
+    return startableTasks;
+}
+
+- (void)startScheduledTasks:(NSArray *)scheduledTasks
+{
+    for (http_request_scheduled_task *scheduledTask in scheduledTasks)
+    {
+        if (scheduledTask.resumeCallback)
+        {
+            scheduledTask.resumeCallback();
+        }
+
+        [scheduledTask.task resume];
+    }
+}
+
+#pragma mark - Initialization
+
+- (id)init
+{
+    return [self initWithMaxConcurrentRequestsPerHost:kDefaultMaxConcurrentRequestsPerHost];
+}
+
+- (id)initWithMaxConcurrentRequestsPerHost:(NSUInteger)maxConcurrentRequestsPerHost
+{
+    self = [super init];
+    if (self)
+    {
+        _maxConcurrentRequestsPerHost = MAX(maxConcurrentRequestsPerHost, (NSUInteger)1);
+        _hosts = [NSMutableDictionary new];
+        _queuedTasks = [NSMapTable strongToStrongObjectsMapTable];
+        _runningTasks = [NSMapTable strongToStrongObjectsMapTable];
+    }
+
+    return self;
+}
+
+@end
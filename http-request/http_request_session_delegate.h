@@ -0,0 +1,85 @@
+//
+//  http_request_session_delegate.h
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  The set of callbacks for a single task which are driven by the session delegate.
+ */
+@interface http_request_task_handler : NSObject
+
+/**
+ *  The callback called upon receiving the response headers; returns whether or not to continue loading the body.
+ */
+@property (copy) BOOL (^onResponse)(NSURLResponse *);
+
+/**
+ *  The callback called upon receiving a chunk of the response body.
+ */
+@property (copy) void (^onData)(NSData *);
+
+/**
+ *  The callback called upon sending a chunk of the request body; passes the bytes sent so far and the expected total,
+ *  or NSURLSessionTransferSizeUnknown.
+ */
+@property (copy) void (^onSendProgress)(int64_t, int64_t);
+
+/**
+ *  The stream from which the body of a streamed upload task is read. Handed to the task once.
+ */
+@property (strong) NSInputStream *bodyStream;
+
+/**
+ *  The callback called as a download task writes the response body; passes the bytes written so far and the expected
+ *  total, or NSURLSessionTransferSizeUnknown.
+ */
+@property (copy) void (^onDownloadProgress)(int64_t, int64_t);
+
+/**
+ *  The callback called once a download task finished writing the response body; passes the location of the file,
+ *  which is deleted as soon as the callback returns.
+ */
+@property (copy) void (^onDownloaded)(NSURL *);
+
+/**
+ *  The callback called upon task completion; passes the error, if any.
+ */
+@property (copy) void (^onComplete)(NSError *);
+
+@end
+
+/**
+ *  The session delegate which routes the session events to the handler registered for each task.
+ */
+@interface http_request_session_delegate : NSObject <NSURLSessionDataDelegate, NSURLSessionDownloadDelegate>
+
+/**
+ *  Registers the handler for the provided task.
+ *
+ *  @param handler The handler to call for the task events. Must not be nil.
+ *  @param task    The task to register the handler for. Must not be nil.
+ */
+- (void)setHandler:(http_request_task_handler *)handler forTask:(NSURLSessionTask *)task;
+
+/**
+ *  Retrieves the handler registered for the provided task.
+ *
+ *  @param task The task whose handler to retrieve. Must not be nil.
+ *
+ *  @return The registered handler; otherwise, nil.
+ */
+- (http_request_task_handler *)handlerForTask:(NSURLSessionTask *)task;
+
+/**
+ *  Unregisters the handler for the provided task.
+ *
+ *  @param task The task whose handler to unregister. Must not be nil.
+ */
+- (void)removeHandlerForTask:(NSURLSessionTask *)task;
+
+@end
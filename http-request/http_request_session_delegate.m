@@ -0,0 +1,160 @@
+//
+//  http_request_session_delegate.m
+//  http-request
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request_session_delegate.h"
+
+@implementation http_request_task_handler
+@end
+
+@interface http_request_session_delegate()
+{
+    NSMutableDictionary *_handlers;
+}
+
+@end
+
+@implementation http_request_session_delegate
+
+#pragma mark - Public API
+
+- (void)setHandler:(http_request_task_handler *)handler forTask:(NSURLSessionTask *)task
+{
+    @synchronized(_handlers)
+    {
+        [_handlers setObject:handler forKey:@(task.taskIdentifier)];
+    }
+}
+
+- (http_request_task_handler *)handlerForTask:(NSURLSessionTask *)task
+{
+    @synchronized(_handlers)
+    {
+        return [_handlers objectForKey:@(task.taskIdentifier)];
+    }
+}
+
+- (void)removeHandlerForTask:(NSURLSessionTask *)task
+{
+    @synchronized(_handlers)
+    {
+        [_handlers removeObjectForKey:@(task.taskIdentifier)];
+    }
+}
+
+#pragma mark - NSURLSessionDataDelegate
+
+- (void)URLSession:(NSURLSession *)session
+          dataTask:(NSURLSessionDataTask *)dataTask
+didReceiveResponse:(NSURLResponse *)response
+ completionHandler:(void (^)(NSURLSessionResponseDisposition))completionHandler
+{
+    http_request_task_handler *handler = [self handlerForTask:dataTask];
+    BOOL proceed = YES;
+    if (handler.onResponse)
+    {
+        proceed = handler.onResponse(response);
+    }
+
+    completionHandler(proceed ? NSURLSessionResponseAllow : NSURLSessionResponseCancel);
+}
+
+- (void)URLSession:(NSURLSession *)session dataTask:(NSURLSessionDataTask *)dataTask didReceiveData:(NSData *)data
+{
+    http_request_task_handler *handler = [self handlerForTask:dataTask];
+    if (handler.onData)
+    {
+        handler.onData(data);
+    }
+}
+
+- (void)URLSession:(NSURLSession *)session
+                task:(NSURLSessionTask *)task
+     didSendBodyData:(int64_t)bytesSent
+      totalBytesSent:(int64_t)totalBytesSent
+totalBytesExpectedToSend:(int64_t)totalBytesExpectedToSend
+{
+    http_request_task_handler *handler = [self handlerForTask:task];
+    if (handler.onSendProgress)
+    {
+        handler.onSendProgress(totalBytesSent, totalBytesExpectedToSend);
+    }
+}
+
+- (void)URLSession:(NSURLSession *)session
+              task:(NSURLSessionTask *)task
+ needNewBodyStream:(void (^)(NSInputStream *))completionHandler
+{
+    // A stream can only be read once: a second request for it (e.g. upon a redirect) fails the task.
+    http_request_task_handler *handler = [self handlerForTask:task];
+    NSInputStream *bodyStream = handler.bodyStream;
+    handler.bodyStream = nil;
+    completionHandler(bodyStream);
+}
+
+- (void)URLSession:(NSURLSession *)session task:(NSURLSessionTask *)task didCompleteWithError:(NSError *)error
+{
+    http_request_task_handler *handler = [self handlerForTask:task];
+    [self removeHandlerForTask:task];
+    if (handler.onComplete)
+    {
+        handler.onComplete(error);
+    }
+}
+
+#pragma mark - NSURLSessionDownloadDelegate
+
+- (void)URLSession:(NSURLSession *)session
+      downloadTask:(NSURLSessionDownloadTask *)downloadTask
+didFinishDownloadingToURL:(NSURL *)location
+{
+    http_request_task_handler *handler = [self handlerForTask:downloadTask];
+    if (handler.onDownloaded)
+    {
+        handler.onDownloaded(location);
+    }
+}
+
+- (void)URLSession:(NSURLSession *)session
+      downloadTask:(NSURLSessionDownloadTask *)downloadTask
+      didWriteData:(int64_t)bytesWritten
+ totalBytesWritten:(int64_t)totalBytesWritten
+totalBytesExpectedToWrite:(int64_t)totalBytesExpectedToWrite
+{
+    http_request_task_handler *handler = [self handlerForTask:downloadTask];
+    if (handler.onDownloadProgress)
+    {
+        handler.onDownloadProgress(totalBytesWritten, totalBytesExpectedToWrite);
+    }
+}
+
+- (void)URLSession:(NSURLSession *)session
+      downloadTask:(NSURLSessionDownloadTask *)downloadTask
+ didResumeAtOffset:(int64_t)fileOffset
+expectedTotalBytes:(int64_t)expectedTotalBytes
+{
+    http_request_task_handler *handler = [self handlerForTask:downloadTask];
+    if (handler.onDownloadProgress)
+    {
+        handler.onDownloadProgress(fileOffset, expectedTotalBytes);
+    }
+}
+
+#pragma mark - Initialization
+
+- (id)init
+{
+    self = [super init];
+    if (self)
+    {
+        _handlers = [NSMutableDictionary new];
+    }
+
+    return self;
+}
+
+@end
@@ -0,0 +1,396 @@
+//
+//  http_requestBenchmarks.m
+//  http-requestTests
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <XCTest/XCTest.h>
+#import <OHHTTPStubs/OHHTTPStubs.h>
+#import <libkern/OSAtomic.h>
+#import <pthread.h>
+#import "http_request.h"
+#import "http_request_loopback_server.h"
+
+// Benchmarks only run when this environment variable is set in the scheme, since they take minutes.
+#define kBenchmarkEnvironmentVariable   @"HTTP_REQUEST_BENCHMARKS"
+#define kBenchmarkConcurrency           8
+#define kMallocLogTypeAllocate          2
+
+// The allocation hook used by the malloc stack logging tools; called for every allocation in every zone.
+typedef void (malloc_logger_t)(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t result, uint32_t skip);
+extern malloc_logger_t *malloc_logger;
+
+static volatile int64_t _allocationCount = 0;
+static pthread_t _countedThread = NULL;
+
+static void count_allocation(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t result, uint32_t skip)
+{
+    // Once a thread is set, only its allocations are counted, e.g. the synchronous part of issuing a request.
+    if ((type & kMallocLogTypeAllocate) && (!_countedThread || pthread_equal(_countedThread, pthread_self())))
+    {
+        OSAtomicIncrement64(&_allocationCount);
+    }
+}
+
+@interface http_requestBenchmarks : XCTestCase
+
+@property (nonatomic, strong) http_request_loopback_server *server;
+
+@end
+
+@implementation http_requestBenchmarks
+
+- (BOOL)benchmarksEnabled
+{
+    return [[[NSProcessInfo processInfo] environment] objectForKey:kBenchmarkEnvironmentVariable] != nil;
+}
+
+- (void)runBenchmark:(NSString *)name
+          iterations:(NSUInteger)iterations
+         concurrency:(NSUInteger)concurrency
+           withBlock:(NSURLSessionDataTask *(^)(http_request *, void (^)(BOOL)))issue
+{
+    NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration defaultSessionConfiguration];
+    configuration.HTTPMaximumConnectionsPerHost = concurrency;
+    configuration.URLCache = nil;
+    http_request *httpRequest = [[http_request alloc] initWithConfiguration:configuration];
+
+    NSMutableArray *latencies = [NSMutableArray arrayWithCapacity:iterations];
+    __block NSUInteger failureCount = 0;
+    dispatch_semaphore_t slots = dispatch_semaphore_create(concurrency);
+    dispatch_group_t group = dispatch_group_create();
+    _allocationCount = 0;
+    malloc_logger = count_allocation;
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger iteration = 0; iteration < iterations; iteration++)
+    {
+        dispatch_semaphore_wait(slots, DISPATCH_TIME_FOREVER);
+        dispatch_group_enter(group);
+        CFAbsoluteTime issueTime = CFAbsoluteTimeGetCurrent();
+        issue(httpRequest, ^(BOOL succeeded)
+        {
+            NSTimeInterval latency = CFAbsoluteTimeGetCurrent() - issueTime;
+            @synchronized(latencies)
+            {
+                [latencies addObject:@(latency)];
+                failureCount += succeeded ? 0 : 1;
+            }
+
+            dispatch_semaphore_signal(slots);
+            dispatch_group_leave(group);
+        });
+    }
+
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    NSTimeInterval elapsed = CFAbsoluteTimeGetCurrent() - start;
+    malloc_logger = NULL;
+
+    NSArray *sortedLatencies = [latencies sortedArrayUsingSelector:@selector(compare:)];
+    double p50 = [sortedLatencies[(NSUInteger)(0.50 * (sortedLatencies.count - 1))] doubleValue] * 1000.0;
+    double p99 = [sortedLatencies[(NSUInteger)(0.99 * (sortedLatencies.count - 1))] doubleValue] * 1000.0;
+    NSLog(@"[benchmark] %@ x%lu concurrency %lu: %.1f req/s, p50 %.2f ms, p99 %.2f ms, %.0f allocations/request",
+          name,
+          (unsigned long)iterations,
+          (unsigned long)concurrency,
+          iterations / elapsed,
+          p50,
+          p99,
+          (double)_allocationCount / iterations);
+    XCTAssertEqual((NSUInteger)0, failureCount, @"%@: every request should have succeeded", name);
+}
+
+- (void)benchmarkGetWithType:(NSString *)type
+{
+    NSArray *sizes = @[@(1024), @(64 * 1024), @(1024 * 1024), @(100 * 1024 * 1024)];
+    NSArray *iterations = @[@(2000), @(500), @(100), @(4)];
+    for (NSUInteger index = 0; index < sizes.count; index++)
+    {
+        NSUInteger size = [sizes[index] unsignedIntegerValue];
+        NSURL *url = [self.server payloadUrlWithSize:size type:type];
+        [self
+         runBenchmark:[NSString stringWithFormat:@"GET %@ %lu bytes", type, (unsigned long)size]
+         iterations:[iterations[index] unsignedIntegerValue]
+         concurrency:kBenchmarkConcurrency
+         withBlock:^NSURLSessionDataTask *(http_request *httpRequest, void (^completed)(BOOL))
+         {
+             return [httpRequest
+                     getAsync:url
+                     onSuccess:^(NSURLResponse *response, id body)
+                     {
+                         completed(YES);
+                     }
+                     onError:^(NSError *error)
+                     {
+                         completed(NO);
+                     }];
+         }];
+    }
+}
+
+- (void)benchmarkUploadWithMethod:(NSString *)method
+{
+    NSArray *sizes = @[@(1024), @(64 * 1024), @(1024 * 1024)];
+    NSArray *iterations = @[@(2000), @(500), @(100)];
+    NSURL *url = [self.server uploadUrl];
+    for (NSString *type in @[@"json", @"binary"])
+    {
+        for (NSUInteger index = 0; index < sizes.count; index++)
+        {
+            NSUInteger size = [sizes[index] unsignedIntegerValue];
+            NSDictionary *json = nil;
+            NSData *data = nil;
+            if ([type isEqualToString:@"json"])
+            {
+                NSMutableArray *records = [NSMutableArray new];
+                for (NSUInteger record = 0; record < size / 48; record++)
+                {
+                    [records addObject:@{@"id":@(record), @"name":@"record", @"active":@YES}];
+                }
+
+                json = @{@"records":records};
+            }
+            else
+            {
+                NSMutableData *bytes = [NSMutableData dataWithLength:size];
+                arc4random_buf(bytes.mutableBytes, size);
+                data = bytes;
+            }
+
+            [self
+             runBenchmark:[NSString stringWithFormat:@"%@ %@ %lu bytes", method, type, (unsigned long)size]
+             iterations:[iterations[index] unsignedIntegerValue]
+             concurrency:kBenchmarkConcurrency
+             withBlock:^NSURLSessionDataTask *(http_request *httpRequest, void (^completed)(BOOL))
+             {
+                 void (^success)(NSURLResponse *, id) = ^(NSURLResponse *response, id body)
+                 {
+                     completed(YES);
+                 };
+                 void (^failure)(NSError *) = ^(NSError *error)
+                 {
+                     completed(NO);
+                 };
+                 if ([method isEqualToString:kPutHttpMethod])
+                 {
+                     return json
+                            ? [httpRequest putAsync:url withJson:json onSuccess:success onError:failure]
+                            : [httpRequest putAsync:url withBody:data onSuccess:success onError:failure];
+                 }
+                 else if ([method isEqualToString:kPatchHttpMethod])
+                 {
+                     return json
+                            ? [httpRequest patchAsync:url withJson:json onSuccess:success onError:failure]
+                            : [httpRequest patchAsync:url withBody:data onSuccess:success onError:failure];
+                 }
+
+                 return json
+                        ? [httpRequest postAsync:url withJson:json onSuccess:success onError:failure]
+                        : [httpRequest postAsync:url withBody:data onSuccess:success onError:failure];
+             }];
+        }
+    }
+}
+
+- (void)benchmarkJsonCodec:(id<http_request_json_codec>)codec named:(NSString *)name
+{
+    NSArray *sizes = @[@(64 * 1024), @(1024 * 1024), @(16 * 1024 * 1024)];
+    NSArray *iterations = @[@(500), @(50), @(5)];
+    for (NSUInteger index = 0; index < sizes.count; index++)
+    {
+        NSUInteger size = [sizes[index] unsignedIntegerValue];
+        NSMutableArray *items = [NSMutableArray new];
+        for (NSUInteger item = 0; item < size / 96; item++)
+        {
+            [items addObject:@{@"id":@(item), @"name":@"item", @"tags":@[@"a", @"b"], @"score":@(item * 0.5)}];
+        }
+
+        NSData *data = [NSJSONSerialization dataWithJSONObject:@{@"count":@(items.count), @"items":items} options:kNilOptions error:nil];
+        NSUInteger count = [iterations[index] unsignedIntegerValue];
+        NSUInteger failureCount = 0;
+        _allocationCount = 0;
+        malloc_logger = count_allocation;
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        for (NSUInteger iteration = 0; iteration < count; iteration++)
+        {
+            @autoreleasepool
+            {
+                // Reads a few fields, as a client only interested in the head of a large listing would.
+                NSError *error = nil;
+                id json = [codec decodeData:data error:&error];
+                id firstName = json[@"items"][0][@"name"];
+                failureCount += [json[@"count"] unsignedIntegerValue] == items.count && [firstName isEqual:@"item"] ? 0 : 1;
+            }
+        }
+
+        NSTimeInterval elapsed = CFAbsoluteTimeGetCurrent() - start;
+        malloc_logger = NULL;
+        NSLog(@"[benchmark] JSON %@ %lu bytes x%lu: %.2f ms/parse, %.0f allocations/parse",
+              name,
+              (unsigned long)data.length,
+              (unsigned long)count,
+              elapsed * 1000.0 / count,
+              (double)_allocationCount / count);
+        XCTAssertEqual((NSUInteger)0, failureCount, @"%@: every parse should have read the fields", name);
+    }
+}
+
+- (void)benchmarkIssuing:(NSString *)name withBlock:(NSURLSessionDataTask *(^)(http_request *, NSURL *))issue
+{
+    NSUInteger count = 10000;
+    http_request *httpRequest = [http_request new];
+    NSURL *url = [self.server uploadUrl];
+    NSUInteger failureCount = 0;
+    NSTimeInterval elapsed = 0;
+    _allocationCount = 0;
+    _countedThread = pthread_self();
+    malloc_logger = count_allocation;
+    for (NSUInteger iteration = 0; iteration < count; iteration++)
+    {
+        @autoreleasepool
+        {
+            // Only the call itself is measured: the task is cancelled right away so the network stays out of it.
+            CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+            NSURLSessionDataTask *task = issue(httpRequest, url);
+            elapsed += CFAbsoluteTimeGetCurrent() - start;
+            failureCount += task ? 0 : 1;
+            [task cancel];
+        }
+    }
+
+    malloc_logger = NULL;
+    _countedThread = NULL;
+    NSLog(@"[benchmark] issue %@ x%lu: %.2f us/request, %.1f allocations/request",
+          name,
+          (unsigned long)count,
+          elapsed * 1000000.0 / count,
+          (double)_allocationCount / count);
+    XCTAssertEqual((NSUInteger)0, failureCount, @"%@: every request should have been issued", name);
+}
+
+- (void)setUp
+{
+    [super setUp];
+    [OHHTTPStubs removeAllStubs];
+    self.server = [http_request_loopback_server new];
+    NSError *error = nil;
+    XCTAssertTrue([self.server start:&error], @"loopback server should have started: %@", error);
+}
+
+- (void)tearDown
+{
+    [self.server stop];
+    self.server = nil;
+    [super tearDown];
+}
+
+- (void)test_benchmark_get_json_payloads
+{
+    if ([self benchmarksEnabled])
+    {
+        [self benchmarkGetWithType:@"json"];
+    }
+}
+
+- (void)test_benchmark_get_text_payloads
+{
+    if ([self benchmarksEnabled])
+    {
+        [self benchmarkGetWithType:@"text"];
+    }
+}
+
+- (void)test_benchmark_get_binary_payloads
+{
+    if ([self benchmarksEnabled])
+    {
+        [self benchmarkGetWithType:@"binary"];
+    }
+}
+
+- (void)test_benchmark_post_payloads
+{
+    if ([self benchmarksEnabled])
+    {
+        [self benchmarkUploadWithMethod:kPostHttpMethod];
+    }
+}
+
+- (void)test_benchmark_put_payloads
+{
+    if ([self benchmarksEnabled])
+    {
+        [self benchmarkUploadWithMethod:kPutHttpMethod];
+    }
+}
+
+- (void)test_benchmark_patch_payloads
+{
+    if ([self benchmarksEnabled])
+    {
+        [self benchmarkUploadWithMethod:kPatchHttpMethod];
+    }
+}
+
+- (void)test_benchmark_json_codecs
+{
+    if ([self benchmarksEnabled])
+    {
+        [self benchmarkJsonCodec:[http_request_foundation_json_codec new] named:@"NSJSONSerialization"];
+        [self benchmarkJsonCodec:[http_request_lazy_json_codec new] named:@"lazy document"];
+    }
+}
+
+- (void)test_benchmark_request_building
+{
+    if ([self benchmarksEnabled])
+    {
+        // Only goes through the public verb overloads, so the same benchmark measures any revision of the library.
+        void (^success)(NSURLResponse *, id) = ^(NSURLResponse *response, id body)
+        {
+        };
+        void (^failure)(NSError *) = ^(NSError *error)
+        {
+        };
+        [self
+         benchmarkIssuing:@"getAsync"
+         withBlock:^NSURLSessionDataTask *(http_request *httpRequest, NSURL *url)
+         {
+             return [httpRequest getAsync:url onSuccess:success onError:failure];
+         }];
+
+        NSDictionary *json = @{@"key":@"value"};
+        [self
+         benchmarkIssuing:@"putAsync withJson"
+         withBlock:^NSURLSessionDataTask *(http_request *httpRequest, NSURL *url)
+         {
+             return [httpRequest putAsync:url withJson:json onSuccess:success onError:failure];
+         }];
+    }
+}
+
+- (void)test_that_loopback_server_serves_payloads_of_the_requested_size
+{
+    http_request *httpRequest = [http_request new];
+    dispatch_semaphore_t completed = dispatch_semaphore_create(0);
+    __block NSData *payload = nil;
+    [httpRequest
+     getAsync:[self.server payloadUrlWithSize:1024 type:@"binary"]
+     onSuccess:^(NSURLResponse *response, id body)
+     {
+         payload = body;
+         dispatch_semaphore_signal(completed);
+     }
+     onError:^(NSError *error)
+     {
+         dispatch_semaphore_signal(completed);
+     }];
+
+    dispatch_semaphore_wait(completed, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC));
+    XCTAssertEqual((NSUInteger)1024, payload.length, @"payload size mismatch");
+    XCTAssertEqual((NSUInteger)1, self.server.requestCount, @"request count mismatch");
+}
+
+@end
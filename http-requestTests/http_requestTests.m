@@ -41,6 +41,21 @@ static NSArray *_methods    = nil;
     }
 }
 
+- (NSData *)readStream:(NSInputStream *)stream
+{
+    NSMutableData *data = [NSMutableData new];
+    uint8_t buffer[1024];
+    NSInteger readLength = 0;
+    [stream open];
+    while ((readLength = [stream read:buffer maxLength:sizeof(buffer)]) > 0)
+    {
+        [data appendBytes:buffer length:readLength];
+    }
+
+    [stream close];
+    return readLength < 0 ? nil : data;
+}
+
 - (void)setUp
 {
     [super setUp];
@@ -3571,4 +3586,2672 @@ static NSArray *_methods    = nil;
      }];
 }
 
+- (void)test_that_http_request_streamAsync_call_chunk_and_complete_blocks
+{
+    NSMutableString *expectedBody = [NSMutableString new];
+    for (int index = 0; index < 4096; index++)
+    {
+        [expectedBody appendFormat:@"{\"index\": %d}\n", index];
+    }
+
+    NSData *expectedData = [expectedBody dataUsingEncoding:NSUTF8StringEncoding];
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         return [OHHTTPStubsResponse
+                 responseWithData:expectedData
+                 statusCode:200
+                 headers:@{@"Content-Type":@"application/x-ndjson"}];
+     }];
+
+    [self
+     runTestWithBlock:^
+     {
+         NSMutableData *actualData = [NSMutableData new];
+         http_request *httpRequest = [http_request new];
+         httpRequest.streamBufferLimit = 1024;
+         NSMutableURLRequest *request = [http_request constructRequest:kGetHttpMethod withUrl:_testUrl withHeaders:nil withBody:nil];
+         NSURLSessionDataTask *task = [httpRequest
+                                       streamAsync:request
+                                       onChunk:^(NSData *chunk)
+                                       {
+                                           [actualData appendData:chunk];
+                                       }
+                                       onComplete:^(NSURLResponse *response)
+                                       {
+                                           [self blockTestCompletedWithBlock:^
+                                            {
+                                                XCTAssertNotNil(response, @"response should not be nil");
+                                                XCTAssertEqualObjects(expectedData, actualData, @"streamed body mismatch");
+                                            }];
+                                       }
+                                       onError:^(NSError *error)
+                                       {
+                                           [self blockTestCompletedWithBlock:^
+                                            {
+                                                XCTFail(@"error block should not have been called");
+                                            }];
+                                       }];
+         XCTAssertNotNil(task, @"returned task should not be nil");
+     }];
+}
+
+- (void)test_that_http_request_streamAsync_call_error_block_by_status_code_error
+{
+    NSString *expectedKey = @"Error";
+    NSString *expectedValue = @"This is an error!";
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         NSString *responseString = [NSString stringWithFormat:@"{\"%@\": \"%@\"}", expectedKey, expectedValue];
+         NSData *responseData = [responseString dataUsingEncoding:NSUTF8StringEncoding];
+         return [OHHTTPStubsResponse
+                 responseWithData:responseData
+                 statusCode:500
+                 headers:@{@"Content-Type":@"application/json"}];
+     }];
+
+    [self
+     runTestWithBlock:^
+     {
+         http_request *httpRequest = [http_request new];
+         NSMutableURLRequest *request = [http_request constructRequest:kGetHttpMethod withUrl:_testUrl withHeaders:nil withBody:nil];
+         NSURLSessionDataTask *task = [httpRequest
+                                       streamAsync:request
+                                       onChunk:^(NSData *chunk)
+                                       {
+                                           XCTFail(@"chunk block should not have been called");
+                                       }
+                                       onComplete:^(NSURLResponse *response)
+                                       {
+                                           [self blockTestCompletedWithBlock:^
+                                            {
+                                                XCTFail(@"complete block should not have been called");
+                                            }];
+                                       }
+                                       onError:^(NSError *error)
+                                       {
+                                           [self blockTestCompletedWithBlock:^
+                                            {
+                                                XCTAssertNotNil(error, @"error should not be nil");
+                                                NSHTTPURLResponse *httpResponse = error.userInfo[@"Response"];
+                                                id body = error.userInfo[@"Body"];
+                                                XCTAssertEqual(500, httpResponse.statusCode, @"status code did not equal 500");
+                                                XCTAssertTrue([body isKindOfClass:[NSDictionary class]], @"body should be NSDictionary");
+                                                XCTAssertEqualObjects(expectedValue, [body objectForKey:expectedKey], @"body value mismatch");
+                                            }];
+                                       }];
+         XCTAssertNotNil(task, @"returned task should not be nil");
+     }];
+}
+
+- (void)test_that_http_request_json_stream_parser_emits_array_records_across_chunks
+{
+    NSString *json = @" [ {\"key\": \"va]l,ue\"}, [1, [2, 3]], \"str\\\"ing\", 42, null ] ";
+    NSData *data = [json dataUsingEncoding:NSUTF8StringEncoding];
+    NSArray *expectedRecords = [NSJSONSerialization JSONObjectWithData:data options:kNilOptions error:nil];
+    for (NSUInteger chunkLength = 1; chunkLength <= data.length; chunkLength++)
+    {
+        NSMutableArray *actualRecords = [NSMutableArray new];
+        http_request_json_stream_parser *parser = [[http_request_json_stream_parser alloc]
+                                                   initWithFormat:http_request_json_stream_format_array
+                                                   onRecord:^(id record)
+                                                   {
+                                                       [actualRecords addObject:record];
+                                                   }];
+        NSError *error = nil;
+        for (NSUInteger offset = 0; offset < data.length; offset += chunkLength)
+        {
+            NSData *chunk = [data subdataWithRange:NSMakeRange(offset, MIN(chunkLength, data.length - offset))];
+            XCTAssertTrue([parser appendData:chunk error:&error], @"chunk should be parsed");
+            XCTAssertNil(error, @"parsing error should be nil");
+        }
+
+        XCTAssertTrue([parser finish:&error], @"parser should finish");
+        XCTAssertEqualObjects(expectedRecords, actualRecords, @"records mismatch for chunk length %lu", (unsigned long)chunkLength);
+    }
+}
+
+- (void)test_that_http_request_json_stream_parser_emits_ndjson_records_and_reports_errors
+{
+    NSMutableArray *records = [NSMutableArray new];
+    http_request_json_stream_parser *parser = [[http_request_json_stream_parser alloc]
+                                               initWithFormat:http_request_json_stream_format_ndjson
+                                               onRecord:^(id record)
+                                               {
+                                                   [records addObject:record];
+                                               }];
+    NSError *error = nil;
+    XCTAssertTrue([parser appendData:[@"{\"a\": 1}\n\n{\"b\"" dataUsingEncoding:NSUTF8StringEncoding] error:&error], @"chunk should be parsed");
+    XCTAssertEqual((NSUInteger)1, records.count, @"first record should be emitted before the body completes");
+    XCTAssertTrue([parser appendData:[@": 2}\r\n{\"c\": 3}" dataUsingEncoding:NSUTF8StringEncoding] error:&error], @"chunk should be parsed");
+    XCTAssertTrue([parser finish:&error], @"parser should finish");
+    XCTAssertEqual((NSUInteger)3, parser.recordCount, @"record count mismatch");
+    XCTAssertEqualObjects(@3, records[2][@"c"], @"last record mismatch");
+    XCTAssertFalse([parser appendData:[@"{oops}\n" dataUsingEncoding:NSUTF8StringEncoding] error:&error], @"invalid record should fail");
+    XCTAssertEqual(-3, error.code, @"invalid error code, expected -3");
+}
+
+- (void)test_that_http_request_recordStreamAsync_call_record_and_complete_blocks
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         NSData *responseData = [@"[{\"index\": 0}, {\"index\": 1}, {\"index\": 2}]" dataUsingEncoding:NSUTF8StringEncoding];
+         return [OHHTTPStubsResponse
+                 responseWithData:responseData
+                 statusCode:200
+                 headers:@{@"Content-Type":@"application/json; charset=utf-8"}];
+     }];
+
+    [self
+     runTestWithBlock:^
+     {
+         NSMutableArray *records = [NSMutableArray new];
+         http_request *httpRequest = [http_request new];
+         NSMutableURLRequest *request = [http_request constructRequest:kGetHttpMethod withUrl:_testUrl withHeaders:nil withBody:nil];
+         NSURLSessionDataTask *task = [httpRequest
+                                       recordStreamAsync:request
+                                       onRecord:^(id record)
+                                       {
+                                           [records addObject:record];
+                                       }
+                                       onComplete:^(NSURLResponse *response)
+                                       {
+                                           [self blockTestCompletedWithBlock:^
+                                            {
+                                                XCTAssertEqual((NSUInteger)3, records.count, @"record count mismatch");
+                                                XCTAssertEqualObjects(@2, records[2][@"index"], @"record mismatch");
+                                            }];
+                                       }
+                                       onError:^(NSError *error)
+                                       {
+                                           [self blockTestCompletedWithBlock:^
+                                            {
+                                                XCTFail(@"error block should not have been called");
+                                            }];
+                                       }];
+         XCTAssertNotNil(task, @"returned task should not be nil");
+     }];
+}
+
+- (void)test_that_http_request_parses_on_parsing_queue_and_calls_back_on_callback_queue
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         NSData *responseData = [@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [OHHTTPStubsResponse
+                 responseWithData:responseData
+                 statusCode:200
+                 headers:@{@"Content-Type":@"application/json"}];
+     }];
+
+    [self
+     runTestWithBlock:^
+     {
+         http_request *httpRequest = [http_request new];
+         NSOperationQueue *parsingQueue = [NSOperationQueue new];
+         httpRequest.parsingQueue = parsingQueue;
+         httpRequest.callbackQueue = [NSOperationQueue mainQueue];
+         __block NSOperationQueue *actualParsingQueue = nil;
+         NSURLSessionDataTask *task = [httpRequest
+                                       issueAsync:[http_request constructRequest:kGetHttpMethod withUrl:_testUrl withHeaders:nil withBody:nil]
+                                       withBodyParser:^id (NSURLResponse *response, NSData *data, NSError *__autoreleasing *error)
+                                       {
+                                           actualParsingQueue = [NSOperationQueue currentQueue];
+                                           return [http_request parseBody:response withBody:data error:error];
+                                       }
+                                       withResponseValidation:nil
+                                       onSuccess:^(NSURLResponse *response, id body)
+                                       {
+                                           BOOL isMainThread = [NSThread isMainThread];
+                                           [self blockTestCompletedWithBlock:^
+                                            {
+                                                XCTAssertEqual(parsingQueue, actualParsingQueue, @"body should be parsed on the parsing queue");
+                                                XCTAssertTrue(isMainThread, @"success block should be called on the callback queue");
+                                                XCTAssertEqualObjects(@"value", body[@"key"], @"body mismatch");
+                                            }];
+                                       }
+                                       onError:^(NSError *error)
+                                       {
+                                           [self blockTestCompletedWithBlock:^
+                                            {
+                                                XCTFail(@"error block should not have been called");
+                                            }];
+                                       }];
+         XCTAssertNotNil(task, @"returned task should not be nil");
+     }];
+}
+
+- (void)test_that_http_request_without_callback_queue_calls_back_one_at_a_time
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         NSData *responseData = [@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [OHHTTPStubsResponse
+                 responseWithData:responseData
+                 statusCode:200
+                 headers:@{@"Content-Type":@"application/json"}];
+     }];
+
+    [self
+     runTestWithBlock:^
+     {
+         http_request *httpRequest = [http_request new];
+         NSUInteger requestCount = 8;
+         __block NSUInteger completedCount = 0;
+         __block NSUInteger runningCount = 0;
+         __block BOOL overlapped = NO;
+         NSObject *lock = [NSObject new];
+         for (NSUInteger i = 0; i < requestCount; i++)
+         {
+             [httpRequest
+              getAsync:_testUrl
+              withHeaders:nil
+              onSuccess:^(NSURLResponse *response, id body)
+              {
+                  @synchronized(lock)
+                  {
+                      overlapped = overlapped || runningCount > 0;
+                      runningCount++;
+                  }
+
+                  [NSThread sleepForTimeInterval:0.01];
+                  BOOL completed = NO;
+                  @synchronized(lock)
+                  {
+                      runningCount--;
+                      completed = ++completedCount == requestCount;
+                  }
+
+                  if (completed)
+                  {
+                      [self blockTestCompletedWithBlock:^
+                       {
+                           XCTAssertFalse(overlapped, @"callbacks should not have run concurrently");
+                       }];
+                  }
+              }
+              onError:^(NSError *error)
+              {
+                  [self blockTestCompletedWithBlock:^
+                   {
+                       XCTFail(@"error block should not have been called");
+                   }];
+              }];
+         }
+     }];
+}
+
+- (void)test_that_http_request_serves_fresh_cached_response_without_network
+{
+    __block NSUInteger requestCount = 0;
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         requestCount++;
+         NSData *responseData = [@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [OHHTTPStubsResponse
+                 responseWithData:responseData
+                 statusCode:200
+                 headers:@{@"Content-Type":@"application/json", @"Cache-Control":@"max-age=60"}];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    httpRequest.cache = [[http_request_cache alloc] initWithMemoryCapacity:kDefaultCacheMemoryCapacity diskCapacity:0 diskPath:nil];
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        [self
+         runTestWithBlock:^
+         {
+             NSURLSessionDataTask *task = [httpRequest
+                                           getAsync:_testUrl
+                                           onSuccess:^(NSURLResponse *response, id body)
+                                           {
+                                               [self blockTestCompletedWithBlock:^
+                                                {
+                                                    XCTAssertEqualObjects(@"value", body[@"key"], @"body mismatch");
+                                                }];
+                                           }
+                                           onError:^(NSError *error)
+                                           {
+                                               [self blockTestCompletedWithBlock:^
+                                                {
+                                                    XCTFail(@"error block should not have been called");
+                                                }];
+                                           }];
+             XCTAssertNotNil(task, @"returned task should not be nil");
+         }];
+    }
+
+    XCTAssertEqual((NSUInteger)1, requestCount, @"the second request should have been served from the cache");
+    XCTAssertEqual((NSUInteger)1, httpRequest.cache.hitCount, @"hit count mismatch");
+    XCTAssertEqual((NSUInteger)1, httpRequest.cache.missCount, @"miss count mismatch");
+}
+
+- (void)test_that_http_request_revalidates_stale_cached_response_with_etag
+{
+    NSString *etag = @"\"v1\"";
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         if ([etag isEqualToString:[request valueForHTTPHeaderField:@"If-None-Match"]])
+         {
+             return [OHHTTPStubsResponse responseWithData:[NSData data] statusCode:304 headers:@{@"ETag":etag}];
+         }
+
+         NSData *responseData = [@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [OHHTTPStubsResponse
+                 responseWithData:responseData
+                 statusCode:200
+                 headers:@{@"Content-Type":@"application/json", @"Cache-Control":@"no-cache", @"ETag":etag}];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    httpRequest.cache = [[http_request_cache alloc] initWithMemoryCapacity:kDefaultCacheMemoryCapacity diskCapacity:0 diskPath:nil];
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        [self
+         runTestWithBlock:^
+         {
+             [httpRequest
+              getAsync:_testUrl
+              onSuccess:^(NSURLResponse *response, id body)
+              {
+                  [self blockTestCompletedWithBlock:^
+                   {
+                       XCTAssertEqual(200, ((NSHTTPURLResponse *)response).statusCode, @"status code did not equal 200");
+                       XCTAssertEqualObjects(@"value", body[@"key"], @"body mismatch");
+                   }];
+              }
+              onError:^(NSError *error)
+              {
+                  [self blockTestCompletedWithBlock:^
+                   {
+                       XCTFail(@"error block should not have been called");
+                   }];
+              }];
+         }];
+    }
+
+    XCTAssertEqual((NSUInteger)0, httpRequest.cache.hitCount, @"hit count mismatch");
+    XCTAssertEqual((NSUInteger)1, httpRequest.cache.revalidationCount, @"revalidation count mismatch");
+    XCTAssertEqual((NSUInteger)1, httpRequest.cache.missCount, @"miss count mismatch");
+}
+
+- (void)test_that_http_request_coalesces_identical_in_flight_get_requests
+{
+    __block NSUInteger requestCount = 0;
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         requestCount++;
+         NSData *responseData = [@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [[OHHTTPStubsResponse
+                  responseWithData:responseData
+                  statusCode:200
+                  headers:@{@"Content-Type":@"application/json"}]
+                 requestTime:0.0 responseTime:0.5];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    httpRequest.coalescesRequests = YES;
+    __block NSUInteger successCount = 0;
+    [self
+     runTestWithBlock:^
+     {
+         for (int caller = 0; caller < 2; caller++)
+         {
+             [httpRequest
+              getAsync:_testUrl
+              onSuccess:^(NSURLResponse *response, id body)
+              {
+                  XCTAssertEqualObjects(@"value", body[@"key"], @"body mismatch");
+                  if (++successCount == 2)
+                  {
+                      [self blockTestCompletedWithBlock:nil];
+                  }
+              }
+              onError:^(NSError *error)
+              {
+                  [self blockTestCompletedWithBlock:^
+                   {
+                       XCTFail(@"error block should not have been called");
+                   }];
+              }];
+         }
+     }];
+
+    XCTAssertEqual((NSUInteger)1, requestCount, @"identical requests should have shared a single fetch");
+}
+
+- (void)test_that_http_request_cancelling_a_coalesced_caller_does_not_cancel_the_others
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         NSData *responseData = [@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [[OHHTTPStubsResponse
+                  responseWithData:responseData
+                  statusCode:200
+                  headers:@{@"Content-Type":@"application/json"}]
+                 requestTime:0.0 responseTime:0.5];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    httpRequest.coalescesRequests = YES;
+    __block NSError *cancelledError = nil;
+    [self
+     runTestWithBlock:^
+     {
+         NSURLSessionDataTask *cancelledTask = [httpRequest
+                                                getAsync:_testUrl
+                                                onSuccess:^(NSURLResponse *response, id body)
+                                                {
+                                                    XCTFail(@"success block of the cancelled caller should not have been called");
+                                                }
+                                                onError:^(NSError *error)
+                                                {
+                                                    cancelledError = error;
+                                                }];
+         [httpRequest
+          getAsync:_testUrl
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTAssertEqualObjects(@"value", body[@"key"], @"body mismatch");
+               }];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"error block should not have been called");
+               }];
+          }];
+         [cancelledTask cancel];
+     }];
+
+    XCTAssertEqual(NSURLErrorCancelled, cancelledError.code, @"the cancelled caller should have received a cancellation");
+}
+
+- (void)test_that_http_request_metrics_collector_reports_percentiles_per_method_and_host
+{
+    http_request_metrics_collector *collector = [http_request_metrics_collector new];
+    for (int index = 1; index <= 100; index++)
+    {
+        http_request_metrics *metrics = [http_request_metrics new];
+        metrics.method = kGetHttpMethod;
+        metrics.host = @"www.langholz.net";
+        metrics.bytesReceived = 10;
+        [metrics addDuration:index / 1000.0 toPhase:http_request_metrics_phase_network];
+        [collector recordMetrics:metrics];
+    }
+
+    NSTimeInterval median = [collector
+                             percentile:50
+                             ofPhase:http_request_metrics_phase_network
+                             forMethod:kGetHttpMethod
+                             host:@"www.langholz.net"];
+    NSTimeInterval tail = [collector
+                           percentile:99
+                           ofPhase:http_request_metrics_phase_network
+                           forMethod:kGetHttpMethod
+                           host:@"www.langholz.net"];
+    XCTAssertEqualWithAccuracy(0.050, median, 0.005, @"p50 mismatch");
+    XCTAssertEqualWithAccuracy(0.099, tail, 0.010, @"p99 mismatch");
+    XCTAssertEqual((NSUInteger)100, [collector requestCountForMethod:kGetHttpMethod host:@"www.langholz.net"], @"request count mismatch");
+    XCTAssertEqual(1000ULL, [collector bytesReceivedForMethod:kGetHttpMethod host:@"www.langholz.net"], @"bytes received mismatch");
+    XCTAssertEqual((NSUInteger)0, [collector requestCountForMethod:kPostHttpMethod host:@"www.langholz.net"], @"request count mismatch");
+}
+
+- (void)test_that_http_request_pushes_metrics_to_its_sink
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         NSData *responseData = [@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [OHHTTPStubsResponse
+                 responseWithData:responseData
+                 statusCode:200
+                 headers:@{@"Content-Type":@"application/json"}];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    http_request_metrics_collector *collector = [http_request_metrics_collector new];
+    httpRequest.metricsSink = collector;
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          getAsync:_testUrl
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              [self blockTestCompletedWithBlock:nil];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"error block should not have been called");
+               }];
+          }];
+     }];
+
+    // The sink is called once the callback returned.
+    NSDate *timeout = [NSDate dateWithTimeIntervalSinceNow:1];
+    while ([collector requestCountForMethod:kGetHttpMethod host:@"www.langholz.net"] == 0 && [timeout timeIntervalSinceNow] > 0)
+    {
+        CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0.01, YES);
+    }
+
+    XCTAssertEqual((NSUInteger)1, [collector requestCountForMethod:kGetHttpMethod host:@"www.langholz.net"], @"request count mismatch");
+    XCTAssertEqual(16ULL, [collector bytesReceivedForMethod:kGetHttpMethod host:@"www.langholz.net"], @"bytes received mismatch");
+    XCTAssertTrue([collector
+                   percentile:50
+                   ofPhase:http_request_metrics_phase_total
+                   forMethod:kGetHttpMethod
+                   host:@"www.langholz.net"] > 0, @"total duration should have been recorded");
+}
+
+- (void)test_that_http_request_batchAsync_delivers_results_in_order_and_calls_complete_block
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         // Earlier requests answer later so that completion order differs from request order.
+         NSInteger index = [[request.URL lastPathComponent] integerValue];
+         NSData *responseData = [[NSString stringWithFormat:@"{\"index\": %ld}", (long)index] dataUsingEncoding:NSUTF8StringEncoding];
+         return [[OHHTTPStubsResponse
+                  responseWithData:responseData
+                  statusCode:200
+                  headers:@{@"Content-Type":@"application/json"}]
+                 requestTime:0.0 responseTime:0.05 * (5 - index)];
+     }];
+
+    NSMutableArray *requests = [NSMutableArray new];
+    for (int index = 0; index < 5; index++)
+    {
+        NSURL *url = [_testUrl URLByAppendingPathComponent:[NSString stringWithFormat:@"%d", index]];
+        [requests addObject:[http_request constructRequest:kGetHttpMethod withUrl:url withHeaders:nil withBody:nil]];
+    }
+
+    http_request *httpRequest = [http_request new];
+    NSMutableArray *deliveredIndexes = [NSMutableArray new];
+    [self
+     runTestWithBlock:^
+     {
+         http_request_batch *batch = [httpRequest
+                                      batchAsync:requests
+                                      maxConcurrency:2
+                                      delivery:http_request_batch_delivery_in_order
+                                      onResult:^(http_request_batch_result *result)
+                                      {
+                                          [deliveredIndexes addObject:@(result.index)];
+                                      }
+                                      onComplete:^(NSArray *results)
+                                      {
+                                          [self blockTestCompletedWithBlock:^
+                                           {
+                                               XCTAssertEqual((NSUInteger)5, results.count, @"result count mismatch");
+                                               for (NSUInteger index = 0; index < results.count; index++)
+                                               {
+                                                   http_request_batch_result *result = results[index];
+                                                   XCTAssertNil(result.error, @"error should be nil");
+                                                   XCTAssertEqualObjects(@(index), result.body[@"index"], @"body mismatch");
+                                               }
+                                           }];
+                                      }];
+         XCTAssertEqual((NSUInteger)5, batch.count, @"batch count mismatch");
+     }];
+
+    NSArray *expectedIndexes = @[@0, @1, @2, @3, @4];
+    XCTAssertEqualObjects(expectedIndexes, deliveredIndexes, @"results should have been delivered in order");
+}
+
+- (void)test_that_http_request_batchAsync_reports_per_item_errors
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         int statusCode = [[request.URL lastPathComponent] isEqualToString:@"1"] ? 500 : 200;
+         return [OHHTTPStubsResponse responseWithData:[NSData data] statusCode:statusCode headers:nil];
+     }];
+
+    NSMutableArray *requests = [NSMutableArray new];
+    for (int index = 0; index < 3; index++)
+    {
+        NSURL *url = [_testUrl URLByAppendingPathComponent:[NSString stringWithFormat:@"%d", index]];
+        [requests addObject:[http_request constructRequest:kGetHttpMethod withUrl:url withHeaders:nil withBody:nil]];
+    }
+
+    http_request *httpRequest = [http_request new];
+    __block http_request_batch *batch = nil;
+    [self
+     runTestWithBlock:^
+     {
+         batch = [httpRequest
+                  batchAsync:requests
+                  maxConcurrency:0
+                  delivery:http_request_batch_delivery_as_completed
+                  onResult:nil
+                  onComplete:^(NSArray *results)
+                  {
+                      [self blockTestCompletedWithBlock:^
+                       {
+                           XCTAssertNil([results[0] error], @"error should be nil");
+                           XCTAssertNotNil([results[1] error], @"error should not be nil");
+                           XCTAssertNil([results[2] error], @"error should be nil");
+                       }];
+                  }];
+     }];
+
+    XCTAssertEqual((NSUInteger)3, batch.completedCount, @"completed count mismatch");
+    XCTAssertEqual((NSUInteger)1, batch.failedCount, @"failed count mismatch");
+}
+
+- (void)test_that_http_request_putAsync_with_file_call_success_block
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl] && [request.HTTPMethod isEqualToString:kPutHttpMethod];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         NSData *responseData = [@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [OHHTTPStubsResponse
+                 responseWithData:responseData
+                 statusCode:200
+                 headers:@{@"Content-Type":@"application/json"}];
+     }];
+
+    NSURL *fileUrl = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"http_request_upload.bin"]];
+    [[NSMutableData dataWithLength:64 * 1024] writeToURL:fileUrl atomically:YES];
+    http_request *httpRequest = [http_request new];
+    [self
+     runTestWithBlock:^
+     {
+         NSURLSessionUploadTask *task = [httpRequest
+                                         putAsync:_testUrl
+                                         withHeaders:nil
+                                         withFile:fileUrl
+                                         onProgress:nil
+                                         onSuccess:^(NSURLResponse *response, id body)
+                                         {
+                                             [self blockTestCompletedWithBlock:^
+                                              {
+                                                  XCTAssertEqual(200, ((NSHTTPURLResponse *)response).statusCode, @"status code did not equal 200");
+                                                  XCTAssertEqualObjects(@"value", body[@"key"], @"body mismatch");
+                                              }];
+                                         }
+                                         onError:^(NSError *error)
+                                         {
+                                             [self blockTestCompletedWithBlock:^
+                                              {
+                                                  XCTFail(@"error block should not have been called");
+                                              }];
+                                         }];
+         XCTAssertTrue([task isKindOfClass:[NSURLSessionUploadTask class]], @"returned task should be an upload task");
+     }];
+
+    [[NSFileManager defaultManager] removeItemAtURL:fileUrl error:nil];
+}
+
+- (void)test_that_http_request_postAsync_with_stream_and_bad_status_call_error_block
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl] && [request.HTTPMethod isEqualToString:kPostHttpMethod];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         return [OHHTTPStubsResponse responseWithData:[NSData data] statusCode:500 headers:nil];
+     }];
+
+    NSInputStream *stream = [NSInputStream inputStreamWithData:[@"hello world" dataUsingEncoding:NSUTF8StringEncoding]];
+    http_request *httpRequest = [http_request new];
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          postAsync:_testUrl
+          withHeaders:@{@"Content-Type":@"text/plain"}
+          withStream:stream
+          onProgress:nil
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"success block should not have been called");
+               }];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTAssertEqual(-1011, error.code, @"error code mismatch");
+               }];
+          }];
+     }];
+}
+
+- (void)test_that_http_request_downloadAsync_writes_the_body_to_file
+{
+    NSData *expectedData = [@"binary content" dataUsingEncoding:NSUTF8StringEncoding];
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         return [OHHTTPStubsResponse
+                 responseWithData:expectedData
+                 statusCode:200
+                 headers:@{@"Content-Type":@"application/octet-stream"}];
+     }];
+
+    NSURL *fileUrl = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"http_request_download.bin"]];
+    http_request *httpRequest = [http_request new];
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          downloadAsync:_testUrl
+          toFile:fileUrl
+          onProgress:nil
+          onSuccess:^(NSURLResponse *response, NSURL *downloadedUrl)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTAssertEqualObjects(fileUrl, downloadedUrl, @"file url mismatch");
+                   XCTAssertEqualObjects(expectedData, [NSData dataWithContentsOfURL:fileUrl], @"file content mismatch");
+               }];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"error block should not have been called");
+               }];
+          }];
+     }];
+
+    [[NSFileManager defaultManager] removeItemAtURL:fileUrl error:nil];
+}
+
+- (void)test_that_http_request_continueDownloadAsync_appends_the_requested_range
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         if ([[request valueForHTTPHeaderField:@"Range"] isEqualToString:@"bytes=6-"])
+         {
+             return [OHHTTPStubsResponse
+                     responseWithData:[@"world" dataUsingEncoding:NSUTF8StringEncoding]
+                     statusCode:206
+                     headers:@{@"Content-Range":@"bytes 6-10/11"}];
+         }
+
+         return [OHHTTPStubsResponse responseWithData:[NSData data] statusCode:416 headers:nil];
+     }];
+
+    NSURL *fileUrl = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"http_request_partial.txt"]];
+    [[@"hello " dataUsingEncoding:NSUTF8StringEncoding] writeToURL:fileUrl atomically:YES];
+    http_request *httpRequest = [http_request new];
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          continueDownloadAsync:_testUrl
+          toFile:fileUrl
+          onProgress:nil
+          onSuccess:^(NSURLResponse *response, NSURL *downloadedUrl)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   NSString *content = [NSString stringWithContentsOfURL:fileUrl encoding:NSUTF8StringEncoding error:nil];
+                   XCTAssertEqualObjects(@"hello world", content, @"file content mismatch");
+               }];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"error block should not have been called");
+               }];
+          }];
+     }];
+
+    [[NSFileManager defaultManager] removeItemAtURL:fileUrl error:nil];
+}
+
+- (void)test_that_http_request_retries_a_server_error_and_calls_success_block
+{
+    __block NSUInteger requestCount = 0;
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         int statusCode = ++requestCount == 1 ? 503 : 200;
+         NSData *responseData = [@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [OHHTTPStubsResponse
+                 responseWithData:responseData
+                 statusCode:statusCode
+                 headers:@{@"Content-Type":@"application/json"}];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    httpRequest.retryPolicy = [http_request_retry_policy new];
+    httpRequest.retryPolicy.baseDelay = 0.01;
+    httpRequest.retryPolicy.budget = nil;
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          getAsync:_testUrl
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTAssertEqual(200, ((NSHTTPURLResponse *)response).statusCode, @"status code did not equal 200");
+                   XCTAssertEqualObjects(@"value", body[@"key"], @"body mismatch");
+               }];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"error block should not have been called");
+               }];
+          }];
+     }];
+
+    XCTAssertEqual((NSUInteger)2, requestCount, @"the failed request should have been retried once");
+}
+
+- (void)test_that_http_request_does_not_retry_a_post_request_and_calls_error_block
+{
+    __block NSUInteger requestCount = 0;
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         requestCount++;
+         return [OHHTTPStubsResponse
+                 responseWithData:[NSData data]
+                 statusCode:503
+                 headers:@{@"Content-Type":@"text/plain"}];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    httpRequest.retryPolicy = [http_request_retry_policy new];
+    httpRequest.retryPolicy.baseDelay = 0.01;
+    httpRequest.retryPolicy.budget = nil;
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          postAsync:_testUrl
+          withBody:[@"{}" dataUsingEncoding:NSUTF8StringEncoding]
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"success block should not have been called");
+               }];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTAssertEqual((NSInteger)-1011, error.code, @"error code did not equal -1011");
+               }];
+          }];
+     }];
+
+    XCTAssertEqual((NSUInteger)1, requestCount, @"a non-idempotent request should not have been retried");
+}
+
+- (void)test_that_http_request_retry_budget_rejects_retries_once_exhausted
+{
+    http_request_retry_budget *budget = [[http_request_retry_budget alloc] initWithRetryRatio:0.5 maxBalance:1.0];
+    XCTAssertTrue([budget withdrawForRetry], @"the initial balance should allow a retry");
+    XCTAssertFalse([budget withdrawForRetry], @"the exhausted budget should reject the retry");
+    [budget depositForRequest];
+    [budget depositForRequest];
+    XCTAssertTrue([budget withdrawForRetry], @"two deposits should allow a retry");
+    XCTAssertEqual((NSUInteger)2, budget.retryCount, @"retry count mismatch");
+    XCTAssertEqual((NSUInteger)1, budget.rejectedRetryCount, @"rejected retry count mismatch");
+}
+
+- (void)test_that_http_request_scheduler_starts_queued_interactive_requests_before_background_ones
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         NSData *responseData = [@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [[OHHTTPStubsResponse
+                  responseWithData:responseData
+                  statusCode:200
+                  headers:@{@"Content-Type":@"application/json"}]
+                 requestTime:0.0 responseTime:0.2];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    httpRequest.scheduler = [[http_request_scheduler alloc] initWithMaxConcurrentRequestsPerHost:1];
+    NSMutableArray *completionOrder = [NSMutableArray new];
+    NSArray *names = @[@"running", @"background", @"interactive"];
+    NSArray *priorities = @[@(http_request_priority_background),
+                            @(http_request_priority_background),
+                            @(http_request_priority_interactive)];
+    [self
+     runTestWithBlock:^
+     {
+         for (NSUInteger index = 0; index < names.count; index++)
+         {
+             NSURL *url = [NSURL URLWithString:[NSString stringWithFormat:@"%@/%@", kTestUrl, names[index]]];
+             NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:url];
+             [http_request_scheduler setPriority:[priorities[index] integerValue] forRequest:request];
+             [httpRequest
+              issueAsync:request
+              withBodyParser:httpRequest.bodyParser
+              withResponseValidation:httpRequest.responseValidator
+              onSuccess:^(NSURLResponse *response, id body)
+              {
+                  @synchronized(completionOrder)
+                  {
+                      [completionOrder addObject:names[index]];
+                      if (completionOrder.count == names.count)
+                      {
+                          [self blockTestCompletedWithBlock:nil];
+                      }
+                  }
+              }
+              onError:^(NSError *error)
+              {
+                  [self blockTestCompletedWithBlock:^
+                   {
+                       XCTFail(@"error block should not have been called");
+                   }];
+              }];
+         }
+
+         XCTAssertEqual((NSUInteger)2, [httpRequest.scheduler queuedCountForHost:@"www.langholz.net"], @"queued count mismatch");
+         XCTAssertEqual((NSUInteger)1, [httpRequest.scheduler runningCountForHost:@"www.langholz.net"], @"running count mismatch");
+     }];
+
+    NSArray *expectedOrder = @[@"running", @"interactive", @"background"];
+    XCTAssertEqualObjects(expectedOrder, completionOrder, @"the interactive request should have started first");
+    XCTAssertTrue([httpRequest.scheduler averageWaitTimeForPriority:http_request_priority_background] > 0,
+                  @"the queued background request should have waited");
+}
+
+- (void)test_that_http_request_scheduler_cancelling_a_queued_request_calls_error_block
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         NSData *responseData = [@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [[OHHTTPStubsResponse
+                  responseWithData:responseData
+                  statusCode:200
+                  headers:@{@"Content-Type":@"application/json"}]
+                 requestTime:0.0 responseTime:0.2];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    httpRequest.scheduler = [[http_request_scheduler alloc] initWithMaxConcurrentRequestsPerHost:1];
+    __block NSUInteger completedCount = 0;
+    __block NSError *cancellationError = nil;
+    [self
+     runTestWithBlock:^
+     {
+         void (^completed)(void) = ^
+         {
+             @synchronized(self)
+             {
+                 if (++completedCount == 2)
+                 {
+                     [self blockTestCompletedWithBlock:nil];
+                 }
+             }
+         };
+         [httpRequest
+          getAsync:_testUrl
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              completed();
+          }
+          onError:^(NSError *error)
+          {
+              completed();
+          }];
+         NSURLSessionDataTask *queuedTask = [httpRequest
+                                             getAsync:_testUrl
+                                             onSuccess:^(NSURLResponse *response, id body)
+                                             {
+                                                 completed();
+                                             }
+                                             onError:^(NSError *error)
+                                             {
+                                                 cancellationError = error;
+                                                 completed();
+                                             }];
+         XCTAssertTrue([httpRequest.scheduler cancelQueuedTask:queuedTask], @"the second request should have been queued");
+         XCTAssertEqual((NSUInteger)0, [httpRequest.scheduler queuedCount], @"nothing should be left queued");
+     }];
+
+    XCTAssertNotNil(cancellationError, @"the queued request should have failed");
+    XCTAssertEqual((NSInteger)NSURLErrorCancelled, cancellationError.code, @"error code did not equal NSURLErrorCancelled");
+}
+
+- (void)test_that_http_request_compression_round_trips_gzip_and_deflate
+{
+    NSMutableString *json = [NSMutableString stringWithString:@"["];
+    for (int index = 0; index < 1000; index++)
+    {
+        [json appendFormat:@"%@{\"key\": \"value\", \"index\": %d}", index > 0 ? @"," : @"", index];
+    }
+
+    [json appendString:@"]"];
+    NSData *data = [json dataUsingEncoding:NSUTF8StringEncoding];
+    for (NSString *encoding in @[kGzipContentEncoding, kDeflateContentEncoding])
+    {
+        NSData *compressedData = [http_request_compression compressData:data withEncoding:encoding];
+        XCTAssertNotNil(compressedData, @"compressed data should not be nil");
+        XCTAssertTrue(compressedData.length * 4 < data.length, @"repetitive JSON should have compressed well");
+        XCTAssertEqualObjects(data, [http_request_compression decompressData:compressedData withEncoding:encoding], @"data mismatch");
+    }
+
+    XCTAssertNil([http_request_compression compressData:data withEncoding:@"br"], @"unsupported coding should return nil");
+
+    http_request_metrics *metrics = [http_request_metrics new];
+    metrics.uncompressedBytesSent = 400;
+    metrics.bytesSent = 100;
+    XCTAssertEqualWithAccuracy(4.0, [metrics requestCompressionRatio], 0.001, @"compression ratio mismatch");
+    XCTAssertEqualWithAccuracy(1.0, [metrics responseCompressionRatio], 0.001, @"compression ratio mismatch");
+}
+
+- (void)test_that_http_request_compresses_request_bodies_above_the_threshold
+{
+    NSMutableDictionary *contentEncodings = [NSMutableDictionary new];
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         @synchronized(contentEncodings)
+         {
+             NSString *contentEncoding = [request valueForHTTPHeaderField:@"Content-Encoding"];
+             [contentEncodings setObject:contentEncoding ?: @"identity" forKey:[request.URL lastPathComponent]];
+         }
+
+         NSData *responseData = [@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [OHHTTPStubsResponse
+                 responseWithData:responseData
+                 statusCode:200
+                 headers:@{@"Content-Type":@"application/json"}];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    httpRequest.requestContentEncoding = kGzipContentEncoding;
+    httpRequest.requestCompressionThreshold = 256;
+    NSMutableString *largeBody = [NSMutableString new];
+    while (largeBody.length < 1024)
+    {
+        [largeBody appendString:@"{\"key\": \"value\"}"];
+    }
+
+    NSDictionary *bodies = @{@"large":[largeBody dataUsingEncoding:NSUTF8StringEncoding],
+                             @"small":[@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding]};
+    __block NSUInteger completedCount = 0;
+    [self
+     runTestWithBlock:^
+     {
+         for (NSString *name in bodies)
+         {
+             NSURL *url = [NSURL URLWithString:[NSString stringWithFormat:@"%@/%@", kTestUrl, name]];
+             [httpRequest
+              postAsync:url
+              withBody:bodies[name]
+              onSuccess:^(NSURLResponse *response, id body)
+              {
+                  @synchronized(bodies)
+                  {
+                      if (++completedCount == bodies.count)
+                      {
+                          [self blockTestCompletedWithBlock:nil];
+                      }
+                  }
+              }
+              onError:^(NSError *error)
+              {
+                  [self blockTestCompletedWithBlock:^
+                   {
+                       XCTFail(@"error block should not have been called");
+                   }];
+              }];
+         }
+     }];
+
+    XCTAssertEqualObjects(@"gzip", contentEncodings[@"large"], @"the large body should have been compressed");
+    XCTAssertEqualObjects(@"identity", contentEncodings[@"small"], @"the small body should have been sent as is");
+}
+
+- (void)test_that_http_request_json_document_reads_values_lazily
+{
+    NSString *json = @" {\"name\": \"caf\\u00e9\", \"count\": 3, \"ratio\": -1.5e2, \"ok\": true, \"none\": null,"
+                     @" \"items\": [{\"id\": 1}, {\"id\": 2, \"tags\": [\"a\", \"b]\"]}], \"empty\": {}} ";
+    NSError *error = nil;
+    http_request_json_document *document = [http_request_json_document
+                                            documentWithData:[json dataUsingEncoding:NSUTF8StringEncoding]
+                                            error:&error];
+    XCTAssertNotNil(document, @"document should not be nil: %@", error);
+    XCTAssertEqual(http_request_json_type_object, document.type, @"type mismatch");
+    XCTAssertEqual((NSUInteger)7, [document count], @"count mismatch");
+    XCTAssertEqualObjects(@"café", document[@"name"], @"escaped string mismatch");
+    XCTAssertEqualObjects(@3, document[@"count"], @"integer mismatch");
+    XCTAssertEqualWithAccuracy(-150.0, [document[@"ratio"] doubleValue], 0.001, @"double mismatch");
+    XCTAssertEqualObjects(@YES, document[@"ok"], @"boolean mismatch");
+    XCTAssertEqualObjects([NSNull null], document[@"none"], @"null mismatch");
+    XCTAssertNil(document[@"missing"], @"missing key should be nil");
+    XCTAssertEqual((NSUInteger)2, [document[@"items"] count], @"array count mismatch");
+    XCTAssertEqualObjects(@2, document[@"items"][1][@"id"], @"nested value mismatch");
+    XCTAssertEqualObjects(@"b]", [document objectForKeyPath:@"items.1.tags.1"], @"key path mismatch");
+    XCTAssertEqual((NSUInteger)0, [document[@"empty"] count], @"empty object count mismatch");
+
+    NSDictionary *materialized = [document materialize:&error];
+    XCTAssertEqualObjects(@"café", materialized[@"name"], @"materialized value mismatch");
+
+    XCTAssertNil([http_request_json_document
+                  documentWithData:[@"{\"key\": [1, 2}" dataUsingEncoding:NSUTF8StringEncoding]
+                  error:&error], @"unbalanced document should be nil");
+    XCTAssertEqual((NSInteger)-3, error.code, @"error code did not equal -3");
+}
+
+- (void)test_that_http_request_parses_json_bodies_through_the_json_codec
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         NSData *responseData = [@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [OHHTTPStubsResponse
+                 responseWithData:responseData
+                 statusCode:200
+                 headers:@{@"Content-Type":@"application/json"}];
+     }];
+
+    [http_request setJsonCodec:[http_request_lazy_json_codec new]];
+    __block id parsedBody = nil;
+    [self
+     runTestWithBlock:^
+     {
+         http_request *httpRequest = [http_request new];
+         [httpRequest
+          getAsync:_testUrl
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              parsedBody = body;
+              [self blockTestCompletedWithBlock:nil];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"error block should not have been called");
+               }];
+          }];
+     }];
+    [http_request setJsonCodec:nil];
+
+    XCTAssertTrue([parsedBody isKindOfClass:[http_request_json_document class]], @"body should be a lazy document");
+    XCTAssertEqualObjects(@"value", parsedBody[@"key"], @"body mismatch");
+    XCTAssertTrue([[http_request jsonCodec] isKindOfClass:[http_request_foundation_json_codec class]], @"default codec should be restored");
+}
+
+- (void)test_that_http_request_binary_decoders_decode_messagepack_and_cbor
+{
+    const uint8_t msgpack[] = { 0x84, 0xa1, 'a', 0x01, 0xa1, 'b', 0x93, 0xc3, 0xc0, 0xa1, 'x', 0xa1, 'c', 0xfe,
+                                0xa1, 'd', 0xcb, 0x3f, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    const uint8_t cbor[] = { 0xa4, 0x61, 'a', 0x01, 0x61, 'b', 0x83, 0xf5, 0xf6, 0x61, 'x', 0x61, 'c', 0x21,
+                             0x61, 'd', 0xf9, 0x3e, 0x00 };
+    NSDictionary *expected = @{@"a":@1, @"b":@[@YES, [NSNull null], @"x"], @"c":@-2, @"d":@1.5};
+    NSError *error = nil;
+    id decoded = [http_request_msgpack_decoder decodeData:[NSData dataWithBytes:msgpack length:sizeof(msgpack)] error:&error];
+    XCTAssertEqualObjects(expected, decoded, @"MessagePack mismatch: %@", error);
+    decoded = [http_request_cbor_decoder decodeData:[NSData dataWithBytes:cbor length:sizeof(cbor)] error:&error];
+    XCTAssertEqualObjects(expected, decoded, @"CBOR mismatch: %@", error);
+
+    const uint8_t indefinite[] = { 0x9f, 0x01, 0x02, 0xff };
+    decoded = [http_request_cbor_decoder decodeData:[NSData dataWithBytes:indefinite length:sizeof(indefinite)] error:&error];
+    XCTAssertEqualObjects((@[@1, @2]), decoded, @"indefinite length array mismatch");
+
+    XCTAssertNil([http_request_msgpack_decoder decodeData:[NSData dataWithBytes:msgpack length:sizeof(msgpack) - 1] error:&error],
+                 @"truncated data should not decode");
+    XCTAssertEqual((NSInteger)-3, error.code, @"error code did not equal -3");
+}
+
+- (void)test_that_http_request_parses_bodies_by_media_type_regardless_of_parameters
+{
+    NSDictionary *contentTypes = @{@"json":@"Application/JSON; charset=utf-8",
+                                   @"vendor":@"application/vnd.api+json",
+                                   @"latin":@"text/html; charset=\"iso-8859-1\"",
+                                   @"proto":kApplicationProtobufContentType};
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         NSString *name = [request.URL lastPathComponent];
+         NSData *responseData = [name isEqualToString:@"latin"]
+                                ? [@"café" dataUsingEncoding:NSISOLatin1StringEncoding]
+                                : [@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [OHHTTPStubsResponse
+                 responseWithData:responseData
+                 statusCode:200
+                 headers:@{@"Content-Type":contentTypes[name]}];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    [httpRequest.parserRegistry
+     registerParser:^id (NSURLResponse *response, NSData *data, NSError *__autoreleasing *error)
+     {
+         // Stands in for a generated protobuf decoder.
+         *error = nil;
+         return @{@"decoded":@(data.length)};
+     }
+     forMediaType:kApplicationProtobufContentType];
+    NSMutableDictionary *bodies = [NSMutableDictionary new];
+    [self
+     runTestWithBlock:^
+     {
+         for (NSString *name in contentTypes)
+         {
+             NSURL *url = [NSURL URLWithString:[NSString stringWithFormat:@"%@/%@", kTestUrl, name]];
+             [httpRequest
+              getAsync:url
+              onSuccess:^(NSURLResponse *response, id body)
+              {
+                  @synchronized(bodies)
+                  {
+                      [bodies setObject:body forKey:name];
+                      if (bodies.count == contentTypes.count)
+                      {
+                          [self blockTestCompletedWithBlock:nil];
+                      }
+                  }
+              }
+              onError:^(NSError *error)
+              {
+                  [self blockTestCompletedWithBlock:^
+                   {
+                       XCTFail(@"error block should not have been called");
+                   }];
+              }];
+         }
+     }];
+
+    XCTAssertEqualObjects(@"value", bodies[@"json"][@"key"], @"JSON with parameters should have been parsed");
+    XCTAssertEqualObjects(@"value", bodies[@"vendor"][@"key"], @"+json suffix should have been parsed as JSON");
+    XCTAssertEqualObjects(@"café", bodies[@"latin"], @"text should have been decoded with its charset");
+    XCTAssertEqualObjects(@16, bodies[@"proto"][@"decoded"], @"registered parser should have been used");
+}
+
+- (void)test_that_http_request_future_then_chains_dependent_requests
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         NSString *json = [request.URL.path isEqualToString:@"/token"]
+                          ? @"{\"token\": \"secret\"}"
+                          : [NSString stringWithFormat:@"{\"authorization\": \"%@\"}", [request valueForHTTPHeaderField:@"Authorization"]];
+         return [OHHTTPStubsResponse
+                 responseWithData:[json dataUsingEncoding:NSUTF8StringEncoding]
+                 statusCode:200
+                 headers:@{@"Content-Type":@"application/json"}];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    NSURL *tokenUrl = [NSURL URLWithString:[NSString stringWithFormat:@"%@/token", kTestUrl]];
+    NSURL *resourceUrl = [NSURL URLWithString:[NSString stringWithFormat:@"%@/resource", kTestUrl]];
+    __block id resultBody = nil;
+    __block NSURLResponse *resultResponse = nil;
+    [self
+     runTestWithBlock:^
+     {
+         [[[httpRequest getFuture:tokenUrl withHeaders:nil]
+           then:^id(NSDictionary *body)
+           {
+               return [httpRequest getFuture:resourceUrl withHeaders:@{@"Authorization":body[@"token"]}];
+           }]
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              resultResponse = response;
+              resultBody = body;
+              [self blockTestCompletedWithBlock:nil];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:nil];
+          }];
+     }];
+
+    XCTAssertEqualObjects(@"secret", resultBody[@"authorization"], @"the second request should have used the token");
+    XCTAssertEqualObjects(resourceUrl, resultResponse.URL, @"the response should be the one of the second request");
+}
+
+- (void)test_that_http_request_future_timeout_cancels_the_request
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         NSData *responseData = [@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [[OHHTTPStubsResponse
+                  responseWithData:responseData
+                  statusCode:200
+                  headers:@{@"Content-Type":@"application/json"}]
+                 requestTime:0.0 responseTime:2.0];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    http_request_future *requestFuture = [httpRequest getFuture:_testUrl withHeaders:nil];
+    __block NSError *timeoutError = nil;
+    [self
+     runTestWithBlock:^
+     {
+         [[requestFuture timeout:0.1]
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              [self blockTestCompletedWithBlock:nil];
+          }
+          onError:^(NSError *error)
+          {
+              timeoutError = error;
+              [self blockTestCompletedWithBlock:nil];
+          }];
+     }];
+
+    XCTAssertEqual((NSInteger)NSURLErrorTimedOut, timeoutError.code, @"error code did not equal NSURLErrorTimedOut");
+    XCTAssertTrue(requestFuture.isCompleted, @"the request future should have been cancelled");
+    XCTAssertEqual((NSInteger)NSURLErrorCancelled, requestFuture.error.code, @"error code did not equal NSURLErrorCancelled");
+}
+
+- (void)test_that_http_request_future_all_and_race_combine_futures
+{
+    http_request_future *pending = [http_request_future new];
+    http_request_future *all = [http_request_future all:@[[http_request_future futureWithValue:@1],
+                                                          [http_request_future futureWithValue:nil],
+                                                          pending]];
+    XCTAssertFalse(all.isCompleted, @"all should wait for every future");
+    [pending fulfillWithValue:@3];
+    NSArray *expected = @[@1, [NSNull null], @3];
+    XCTAssertEqualObjects(expected, all.value, @"all should have kept the order of the futures");
+
+    http_request_future *loser = [http_request_future new];
+    http_request_future *winner = [http_request_future new];
+    http_request_future *race = [http_request_future race:@[loser, winner]];
+    NSError *error = [NSError errorWithDomain:kHttpRequestDomain code:-4 userInfo:nil];
+    [winner rejectWithError:error];
+    XCTAssertEqualObjects(error, race.error, @"race should have completed like the first future");
+    XCTAssertEqual((NSInteger)NSURLErrorCancelled, loser.error.code, @"the loser should have been cancelled");
+
+    http_request_future *recovered = [[http_request_future futureWithError:error] recover:^id(NSError *recoveredError)
+    {
+        return @"fallback";
+    }];
+    XCTAssertEqualObjects(@"fallback", recovered.value, @"recover should have replaced the error");
+}
+
+- (void)test_that_http_request_descriptor_builds_requests_sharing_its_headers
+{
+    NSDictionary *headers = @{@"Authorization":@"Bearer token"};
+    NSData *body = [@"body" dataUsingEncoding:NSUTF8StringEncoding];
+    http_request_descriptor *template = [http_request_descriptor
+                                         descriptorWithMethod:http_request_method_patch
+                                         url:_testUrl
+                                         headers:headers
+                                         body:nil];
+    NSURL *otherUrl = [NSURL URLWithString:[NSString stringWithFormat:@"%@/other", kTestUrl]];
+    http_request_descriptor *derived = [[template descriptorWithUrl:otherUrl] descriptorWithBody:body];
+    NSMutableURLRequest *request = [derived request];
+
+    XCTAssertEqualObjects(kPatchHttpMethod, request.HTTPMethod, @"method mismatch");
+    XCTAssertEqualObjects(otherUrl, request.URL, @"url mismatch");
+    XCTAssertEqualObjects(@"Bearer token", [request valueForHTTPHeaderField:@"Authorization"], @"header mismatch");
+    XCTAssertEqualObjects(body, request.HTTPBody, @"body mismatch");
+    XCTAssertTrue(template.headers == derived.headers, @"derived descriptors should share the header dictionary");
+    XCTAssertNil(template.body, @"deriving should not have changed the template");
+    XCTAssertEqualObjects(_testUrl, template.url, @"deriving should not have changed the template");
+    XCTAssertEqualObjects(kDeleteHttpMethod, [http_request_descriptor nameOfMethod:http_request_method_delete], @"method name mismatch");
+}
+
+- (void)test_that_http_request_send_serializes_the_body_of_a_descriptor
+{
+    __block NSString *receivedMethod = nil;
+    __block NSString *receivedHeader = nil;
+    __block id serializedBody = nil;
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         receivedMethod = request.HTTPMethod;
+         receivedHeader = [request valueForHTTPHeaderField:@"X-Trace"];
+         return [OHHTTPStubsResponse
+                 responseWithData:[@"{}" dataUsingEncoding:NSUTF8StringEncoding]
+                 statusCode:200
+                 headers:@{@"Content-Type":@"application/json"}];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    httpRequest.bodySerializer = ^NSData *(id body, NSError *__autoreleasing *error)
+    {
+        serializedBody = body;
+        return [http_request serializeBody:body error:error];
+    };
+    http_request_descriptor *descriptor = [http_request_descriptor
+                                           descriptorWithMethod:http_request_method_post
+                                           url:_testUrl
+                                           headers:@{@"X-Trace":@"1"}
+                                           body:nil];
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          sendAsync:descriptor
+          withBody:@{@"key":@"value"}
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              [self blockTestCompletedWithBlock:nil];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:nil];
+          }];
+     }];
+
+    XCTAssertEqualObjects(kPostHttpMethod, receivedMethod, @"method mismatch");
+    XCTAssertEqualObjects(@"1", receivedHeader, @"header mismatch");
+    XCTAssertEqualObjects(@{@"key":@"value"}, serializedBody, @"body should have gone through the body serializer");
+}
+
+- (void)test_that_http_request_sends_both_default_headers
+{
+    __block NSString *contentType = nil;
+    __block NSString *accept = nil;
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         contentType = [request valueForHTTPHeaderField:@"Content-Type"];
+         accept = [request valueForHTTPHeaderField:@"Accept"];
+         return [OHHTTPStubsResponse
+                 responseWithData:[@"{}" dataUsingEncoding:NSUTF8StringEncoding]
+                 statusCode:200
+                 headers:@{@"Content-Type":@"application/json"}];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          getAsync:_testUrl
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              [self blockTestCompletedWithBlock:nil];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:nil];
+          }];
+     }];
+
+    XCTAssertEqualObjects(kApplicationJsonContentType, contentType, @"the Content-Type default should have been sent");
+    XCTAssertEqualObjects(kApplicationJsonContentType, accept, @"the Accept default should have been sent");
+}
+
+- (void)test_that_http_request_header_templates_merge_by_host_and_base_url
+{
+    http_request_header_templates *templates = [http_request_header_templates new];
+    [templates setHeaders:@{@"X-Trace":@"host", @"Authorization":@"Bearer old"} forHost:@"API.example.com"];
+    [templates setHeaders:@{@"X-Trace":@"v1"} forBaseUrl:[NSURL URLWithString:@"https://api.example.com/v1/"]];
+
+    NSDictionary *headers = [templates headersForUrl:[NSURL URLWithString:@"https://api.example.com/v1/users?page=2"]];
+    XCTAssertEqualObjects(@"v1", headers[@"X-Trace"], @"the base URL template should have overridden the host one");
+    XCTAssertEqualObjects(@"Bearer old", headers[@"Authorization"], @"the host template should have applied");
+    XCTAssertTrue(headers == [templates headersForUrl:[NSURL URLWithString:@"https://api.example.com/v1/items"]],
+                  @"merged headers should have been cached");
+    XCTAssertEqualObjects(@"host", [templates headersForUrl:[NSURL URLWithString:@"https://api.example.com/v10"]][@"X-Trace"],
+                          @"base URLs should only match at a path boundary");
+    XCTAssertNil([templates headersForUrl:[NSURL URLWithString:@"https://other.example.com/v1"]], @"no template should apply");
+
+    [templates setValue:@"Bearer new" forHeader:@"Authorization" forHost:@"api.example.com"];
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:[NSURL URLWithString:@"https://api.example.com/v1/users"]];
+    [request setValue:@"request" forHTTPHeaderField:@"X-Trace"];
+    [templates applyToRequest:request];
+    XCTAssertEqualObjects(@"Bearer new", [request valueForHTTPHeaderField:@"Authorization"], @"the refreshed token should have applied");
+    XCTAssertEqualObjects(@"request", [request valueForHTTPHeaderField:@"X-Trace"], @"the request header should have taken precedence");
+}
+
+- (void)test_that_http_request_replays_recorded_traffic_without_the_network
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         NSData *responseData = [@"{\"key\": \"recorded\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [[OHHTTPStubsResponse
+                  responseWithData:responseData
+                  statusCode:200
+                  headers:@{@"Content-Type":@"application/json"}]
+                 requestTime:0.0 responseTime:0.2];
+     }];
+
+    NSURL *fileUrl = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]]];
+    NSError *error = nil;
+    http_request *httpRequest = [http_request new];
+    httpRequest.recorder = [[http_request_recorder alloc] initWithFileUrl:fileUrl error:&error];
+    XCTAssertNotNil(httpRequest.recorder, @"recorder should have opened the file: %@", error);
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          getAsync:_testUrl
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              [self blockTestCompletedWithBlock:nil];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:nil];
+          }];
+     }];
+
+    [httpRequest.recorder close];
+    http_request_recording *recording = [http_request_recording recordingWithContentsOfUrl:fileUrl error:&error];
+    XCTAssertEqual((NSUInteger)1, recording.count, @"one request should have been recorded: %@", error);
+    http_request_recording_entry *entry = [recording entryAtIndex:0];
+    XCTAssertEqualObjects(kGetHttpMethod, entry.method, @"method mismatch");
+    XCTAssertEqual((NSInteger)200, entry.statusCode, @"status code mismatch");
+    XCTAssertTrue(entry.duration >= 0.2, @"the network time should have been recorded");
+
+    [OHHTTPStubs removeAllStubs];
+    NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration defaultSessionConfiguration];
+    [http_request_replay_protocol addToConfiguration:configuration];
+    [http_request_replay_protocol startReplaying:recording withTimeScale:0];
+    http_request *replayingHttpRequest = [[http_request alloc] initWithConfiguration:configuration];
+    __block id replayedBody = nil;
+    [self
+     runTestWithBlock:^
+     {
+         [replayingHttpRequest
+          getAsync:_testUrl
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              replayedBody = body;
+              [self blockTestCompletedWithBlock:nil];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:nil];
+          }];
+     }];
+
+    [http_request_replay_protocol stopReplaying];
+    [[NSFileManager defaultManager] removeItemAtURL:fileUrl error:nil];
+    XCTAssertEqualObjects(@"recorded", replayedBody[@"key"], @"the recorded body should have been replayed");
+}
+
+- (void)test_that_http_request_recorder_drops_a_truncated_last_record
+{
+    NSURL *fileUrl = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]]];
+    NSError *error = nil;
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:_testUrl statusCode:200 HTTPVersion:@"HTTP/1.1" headerFields:@{}];
+    http_request_recorder *recorder = [[http_request_recorder alloc] initWithFileUrl:fileUrl error:&error];
+    [recorder
+     recordRequest:[NSURLRequest requestWithURL:_testUrl]
+     response:response
+     body:[@"{}" dataUsingEncoding:NSUTF8StringEncoding]
+     startTime:CFAbsoluteTimeGetCurrent()
+     duration:0.1];
+    [recorder close];
+
+    NSFileHandle *fileHandle = [NSFileHandle fileHandleForWritingToURL:fileUrl error:&error];
+    [fileHandle seekToEndOfFile];
+    [fileHandle writeData:[NSData dataWithBytes:"\x40\x00\x00\x00partial" length:11]];
+    [fileHandle closeFile];
+    XCTAssertEqual((NSUInteger)1, [http_request_recording recordingWithContentsOfUrl:fileUrl error:&error].count, @"the partial record should have been ignored");
+
+    recorder = [[http_request_recorder alloc] initWithFileUrl:fileUrl error:&error];
+    [recorder
+     recordRequest:[NSURLRequest requestWithURL:_testUrl]
+     response:response
+     body:nil
+     startTime:CFAbsoluteTimeGetCurrent()
+     duration:0.1];
+    [recorder close];
+    XCTAssertEqual((NSUInteger)2, [http_request_recording recordingWithContentsOfUrl:fileUrl error:&error].count, @"appending should have dropped the partial record");
+    [[NSFileManager defaultManager] removeItemAtURL:fileUrl error:nil];
+}
+
+- (void)test_that_http_request_circuit_breaker_fails_fast_once_the_circuit_opened
+{
+    __block NSUInteger requestCount = 0;
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         requestCount++;
+         return [OHHTTPStubsResponse
+                 responseWithData:[NSData data]
+                 statusCode:500
+                 headers:@{@"Content-Type":@"text/plain"}];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    httpRequest.circuitBreaker = [http_request_circuit_breaker new];
+    httpRequest.circuitBreaker.failureThreshold = 2;
+    void (^successCallback)(NSURLResponse *, id) = ^(NSURLResponse *response, id body)
+    {
+        [self blockTestCompletedWithBlock:^
+         {
+             XCTFail(@"success block should not have been called");
+         }];
+    };
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          getAsync:_testUrl
+          onSuccess:successCallback
+          onError:^(NSError *error)
+          {
+              [httpRequest
+               getAsync:_testUrl
+               onSuccess:successCallback
+               onError:^(NSError *error)
+               {
+                   [httpRequest
+                    getAsync:_testUrl
+                    onSuccess:successCallback
+                    onError:^(NSError *error)
+                    {
+                        [self blockTestCompletedWithBlock:^
+                         {
+                             XCTAssertEqualObjects(kHttpRequestDomain, error.domain, @"error domain mismatch");
+                             XCTAssertEqual((NSInteger)-7, error.code, @"error code did not equal -7");
+                             XCTAssertEqualObjects(@"www.langholz.net", error.userInfo[@"Route"], @"route mismatch");
+                         }];
+                    }];
+               }];
+          }];
+     }];
+
+    XCTAssertEqual((NSUInteger)2, requestCount, @"the request rejected by the open circuit should not have been sent");
+    XCTAssertEqual(http_request_circuit_state_open,
+                   [httpRequest.circuitBreaker stateForRoute:@"www.langholz.net"],
+                   @"the circuit should have been open");
+}
+
+- (void)test_that_http_request_circuit_breaker_closes_the_circuit_after_a_successful_probe
+{
+    __block NSUInteger requestCount = 0;
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         int statusCode = ++requestCount == 1 ? 503 : 200;
+         return [OHHTTPStubsResponse
+                 responseWithData:[NSData data]
+                 statusCode:statusCode
+                 headers:@{@"Content-Type":@"text/plain"}];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    httpRequest.circuitBreaker = [http_request_circuit_breaker new];
+    httpRequest.circuitBreaker.failureThreshold = 1;
+    httpRequest.circuitBreaker.openInterval = 0.2;
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          getAsync:_testUrl
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"success block should not have been called");
+               }];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:nil];
+          }];
+     }];
+
+    NSString *route = [httpRequest.circuitBreaker routeOfRequest:[NSURLRequest requestWithURL:_testUrl]];
+    XCTAssertEqual(http_request_circuit_state_open,
+                   [httpRequest.circuitBreaker stateForRoute:route],
+                   @"the circuit should have been open");
+    [NSThread sleepForTimeInterval:0.3];
+    XCTAssertEqual(http_request_circuit_state_half_open,
+                   [httpRequest.circuitBreaker stateForRoute:route],
+                   @"the circuit should have been half open");
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          getAsync:_testUrl
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              [self blockTestCompletedWithBlock:nil];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"error block should not have been called");
+               }];
+          }];
+     }];
+
+    XCTAssertEqual(http_request_circuit_state_closed,
+                   [httpRequest.circuitBreaker stateForRoute:route],
+                   @"the successful probe should have closed the circuit");
+    XCTAssertEqual((NSUInteger)0, [httpRequest.circuitBreaker inFlightCountForRoute:route], @"in flight count mismatch");
+}
+
+- (void)test_that_http_request_fails_at_the_deadline_across_retries_and_calls_error_block_once
+{
+    __block NSUInteger requestCount = 0;
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         requestCount++;
+         return [[OHHTTPStubsResponse
+                  responseWithData:[NSData data]
+                  statusCode:503
+                  headers:@{@"Content-Type":@"text/plain"}]
+                 requestTime:0.0 responseTime:0.1];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    httpRequest.retryPolicy = [http_request_retry_policy new];
+    httpRequest.retryPolicy.maxRetryCount = 100;
+    httpRequest.retryPolicy.baseDelay = 0.01;
+    httpRequest.retryPolicy.budget = nil;
+    NSMutableURLRequest *request = [http_request constructRequest:kGetHttpMethod withUrl:_testUrl withHeaders:nil withBody:nil];
+    [http_request setTimeout:0.5 forRequest:request];
+    __block NSUInteger callbackCount = 0;
+    __block NSError *deadlineError = nil;
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          issueAsync:request
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              callbackCount++;
+              [self blockTestCompletedWithBlock:nil];
+          }
+          onError:^(NSError *error)
+          {
+              callbackCount++;
+              deadlineError = error;
+              [self blockTestCompletedWithBlock:nil];
+          }];
+     }];
+
+    NSTimeInterval elapsedTime = CFAbsoluteTimeGetCurrent() - startTime;
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.3]];
+    XCTAssertEqual((NSUInteger)1, callbackCount, @"exactly one callback should have been called");
+    XCTAssertEqual((NSInteger)NSURLErrorTimedOut, deadlineError.code, @"error code did not equal NSURLErrorTimedOut");
+    XCTAssertTrue(elapsedTime < 1.0, @"the request should have failed at its deadline");
+    XCTAssertTrue(requestCount > 1, @"the request should have been retried until the deadline");
+}
+
+- (void)test_that_http_request_hedges_a_slow_request_and_cancels_the_loser
+{
+    __block NSUInteger requestCount = 0;
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         NSTimeInterval responseTime = ++requestCount == 1 ? 2.0 : 0.05;
+         NSData *responseData = [@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [[OHHTTPStubsResponse
+                  responseWithData:responseData
+                  statusCode:200
+                  headers:@{@"Content-Type":@"application/json"}]
+                 requestTime:0.0 responseTime:responseTime];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    httpRequest.hedgingPolicy = [http_request_hedging_policy new];
+    httpRequest.hedgingPolicy.minSampleCount = 1;
+    httpRequest.hedgingPolicy.budget = nil;
+    [httpRequest.hedgingPolicy recordLatency:0.1];
+    __block NSUInteger callbackCount = 0;
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          getAsync:_testUrl
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              callbackCount++;
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTAssertEqualObjects(@"value", body[@"key"], @"body mismatch");
+               }];
+          }
+          onError:^(NSError *error)
+          {
+              callbackCount++;
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"error block should not have been called");
+               }];
+          }];
+     }];
+
+    NSTimeInterval elapsedTime = CFAbsoluteTimeGetCurrent() - startTime;
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.3]];
+    XCTAssertEqual((NSUInteger)1, callbackCount, @"exactly one callback should have been called");
+    XCTAssertEqual((NSUInteger)2, requestCount, @"the slow request should have been hedged once");
+    XCTAssertEqual((NSUInteger)1, httpRequest.hedgingPolicy.hedgeCount, @"hedge count mismatch");
+    XCTAssertEqual((NSUInteger)1, httpRequest.hedgingPolicy.hedgeWinCount, @"hedge win count mismatch");
+    XCTAssertTrue(elapsedTime < 1.0, @"the hedge should have won over the slow request");
+}
+
+- (void)test_that_http_request_multipart_body_streams_its_parts_with_the_computed_length
+{
+    NSURL *fileUrl = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]]];
+    [[@"file content" dataUsingEncoding:NSUTF8StringEncoding] writeToURL:fileUrl atomically:YES];
+    http_request_multipart_body *multipartBody = [[http_request_multipart_body alloc] initWithBoundary:@"boundary"];
+    [multipartBody appendPartWithName:@"field" string:@"value"];
+    [multipartBody
+     appendPartWithName:@"data"
+     data:[@"data content" dataUsingEncoding:NSUTF8StringEncoding]
+     fileName:@"data.txt"
+     contentType:@"text/plain"];
+    NSError *error = nil;
+    XCTAssertTrue([multipartBody
+                   appendPartWithName:@"file"
+                   fileUrl:fileUrl
+                   fileName:nil
+                   contentType:nil
+                   error:&error],
+                  @"the file part should have been appended");
+    NSString *expectedBody = [@[@"--boundary",
+                                @"Content-Disposition: form-data; name=\"field\"",
+                                @"",
+                                @"value",
+                                @"--boundary",
+                                @"Content-Disposition: form-data; name=\"data\"; filename=\"data.txt\"",
+                                @"Content-Type: text/plain",
+                                @"",
+                                @"data content",
+                                @"--boundary",
+                                [NSString stringWithFormat:@"Content-Disposition: form-data; name=\"file\"; filename=\"%@\"",
+                                 [fileUrl lastPathComponent]],
+                                @"Content-Type: application/octet-stream",
+                                @"",
+                                @"file content",
+                                @"--boundary--",
+                                @""] componentsJoinedByString:@"\r\n"];
+    NSData *body = [self readStream:[multipartBody inputStream]];
+    XCTAssertEqualObjects(expectedBody, [[NSString alloc] initWithData:body encoding:NSUTF8StringEncoding], @"body mismatch");
+    XCTAssertEqual((int64_t)body.length, multipartBody.contentLength, @"content length mismatch");
+    XCTAssertTrue(multipartBody.repeatable, @"a body without stream parts should be repeatable");
+    XCTAssertEqualObjects(body, [self readStream:[multipartBody inputStream]], @"the body should read the same again");
+    XCTAssertNil([http_request serializeBody:multipartBody error:&error], @"the body should not have been buffered");
+    XCTAssertEqual((NSInteger)-1, error.code, @"error code did not equal -1");
+    [multipartBody
+     appendPartWithName:@"stream"
+     stream:[NSInputStream inputStreamWithData:[NSData data]]
+     length:-1
+     fileName:nil
+     contentType:nil];
+    XCTAssertTrue(multipartBody.contentLength < 0, @"a stream part of unknown length should make the length unknown");
+    [[NSFileManager defaultManager] removeItemAtURL:fileUrl error:nil];
+}
+
+- (void)test_that_http_request_postAsync_with_multipart_body_sets_its_headers_and_calls_success_block
+{
+    http_request_multipart_body *multipartBody = [http_request_multipart_body new];
+    [multipartBody appendPartWithName:@"field" string:@"value"];
+    [multipartBody
+     appendPartWithName:@"data"
+     data:[NSMutableData dataWithLength:256 * 1024]
+     fileName:@"data.bin"
+     contentType:nil];
+    NSString *expectedContentLength = [NSString stringWithFormat:@"%lld", multipartBody.contentLength];
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl]
+                && [multipartBody.contentType isEqualToString:[request valueForHTTPHeaderField:@"Content-Type"]]
+                && [expectedContentLength isEqualToString:[request valueForHTTPHeaderField:@"Content-Length"]];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         NSData *responseData = [@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [OHHTTPStubsResponse
+                 responseWithData:responseData
+                 statusCode:200
+                 headers:@{@"Content-Type":@"application/json"}];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          postAsync:_testUrl
+          withHeaders:nil
+          withMultipartBody:multipartBody
+          onProgress:nil
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTAssertEqual(200, ((NSHTTPURLResponse *)response).statusCode, @"status code did not equal 200");
+                   XCTAssertEqualObjects(@"value", body[@"key"], @"body mismatch");
+               }];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"error block should not have been called");
+               }];
+          }];
+     }];
+}
+
+- (void)test_that_http_request_continueDownloadAsync_reports_progress_of_a_replaced_file
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         return [OHHTTPStubsResponse
+                 responseWithData:[@"hello world" dataUsingEncoding:NSUTF8StringEncoding]
+                 statusCode:200
+                 headers:nil];
+     }];
+
+    NSURL *fileUrl = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"http_request_replaced.txt"]];
+    [[@"stale " dataUsingEncoding:NSUTF8StringEncoding] writeToURL:fileUrl atomically:YES];
+    __block int64_t lastWritten = 0;
+    http_request *httpRequest = [http_request new];
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          continueDownloadAsync:_testUrl
+          toFile:fileUrl
+          onProgress:^(int64_t written, int64_t expected)
+          {
+              lastWritten = written;
+          }
+          onSuccess:^(NSURLResponse *response, NSURL *downloadedUrl)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   NSString *content = [NSString stringWithContentsOfURL:fileUrl encoding:NSUTF8StringEncoding error:nil];
+                   XCTAssertEqualObjects(@"hello world", content, @"file content mismatch");
+                   XCTAssertEqual((int64_t)11, lastWritten, @"progress should not include the replaced part");
+               }];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"error block should not have been called");
+               }];
+          }];
+     }];
+
+    [[NSFileManager defaultManager] removeItemAtURL:fileUrl error:nil];
+}
+
+- (void)test_that_http_request_downloadAsync_falls_back_to_one_connection_when_ranges_are_ignored
+{
+    NSMutableData *content = [NSMutableData dataWithLength:kDefaultMinimumRangeLength * 2];
+    memset([content mutableBytes], 'a', content.length);
+    __block NSUInteger getCount = 0;
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         if ([request.HTTPMethod isEqualToString:@"GET"])
+         {
+             @synchronized(content)
+             {
+                 getCount++;
+             }
+         }
+
+         // Advertises ranges but answers every request with the whole content.
+         return [OHHTTPStubsResponse
+                 responseWithData:content
+                 statusCode:200
+                 headers:@{@"Accept-Ranges":@"bytes"}];
+     }];
+
+    NSURL *fileUrl = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"http_request_ranges.bin"]];
+    http_request *httpRequest = [http_request new];
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          downloadAsync:_testUrl
+          toFile:fileUrl
+          withConnections:2
+          onProgress:nil
+          onSuccess:^(NSURLResponse *response, NSURL *downloadedUrl)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   NSData *downloaded = [NSData dataWithContentsOfURL:fileUrl];
+                   XCTAssertEqualObjects(content, downloaded, @"file content mismatch");
+                   XCTAssertTrue(getCount >= 2, @"the whole content should have been fetched again");
+               }];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"error block should not have been called");
+               }];
+          }];
+     }];
+
+    [[NSFileManager defaultManager] removeItemAtURL:fileUrl error:nil];
+}
+
+- (void)test_that_http_request_issueAsync_leaves_the_request_of_the_caller_untouched
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         return [OHHTTPStubsResponse responseWithData:[NSData data] statusCode:204 headers:nil];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    httpRequest.requestContentEncoding = kGzipContentEncoding;
+    httpRequest.requestCompressionThreshold = 256;
+    [httpRequest.headerTemplates setHeaders:@{@"X-Template":@"value"} forHost:_testUrl.host];
+    NSMutableString *largeBody = [NSMutableString new];
+    while (largeBody.length < 1024)
+    {
+        [largeBody appendString:@"{\"key\": \"value\"}"];
+    }
+
+    NSData *body = [largeBody dataUsingEncoding:NSUTF8StringEncoding];
+    NSMutableURLRequest *request = [http_request constructRequest:kPostHttpMethod withUrl:_testUrl withHeaders:nil withBody:body];
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          issueAsync:request
+          withBodyParser:nil
+          withResponseValidation:nil
+          onSuccess:^(NSURLResponse *response, id responseBody)
+          {
+              [self blockTestCompletedWithBlock:nil];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"error block should not have been called");
+               }];
+          }];
+     }];
+
+    XCTAssertEqualObjects(body, request.HTTPBody, @"the body of the request should not have been compressed");
+    XCTAssertNil([request valueForHTTPHeaderField:@"Content-Encoding"], @"the request should not have been encoded");
+    XCTAssertNil([request valueForHTTPHeaderField:@"X-Template"], @"the templates should not have been applied to the request");
+
+    NSURL *fileUrl = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]]];
+    [body writeToURL:fileUrl atomically:YES];
+    NSMutableURLRequest *uploadRequest = [http_request constructRequest:kPutHttpMethod withUrl:_testUrl withHeaders:nil withBody:nil];
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          uploadAsync:uploadRequest
+          fromFile:fileUrl
+          onProgress:nil
+          onSuccess:^(NSURLResponse *response, id responseBody)
+          {
+              [self blockTestCompletedWithBlock:nil];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"error block should not have been called");
+               }];
+          }];
+     }];
+
+    XCTAssertNil([uploadRequest valueForHTTPHeaderField:@"X-Template"], @"the templates should not have been applied to the upload request");
+    NSMutableURLRequest *streamRequest = [http_request constructRequest:kGetHttpMethod withUrl:_testUrl withHeaders:nil withBody:nil];
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          streamAsync:streamRequest
+          onChunk:^(NSData *chunk)
+          {
+          }
+          onComplete:^(NSURLResponse *response)
+          {
+              [self blockTestCompletedWithBlock:nil];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"error block should not have been called");
+               }];
+          }];
+     }];
+
+    XCTAssertNil([streamRequest valueForHTTPHeaderField:@"X-Template"], @"the templates should not have been applied to the stream request");
+    NSMutableURLRequest *downloadRequest = [http_request constructRequest:kGetHttpMethod withUrl:_testUrl withHeaders:nil withBody:nil];
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          issueDownloadAsync:downloadRequest
+          toFile:fileUrl
+          atOffset:0
+          onProgress:nil
+          onSuccess:^(NSURLResponse *response, NSURL *file)
+          {
+              [self blockTestCompletedWithBlock:nil];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"error block should not have been called");
+               }];
+          }];
+     }];
+
+    XCTAssertNil([downloadRequest valueForHTTPHeaderField:@"X-Template"], @"the templates should not have been applied to the download request");
+    [[NSFileManager defaultManager] removeItemAtURL:fileUrl error:nil];
+}
+
+- (void)test_that_http_request_downloadAsync_with_connections_applies_the_header_templates
+{
+    NSMutableArray *authorizations = [NSMutableArray new];
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         @synchronized(authorizations)
+         {
+             NSString *authorization = [request valueForHTTPHeaderField:@"Authorization"];
+             [authorizations addObject:[NSString stringWithFormat:@"%@ %@", request.HTTPMethod, authorization ?: @"none"]];
+         }
+
+         return [OHHTTPStubsResponse
+                 responseWithData:[@"hello world" dataUsingEncoding:NSUTF8StringEncoding]
+                 statusCode:200
+                 headers:@{@"Accept-Ranges":@"bytes"}];
+     }];
+
+    NSURL *fileUrl = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"http_request_templates.txt"]];
+    http_request *httpRequest = [http_request new];
+    [httpRequest.headerTemplates setValue:@"Bearer token" forHeader:@"Authorization" forHost:_testUrl.host];
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          downloadAsync:_testUrl
+          toFile:fileUrl
+          withConnections:4
+          onProgress:nil
+          onSuccess:^(NSURLResponse *response, NSURL *downloadedUrl)
+          {
+              [self blockTestCompletedWithBlock:nil];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"error block should not have been called");
+               }];
+          }];
+     }];
+
+    NSArray *expectedAuthorizations = @[@"HEAD Bearer token", @"GET Bearer token"];
+    XCTAssertEqualObjects(expectedAuthorizations, authorizations, @"every request should have carried the template");
+    [[NSFileManager defaultManager] removeItemAtURL:fileUrl error:nil];
+}
+
+- (void)test_that_http_request_circuit_breaker_delivers_a_rejection_asynchronously
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         return [OHHTTPStubsResponse
+                 responseWithData:[NSData data]
+                 statusCode:503
+                 headers:@{@"Content-Type":@"text/plain"}];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    httpRequest.circuitBreaker = [http_request_circuit_breaker new];
+    httpRequest.circuitBreaker.failureThreshold = 1;
+    void (^successCallback)(NSURLResponse *, id) = ^(NSURLResponse *response, id body)
+    {
+        [self blockTestCompletedWithBlock:^
+         {
+             XCTFail(@"success block should not have been called");
+         }];
+    };
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          getAsync:_testUrl
+          onSuccess:successCallback
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:nil];
+          }];
+     }];
+
+    NSThread *issuingThread = [NSThread currentThread];
+    __block NSThread *callbackThread = nil;
+    __block NSError *rejectionError = nil;
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          getAsync:_testUrl
+          onSuccess:successCallback
+          onError:^(NSError *error)
+          {
+              callbackThread = [NSThread currentThread];
+              rejectionError = error;
+              [self blockTestCompletedWithBlock:nil];
+          }];
+     }];
+
+    XCTAssertEqual((NSInteger)-7, rejectionError.code, @"error code did not equal -7");
+    XCTAssertNotEqualObjects(issuingThread, callbackThread, @"the rejection should not have been delivered while issuing");
+}
+
+- (void)test_that_http_request_circuit_breaker_lets_only_the_probe_decide_a_half_open_circuit
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         // The slow request was admitted before the circuit opened and succeeds while the probe is in flight.
+         NSString *name = [request.URL lastPathComponent];
+         int statusCode = [name isEqualToString:@"slow"] ? 200 : 503;
+         NSTimeInterval responseTime = [name isEqualToString:@"slow"] ? 0.6 : ([name isEqualToString:@"probe"] ? 1.0 : 0.0);
+         return [[OHHTTPStubsResponse
+                  responseWithData:[NSData data]
+                  statusCode:statusCode
+                  headers:@{@"Content-Type":@"text/plain"}]
+                 requestTime:0.0 responseTime:responseTime];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    httpRequest.circuitBreaker = [http_request_circuit_breaker new];
+    httpRequest.circuitBreaker.failureThreshold = 1;
+    httpRequest.circuitBreaker.openInterval = 0.3;
+    NSString *route = [httpRequest.circuitBreaker routeOfRequest:[NSURLRequest requestWithURL:_testUrl]];
+    dispatch_semaphore_t slowCompleted = dispatch_semaphore_create(0);
+    dispatch_semaphore_t failCompleted = dispatch_semaphore_create(0);
+    dispatch_semaphore_t probeCompleted = dispatch_semaphore_create(0);
+    for (NSString *name in @[@"slow", @"fail"])
+    {
+        dispatch_semaphore_t completed = [name isEqualToString:@"slow"] ? slowCompleted : failCompleted;
+        [httpRequest
+         getAsync:[_testUrl URLByAppendingPathComponent:name]
+         onSuccess:^(NSURLResponse *response, id body)
+         {
+             dispatch_semaphore_signal(completed);
+         }
+         onError:^(NSError *error)
+         {
+             dispatch_semaphore_signal(completed);
+         }];
+    }
+
+    dispatch_semaphore_wait(failCompleted, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC));
+    [NSThread sleepForTimeInterval:0.4];
+    [httpRequest
+     getAsync:[_testUrl URLByAppendingPathComponent:@"probe"]
+     onSuccess:^(NSURLResponse *response, id body)
+     {
+         dispatch_semaphore_signal(probeCompleted);
+     }
+     onError:^(NSError *error)
+     {
+         dispatch_semaphore_signal(probeCompleted);
+     }];
+
+    dispatch_semaphore_wait(slowCompleted, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC));
+    XCTAssertEqual(http_request_circuit_state_half_open,
+                   [httpRequest.circuitBreaker stateForRoute:route],
+                   @"a request admitted before the circuit opened should not have closed it");
+    dispatch_semaphore_wait(probeCompleted, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC));
+    XCTAssertEqual(http_request_circuit_state_open,
+                   [httpRequest.circuitBreaker stateForRoute:route],
+                   @"the failed probe should have opened the circuit again");
+}
+
+- (void)test_that_http_request_postFuture_streams_a_multipart_body
+{
+    http_request_multipart_body *multipartBody = [http_request_multipart_body new];
+    [multipartBody appendPartWithName:@"field" string:@"value"];
+    [multipartBody
+     appendPartWithName:@"stream"
+     stream:[NSInputStream inputStreamWithData:[NSMutableData dataWithLength:64 * 1024]]
+     length:-1
+     fileName:@"stream.bin"
+     contentType:nil];
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl]
+                && [multipartBody.contentType isEqualToString:[request valueForHTTPHeaderField:@"Content-Type"]];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         NSData *responseData = [@"{\"key\": \"value\"}" dataUsingEncoding:NSUTF8StringEncoding];
+         return [OHHTTPStubsResponse
+                 responseWithData:responseData
+                 statusCode:200
+                 headers:@{@"Content-Type":@"application/json"}];
+     }];
+
+    http_request *httpRequest = [http_request new];
+    http_request_future *future = [httpRequest postFuture:_testUrl withHeaders:nil withBody:multipartBody];
+    NSError *error = nil;
+    id body = [future waitWithTimeout:10 error:&error];
+    XCTAssertNil(error, @"error should have been nil");
+    XCTAssertEqualObjects(@"value", body[@"key"], @"body mismatch");
+}
+
+- (void)test_that_http_request_postAsync_with_multipart_body_fails_when_a_part_cannot_be_read
+{
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         return [OHHTTPStubsResponse responseWithData:[NSData data] statusCode:200 headers:nil];
+     }];
+
+    NSURL *fileUrl = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]]];
+    [[@"file content" dataUsingEncoding:NSUTF8StringEncoding] writeToURL:fileUrl atomically:YES];
+    http_request_multipart_body *multipartBody = [http_request_multipart_body new];
+    [multipartBody appendPartWithName:@"field" string:@"value"];
+    NSError *appendError = nil;
+    [multipartBody appendPartWithName:@"file" fileUrl:fileUrl fileName:nil contentType:nil error:&appendError];
+    [[NSFileManager defaultManager] removeItemAtURL:fileUrl error:nil];
+    http_request *httpRequest = [http_request new];
+    __block NSError *uploadError = nil;
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          postAsync:_testUrl
+          withHeaders:nil
+          withMultipartBody:multipartBody
+          onProgress:nil
+          onSuccess:^(NSURLResponse *response, id body)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"success block should not have been called");
+               }];
+          }
+          onError:^(NSError *error)
+          {
+              uploadError = error;
+              [self blockTestCompletedWithBlock:nil];
+          }];
+     }];
+
+    XCTAssertNotNil(uploadError, @"error should not have been nil");
+    XCTAssertNotEqual((NSInteger)NSURLErrorCancelled, uploadError.code, @"the error of the part should have been reported");
+}
+
+- (void)test_that_http_request_downloadAsync_with_zero_connections_downloads_over_one_connection
+{
+    NSMutableData *content = [NSMutableData dataWithLength:kDefaultMinimumRangeLength * 2];
+    memset([content mutableBytes], 'b', content.length);
+    [OHHTTPStubs
+     stubRequestsPassingTest:^BOOL(NSURLRequest *request)
+     {
+         NSString *url = [[request.URL absoluteString] lowercaseString];
+         return [url hasPrefix:kTestUrl];
+     }
+     withStubResponse:^OHHTTPStubsResponse*(NSURLRequest *request)
+     {
+         return [OHHTTPStubsResponse
+                 responseWithData:content
+                 statusCode:200
+                 headers:@{@"Accept-Ranges":@"bytes"}];
+     }];
+
+    NSURL *fileUrl = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:@"http_request_no_connections.bin"]];
+    http_request *httpRequest = [http_request new];
+    [self
+     runTestWithBlock:^
+     {
+         [httpRequest
+          downloadAsync:_testUrl
+          toFile:fileUrl
+          withConnections:0
+          onProgress:nil
+          onSuccess:^(NSURLResponse *response, NSURL *downloadedUrl)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTAssertEqualObjects(content, [NSData dataWithContentsOfURL:fileUrl], @"file content mismatch");
+               }];
+          }
+          onError:^(NSError *error)
+          {
+              [self blockTestCompletedWithBlock:^
+               {
+                   XCTFail(@"error block should not have been called");
+               }];
+          }];
+     }];
+
+    [[NSFileManager defaultManager] removeItemAtURL:fileUrl error:nil];
+}
+
 @end
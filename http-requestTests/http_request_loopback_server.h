@@ -0,0 +1,61 @@
+//
+//  http_request_loopback_server.h
+//  http-requestTests
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ *  http_request_loopback_server is a minimal in-process HTTP/1.1 server listening on 127.0.0.1, used to drive the
+ *  request pipeline through real sockets without leaving the machine.
+ *
+ *  GET /payload?size=<bytes>&type=<json|text|binary> responds with a pre-generated body of the requested size and type.
+ *  Any other request has its body read and discarded, and is answered with {"received": <bytes>}.
+ */
+@interface http_request_loopback_server : NSObject
+
+/**
+ *  The port the server is listening on; zero until started.
+ */
+@property (readonly) uint16_t port;
+
+/**
+ *  The number of requests received in full so far, counted before they are answered.
+ */
+@property (readonly) NSUInteger requestCount;
+
+/**
+ *  Starts listening on an ephemeral loopback port.
+ *
+ *  @param error The error, if any. Must not be nil.
+ *
+ *  @return YES if the server started; otherwise, NO.
+ */
+- (BOOL)start:(NSError *__autoreleasing *)error;
+
+/**
+ *  Stops listening. Connections in progress are closed once their current request was answered.
+ */
+- (void)stop;
+
+/**
+ *  Constructs the URL of the payload endpoint.
+ *
+ *  @param size The size of the payload in bytes.
+ *  @param type The type of the payload: json, text or binary. Must not be nil.
+ *
+ *  @return The URL.
+ */
+- (NSURL *)payloadUrlWithSize:(NSUInteger)size type:(NSString *)type;
+
+/**
+ *  Constructs the URL of the endpoint which consumes request bodies.
+ *
+ *  @return The URL.
+ */
+- (NSURL *)uploadUrl;
+
+@end
@@ -0,0 +1,362 @@
+//
+//  http_request_loopback_server.m
+//  http-requestTests
+//
+//  Created by Elmar Langholz on 4/10/14.
+//  Copyright (c) 2014 Elmar Langholz. All rights reserved.
+//
+
+#import "http_request_loopback_server.h"
+#import <arpa/inet.h>
+#import <netinet/in.h>
+#import <sys/socket.h>
+#import <unistd.h>
+
+#define kLoopbackReadChunkSize          (64 * 1024)
+#define kLoopbackServerDomain           @"http_request_loopback_server"
+
+@interface http_request_loopback_server()
+{
+    int _socket;
+    dispatch_source_t _acceptSource;
+    dispatch_queue_t _connectionQueue;
+    NSMutableDictionary *_payloads;
+    volatile BOOL _running;
+}
+
++ (NSData *)generatePayloadWithSize:(NSUInteger)size type:(NSString *)type;
++ (NSDictionary *)parseQuery:(NSString *)query;
++ (BOOL)writeData:(NSData *)data toConnection:(int)connection;
+
+- (NSData *)payloadWithSize:(NSUInteger)size type:(NSString *)type;
+- (void)acceptConnection;
+- (void)serveConnection:(int)connection;
+
+@end
+
+@implementation http_request_loopback_server
+
+#pragma mark - Public API
+
+- (BOOL)start:(NSError *__autoreleasing *)error
+{
+    *error = nil;
+    _socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    int reuse = 1;
+    setsockopt(_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_len = sizeof(address);
+    address.sin_family = AF_INET;
+    address.sin_port = 0;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addressLength = sizeof(address);
+    if (_socket < 0
+        || bind(_socket, (struct sockaddr *)&address, sizeof(address)) != 0
+        || listen(_socket, SOMAXCONN) != 0
+        || getsockname(_socket, (struct sockaddr *)&address, &addressLength) != 0)
+    {
+        *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+        if (_socket >= 0)
+        {
+            close(_socket);
+        }
+
+        return NO;
+    }
+
+    _port = ntohs(address.sin_port);
+    _running = YES;
+    _acceptSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_READ, _socket, 0, _connectionQueue);
+    int listeningSocket = _socket;
+    __weak http_request_loopback_server *weakSelf = self;
+    dispatch_source_set_event_handler(_acceptSource, ^
+    {
+        [weakSelf acceptConnection];
+    });
+    dispatch_source_set_cancel_handler(_acceptSource, ^
+    {
+        close(listeningSocket);
+    });
+    dispatch_resume(_acceptSource);
+    return YES;
+}
+
+- (void)stop
+{
+    if (_running)
+    {
+        _running = NO;
+        dispatch_source_cancel(_acceptSource);
+        _acceptSource = nil;
+        _port = 0;
+    }
+}
+
+- (NSURL *)payloadUrlWithSize:(NSUInteger)size type:(NSString *)type
+{
+    NSString *url = [NSString stringWithFormat:@"http://127.0.0.1:%u/payload?size=%lu&type=%@", _port, (unsigned long)size, type];
+    return [NSURL URLWithString:url];
+}
+
+- (NSURL *)uploadUrl
+{
+    return [NSURL URLWithString:[NSString stringWithFormat:@"http://127.0.0.1:%u/upload", _port]];
+}
+
+#pragma mark - Internal API
+
++ (NSData *)generatePayloadWithSize:(NSUInteger)size type:(NSString *)type
+{
+    NSMutableData *payload = [NSMutableData dataWithCapacity:size];
+    if ([type isEqualToString:@"binary"])
+    {
+        [payload setLength:size];
+        arc4random_buf(payload.mutableBytes, size);
+    }
+    else if ([type isEqualToString:@"json"])
+    {
+        // An array of records padded with whitespace up to the exact size.
+        [payload appendBytes:"[" length:1];
+        NSUInteger index = 0;
+        while (YES)
+        {
+            NSString *record = [NSString
+                                stringWithFormat:@"%@{\"id\":%lu,\"name\":\"record %lu\",\"active\":true}",
+                                index > 0 ? @"," : @"",
+                                (unsigned long)index,
+                                (unsigned long)index];
+            NSData *recordData = [record dataUsingEncoding:NSUTF8StringEncoding];
+            if (payload.length + recordData.length + 1 > size)
+            {
+                break;
+            }
+
+            [payload appendData:recordData];
+            index++;
+        }
+
+        [payload appendBytes:"]" length:1];
+        while (payload.length < size)
+        {
+            [payload appendBytes:" " length:1];
+        }
+    }
+    else
+    {
+        const char *text = "Lorem ipsum dolor sit amet, consectetur adipiscing elit. ";
+        NSUInteger textLength = strlen(text);
+        while (payload.length < size)
+        {
+            [payload appendBytes:text length:MIN(textLength, size - payload.length)];
+        }
+    }
+
+    return payload;
+}
+
++ (NSDictionary *)parseQuery:(NSString *)query
+{
+    NSMutableDictionary *parameters = [NSMutableDictionary new];
+    for (NSString *pair in [query componentsSeparatedByString:@"&"])
+    {
+        NSArray *components = [pair componentsSeparatedByString:@"="];
+        if (components.count == 2)
+        {
+            [parameters setObject:components[1] forKey:components[0]];
+        }
+    }
+
+    return parameters;
+}
+
++ (BOOL)writeData:(NSData *)data toConnection:(int)connection
+{
+    const char *bytes = data.bytes;
+    NSUInteger written = 0;
+    while (written < data.length)
+    {
+        ssize_t count = send(connection, bytes + written, data.length - written, 0);
+        if (count <= 0)
+        {
+            return NO;
+        }
+
+        written += count;
+    }
+
+    return YES;
+}
+
+- (NSData *)payloadWithSize:(NSUInteger)size type:(NSString *)type
+{
+    NSString *key = [NSString stringWithFormat:@"%@ %lu", type, (unsigned long)size];
+    @synchronized(_payloads)
+    {
+        NSData *payload = [_payloads objectForKey:key];
+        if (!payload)
+        {
+            payload = [http_request_loopback_server generatePayloadWithSize:size type:type];
+            [_payloads setObject:payload forKey:key];
+        }
+
+        return payload;
+    }
+}
+
+- (void)acceptConnection
+{
+    int connection = accept(_socket, NULL, NULL);
+    if (connection < 0)
+    {
+        return;
+    }
+
+    int noSigPipe = 1;
+    setsockopt(connection, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^
+    {
+        [self serveConnection:connection];
+    });
+}
+
+- (void)serveConnection:(int)connection
+{
+    NSMutableData *buffer = [NSMutableData new];
+    char *chunk = malloc(kLoopbackReadChunkSize);
+    NSData *headerTerminator = [@"\r\n\r\n" dataUsingEncoding:NSASCIIStringEncoding];
+    BOOL keepAlive = YES;
+    while (keepAlive && _running)
+    {
+        NSRange headerEnd = NSMakeRange(NSNotFound, 0);
+        while ((headerEnd = [buffer rangeOfData:headerTerminator options:0 range:NSMakeRange(0, buffer.length)]).location == NSNotFound)
+        {
+            ssize_t count = recv(connection, chunk, kLoopbackReadChunkSize, 0);
+            if (count <= 0)
+            {
+                keepAlive = NO;
+                break;
+            }
+
+            [buffer appendBytes:chunk length:count];
+        }
+
+        if (!keepAlive)
+        {
+            break;
+        }
+
+        NSUInteger headerLength = NSMaxRange(headerEnd);
+        NSString *header = [[NSString alloc]
+                            initWithBytes:buffer.bytes
+                            length:headerEnd.location
+                            encoding:NSISOLatin1StringEncoding];
+        NSArray *lines = [header componentsSeparatedByString:@"\r\n"];
+        NSArray *requestLine = [lines[0] componentsSeparatedByString:@" "];
+        NSString *method = requestLine.count > 0 ? requestLine[0] : @"";
+        NSString *target = requestLine.count > 1 ? requestLine[1] : @"/";
+        unsigned long long contentLength = 0;
+        for (NSString *line in lines)
+        {
+            NSRange separator = [line rangeOfString:@":"];
+            if (separator.location == NSNotFound)
+            {
+                continue;
+            }
+
+            NSString *name = [[line substringToIndex:separator.location] lowercaseString];
+            NSString *value = [[line substringFromIndex:separator.location + 1]
+                               stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+            if ([name isEqualToString:@"content-length"])
+            {
+                contentLength = strtoull([value UTF8String], NULL, 10);
+            }
+            else if ([name isEqualToString:@"connection"] && [value caseInsensitiveCompare:@"close"] == NSOrderedSame)
+            {
+                keepAlive = NO;
+            }
+        }
+
+        // Consume the body without retaining it.
+        unsigned long long buffered = MIN(contentLength, (unsigned long long)(buffer.length - headerLength));
+        unsigned long long remaining = contentLength - buffered;
+        [buffer replaceBytesInRange:NSMakeRange(0, headerLength + (NSUInteger)buffered) withBytes:NULL length:0];
+        while (remaining > 0)
+        {
+            ssize_t count = recv(connection, chunk, (size_t)MIN(remaining, (unsigned long long)kLoopbackReadChunkSize), 0);
+            if (count <= 0)
+            {
+                keepAlive = NO;
+                break;
+            }
+
+            remaining -= count;
+        }
+
+        if (remaining > 0)
+        {
+            break;
+        }
+
+        // Counted before responding, so that a client which got the response always sees its request counted.
+        @synchronized(self)
+        {
+            _requestCount++;
+        }
+
+        NSData *body = nil;
+        NSString *contentType = @"application/json";
+        NSRange queryStart = [target rangeOfString:@"?"];
+        NSString *path = queryStart.location == NSNotFound ? target : [target substringToIndex:queryStart.location];
+        if ([method isEqualToString:@"GET"] && [path isEqualToString:@"/payload"])
+        {
+            NSDictionary *parameters = [http_request_loopback_server parseQuery:[target substringFromIndex:queryStart.location + 1]];
+            NSString *type = parameters[@"type"] ?: @"json";
+            body = [self payloadWithSize:(NSUInteger)[parameters[@"size"] longLongValue] type:type];
+            contentType = [type isEqualToString:@"binary"]
+                          ? @"application/octet-stream"
+                          : [type isEqualToString:@"text"] ? @"text/plain; charset=utf-8" : @"application/json";
+        }
+        else
+        {
+            body = [[NSString stringWithFormat:@"{\"received\": %llu}", contentLength] dataUsingEncoding:NSUTF8StringEncoding];
+        }
+
+        NSString *responseHeader = [NSString
+                                    stringWithFormat:@"HTTP/1.1 200 OK\r\nContent-Type: %@\r\nContent-Length: %lu\r\nConnection: %@\r\n\r\n",
+                                    contentType,
+                                    (unsigned long)body.length,
+                                    keepAlive ? @"keep-alive" : @"close"];
+        if (![http_request_loopback_server writeData:[responseHeader dataUsingEncoding:NSASCIIStringEncoding] toConnection:connection]
+            || ![http_request_loopback_server writeData:body toConnection:connection])
+        {
+            break;
+        }
+    }
+
+    free(chunk);
+    close(connection);
+}
+
+#pragma mark - Initialization
+
+- (id)init
+{
+    self = [super init];
+    if (self)
+    {
+        _socket = -1;
+        _connectionQueue = dispatch_queue_create("http-request.loopback-server", DISPATCH_QUEUE_SERIAL);
+        _payloads = [NSMutableDictionary new];
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    [self stop];
+}
+
+@end